@@ -0,0 +1,256 @@
+/* Copyright (c) 2022 Hygon Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Microbenchmark of the SM2 verifications done by the csv verifier, over a CEK, a PEK
+ * and an attestation report signed here with keys of our own.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/core_names.h>
+#include "hygoncert.h"
+
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+#error "OpenSSL 3.0 or later is required to sign with SM2"
+#endif
+
+#define BENCH_ROUNDS	     5
+#define BENCH_DEFAULT_ITERS  200
+#define BENCH_CEK_USERID     "HYGON-SSD-CEK"
+#define BENCH_PEK_USERID     "HYGON-SSD-PEK"
+#define BENCH_SM2_POINT_SIZE 32
+
+static csv_cert_t cek_cert;
+static csv_attestation_report report;
+static hygon_sm2_key_t *cek_key;
+
+/* Hygon certs hold the coordinates in little endian */
+static void bn_to_hygon(const BIGNUM *bn, uint8_t *out)
+{
+	uint8_t be[BENCH_SM2_POINT_SIZE];
+
+	BN_bn2binpad(bn, be, sizeof(be));
+	for (int i = 0; i < BENCH_SM2_POINT_SIZE; i++)
+		out[i] = be[BENCH_SM2_POINT_SIZE - 1 - i];
+}
+
+static EVP_PKEY *sm2_keygen(hygon_csv_pubkey_t *pubkey, const char *userid)
+{
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new_from_name(NULL, "SM2", NULL);
+	EVP_PKEY *pkey = NULL;
+	BIGNUM *x = NULL, *y = NULL;
+
+	if (!ctx || EVP_PKEY_keygen_init(ctx) != 1 || EVP_PKEY_generate(ctx, &pkey) != 1 ||
+	    !EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_EC_PUB_X, &x) ||
+	    !EVP_PKEY_get_bn_param(pkey, OSSL_PKEY_PARAM_EC_PUB_Y, &y)) {
+		fprintf(stderr, "failed to generate SM2 key\n");
+		exit(EXIT_FAILURE);
+	}
+
+	pubkey->curve_id = 3;
+	bn_to_hygon(x, pubkey->qx);
+	bn_to_hygon(y, pubkey->qy);
+	pubkey->uid_len = strlen(userid);
+	memcpy(pubkey->uid, userid, pubkey->uid_len);
+
+	BN_free(x);
+	BN_free(y);
+	EVP_PKEY_CTX_free(ctx);
+
+	return pkey;
+}
+
+static void sm2_sign(EVP_PKEY *pkey, const char *userid, const void *msg, size_t msg_len,
+		     uint8_t *r, uint8_t *s)
+{
+	EVP_MD_CTX *md_ctx = EVP_MD_CTX_new();
+	EVP_PKEY_CTX *ctx = EVP_PKEY_CTX_new(pkey, NULL);
+	uint8_t der[128];
+	size_t der_len = sizeof(der);
+
+	if (!md_ctx || !ctx || EVP_PKEY_CTX_set1_id(ctx, userid, strlen(userid)) != 1) {
+		fprintf(stderr, "failed to prepare SM2 signing\n");
+		exit(EXIT_FAILURE);
+	}
+	EVP_MD_CTX_set_pkey_ctx(md_ctx, ctx);
+
+	if (EVP_DigestSignInit(md_ctx, NULL, EVP_sm3(), NULL, pkey) != 1 ||
+	    EVP_DigestSign(md_ctx, der, &der_len, msg, msg_len) != 1) {
+		fprintf(stderr, "failed to sign with SM2\n");
+		exit(EXIT_FAILURE);
+	}
+
+	const uint8_t *p = der;
+	ECDSA_SIG *sig = d2i_ECDSA_SIG(NULL, &p, der_len);
+	bn_to_hygon(ECDSA_SIG_get0_r(sig), r);
+	bn_to_hygon(ECDSA_SIG_get0_s(sig), s);
+
+	ECDSA_SIG_free(sig);
+	EVP_MD_CTX_free(md_ctx);
+	EVP_PKEY_CTX_free(ctx);
+}
+
+static void setup(void)
+{
+	csv_cert_t *pek_cert = (csv_cert_t *)report.pek_cert;
+
+	EVP_PKEY *cek = sm2_keygen(&cek_cert.sm2_pubkey, BENCH_CEK_USERID);
+	cek_cert.pubkey_usage = KEY_USAGE_TYPE_CEK;
+
+	EVP_PKEY *pek = sm2_keygen(&pek_cert->sm2_pubkey, BENCH_PEK_USERID);
+	pek_cert->pubkey_usage = KEY_USAGE_TYPE_PEK;
+	pek_cert->sig1_usage = KEY_USAGE_TYPE_CEK;
+	sm2_sign(cek, BENCH_CEK_USERID, pek_cert, 16 + 1028, pek_cert->ecc_sig1.r,
+		 pek_cert->ecc_sig1.s);
+
+	memset(report.user_data, 0xa5, sizeof(report.user_data));
+	sm2_sign(pek, BENCH_PEK_USERID, (uint8_t *)&report + CSV_ATTESTATION_REPORT_SIGN_DATA_OFFSET,
+		 CSV_ATTESTATION_REPORT_SIGN_DATA_SIZE, report.ecc_sig1.r, report.ecc_sig1.s);
+
+	EVP_PKEY_free(cek);
+	EVP_PKEY_free(pek);
+
+	cek_key = hygon_sm2_key_new((hygon_pubkey_t *)&cek_cert.sm2_pubkey);
+	if (!cek_key) {
+		fprintf(stderr, "failed to prepare CEK\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static int bench_key_new(void)
+{
+	hygon_sm2_key_t *key = hygon_sm2_key_new((hygon_pubkey_t *)&cek_cert.sm2_pubkey);
+
+	hygon_sm2_key_free(key);
+
+	return key ? 1 : 0;
+}
+
+static int bench_pek_cert(void)
+{
+	return verify_pek_cert(&cek_cert, (csv_cert_t *)report.pek_cert);
+}
+
+static int bench_pek_cert_by_key(void)
+{
+	return verify_pek_cert_by_key(cek_key, (csv_cert_t *)report.pek_cert);
+}
+
+static int bench_report(void)
+{
+	return sm2_verify_attestation_report((csv_cert_t *)report.pek_cert, &report);
+}
+
+static int bench_handshake(void)
+{
+	if (bench_pek_cert_by_key() != 1)
+		return 0;
+
+	return bench_report();
+}
+
+/* The verifications must accept the signatures made here, and reject them once
+ * the signed data is tampered with, whichever SM2 implementation is built in.
+ */
+static void check(void)
+{
+	csv_cert_t *pek_cert = (csv_cert_t *)report.pek_cert;
+	int failed = 0;
+
+	if (verify_pek_cert(&cek_cert, pek_cert) != 1 || bench_pek_cert_by_key() != 1) {
+		fprintf(stderr, "valid PEK cert rejected\n");
+		failed = 1;
+	}
+	if (bench_report() != 1) {
+		fprintf(stderr, "valid attestation report rejected\n");
+		failed = 1;
+	}
+
+	pek_cert->sm2_pubkey.qx[0] ^= 1;
+	if (verify_pek_cert(&cek_cert, pek_cert) == 1 || bench_pek_cert_by_key() == 1) {
+		fprintf(stderr, "tampered PEK cert accepted\n");
+		failed = 1;
+	}
+	pek_cert->sm2_pubkey.qx[0] ^= 1;
+
+	report.user_data[0] ^= 1;
+	if (bench_report() == 1) {
+		fprintf(stderr, "tampered attestation report accepted\n");
+		failed = 1;
+	}
+	report.user_data[0] ^= 1;
+
+	report.ecc_sig1.s[0] ^= 1;
+	if (bench_report() == 1) {
+		fprintf(stderr, "tampered report signature accepted\n");
+		failed = 1;
+	}
+	report.ecc_sig1.s[0] ^= 1;
+
+	if (failed)
+		exit(EXIT_FAILURE);
+
+	printf("SM2 verification check passed\n");
+}
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* Report the best of a few rounds, the least disturbed by the rest of the system */
+static void run(const char *name, int (*fn)(void), int iters)
+{
+	double best = 0;
+
+	for (int round = 0; round < BENCH_ROUNDS; round++) {
+		double start = now_us();
+
+		for (int i = 0; i < iters; i++) {
+			if (fn() != 1) {
+				fprintf(stderr, "%s failed\n", name);
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		double elapsed = (now_us() - start) / iters;
+		if (!round || elapsed < best)
+			best = elapsed;
+	}
+
+	printf("%-28s %10.1f us/op %10.0f op/s\n", name, best, 1e6 / best);
+}
+
+int main(int argc, char **argv)
+{
+	int iters = argc > 1 ? atoi(argv[1]) : BENCH_DEFAULT_ITERS;
+
+	if (iters <= 0) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	setup();
+	check();
+
+	run("hygon_sm2_key_new", bench_key_new, iters);
+	run("verify_pek_cert", bench_pek_cert, iters);
+	run("verify_pek_cert_by_key", bench_pek_cert_by_key, iters);
+	run("verify_attestation_report", bench_report, iters);
+	run("handshake (cached CEK)", bench_handshake, iters);
+
+	hygon_sm2_key_free(cek_key);
+
+	return EXIT_SUCCESS;
+}
@@ -2,6 +2,14 @@
 include(CMakeParseArguments)
 include(FindSGXSSL)
 
+# The ocalls on the network and time paths of the enclave are imported from
+# rtls_syscalls_io.edl, declared either as regular or as switchless ocalls.
+if(SGX_SWITCHLESS)
+    get_filename_component(RTLS_SYSCALLS_IO_EDL_PATH ${CMAKE_CURRENT_LIST_DIR}/../src/include/edl/switchless ABSOLUTE)
+else()
+    get_filename_component(RTLS_SYSCALLS_IO_EDL_PATH ${CMAKE_CURRENT_LIST_DIR}/../src/include/edl/ocall ABSOLUTE)
+endif()
+
 # Build edl to *_t.h and *_t.c.
 # Default not support mutiple edl which cause repeated definition for sgx edl common structure.
 # So need import all in one edl file for building.
@@ -27,6 +35,7 @@ function(build_edl_trust target)
             get_filename_component(ABSPATH ${path} ABSOLUTE)
             list(APPEND SEARCH_PATHS "${ABSPATH}")
         endforeach()
+        list(APPEND SEARCH_PATHS "${RTLS_SYSCALLS_IO_EDL_PATH}")
         list(APPEND SEARCH_PATHS "${SGX_PATH}/include")
         string(REPLACE ";" ":" SEARCH_PATHS "${SEARCH_PATHS}")
 
@@ -72,6 +81,7 @@ function(build_edl_untrust target)
             get_filename_component(ABSPATH ${path} ABSOLUTE)
             list(APPEND SEARCH_PATHS "${ABSPATH}")
         endforeach()
+        list(APPEND SEARCH_PATHS "${RTLS_SYSCALLS_IO_EDL_PATH}")
         list(APPEND SEARCH_PATHS "${SGX_PATH}/include")
         string(REPLACE ";" ":" SEARCH_PATHS "${SEARCH_PATHS}")
 
@@ -168,6 +178,9 @@ function(add_enclave_library target)
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,-z,noexecstack -Wl,-z,relro -Wl,-z,now -pie")
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,--whole-archive ${TLIB_LIST} -l${SGX_TRTS_LIB} -Wl,--no-whole-archive")
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,--whole-archive -lsgx_tsgxssl -Wl,--no-whole-archive")
+    if(SGX_SWITCHLESS)
+        set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,--whole-archive -lsgx_tswitchless -Wl,--no-whole-archive")
+    endif()
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,--start-group -lsgx_tstdc -lsgx_pthread -lsgx_tcxx -lsgx_tkey_exchange -lsgx_tcrypto -lsgx_trts -lsgx_tservice -lsgx_tsgxssl_crypto -lsgx_tsgxssl_ssl -l${SGX_TSVC_LIB} -l${SGX_DCAP_TVL} -Wl,--end-group")
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,-Bstatic -Wl,-Bsymbolic -Wl,--no-undefined")
     set(ENCLAVE_LINK_FLAGS "${ENCLAVE_LINK_FLAGS} -Wl,-pie,-eenclave_entry -Wl,--export-dynamic")
@@ -260,6 +273,9 @@ function(add_untrusted_library target mode)
     endif()
 
     set(UNTRUSTED_LINK_FLAGS "-L${SGX_LIBRARY_PATH} -l${SGX_URTS_LIB} -l${SGX_USVC_LIB} -l${SGX_DACP_QL} -l${SGX_DACP_QUOTEVERIFY} -lsgx_ukey_exchange -L${INTEL_SGXSSL_LIB} -lsgx_usgxssl")
+    if(SGX_SWITCHLESS)
+        set(UNTRUSTED_LINK_FLAGS "${UNTRUSTED_LINK_FLAGS} -lsgx_uswitchless")
+    endif()
 
     set_target_properties(${target} PROPERTIES COMPILE_FLAGS ${APP_C_FLAGS})
     target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR} ${APP_INCLUDES})
@@ -300,6 +316,9 @@ function(add_untrusted_executable target)
     endforeach()
 
     set(UNTRUSTED_LINK_FLAGS "-L${SGX_LIBRARY_PATH} ${ULIB_LIST} -l${SGX_URTS_LIB} -l${SGX_USVC_LIB} -l${SGX_DACP_QL} -l${SGX_DACP_QUOTEVERIFY} -lsgx_ukey_exchange -L${INTEL_SGXSSL_LIB} -lsgx_usgxssl")
+    if(SGX_SWITCHLESS)
+        set(UNTRUSTED_LINK_FLAGS "${UNTRUSTED_LINK_FLAGS} -lsgx_uswitchless")
+    endif()
 
     set_target_properties(${target} PROPERTIES COMPILE_FLAGS ${APP_C_FLAGS})
     target_include_directories(${target} PRIVATE ${CMAKE_CURRENT_BINARY_DIR} ${APP_INCLUDES})
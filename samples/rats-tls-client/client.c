@@ -27,6 +27,7 @@
 #include <sgx_urts.h>
 #include <sgx_quote.h>
 #include "sgx_stub_u.h"
+#include "rtls_enclave.h"
 
 #define ENCLAVE_FILENAME "sgx_stub_enclave.signed.so"
 // clang-format on
@@ -35,13 +36,9 @@ rats_tls_log_level_t global_log_level = RATS_TLS_LOG_LEVEL_DEFAULT;
 
 static sgx_enclave_id_t load_enclave(bool debug_enclave)
 {
-	sgx_launch_token_t t;
-
-	memset(t, 0, sizeof(t));
-
 	sgx_enclave_id_t eid;
-	int updated = 0;
-	int ret = sgx_create_enclave(ENCLAVE_FILENAME, debug_enclave, &t, &updated, &eid, NULL);
+	/* With the switchless ocalls configured by the environment, if enabled */
+	int ret = rtls_sgx_create_enclave(ENCLAVE_FILENAME, debug_enclave, NULL, &eid);
 	if (ret != SGX_SUCCESS) {
 		RTLS_ERR("Failed to load enclave %d\n", ret);
 		return 0;
@@ -30,6 +30,7 @@
 #include <sgx_urts.h>
 #include <sgx_quote.h>
 #include "sgx_stub_u.h"
+#include "rtls_enclave.h"
 
 #define ENCLAVE_FILENAME "sgx_stub_enclave.signed.so"
 
@@ -37,13 +38,9 @@ rats_tls_log_level_t global_log_level = RATS_TLS_LOG_LEVEL_DEFAULT;
 
 static sgx_enclave_id_t load_enclave(bool debug_enclave)
 {
-        sgx_launch_token_t t;
-
-        memset(t, 0, sizeof(t));
-
         sgx_enclave_id_t eid;
-        int updated = 0;
-        int ret = sgx_create_enclave(ENCLAVE_FILENAME, debug_enclave, &t, &updated, &eid, NULL);
+        /* With the switchless ocalls configured by the environment, if enabled */
+        int ret = rtls_sgx_create_enclave(ENCLAVE_FILENAME, debug_enclave, NULL, &eid);
         if (ret != SGX_SUCCESS) {
                 RTLS_ERR("Failed to load enclave %d\n", ret);
                 return 0;
@@ -245,20 +242,29 @@ int rats_tls_server_startup(rats_tls_log_level_t log_level, char *attester_type,
 			goto err;
 		}
 
-		ret = rats_tls_negotiate(handle, connd);
+		/* Each connection runs in a session sharing the attested identity of handle */
+		rats_tls_handle session;
+		ret = rats_tls_session_init(handle, &session);
 		if (ret != RATS_TLS_ERR_NONE) {
-			RTLS_ERR("Failed to negotiate %#x\n", ret);
+			RTLS_ERR("Failed to initialize rats tls session %#x\n", ret);
+			close(connd);
 			goto err;
 		}
 
+		ret = rats_tls_negotiate(session, connd);
+		if (ret != RATS_TLS_ERR_NONE) {
+			RTLS_ERR("Failed to negotiate %#x\n", ret);
+			goto err_session;
+		}
+
 		RTLS_DEBUG("Client connected successfully\n");
 
 		char buf[256];
 		size_t len = sizeof(buf);
-		ret = rats_tls_receive(handle, buf, &len);
+		ret = rats_tls_receive(session, buf, &len);
 		if (ret != RATS_TLS_ERR_NONE) {
 			RTLS_ERR("Failed to receive %#x\n", ret);
-			goto err;
+			goto err_session;
 		}
 
 		if (len >= sizeof(buf))
@@ -271,7 +277,7 @@ int rats_tls_server_startup(rats_tls_log_level_t log_level, char *attester_type,
 		sgx_report_t app_report;
 		if (sgx_create_report(&app_report) < 0) {
 			RTLS_ERR("Failed to generate local report\n");
-			goto err;
+			goto err_session;
 		}
 
 		/* Write mrencalve, mesigner and hello into buff */
@@ -285,13 +291,20 @@ int rats_tls_server_startup(rats_tls_log_level_t log_level, char *attester_type,
 	#endif
 
 		/* Reply back to the client */
-		ret = rats_tls_transmit(handle, buf, &len);
+		ret = rats_tls_transmit(session, buf, &len);
 		if (ret != RATS_TLS_ERR_NONE) {
 			RTLS_ERR("Failed to transmit %#x\n", ret);
-			goto err;
+			goto err_session;
 		}
 
+		rats_tls_cleanup(session);
+		close(connd);
+		continue;
+
+	err_session:
+		rats_tls_cleanup(session);
 		close(connd);
+		goto err;
 	}
 
 	ret = rats_tls_cleanup(handle);
@@ -13,42 +13,111 @@
 #include "internal/attester.h"
 #include "internal/verifier.h"
 #include "internal/tls_wrapper.h"
+#include "internal/cert_cache.h"
+#include "internal/verify_async.h"
+#include "internal/verify_cache.h"
+#include "internal/cert_rotation.h"
+#include "internal/transmit.h"
+#include "internal/receive.h"
+#include "internal/shm_ring.h"
 
-rats_tls_err_t rats_tls_cleanup(rats_tls_handle handle)
+static rats_tls_err_t rtls_identity_cleanup(rtls_core_context_t *ctx)
 {
-	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
-
-	RTLS_DEBUG("handle %p\n", ctx);
+	RTLS_DEBUG("identity %p\n", ctx);
 
-	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
-	    !handle->tls_wrapper->opts->cleanup || !handle->attester || !handle->attester->opts ||
-	    !handle->attester->opts->cleanup || !handle->verifier || !handle->verifier->opts ||
-	    !handle->verifier->opts->cleanup)
-		return -RATS_TLS_ERR_INVALID;
+	/* Stop replacing the certificate before tearing down the instances */
+	rtls_core_cert_rotation_stop(ctx);
 
 	if (ctx->config.custom_claims) {
 		free_claims_list(ctx->config.custom_claims, ctx->config.custom_claims_length);
 	}
 
-	tls_wrapper_err_t err = handle->tls_wrapper->opts->cleanup(handle->tls_wrapper);
+	tls_wrapper_err_t err = ctx->tls_wrapper->opts->cleanup(ctx->tls_wrapper);
 	if (err != TLS_WRAPPER_ERR_NONE) {
 		RTLS_DEBUG("failed to clean up tls wrapper %#x\n", err);
 		return err;
 	}
 
-	enclave_attester_err_t err_ea = handle->attester->opts->cleanup(handle->attester);
+	enclave_attester_err_t err_ea = ctx->attester->opts->cleanup(ctx->attester);
 	if (err_ea != ENCLAVE_ATTESTER_ERR_NONE) {
 		RTLS_DEBUG("failed to clean up attester %#x\n", err_ea);
 		return -RATS_TLS_ERR_INVALID;
 	}
+	free(ctx->attester);
 
-	enclave_verifier_err_t err_ev = handle->verifier->opts->cleanup(handle->verifier);
-	if (err_ev != ENCLAVE_VERIFIER_ERR_NONE) {
-		RTLS_DEBUG("failed to clean up verifier %#x\n", err_ev);
+	/* The certificates keep their own copy of the private key */
+	crypto_wrapper_err_t err_cw = ctx->crypto_wrapper->opts->cleanup(ctx->crypto_wrapper);
+	if (err_cw != CRYPTO_WRAPPER_ERR_NONE) {
+		RTLS_DEBUG("failed to clean up crypto wrapper %#x\n", err_cw);
 		return -RATS_TLS_ERR_INVALID;
 	}
+	free(ctx->crypto_wrapper);
+
+	/* Including the verifiers selected by the sessions */
+	rtls_verifier_cleanup_all(ctx);
+
+	rtls_verify_result_put(ctx->tls_wrapper->peer_evidence);
+	rtls_shm_detach(ctx->tls_wrapper->shm);
+	free(ctx->tls_wrapper);
+
+	rtls_cert_bundle_put(ctx->cert_bundle);
 
+	pthread_mutex_destroy(&ctx->rotate_lock);
 	free(ctx);
 
 	return RATS_TLS_ERR_NONE;
 }
+
+static rats_tls_err_t rtls_identity_put(rtls_core_context_t *identity)
+{
+	if (__atomic_sub_fetch(&identity->refcount, 1, __ATOMIC_SEQ_CST))
+		return RATS_TLS_ERR_NONE;
+
+	return rtls_identity_cleanup(identity);
+}
+
+static rats_tls_err_t rtls_session_cleanup(rtls_core_context_t *ctx)
+{
+	rtls_core_context_t *identity = ctx->identity;
+
+	RTLS_DEBUG("session %p of identity %p\n", ctx, identity);
+
+	tls_wrapper_err_t err = ctx->tls_wrapper->opts->cleanup(ctx->tls_wrapper);
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		RTLS_DEBUG("failed to clean up tls wrapper %#x\n", err);
+		return err;
+	}
+	rtls_verify_result_put(ctx->tls_wrapper->peer_evidence);
+	rtls_shm_detach(ctx->tls_wrapper->shm);
+	free(ctx->tls_wrapper);
+
+	free(ctx);
+
+	return rtls_identity_put(identity);
+}
+
+rats_tls_err_t rats_tls_cleanup(rats_tls_handle handle)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p\n", ctx);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->cleanup || !handle->attester || !handle->attester->opts ||
+	    !handle->attester->opts->cleanup || !handle->verifier || !handle->verifier->opts ||
+	    !handle->verifier->opts->cleanup)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* Wait for the verification in flight on behalf of the handle */
+	rtls_core_verify_async_cleanup(ctx);
+
+	/* The data still corked is discarded */
+	free(ctx->cork_buffer);
+	rtls_core_recv_buffer_free(ctx);
+
+	if (ctx->identity)
+		return rtls_session_cleanup(ctx);
+
+	/* The identity is torn down once the last session is released */
+	return rtls_identity_put(ctx);
+}
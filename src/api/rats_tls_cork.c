@@ -0,0 +1,24 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/core.h"
+#include "internal/transmit.h"
+
+rats_tls_err_t rats_tls_cork(rats_tls_handle handle, bool cork)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, cork %d\n", ctx, cork);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->transmit)
+		return -RATS_TLS_ERR_INVALID;
+
+	return rtls_core_cork(ctx, cork);
+}
@@ -0,0 +1,28 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/core.h"
+#include "internal/transmit.h"
+
+rats_tls_err_t rats_tls_flush(rats_tls_handle handle)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p\n", ctx);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->transmit)
+		return -RATS_TLS_ERR_INVALID;
+
+	rats_tls_err_t err = rtls_core_flush(ctx);
+	if (err == RATS_TLS_ERR_NONE)
+		handle->events = 0;
+
+	return err;
+}
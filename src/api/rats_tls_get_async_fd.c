@@ -0,0 +1,26 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/verify_async.h"
+
+rats_tls_err_t rats_tls_get_async_fd(rats_tls_handle handle, int *fd)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, fd %p\n", ctx, fd);
+
+	if (!ctx || !fd || !(ctx->config.flags & RATS_TLS_CONF_FLAGS_ASYNC_VERIFY))
+		return -RATS_TLS_ERR_INVALID;
+
+	*fd = rtls_core_get_async_fd(ctx);
+	if (*fd < 0)
+		return -RATS_TLS_ERR_INVALID;
+
+	return RATS_TLS_ERR_NONE;
+}
@@ -0,0 +1,23 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+
+rats_tls_err_t rats_tls_get_events(rats_tls_handle handle, int *events)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, events %p\n", ctx, events);
+
+	if (!ctx || !events)
+		return -RATS_TLS_ERR_INVALID;
+
+	*events = ctx->events;
+
+	return RATS_TLS_ERR_NONE;
+}
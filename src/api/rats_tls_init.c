@@ -14,6 +14,8 @@
 #include "internal/tls_wrapper.h"
 #include "internal/attester.h"
 #include "internal/verifier.h"
+#include "internal/cert_rotation.h"
+#include "internal/cert_cache.h"
 #include <openssl/opensslv.h>
 
 rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handle)
@@ -28,6 +30,9 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 		return -RATS_TLS_ERR_NO_MEM;
 
 	ctx->config = *conf;
+	ctx->refcount = 1;
+	ctx->async_fd = -1;
+	pthread_mutex_init(&ctx->rotate_lock, NULL);
 
 	rats_tls_err_t err = -RATS_TLS_ERR_INVALID;
 
@@ -66,7 +71,7 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 			   conf->custom_claims, conf->custom_claims_length);
 		ctx->config.custom_claims =
 			clone_claims_list(conf->custom_claims, conf->custom_claims_length);
-		err = RATS_TLS_ERR_NO_MEM;
+		err = -RATS_TLS_ERR_NO_MEM;
 		if (!ctx->config.custom_claims) {
 			RTLS_ERR("failed to make copy of custom claims: out of memory\n");
 			goto err_ctx;
@@ -86,7 +91,7 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 	}
 	err = rtls_crypto_wrapper_select(ctx, choice);
 	if (err != RATS_TLS_ERR_NONE)
-		goto err_ctx;
+		goto err_claims;
 
 	/* Select the target attester to be used */
 	choice = ctx->config.attester_type;
@@ -97,7 +102,7 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 	}
 	err = rtls_attester_select(ctx, choice, ctx->config.cert_algo);
 	if (err != RATS_TLS_ERR_NONE)
-		goto err_ctx;
+		goto err_crypto;
 
 	/* Select the target verifier to be used */
 	choice = ctx->config.verifier_type;
@@ -108,7 +113,7 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 	}
 	err = rtls_verifier_select(ctx, choice, ctx->config.cert_algo);
 	if (err != RATS_TLS_ERR_NONE)
-		goto err_ctx;
+		goto err_attester;
 
 	/* Select the target tls wrapper to be used */
 	choice = ctx->config.tls_type;
@@ -119,14 +124,37 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 	}
 	err = rtls_tls_wrapper_select(ctx, choice);
 	if (err != RATS_TLS_ERR_NONE)
-		goto err_ctx;
+		goto err_verifier;
 
 	/* Check whether requiring to generate TLS certificate */
 	if ((ctx->config.flags & RATS_TLS_CONF_FLAGS_SERVER) ||
 	    (ctx->config.flags & RATS_TLS_CONF_FLAGS_MUTUAL)) {
+		/* The leaf certificate signed by the attested issuer is short-lived */
+		if ((ctx->config.flags & RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER) &&
+		    !(ctx->config.flags & RATS_TLS_CONF_FLAGS_CERT_ROTATION)) {
+#ifdef SGX
+			/* No rotation thread runs in the enclave, so the application
+			 * has to reissue it with rats_tls_rotate_cert().
+			 */
+			RTLS_ERR("the leaf certificate of the attested issuer requires "
+				 "RATS_TLS_CONF_FLAGS_CERT_ROTATION in the enclave\n");
+			err = -RATS_TLS_ERR_INVALID;
+			goto err_tls;
+#else
+			RTLS_INFO("certificate rotation enabled to reissue the leaf certificate\n");
+			ctx->config.flags |= RATS_TLS_CONF_FLAGS_CERT_ROTATION;
+#endif
+		}
+
 		err = rtls_core_generate_certificate(ctx);
 		if (err != RATS_TLS_ERR_NONE)
-			goto err_ctx;
+			goto err_cert;
+
+		if (ctx->config.flags & RATS_TLS_CONF_FLAGS_CERT_ROTATION) {
+			err = rtls_core_cert_rotation_start(ctx);
+			if (err != RATS_TLS_ERR_NONE)
+				goto err_cert;
+		}
 	}
 
 	*handle = ctx;
@@ -135,7 +163,24 @@ rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handl
 
 	return RATS_TLS_ERR_NONE;
 
+err_cert:
+	rtls_cert_bundle_put(ctx->cert_bundle);
+err_tls:
+	ctx->tls_wrapper->opts->cleanup(ctx->tls_wrapper);
+	free(ctx->tls_wrapper);
+err_verifier:
+	rtls_verifier_cleanup_all(ctx);
+err_attester:
+	ctx->attester->opts->cleanup(ctx->attester);
+	free(ctx->attester);
+err_crypto:
+	ctx->crypto_wrapper->opts->cleanup(ctx->crypto_wrapper);
+	free(ctx->crypto_wrapper);
+err_claims:
+	if (ctx->config.custom_claims)
+		free_claims_list(ctx->config.custom_claims, ctx->config.custom_claims_length);
 err_ctx:
+	pthread_mutex_destroy(&ctx->rotate_lock);
 	free(ctx);
 	return err;
 }
@@ -7,6 +7,9 @@
 #include <rats-tls/api.h>
 #include <rats-tls/log.h>
 #include "internal/core.h"
+#include "internal/transmit.h"
+#include "internal/receive.h"
+#include "internal/shm_ring.h"
 
 rats_tls_err_t rats_tls_negotiate(rats_tls_handle handle, int fd)
 {
@@ -18,9 +21,21 @@ rats_tls_err_t rats_tls_negotiate(rats_tls_handle handle, int fd)
 	    !ctx->tls_wrapper->opts->negotiate || fd < 0)
 		return -RATS_TLS_ERR_INVALID;
 
+	/* Nothing written for the previous TLS session is sent to the new peer */
+	rtls_core_cork_discard(ctx);
+	/* Nor is the data read ahead from the previous peer received */
+	rtls_core_recv_buffer_free(ctx);
+
+	/* Give up on the shared memory rings, if negotiated over them previously */
+	rtls_shm_detach(ctx->tls_wrapper->shm);
+	ctx->tls_wrapper->shm = NULL;
+	ctx->flags &= ~RATS_TLS_CTX_FLAGS_SHM_NEGOTIATING;
+
 	tls_wrapper_err_t t_err = ctx->tls_wrapper->opts->negotiate(ctx->tls_wrapper, fd);
 	if (t_err != TLS_WRAPPER_ERR_NONE)
-		return t_err;
+		return rtls_core_update_events(ctx, t_err);
+
+	ctx->events = 0;
 
 	ctx->tls_wrapper->fd = fd;
 
@@ -0,0 +1,58 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/transmit.h"
+#include "internal/receive.h"
+#include "internal/shm_ring.h"
+
+rats_tls_err_t rats_tls_negotiate_shm(rats_tls_handle handle, int shm_fd)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, shm_fd %d\n", ctx, shm_fd);
+
+	if (!ctx || !ctx->tls_wrapper || !ctx->tls_wrapper->opts ||
+	    !ctx->tls_wrapper->opts->negotiate || shm_fd < 0)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* Nothing written for the previous TLS session is sent to the new peer */
+	rtls_core_cork_discard(ctx);
+	/* Nor is the data read ahead from the previous peer received */
+	rtls_core_recv_buffer_free(ctx);
+
+	/* Resume the handshake in progress over the rings already attached */
+	if (!(ctx->flags & RATS_TLS_CTX_FLAGS_SHM_NEGOTIATING)) {
+		rtls_shm_transport_t *shm =
+			rtls_shm_attach(shm_fd, ctx->config.flags & RATS_TLS_CONF_FLAGS_SERVER);
+		if (!shm)
+			return -RATS_TLS_ERR_INVALID;
+
+		/* The TLS session negotiated over the previous rings keeps them until released */
+		rtls_shm_detach(ctx->tls_wrapper->shm);
+		ctx->tls_wrapper->shm = shm;
+	}
+
+	/* The tls wrapper transfers the data through the rings instead of an fd */
+	tls_wrapper_err_t t_err = ctx->tls_wrapper->opts->negotiate(ctx->tls_wrapper, -1);
+	rats_tls_err_t err = rtls_core_update_events(ctx, t_err);
+	if (err == -RATS_TLS_ERR_WANT_READ || err == -RATS_TLS_ERR_WANT_WRITE ||
+	    err == -RATS_TLS_ERR_WANT_VERIFY) {
+		ctx->flags |= RATS_TLS_CTX_FLAGS_SHM_NEGOTIATING;
+		return err;
+	}
+
+	ctx->flags &= ~RATS_TLS_CTX_FLAGS_SHM_NEGOTIATING;
+	if (t_err != TLS_WRAPPER_ERR_NONE) {
+		rtls_shm_detach(ctx->tls_wrapper->shm);
+		ctx->tls_wrapper->shm = NULL;
+		return err;
+	}
+
+	return RATS_TLS_ERR_NONE;
+}
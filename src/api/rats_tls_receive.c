@@ -8,6 +8,7 @@
 #include <rats-tls/log.h>
 
 #include "internal/core.h"
+#include "internal/receive.h"
 
 rats_tls_err_t rats_tls_receive(rats_tls_handle handle, void *buf, size_t *buf_size)
 {
@@ -19,10 +20,11 @@ rats_tls_err_t rats_tls_receive(rats_tls_handle handle, void *buf, size_t *buf_s
 	    !handle->tls_wrapper->opts->receive || !buf || !buf_size)
 		return -RATS_TLS_ERR_INVALID;
 
-	tls_wrapper_err_t err =
-		handle->tls_wrapper->opts->receive(handle->tls_wrapper, buf, buf_size);
-	if (err != TLS_WRAPPER_ERR_NONE)
-		return -RATS_TLS_ERR_INVALID;
+	rats_tls_err_t err = rtls_core_receive(ctx, buf, buf_size);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	rtls_core_update_recv_events(ctx);
 
 	return RATS_TLS_ERR_NONE;
 }
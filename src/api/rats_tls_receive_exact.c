@@ -0,0 +1,28 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/core.h"
+#include "internal/receive.h"
+
+rats_tls_err_t rats_tls_receive_exact(rats_tls_handle handle, void *buf, size_t size)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, buf %p, size %zu\n", ctx, buf, size);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->receive || !buf)
+		return -RATS_TLS_ERR_INVALID;
+
+	rats_tls_err_t err = rtls_core_receive_exact(ctx, buf, size);
+	if (err == RATS_TLS_ERR_NONE)
+		rtls_core_update_recv_events(ctx);
+
+	return err;
+}
@@ -0,0 +1,32 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/cert_rotation.h"
+
+rats_tls_err_t rats_tls_rotate_cert(rats_tls_handle handle)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p\n", ctx);
+
+	if (!ctx || !ctx->tls_wrapper || !ctx->tls_wrapper->opts)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* The certificate belongs to the identity shared by the sessions */
+	ctx = rtls_core_get_identity(ctx);
+
+	rats_tls_err_t err = rtls_core_rotate_certificate(ctx, true);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	/* Postpone the next background rotation accordingly */
+	rtls_core_cert_rotation_notify(ctx);
+
+	return RATS_TLS_ERR_NONE;
+}
@@ -0,0 +1,40 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/core.h"
+#include "internal/transmit.h"
+
+rats_tls_err_t rats_tls_sendfile(rats_tls_handle handle, int file_fd, off_t offset, size_t *size)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, file_fd %d, offset %lld, size %p\n", ctx, file_fd,
+		   (long long)offset, size);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->sendfile || file_fd < 0 || offset < 0 || !size)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* The file follows the data written before */
+	rats_tls_err_t ret = rtls_core_flush(ctx);
+	if (ret != RATS_TLS_ERR_NONE)
+		return ret;
+
+	tls_wrapper_err_t err =
+		handle->tls_wrapper->opts->sendfile(handle->tls_wrapper, file_fd, offset, size);
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		ret = rtls_core_update_events(handle, err);
+		if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+			return ret;
+
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	return rtls_core_transmit_done(ctx);
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/tls_wrapper.h"
+
+rats_tls_err_t rats_tls_session_init(rats_tls_handle handle, rats_tls_handle *session)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, session %p\n", ctx, session);
+
+	if (!handle || !session || !handle->tls_wrapper || !handle->tls_wrapper->opts)
+		return -RATS_TLS_ERR_INVALID;
+
+	if (!handle->tls_wrapper->opts->session_init) {
+		RTLS_ERR("the tls wrapper '%s' doesn't support sessions\n",
+			 handle->tls_wrapper->opts->name);
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	rtls_core_context_t *identity = rtls_core_get_identity(ctx);
+
+	rtls_core_context_t *session_ctx = calloc(1, sizeof(*session_ctx));
+	if (!session_ctx)
+		return -RATS_TLS_ERR_NO_MEM;
+
+	/* The session borrows the attested identity, i.e, the configuration
+	 * (including custom claims), attester, verifier and crypto wrapper
+	 * instances, from the identity handle. Only the tls wrapper instance
+	 * is private to carry the state of a single connection.
+	 */
+	session_ctx->config = identity->config;
+	session_ctx->flags = identity->flags;
+	session_ctx->user_callback = ctx->user_callback;
+	session_ctx->attester = identity->attester;
+	session_ctx->verifier = identity->verifier;
+	session_ctx->crypto_wrapper = identity->crypto_wrapper;
+	session_ctx->async_fd = -1;
+
+	rats_tls_err_t err = -RATS_TLS_ERR_NO_MEM;
+	tls_wrapper_ctx_t *tls_ctx = malloc(sizeof(*tls_ctx));
+	if (!tls_ctx)
+		goto err_session;
+
+	*tls_ctx = *identity->tls_wrapper;
+	tls_ctx->rtls_handle = session_ctx;
+	tls_ctx->tls_private = NULL;
+	tls_ctx->fd = -1;
+	tls_ctx->peer_evidence = NULL;
+	tls_ctx->shm = NULL;
+
+	tls_wrapper_err_t t_err = tls_ctx->opts->session_init(identity->tls_wrapper, tls_ctx);
+	if (t_err != TLS_WRAPPER_ERR_NONE) {
+		RTLS_ERR("failed to initialize tls wrapper session %#x\n", t_err);
+		err = t_err;
+		goto err_tls;
+	}
+
+	session_ctx->tls_wrapper = tls_ctx;
+	session_ctx->identity = identity;
+	__atomic_add_fetch(&identity->refcount, 1, __ATOMIC_SEQ_CST);
+
+	*session = session_ctx;
+
+	RTLS_DEBUG("the session %p of handle %p returned\n", session_ctx, identity);
+
+	return RATS_TLS_ERR_NONE;
+
+err_tls:
+	free(tls_ctx);
+err_session:
+	free(session_ctx);
+	return err;
+}
@@ -0,0 +1,20 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/shm_ring.h"
+
+rats_tls_err_t rats_tls_shm_create(size_t ring_size, int *shm_fd)
+{
+	RTLS_DEBUG("ring_size %zu, shm_fd %p\n", ring_size, shm_fd);
+
+	if (!shm_fd)
+		return -RATS_TLS_ERR_INVALID;
+
+	return rtls_shm_create(ring_size, shm_fd);
+}
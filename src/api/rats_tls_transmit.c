@@ -8,6 +8,7 @@
 #include <rats-tls/log.h>
 
 #include "internal/core.h"
+#include "internal/transmit.h"
 
 rats_tls_err_t rats_tls_transmit(rats_tls_handle handle, void *buf, size_t *buf_size)
 {
@@ -19,10 +20,18 @@ rats_tls_err_t rats_tls_transmit(rats_tls_handle handle, void *buf, size_t *buf_
 	    !handle->tls_wrapper->opts->transmit || !buf || !buf_size)
 		return -RATS_TLS_ERR_INVALID;
 
+	if (rtls_core_corked(ctx))
+		return rtls_core_transmit_corked(ctx, buf, buf_size);
+
 	tls_wrapper_err_t err =
 		handle->tls_wrapper->opts->transmit(handle->tls_wrapper, buf, buf_size);
-	if (err != TLS_WRAPPER_ERR_NONE)
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		rats_tls_err_t ret = rtls_core_update_events(handle, err);
+		if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+			return ret;
+
 		return -RATS_TLS_ERR_INVALID;
+	}
 
-	return RATS_TLS_ERR_NONE;
+	return rtls_core_transmit_done(ctx);
 }
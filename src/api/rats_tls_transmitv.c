@@ -0,0 +1,56 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/api.h>
+#include <rats-tls/log.h>
+
+#include "internal/core.h"
+#include "internal/transmit.h"
+
+rats_tls_err_t rats_tls_transmitv(rats_tls_handle handle, const struct iovec *iov, int iovcnt,
+				  size_t *size)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)handle;
+
+	RTLS_DEBUG("handle %p, iov %p, iovcnt %d, size %p\n", ctx, iov, iovcnt, size);
+
+	if (!handle || !handle->tls_wrapper || !handle->tls_wrapper->opts ||
+	    !handle->tls_wrapper->opts->transmitv || !iov || iovcnt < 0 || !size)
+		return -RATS_TLS_ERR_INVALID;
+
+	if (rtls_core_corked(ctx)) {
+		size_t accepted = 0;
+
+		for (int i = 0; i < iovcnt; ++i) {
+			size_t len = iov[i].iov_len;
+			rats_tls_err_t ret = rtls_core_transmit_corked(ctx, iov[i].iov_base, &len);
+			if (ret != RATS_TLS_ERR_NONE) {
+				if (accepted)
+					break;
+				return ret;
+			}
+
+			accepted += len;
+			if (len < iov[i].iov_len)
+				break;
+		}
+		*size = accepted;
+
+		return RATS_TLS_ERR_NONE;
+	}
+
+	tls_wrapper_err_t err =
+		handle->tls_wrapper->opts->transmitv(handle->tls_wrapper, iov, iovcnt, size);
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		rats_tls_err_t ret = rtls_core_update_events(handle, err);
+		if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+			return ret;
+
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	return rtls_core_transmit_done(ctx);
+}
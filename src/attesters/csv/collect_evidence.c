@@ -8,13 +8,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <rats-tls/log.h>
 #include <rats-tls/attester.h>
 #include <rats-tls/csv.h>
-#include <curl/curl.h>
 #include "csv_utils.h"
-#include "../../verifiers/sev/sev_utils.c"
+#include "hsk_cek.h"
 
 #define PAGE_MAP_FILENAME   "/proc/self/pagemap"
 #define PAGE_MAP_PFN_MASK   0x007fffffffffffffUL
@@ -23,6 +23,36 @@
 #define PAGE_MAP_ENTRY_SIZE sizeof(uint64_t)
 typedef uint64_t page_map_entry_t;
 
+/* Kept open across calls, since pread() doesn't move any shared offset. The fd refers
+ * to the pagemap of the process which opened it, so a forked child opens its own.
+ */
+static int page_map_fd = -1;
+static pid_t page_map_pid;
+static pthread_mutex_t page_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Return the pagemap fd of the calling process, and retry opening it if failed before */
+static int page_map_get(void)
+{
+	pid_t pid = getpid();
+	int fd;
+
+	pthread_mutex_lock(&page_map_lock);
+	if (page_map_fd != -1 && page_map_pid != pid) {
+		close(page_map_fd);
+		page_map_fd = -1;
+	}
+	if (page_map_fd == -1) {
+		page_map_fd = open(PAGE_MAP_FILENAME, O_RDONLY | O_CLOEXEC);
+		if (page_map_fd == -1)
+			RTLS_ERR("failed to open %s\n", PAGE_MAP_FILENAME);
+		page_map_pid = pid;
+	}
+	fd = page_map_fd;
+	pthread_mutex_unlock(&page_map_lock);
+
+	return fd;
+}
+
 /**
  * Translate the virtual address of app to physical address
  *
@@ -34,31 +64,23 @@ typedef uint64_t page_map_entry_t;
  */
 static void *gva_to_gpa(void *va)
 {
-	int fd = -1;
 	void *pa = NULL;
 	uint64_t paging_entry_offset;
 	page_map_entry_t entry;
 
-	fd = open(PAGE_MAP_FILENAME, O_RDONLY);
-	if (fd == -1) {
-		RTLS_ERR("failed to open %s\n", PAGE_MAP_FILENAME);
+	int fd = page_map_get();
+	if (fd == -1)
 		return NULL;
-	}
 
 	paging_entry_offset = ((uint64_t)va >> PAGE_MAP_PAGE_SHIFT) * PAGE_MAP_ENTRY_SIZE;
-	if (lseek(fd, paging_entry_offset, SEEK_SET) == -1) {
-		RTLS_ERR("failed to seek\n");
-		goto err_close_fd;
-	}
-
-	if (read(fd, &entry, sizeof(entry)) != sizeof(entry)) {
+	if (pread(fd, &entry, sizeof(entry), paging_entry_offset) != sizeof(entry)) {
 		RTLS_ERR("failed to read pagemap entry\n");
-		goto err_close_fd;
+		return NULL;
 	}
 
 	if (!(entry & (1ul << 63))) {
 		RTLS_ERR("page doesn't present\n");
-		goto err_close_fd;
+		return NULL;
 	}
 
 	pa = (void *)((entry & PAGE_MAP_PFN_MASK) << PAGE_MAP_PAGE_SHIFT) +
@@ -67,9 +89,6 @@ static void *gva_to_gpa(void *va)
 	RTLS_DEBUG("offset %#016lx, entry %#016lx, pa %#016lx\n",
 		   (unsigned long)paging_entry_offset, (unsigned long)entry, (unsigned long)pa);
 
-err_close_fd:
-	close(fd);
-
 	return pa;
 }
 
@@ -82,102 +101,6 @@ static int do_hypercall(unsigned int p1, unsigned long p2, unsigned long p3)
 	return (int)ret;
 }
 
-static size_t curl_writefunc_callback(void *contents, size_t size, size_t nmemb, void *userp)
-{
-	size_t realsize = size * nmemb;
-	csv_evidence *evidence = (csv_evidence *)userp;
-
-	if (evidence->hsk_cek_cert_len + realsize > HYGON_HSK_CEK_CERT_SIZE) {
-		RTLS_ERR("hsk_cek size is large than %d bytes.", HYGON_HSK_CEK_CERT_SIZE);
-		return 0;
-	}
-	memcpy(&(evidence->hsk_cek_cert[evidence->hsk_cek_cert_len]), contents, realsize);
-	evidence->hsk_cek_cert_len += realsize;
-
-	return realsize;
-}
-
-static int read_hsk_cek_cert_from_localfs(const char *chip_id, csv_evidence *evidence_buffer)
-{
-	int count = 0;
-	char cert_path[200] = {
-		0,
-	};
-
-	count = snprintf(cert_path, sizeof(cert_path), "%s/%s/%s", CSV_HSK_CEK_DEFAULT_DIR, chip_id,
-			 HYGON_HSK_CEK_CERT_FILENAME);
-	cert_path[count] = '\0';
-
-	if (get_file_size(cert_path) != HYGON_HSK_CEK_CERT_SIZE)
-		return -1;
-
-	if (read_file(cert_path, evidence_buffer->hsk_cek_cert, HYGON_HSK_CEK_CERT_SIZE) !=
-	    HYGON_HSK_CEK_CERT_SIZE)
-		return -1;
-
-	evidence_buffer->hsk_cek_cert_len = HYGON_HSK_CEK_CERT_SIZE;
-	return 0;
-}
-
-static int download_hsk_cek_cert(const char *chip_id, csv_evidence *evidence_buffer)
-{
-	/* Download HSK and CEK cert by ChipId */
-	char url[200] = {
-		0,
-	};
-	int count = snprintf(url, sizeof(url), "%s%s", HYGON_KDS_SERVER_SITE, chip_id);
-	url[count] = '\0';
-	// init curl
-	CURLcode curl_ret = CURLE_OK;
-	CURL *curl = curl_easy_init();
-	if (!curl) {
-		RTLS_ERR("failed to init curl.");
-		return -1;
-	}
-
-	curl_easy_setopt(curl, CURLOPT_URL, url);
-	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5);
-	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_writefunc_callback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)evidence_buffer);
-	for (int i = 0; i < 5; i++) {
-		evidence_buffer->hsk_cek_cert_len = 0;
-		if ((curl_ret = curl_easy_perform(curl)) == CURLE_OK) {
-			break;
-		}
-		RTLS_DEBUG("failed to download hsk_cek, try again.");
-	}
-	curl_easy_cleanup(curl);
-	if (curl_ret != CURLE_OK) {
-		RTLS_ERR("failed to download hsk_cek after 5 retries, %s\n",
-			 curl_easy_strerror(curl_ret));
-		return -1;
-	}
-
-	return 0;
-}
-
-/**
- * Download HSK and CEK cert, and then save them to @hsk_cek_cert.
- *
- * Params:
- * 	chip_id         [in]: platform's ChipId
- * 	evidence_buffer [in]: the buffer to save HSK and CEK cert, which follows the attestation
- * 			      report
- * Return:
- * 	0: success
- * 	otherwise error
- */
-static int csv_get_hsk_cek_cert(const char *chip_id, csv_evidence *evidence_buffer)
-{
-	/* First read hsk_cek cert from local file system, and then download
-	 * hsk_cek cert through network when the reading fails */
-	if (read_hsk_cek_cert_from_localfs(chip_id, evidence_buffer))
-		return download_hsk_cek_cert(chip_id, evidence_buffer);
-
-	return 0;
-}
-
 #define CSV_GUEST_MAP_LEN     4096
 #define KVM_HC_VM_ATTESTATION 100 /* Specific to HYGON CPU */
 
@@ -326,11 +249,12 @@ static int collect_attestation_evidence(uint8_t *hash, uint32_t hash_len,
 		((uint32_t *)chip_id)[i] = ((uint32_t *)attestation_report->chip_id)[i] ^
 					   attestation_report->anonce;
 
-	if (csv_get_hsk_cek_cert((const char *)chip_id, evidence_buffer)) {
+	if (csv_get_hsk_cek_cert((const char *)chip_id, evidence_buffer->hsk_cek_cert)) {
 		RTLS_ERR("failed to load HSK and CEK cert\n");
 		ret = -1;
 		goto err_munmap;
 	}
+	evidence_buffer->hsk_cek_cert_len = HYGON_HSK_CEK_CERT_SIZE;
 	evidence->report_len = sizeof(csv_evidence);
 
 	ret = 0;
@@ -0,0 +1,336 @@
+/* Copyright (c) 2022 Hygon Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <curl/curl.h>
+#include <rats-tls/log.h>
+#include <rats-tls/csv.h>
+#include "hsk_cek.h"
+#include "../../verifiers/sev/sev_utils.c"
+
+typedef struct {
+	bool valid;
+	char chip_id[CSV_ATTESTATION_CHIP_SN_SIZE + 1];
+	uint8_t hsk_cek[HYGON_HSK_CEK_CERT_SIZE];
+	uint64_t last_used;
+} hsk_cek_entry_t;
+
+static hsk_cek_entry_t hsk_cek_cache[CSV_HSK_CEK_CACHE_SIZE];
+static uint64_t hsk_cek_clock;
+static pthread_mutex_t hsk_cek_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Reused across downloads to keep the connection to the KDS alive. A download takes
+ * it for its duration, and concurrent ones use a handle of their own.
+ */
+static CURL *kds_curl;
+static pthread_mutex_t kds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* The chips whose certs are being loaded */
+typedef struct hsk_cek_flight {
+	struct hsk_cek_flight *next;
+	char chip_id[CSV_ATTESTATION_CHIP_SN_SIZE + 1];
+} hsk_cek_flight_t;
+
+static hsk_cek_flight_t *flights;
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flights_cond = PTHREAD_COND_INITIALIZER;
+
+typedef struct {
+	uint8_t *hsk_cek;
+	size_t len;
+} kds_response_t;
+
+static bool hsk_cek_cache_get(const char *chip_id, uint8_t *hsk_cek)
+{
+	bool found = false;
+
+	pthread_mutex_lock(&hsk_cek_lock);
+	for (unsigned int i = 0; i < CSV_HSK_CEK_CACHE_SIZE; ++i) {
+		hsk_cek_entry_t *entry = &hsk_cek_cache[i];
+
+		if (entry->valid && !strcmp(entry->chip_id, chip_id)) {
+			memcpy(hsk_cek, entry->hsk_cek, sizeof(entry->hsk_cek));
+			entry->last_used = ++hsk_cek_clock;
+			found = true;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&hsk_cek_lock);
+
+	return found;
+}
+
+static void hsk_cek_cache_add(const char *chip_id, const uint8_t *hsk_cek)
+{
+	pthread_mutex_lock(&hsk_cek_lock);
+
+	hsk_cek_entry_t *entry = &hsk_cek_cache[0];
+	for (unsigned int i = 0; i < CSV_HSK_CEK_CACHE_SIZE; ++i) {
+		if (!hsk_cek_cache[i].valid || !strcmp(hsk_cek_cache[i].chip_id, chip_id)) {
+			entry = &hsk_cek_cache[i];
+			break;
+		}
+		if (hsk_cek_cache[i].last_used < entry->last_used)
+			entry = &hsk_cek_cache[i];
+	}
+
+	snprintf(entry->chip_id, sizeof(entry->chip_id), "%s", chip_id);
+	memcpy(entry->hsk_cek, hsk_cek, sizeof(entry->hsk_cek));
+	entry->last_used = ++hsk_cek_clock;
+	entry->valid = true;
+
+	pthread_mutex_unlock(&hsk_cek_lock);
+}
+
+/* Must be called with flights_lock held */
+static hsk_cek_flight_t **flight_find(const char *chip_id)
+{
+	hsk_cek_flight_t **pos;
+
+	for (pos = &flights; *pos; pos = &(*pos)->next) {
+		if (!strcmp((*pos)->chip_id, chip_id))
+			break;
+	}
+
+	return pos;
+}
+
+/* Wait for the thread loading the certs of the same chip, if any, and then become
+ * the one loading them.
+ */
+static void flight_begin(hsk_cek_flight_t *flight, const char *chip_id)
+{
+	snprintf(flight->chip_id, sizeof(flight->chip_id), "%s", chip_id);
+
+	pthread_mutex_lock(&flights_lock);
+	while (*flight_find(flight->chip_id))
+		pthread_cond_wait(&flights_cond, &flights_lock);
+	flight->next = flights;
+	flights = flight;
+	pthread_mutex_unlock(&flights_lock);
+}
+
+static void flight_end(hsk_cek_flight_t *flight)
+{
+	pthread_mutex_lock(&flights_lock);
+	hsk_cek_flight_t **pos = flight_find(flight->chip_id);
+	*pos = flight->next;
+	pthread_cond_broadcast(&flights_cond);
+	pthread_mutex_unlock(&flights_lock);
+}
+
+/* The ChipId names a directory, so it must not contain any path separator */
+static bool chip_id_is_valid(const char *chip_id)
+{
+	if (!*chip_id)
+		return false;
+
+	for (const char *p = chip_id; *p; ++p) {
+		if (!isalnum((unsigned char)*p) && *p != '-' && *p != '_')
+			return false;
+	}
+
+	return true;
+}
+
+static int read_hsk_cek_cert_from_localfs(const char *chip_id, uint8_t *hsk_cek)
+{
+	char cert_path[200];
+
+	snprintf(cert_path, sizeof(cert_path), "%s%s/%s", CSV_HSK_CEK_DEFAULT_DIR, chip_id,
+		 HYGON_HSK_CEK_CERT_FILENAME);
+
+	if (get_file_size(cert_path) != HYGON_HSK_CEK_CERT_SIZE)
+		return -1;
+
+	if (read_file(cert_path, hsk_cek, HYGON_HSK_CEK_CERT_SIZE) != HYGON_HSK_CEK_CERT_SIZE)
+		return -1;
+
+	return 0;
+}
+
+/* Save the downloaded certs, so that they are not downloaded again after a restart */
+static void write_hsk_cek_cert_to_localfs(const char *chip_id, const uint8_t *hsk_cek)
+{
+	char dir[200], cert_path[256], tmp_path[280];
+
+	snprintf(dir, sizeof(dir), "%s%s", CSV_HSK_CEK_DEFAULT_DIR, chip_id);
+	snprintf(cert_path, sizeof(cert_path), "%s/%s", dir, HYGON_HSK_CEK_CERT_FILENAME);
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%d", cert_path, (int)getpid());
+
+	/* Create /opt/csv/hsk_cek/<ChipId> and its parents */
+	for (char *p = strchr(dir + 1, '/'); p; p = strchr(p + 1, '/')) {
+		*p = '\0';
+		if (mkdir(dir, S_IRWXU) == -1 && errno != EEXIST)
+			goto err;
+		*p = '/';
+	}
+	if (mkdir(dir, S_IRWXU) == -1 && errno != EEXIST)
+		goto err;
+
+	/* Write and rename, so that readers never see a partial file */
+	FILE *fp = fopen(tmp_path, "w");
+	if (!fp)
+		goto err;
+
+	size_t count = fwrite(hsk_cek, 1, HYGON_HSK_CEK_CERT_SIZE, fp);
+	if (fclose(fp) || count != HYGON_HSK_CEK_CERT_SIZE || rename(tmp_path, cert_path)) {
+		unlink(tmp_path);
+		goto err;
+	}
+
+	RTLS_DEBUG("saved hsk_cek to %s\n", cert_path);
+	return;
+err:
+	RTLS_WARN("failed to save hsk_cek to %s: %s\n", cert_path, strerror(errno));
+}
+
+static size_t curl_writefunc_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+	size_t realsize = size * nmemb;
+	kds_response_t *response = (kds_response_t *)userp;
+
+	if (response->len + realsize > HYGON_HSK_CEK_CERT_SIZE) {
+		RTLS_ERR("hsk_cek size is large than %d bytes.", HYGON_HSK_CEK_CERT_SIZE);
+		return 0;
+	}
+	memcpy(&response->hsk_cek[response->len], contents, realsize);
+	response->len += realsize;
+
+	return realsize;
+}
+
+/* Take the shared curl handle, or make another one if it is in use */
+static CURL *kds_curl_get(void)
+{
+	pthread_mutex_lock(&kds_lock);
+	CURL *curl = kds_curl;
+	kds_curl = NULL;
+	pthread_mutex_unlock(&kds_lock);
+
+	if (curl)
+		return curl;
+
+	curl = curl_easy_init();
+	if (!curl)
+		return NULL;
+
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
+	return curl;
+}
+
+/* Give the handle back to be shared, unless another one was given back meanwhile */
+static void kds_curl_put(CURL *curl)
+{
+	pthread_mutex_lock(&kds_lock);
+	if (!kds_curl) {
+		kds_curl = curl;
+		curl = NULL;
+	}
+	pthread_mutex_unlock(&kds_lock);
+
+	curl_easy_cleanup(curl);
+}
+
+/* Download HSK and CEK cert by ChipId, in a single attempt bounded by CURLOPT_TIMEOUT */
+static int download_hsk_cek_cert(const char *chip_id, uint8_t *hsk_cek)
+{
+	char url[200];
+	kds_response_t response = { .hsk_cek = hsk_cek };
+	CURLcode curl_ret;
+	long status = 0;
+	int ret = -1;
+
+	snprintf(url, sizeof(url), "%s%s", HYGON_KDS_SERVER_SITE, chip_id);
+
+	CURL *curl = kds_curl_get();
+	if (!curl) {
+		RTLS_ERR("failed to init curl.");
+		return -1;
+	}
+
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_writefunc_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
+	curl_ret = curl_easy_perform(curl);
+	if (curl_ret != CURLE_OK) {
+		RTLS_ERR("failed to download hsk_cek, %s\n", curl_easy_strerror(curl_ret));
+		goto err;
+	}
+
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+	if (status != 200 || response.len != HYGON_HSK_CEK_CERT_SIZE) {
+		RTLS_ERR("failed to download hsk_cek: HTTP status %ld, %zu bytes\n", status,
+			 response.len);
+		goto err;
+	}
+
+	ret = 0;
+err:
+	kds_curl_put(curl);
+	return ret;
+}
+
+/**
+ * Get HSK and CEK cert, and then save them to @hsk_cek.
+ *
+ * Params:
+ * 	chip_id [in]: platform's ChipId
+ * 	hsk_cek [in]: the buffer to save HSK and CEK cert, which follows the attestation
+ * 		      report
+ * Return:
+ * 	0: success
+ * 	otherwise error
+ */
+int csv_get_hsk_cek_cert(const char *chip_id, uint8_t *hsk_cek)
+{
+	hsk_cek_flight_t flight;
+	int ret = 0;
+
+	/* The certs are kept in memory once loaded */
+	if (hsk_cek_cache_get(chip_id, hsk_cek))
+		return 0;
+
+	if (!chip_id_is_valid(chip_id)) {
+		RTLS_ERR("invalid ChipId %s\n", chip_id);
+		return -1;
+	}
+
+	/* The certs of a chip are loaded by a single thread, so check again
+	 * whether another one loaded them meanwhile.
+	 */
+	flight_begin(&flight, chip_id);
+	if (hsk_cek_cache_get(chip_id, hsk_cek))
+		goto out;
+
+	/* First read hsk_cek cert from local file system, and then download
+	 * hsk_cek cert through network when the reading fails */
+	if (read_hsk_cek_cert_from_localfs(chip_id, hsk_cek)) {
+		if (download_hsk_cek_cert(chip_id, hsk_cek)) {
+			ret = -1;
+			goto out;
+		}
+
+		write_hsk_cek_cert_to_localfs(chip_id, hsk_cek);
+	}
+
+	hsk_cek_cache_add(chip_id, hsk_cek);
+out:
+	flight_end(&flight);
+	return ret;
+}
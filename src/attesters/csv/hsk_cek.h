@@ -0,0 +1,20 @@
+/* Copyright (c) 2022 Hygon Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _CSV_HSK_CEK_H
+#define _CSV_HSK_CEK_H
+
+#include <stdint.h>
+#include <rats-tls/csv.h>
+
+/* Maximum number of chips whose HSK and CEK certs are kept in memory, more than one
+ * only after the guest has been migrated.
+ */
+#define CSV_HSK_CEK_CACHE_SIZE 4
+
+int csv_get_hsk_cek_cert(const char *chip_id, uint8_t *hsk_cek);
+
+#endif
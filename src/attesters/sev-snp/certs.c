@@ -0,0 +1,110 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "sev_snp.h"
+#include "certs.h"
+
+/* The GUIDs of the certs in the table, in the byte order of uuid_parse() */
+static const uint8_t vcek_guid[16] = { 0x63, 0xda, 0x75, 0x8d, 0xe6, 0x64, 0x45, 0x64,
+				       0xad, 0xc5, 0xf4, 0xb9, 0x3b, 0xe8, 0xac, 0xcd };
+static const uint8_t ask_guid[16] = { 0x4a, 0xb7, 0xb3, 0x79, 0xbb, 0xac, 0x4f, 0xe4,
+				      0xa0, 0x2f, 0x05, 0xae, 0xf3, 0x27, 0xc7, 0x82 };
+static const uint8_t ark_guid[16] = { 0xc0, 0xb4, 0x06, 0xa4, 0xa8, 0x03, 0x49, 0x52,
+				      0x97, 0x43, 0x3f, 0xb6, 0x01, 0x4c, 0xd0, 0xae };
+
+/* The chain of the VCEK that signed the last report, as provided by the host */
+static snp_attestation_collateral_t saved;
+static pthread_mutex_t certs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Look up the cert @guid in the table, and return NULL if absent or out of bounds */
+static const uint8_t *find_cert(const uint8_t *certs, size_t certs_size, const uint8_t *guid,
+				uint32_t *cert_size)
+{
+	static const uint8_t zero_guid[16];
+	const snp_cert_table_entry_t *entry = (const snp_cert_table_entry_t *)certs;
+	const snp_cert_table_entry_t *end = entry + certs_size / sizeof(*entry);
+
+	for (; entry < end && memcmp(entry->guid, zero_guid, sizeof(zero_guid)); ++entry) {
+		if (memcmp(entry->guid, guid, sizeof(entry->guid)))
+			continue;
+
+		if (!entry->length || entry->offset > certs_size ||
+		    entry->length > certs_size - entry->offset)
+			return NULL;
+
+		*cert_size = entry->length;
+		return certs + entry->offset;
+	}
+
+	return NULL;
+}
+
+static void collateral_free(snp_attestation_collateral_t *collateral)
+{
+	free(collateral->vcek);
+	free(collateral->ask);
+	free(collateral->ark);
+	memset(collateral, 0, sizeof(*collateral));
+}
+
+static int collateral_copy(snp_attestation_collateral_t *dst,
+			   const snp_attestation_collateral_t *src)
+{
+	dst->vcek = malloc(src->vcek_size);
+	dst->ask = malloc(src->ask_size);
+	dst->ark = malloc(src->ark_size);
+	if (!dst->vcek || !dst->ask || !dst->ark) {
+		collateral_free(dst);
+		return -1;
+	}
+
+	memcpy(dst->vcek, src->vcek, src->vcek_size);
+	dst->vcek_size = src->vcek_size;
+	memcpy(dst->ask, src->ask, src->ask_size);
+	dst->ask_size = src->ask_size;
+	memcpy(dst->ark, src->ark, src->ark_size);
+	dst->ark_size = src->ark_size;
+
+	return 0;
+}
+
+/* Keep the VCEK, ASK and ARK from the cert table returned along with a report */
+void snp_certs_save(const uint8_t *certs, size_t certs_size)
+{
+	snp_attestation_collateral_t found, copy;
+
+	memset(&copy, 0, sizeof(copy));
+
+	found.vcek = (uint8_t *)find_cert(certs, certs_size, vcek_guid, &found.vcek_size);
+	found.ask = (uint8_t *)find_cert(certs, certs_size, ask_guid, &found.ask_size);
+	found.ark = (uint8_t *)find_cert(certs, certs_size, ark_guid, &found.ark_size);
+	if (!found.vcek || !found.ask || !found.ark)
+		RTLS_DEBUG("no VCEK chain provided by the host\n");
+	else if (collateral_copy(&copy, &found))
+		RTLS_WARN("failed to save the VCEK chain provided by the host\n");
+
+	pthread_mutex_lock(&certs_lock);
+	collateral_free(&saved);
+	saved = copy;
+	pthread_mutex_unlock(&certs_lock);
+}
+
+/* Copy the VCEK chain saved with the last report into @collateral */
+int snp_certs_get(snp_attestation_collateral_t *collateral)
+{
+	int ret = -1;
+
+	pthread_mutex_lock(&certs_lock);
+	if (saved.vcek)
+		ret = collateral_copy(collateral, &saved);
+	pthread_mutex_unlock(&certs_lock);
+
+	return ret;
+}
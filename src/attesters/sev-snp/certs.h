@@ -0,0 +1,20 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SEV_SNP_CERTS_H
+#define _SEV_SNP_CERTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <rats-tls/endorsement.h>
+
+/* The largest cert table accepted by the sev-guest driver */
+#define SNP_CERTS_MAX_SIZE 0x4000
+
+void snp_certs_save(const uint8_t *certs, size_t certs_size);
+int snp_certs_get(snp_attestation_collateral_t *collateral);
+
+#endif /* _SEV_SNP_CERTS_H */
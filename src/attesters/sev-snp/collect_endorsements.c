@@ -0,0 +1,24 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/log.h>
+#include <rats-tls/attester.h>
+#include "certs.h"
+
+enclave_attester_err_t sev_snp_collect_endorsements(enclave_attester_ctx_t *ctx,
+						    attestation_evidence_t *evidence,
+						    attestation_endorsement_t *endorsements)
+{
+	RTLS_DEBUG("ctx %p, evidence %p, endorsements %p\n", ctx, evidence, endorsements);
+
+	/* The host provides the VCEK chain along with the report, if configured to */
+	if (snp_certs_get(&endorsements->snp)) {
+		RTLS_DEBUG("no VCEK chain to provide\n");
+		return -ENCLAVE_ATTESTER_ERR_INVALID;
+	}
+
+	return ENCLAVE_ATTESTER_ERR_NONE;
+}
@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -16,30 +17,42 @@
 #include <rats-tls/attester.h>
 #include <rats-tls/log.h>
 #include "sev_snp.h"
+#include "certs.h"
 
 #define SEV_GUEST_DEVICE "/dev/sev-guest"
 
+/* The firmware and VMM errors share a field, renamed as of Linux 6.4 */
+#ifdef SNP_GUEST_VMM_ERR_SHIFT
+#define SNP_GUEST_REQ_ERR(req) ((req)->exitinfo2)
+#else
+#define SNP_GUEST_REQ_ERR(req) ((req)->fw_err)
+#endif
+
+/* Cleared once the VMM turns out not to support extended guest requests */
+static bool ext_report_supported = true;
+
 static int snp_get_report(const uint8_t *data, size_t data_size, snp_attestation_report_t *report)
 {
-	struct snp_report_req req;
+	struct snp_ext_report_req req;
 	struct snp_report_resp resp;
 	struct snp_guest_request_ioctl guest_req;
-	snp_msg_report_rsp_t *report_resp = (struct msg_report_resp *)&resp.data;
+	snp_msg_report_rsp_t *report_resp = (snp_msg_report_rsp_t *)&resp.data;
+	uint8_t *certs = NULL;
+	int ret = -1;
 
-	if (data && (data_size > sizeof(req.user_data) || data_size == 0) || !data || !report)
+	if (data && (data_size > sizeof(req.data.user_data) || data_size == 0) || !data || !report)
 		return -1;
 
 	/* Initialize data structures */
 	memset(&req, 0, sizeof(req));
-	req.vmpl = 1;
+	req.data.vmpl = 1;
 	if (data)
-		memcpy(&req.user_data, data, data_size);
+		memcpy(&req.data.user_data, data, data_size);
 
 	memset(&resp, 0, sizeof(resp));
 
 	memset(&guest_req, 0, sizeof(guest_req));
 	guest_req.msg_version = 1;
-	guest_req.req_data = (__u64)&req;
 	guest_req.resp_data = (__u64)&resp;
 
 	/* Open the sev-guest device */
@@ -49,14 +62,36 @@ static int snp_get_report(const uint8_t *data, size_t data_size, snp_attestation
 		return -1;
 	}
 
-	/* Issue the guest request IOCTL */
-	if (ioctl(fd, SNP_GET_REPORT, &guest_req) == -1) {
-		RTLS_ERR("failed to issue SNP_GET_REPORT ioctl, firmware error %llu\n",
-			 guest_req.fw_err);
-		goto out_close;
+	/* Get the certs of the VCEK chain provided by the host along with the report */
+	if (__atomic_load_n(&ext_report_supported, __ATOMIC_RELAXED))
+		certs = calloc(1, SNP_CERTS_MAX_SIZE);
+	if (certs) {
+		req.certs_address = (__u64)certs;
+		req.certs_len = SNP_CERTS_MAX_SIZE;
+		guest_req.req_data = (__u64)&req;
+
+		if (ioctl(fd, SNP_GET_EXT_REPORT, &guest_req) == -1) {
+			RTLS_WARN("failed to issue SNP_GET_EXT_REPORT ioctl, error %#llx, %s\n",
+				  (unsigned long long)SNP_GUEST_REQ_ERR(&guest_req), strerror(errno));
+
+			/* Other errors, e.g. a busy VMM or a short buffer, may not happen again */
+			if (errno == ENOTTY || errno == EOPNOTSUPP || errno == ENOSYS)
+				__atomic_store_n(&ext_report_supported, false, __ATOMIC_RELAXED);
+
+			free(certs);
+			certs = NULL;
+		}
 	}
 
-	close(fd);
+	/* Issue the guest request IOCTL */
+	if (!certs) {
+		guest_req.req_data = (__u64)&req.data;
+		if (ioctl(fd, SNP_GET_REPORT, &guest_req) == -1) {
+			RTLS_ERR("failed to issue SNP_GET_REPORT ioctl, error %#llx\n",
+				 (unsigned long long)SNP_GUEST_REQ_ERR(&guest_req));
+			goto out_close;
+		}
+	}
 
 	/* Check that the report was successfully generated */
 	if (report_resp->status != 0) {
@@ -72,12 +107,17 @@ static int snp_get_report(const uint8_t *data, size_t data_size, snp_attestation
 
 	memcpy(report, &report_resp->report, report_resp->report_size);
 
-	return 0;
+	/* Keep the certs of the chip and TCB that just signed the report */
+	if (certs)
+		snp_certs_save(certs, SNP_CERTS_MAX_SIZE);
+
+	ret = 0;
 
 out_close:
+	free(certs);
 	close(fd);
 
-	return -1;
+	return ret;
 }
 
 enclave_attester_err_t sev_snp_collect_evidence(enclave_attester_ctx_t *ctx,
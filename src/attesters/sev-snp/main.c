@@ -16,6 +16,9 @@ extern enclave_attester_err_t sev_snp_collect_evidence(enclave_attester_ctx_t *c
 						       attestation_evidence_t *evidence,
 						       rats_tls_cert_algo_t algo, uint8_t *hash,
 						       uint32_t hash_len);
+extern enclave_attester_err_t
+sev_snp_collect_endorsements(enclave_attester_ctx_t *ctx, attestation_evidence_t *evidence,
+			     attestation_endorsement_t *endorsements);
 extern enclave_attester_err_t sev_snp_attester_cleanup(enclave_attester_ctx_t *ctx);
 
 static enclave_attester_opts_t sev_snp_attester_opts = {
@@ -26,6 +29,7 @@ static enclave_attester_opts_t sev_snp_attester_opts = {
 	.pre_init = sev_snp_attester_pre_init,
 	.init = sev_snp_attester_init,
 	.collect_evidence = sev_snp_collect_evidence,
+	.collect_endorsements = sev_snp_collect_endorsements,
 	.cleanup = sev_snp_attester_cleanup,
 };
 
@@ -60,7 +60,11 @@ typedef struct snp_attestation_report {
 	uint8_t report_id[32]; /* 0x140 */
 	uint8_t report_id_ma[32]; /* 0x160 */
 	snp_tcb_version_t reported_tcb; /* 0x180 */
-	uint8_t reserved1[24]; /* 0x188 */
+	/* CPUID family, model and stepping, only reported as of version 3 */
+	uint8_t cpuid_fam_id; /* 0x188 */
+	uint8_t cpuid_mod_id; /* 0x189 */
+	uint8_t cpuid_step; /* 0x18A */
+	uint8_t reserved1[21]; /* 0x18B */
 	uint8_t chip_id[64]; /* 0x1A0 */
 	uint8_t reserved2[192]; /* 0x1E0 */
 	signature_t signature; /* 0x2A0 */
@@ -74,4 +78,16 @@ typedef struct snp_msg_report_rsp {
 	snp_attestation_report_t report;
 } __attribute__((packed)) snp_msg_report_rsp_t;
 
+/* The following structures are defined by the GHCB specification, please refer to
+ * https://www.amd.com/system/files/TechDocs/56421-guest-hypervisor-communication-block-standardization.pdf
+ * for details.
+ */
+
+/* Table 9. Certificate table entry, the table ends with an entry of zeros */
+typedef struct snp_cert_table_entry {
+	uint8_t guid[16];
+	uint32_t offset; /* from the start of the table */
+	uint32_t length;
+} __attribute__((packed)) snp_cert_table_entry_t;
+
 #endif /* _SEV_SNP_H */
@@ -0,0 +1,176 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include <rats-tls/endorsement.h>
+#include "internal/core.h"
+#include "internal/collateral.h"
+#include "internal/verify_cache.h"
+#include "collateral_cache.h"
+
+typedef struct sgx_ecdsa_collateral_entry {
+	struct sgx_ecdsa_collateral_entry *next;
+
+	sgx_collateral_key_t key;
+	sgx_ecdsa_attestation_collateral_t collateral;
+
+	/* Expiration time in seconds since the Epoch */
+	uint64_t expiry;
+	/* Time after which the collateral should be fetched again ahead of its expiration */
+	uint64_t refresh_at;
+	/* A thread is fetching the collateral again */
+	bool refreshing;
+} sgx_ecdsa_collateral_entry_t;
+
+static sgx_ecdsa_collateral_entry_t *collateral_cache;
+static unsigned int collateral_cache_size;
+static pthread_mutex_t collateral_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Must be called with collateral_cache_lock held */
+static sgx_ecdsa_collateral_entry_t **collateral_cache_find(const sgx_collateral_key_t *key)
+{
+	sgx_ecdsa_collateral_entry_t **pos;
+
+	for (pos = &collateral_cache; *pos; pos = &(*pos)->next) {
+		if (!memcmp(&(*pos)->key, key, sizeof(*key)))
+			break;
+	}
+
+	return pos;
+}
+
+/* Must be called with collateral_cache_lock held */
+static void collateral_cache_remove(sgx_ecdsa_collateral_entry_t **pos)
+{
+	sgx_ecdsa_collateral_entry_t *entry = *pos;
+
+	*pos = entry->next;
+	--collateral_cache_size;
+
+	sgx_collateral_free(&entry->collateral);
+	free(entry);
+}
+
+/* Copy the cached collateral of the platform, if still valid. Only a single
+ * caller at a time is asked to refresh a collateral about to expire, while the
+ * others keep on being served the cached one.
+ */
+sgx_ecdsa_collateral_state_t
+sgx_ecdsa_collateral_cache_lookup(const sgx_collateral_key_t *key,
+				  sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	sgx_ecdsa_collateral_state_t state = SGX_ECDSA_COLLATERAL_MISS;
+	uint64_t now = rtls_time();
+
+	pthread_mutex_lock(&collateral_cache_lock);
+
+	sgx_ecdsa_collateral_entry_t **pos = collateral_cache_find(key);
+	sgx_ecdsa_collateral_entry_t *entry = *pos;
+	if (!entry)
+		goto out;
+
+	if (entry->expiry <= now) {
+		RTLS_DEBUG("evict expired collateral %p\n", entry);
+		collateral_cache_remove(pos);
+		goto out;
+	}
+
+	if (sgx_collateral_dup(collateral, &entry->collateral))
+		goto out;
+
+	state = SGX_ECDSA_COLLATERAL_HIT;
+	if (entry->refresh_at <= now && !entry->refreshing) {
+		entry->refreshing = true;
+		state = SGX_ECDSA_COLLATERAL_REFRESH;
+	}
+out:
+	pthread_mutex_unlock(&collateral_cache_lock);
+
+	return state;
+}
+
+/* Must be called with collateral_cache_lock held */
+static void collateral_cache_retry(sgx_ecdsa_collateral_entry_t *entry)
+{
+	entry->refreshing = false;
+	entry->refresh_at = rtls_time() + SGX_ECDSA_COLLATERAL_RETRY_INTERVAL;
+}
+
+/* Replace the cached collateral of the platform. The one being refreshed is
+ * kept if the new one can't be cached, so that the refresh is retried later.
+ */
+void sgx_ecdsa_collateral_cache_insert(const sgx_collateral_key_t *key,
+				       const sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	attestation_endorsement_t endorsements = { .ecdsa = *collateral };
+	uint64_t now = rtls_time();
+	uint64_t expiry = rtls_verify_cache_collateral_expiry("sgx_ecdsa", &endorsements);
+	sgx_ecdsa_collateral_entry_t *entry = NULL;
+
+	if (!expiry)
+		expiry = now + SGX_ECDSA_COLLATERAL_TTL_DEFAULT;
+
+	/* A collateral already out of date is not worth caching */
+	if (expiry > now) {
+		entry = calloc(1, sizeof(*entry));
+		if (entry && sgx_collateral_dup(&entry->collateral, collateral)) {
+			free(entry);
+			entry = NULL;
+		}
+	}
+
+	pthread_mutex_lock(&collateral_cache_lock);
+
+	sgx_ecdsa_collateral_entry_t **pos = collateral_cache_find(key);
+	if (!entry) {
+		if (*pos)
+			collateral_cache_retry(*pos);
+		goto out;
+	}
+
+	if (*pos)
+		collateral_cache_remove(pos);
+
+	memcpy(&entry->key, key, sizeof(entry->key));
+	entry->expiry = expiry;
+	/* Refresh ahead once three quarters of the lifetime have elapsed */
+	entry->refresh_at = now + (expiry - now) / 4 * 3;
+
+	/* Make room by evicting the collateral expiring first */
+	if (collateral_cache_size >= SGX_ECDSA_COLLATERAL_CACHE_SIZE) {
+		sgx_ecdsa_collateral_entry_t **victim = &collateral_cache;
+
+		for (pos = &collateral_cache; *pos; pos = &(*pos)->next) {
+			if ((*pos)->expiry < (*victim)->expiry)
+				victim = pos;
+		}
+		collateral_cache_remove(victim);
+	}
+
+	entry->next = collateral_cache;
+	collateral_cache = entry;
+	++collateral_cache_size;
+
+	RTLS_DEBUG("cache collateral %p expiring at %lu, refreshed from %lu\n", entry,
+		   (unsigned long)entry->expiry, (unsigned long)entry->refresh_at);
+out:
+	pthread_mutex_unlock(&collateral_cache_lock);
+}
+
+/* Keep serving the cached collateral until its expiration, and retry later */
+void sgx_ecdsa_collateral_cache_refresh_failed(const sgx_collateral_key_t *key)
+{
+	pthread_mutex_lock(&collateral_cache_lock);
+
+	sgx_ecdsa_collateral_entry_t *entry = *collateral_cache_find(key);
+	if (entry)
+		collateral_cache_retry(entry);
+
+	pthread_mutex_unlock(&collateral_cache_lock);
+}
@@ -0,0 +1,38 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SGX_ECDSA_COLLATERAL_CACHE_H
+#define _SGX_ECDSA_COLLATERAL_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rats-tls/endorsement.h>
+#include "internal/collateral.h"
+
+/* Maximum number of platforms whose collateral is kept in the cache */
+#define SGX_ECDSA_COLLATERAL_CACHE_SIZE 8
+/* Lifetime in seconds of a collateral without any nextUpdate time */
+#define SGX_ECDSA_COLLATERAL_TTL_DEFAULT 3600
+/* Delay in seconds before retrying a failed refresh of a cached collateral */
+#define SGX_ECDSA_COLLATERAL_RETRY_INTERVAL 60
+
+typedef enum {
+	/* No usable collateral is cached */
+	SGX_ECDSA_COLLATERAL_MISS,
+	/* The cached collateral is returned */
+	SGX_ECDSA_COLLATERAL_HIT,
+	/* The cached collateral is returned but the caller should refresh it */
+	SGX_ECDSA_COLLATERAL_REFRESH,
+} sgx_ecdsa_collateral_state_t;
+
+extern sgx_ecdsa_collateral_state_t
+sgx_ecdsa_collateral_cache_lookup(const sgx_collateral_key_t *key,
+				  sgx_ecdsa_attestation_collateral_t *collateral);
+extern void sgx_ecdsa_collateral_cache_insert(const sgx_collateral_key_t *key,
+					      const sgx_ecdsa_attestation_collateral_t *collateral);
+extern void sgx_ecdsa_collateral_cache_refresh_failed(const sgx_collateral_key_t *key);
+
+#endif
@@ -15,11 +15,12 @@
 #include <sgx_lfence.h>
 #include "rtls_t.h"
 #include <sgx_ql_quote.h>
+#include "collateral_cache.h"
 // clang-format on
 
-enclave_attester_err_t sgx_ecdsa_collect_endorsements(enclave_attester_ctx_t *ctx,
-						      attestation_evidence_t *evidence,
-						      attestation_endorsement_t *endorsements)
+static enclave_attester_err_t sgx_ecdsa_fetch_endorsements(enclave_attester_ctx_t *ctx,
+							   attestation_evidence_t *evidence,
+							   attestation_endorsement_t *endorsements)
 {
 	enclave_attester_err_t ret = ENCLAVE_ATTESTER_ERR_NONE;
 	uint8_t *collateral_untrusted = NULL; /* address of collateral in untrusted-app */
@@ -109,6 +110,48 @@ err:
 	return ret;
 }
 
+enclave_attester_err_t sgx_ecdsa_collect_endorsements(enclave_attester_ctx_t *ctx,
+						      attestation_evidence_t *evidence,
+						      attestation_endorsement_t *endorsements)
+{
+	sgx_ecdsa_collateral_state_t state = SGX_ECDSA_COLLATERAL_MISS;
+	sgx_collateral_key_t key;
+
+	/* The collateral fetched from the PCCS is shared by all the quotes of the platform */
+	bool cacheable = sgx_collateral_key_from_quote(evidence->ecdsa.quote,
+						       evidence->ecdsa.quote_len, &key);
+	if (cacheable) {
+		state = sgx_ecdsa_collateral_cache_lookup(&key, &endorsements->ecdsa);
+		if (state == SGX_ECDSA_COLLATERAL_HIT) {
+			RTLS_DEBUG("use the cached collateral\n");
+			return ENCLAVE_ATTESTER_ERR_NONE;
+		}
+	}
+
+	attestation_endorsement_t fetched;
+	memset(&fetched, 0, sizeof(fetched));
+
+	enclave_attester_err_t ret = sgx_ecdsa_fetch_endorsements(ctx, evidence, &fetched);
+	if (ret != ENCLAVE_ATTESTER_ERR_NONE) {
+		if (state != SGX_ECDSA_COLLATERAL_REFRESH)
+			return ret;
+
+		/* The cached collateral is still valid until its expiration */
+		RTLS_WARN("failed to refresh the collateral, use the cached one\n");
+		sgx_ecdsa_collateral_cache_refresh_failed(&key);
+		return ENCLAVE_ATTESTER_ERR_NONE;
+	}
+
+	if (state == SGX_ECDSA_COLLATERAL_REFRESH)
+		free_endorsements(evidence->type, endorsements);
+	*endorsements = fetched;
+
+	if (cacheable)
+		sgx_ecdsa_collateral_cache_insert(&key, &endorsements->ecdsa);
+
+	return ENCLAVE_ATTESTER_ERR_NONE;
+}
+
 #else
 
 enclave_attester_err_t sgx_ecdsa_collect_endorsements(enclave_attester_ctx_t *ctx,
@@ -0,0 +1,226 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <openssl/pem.h>
+#include <rats-tls/log.h>
+#include "internal/der.h"
+#include "internal/collateral.h"
+
+/* Offset of the signature data in a SGX quote version 3, i.e. the size of
+ * the quote header (48 bytes), of the report body (384 bytes) and of the
+ * size of the signature data (4 bytes).
+ */
+#define SGX_QUOTE3_SIGNATURE_DATA_OFFSET 436
+/* Size of the ECDSA signature, attestation key, QE report and QE report
+ * signature preceding the QE authentication data in the signature data.
+ */
+#define SGX_QL_ECDSA_SIG_DATA_SIZE 576
+#define SGX_QL_PCK_CERT_CHAIN	   5
+
+/* The SGX extension of the PCK certificate, and the common names of its issuers */
+#define SGX_EXTENSION_OID	"1.2.840.113741.1.13.1"
+#define SGX_PCK_PROCESSOR_CA_CN "Intel SGX PCK Processor CA"
+#define SGX_PCK_PLATFORM_CA_CN	"Intel SGX PCK Platform CA"
+
+/* DER encoding of the FMSPC OID 1.2.840.113741.1.13.1.4 */
+static const uint8_t fmspc_oid[] = { 0x2a, 0x86, 0x48, 0x86, 0xf8, 0x4d, 0x01, 0x0d, 0x01, 0x04 };
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define ASN1_STRING_get0_data ASN1_STRING_data
+#endif
+
+static uint32_t get_le(const uint8_t *p, size_t n)
+{
+	uint32_t v = 0;
+
+	while (n--)
+		v = (v << 8) | p[n];
+
+	return v;
+}
+
+/* Find the FMSPC in the SGX extension of the PCK certificate, which is a
+ * SEQUENCE of SEQUENCE { OID, value }.
+ */
+static bool sgx_extension_fmspc(const uint8_t *p, size_t len, uint8_t *fmspc)
+{
+	const uint8_t *end = p + len;
+	const uint8_t *content;
+	size_t content_len;
+
+	if (der_next_element(&p, end, &content, &content_len) != DER_TAG_SEQUENCE)
+		return false;
+
+	p = content;
+	end = content + content_len;
+	while (p < end) {
+		const uint8_t *item, *oid;
+		size_t item_len, oid_len;
+
+		if (der_next_element(&p, end, &item, &item_len) != DER_TAG_SEQUENCE)
+			return false;
+
+		const uint8_t *q = item;
+		const uint8_t *item_end = item + item_len;
+		if (der_next_element(&q, item_end, &oid, &oid_len) != DER_TAG_OID)
+			return false;
+
+		if (oid_len != sizeof(fmspc_oid) || memcmp(oid, fmspc_oid, oid_len))
+			continue;
+
+		if (der_next_element(&q, item_end, &content, &content_len) !=
+			    DER_TAG_OCTET_STRING ||
+		    content_len != SGX_FMSPC_SIZE)
+			return false;
+
+		memcpy(fmspc, content, SGX_FMSPC_SIZE);
+		return true;
+	}
+
+	return false;
+}
+
+static bool pck_cert_key(X509 *cert, sgx_collateral_key_t *key)
+{
+	ASN1_OBJECT *obj = OBJ_txt2obj(SGX_EXTENSION_OID, 1);
+	if (!obj)
+		return false;
+
+	int idx = X509_get_ext_by_OBJ(cert, obj, -1);
+	ASN1_OBJECT_free(obj);
+	if (idx < 0) {
+		RTLS_DEBUG("no SGX extension in the PCK certificate\n");
+		return false;
+	}
+
+	ASN1_OCTET_STRING *ext = X509_EXTENSION_get_data(X509_get_ext(cert, idx));
+	if (!ext || !sgx_extension_fmspc(ASN1_STRING_get0_data(ext),
+					 (size_t)ASN1_STRING_length(ext), key->fmspc)) {
+		RTLS_DEBUG("no FMSPC in the SGX extension of the PCK certificate\n");
+		return false;
+	}
+
+	char issuer[64];
+	if (X509_NAME_get_text_by_NID(X509_get_issuer_name(cert), NID_commonName, issuer,
+				      sizeof(issuer)) > 0) {
+		if (!strcmp(issuer, SGX_PCK_PROCESSOR_CA_CN))
+			key->ca = SGX_PCK_CA_PROCESSOR;
+		else if (!strcmp(issuer, SGX_PCK_PLATFORM_CA_CN))
+			key->ca = SGX_PCK_CA_PLATFORM;
+	}
+
+	return true;
+}
+
+/* Derive the collateral key from the PCK certificate carried by the quote */
+bool sgx_collateral_key_from_quote(const uint8_t *quote, uint32_t quote_len,
+				   sgx_collateral_key_t *key)
+{
+	memset(key, 0, sizeof(*key));
+
+	if (quote_len < SGX_QUOTE3_SIGNATURE_DATA_OFFSET)
+		return false;
+
+	uint32_t signature_data_len = get_le(quote + SGX_QUOTE3_SIGNATURE_DATA_OFFSET - 4, 4);
+	if (signature_data_len > quote_len - SGX_QUOTE3_SIGNATURE_DATA_OFFSET)
+		return false;
+
+	const uint8_t *p = quote + SGX_QUOTE3_SIGNATURE_DATA_OFFSET;
+	const uint8_t *end = p + signature_data_len;
+
+	/* The QE authentication data follows the ECDSA signature data */
+	if ((size_t)(end - p) < SGX_QL_ECDSA_SIG_DATA_SIZE + 2)
+		return false;
+	p += SGX_QL_ECDSA_SIG_DATA_SIZE;
+
+	uint32_t auth_data_size = get_le(p, 2);
+	p += 2;
+	if ((size_t)(end - p) < auth_data_size + 6)
+		return false;
+	p += auth_data_size;
+
+	/* The certification data is made of its type, its size and its content */
+	uint32_t cert_type = get_le(p, 2);
+	uint32_t cert_size = get_le(p + 2, 4);
+	p += 6;
+	if (cert_type != SGX_QL_PCK_CERT_CHAIN || (size_t)(end - p) < cert_size ||
+	    cert_size > INT_MAX) {
+		RTLS_DEBUG("no PCK certificate chain in the quote\n");
+		return false;
+	}
+
+	/* The first certificate of the chain is the PCK certificate */
+	BIO *bio = BIO_new_mem_buf((void *)p, (int)cert_size);
+	if (!bio)
+		return false;
+
+	bool found = false;
+	X509 *cert = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+	if (cert) {
+		found = pck_cert_key(cert, key);
+		X509_free(cert);
+	}
+	BIO_free(bio);
+
+	return found;
+}
+
+/* Return the name of the CA as used by the PCS API, or NULL if unknown */
+const char *sgx_pck_ca_name(sgx_pck_ca_t ca)
+{
+	switch (ca) {
+	case SGX_PCK_CA_PROCESSOR:
+		return "processor";
+	case SGX_PCK_CA_PLATFORM:
+		return "platform";
+	default:
+		return NULL;
+	}
+}
+
+void sgx_collateral_free(sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	attestation_endorsement_t endorsements = { .ecdsa = *collateral };
+
+	free_endorsements("sgx_ecdsa", &endorsements);
+	memset(collateral, 0, sizeof(*collateral));
+}
+
+int sgx_collateral_dup(sgx_ecdsa_attestation_collateral_t *dst,
+		       const sgx_ecdsa_attestation_collateral_t *src)
+{
+	memset(dst, 0, sizeof(*dst));
+	dst->version = src->version;
+
+#define DUP_COLLATERAL_FIELD(value_field, size_field)			     \
+	do {								     \
+		dst->value_field = malloc(src->size_field);		     \
+		if (!dst->value_field)					     \
+			goto err;					     \
+		memcpy(dst->value_field, src->value_field, src->size_field); \
+		dst->size_field = src->size_field;			     \
+	} while (0)
+
+	DUP_COLLATERAL_FIELD(pck_crl_issuer_chain, pck_crl_issuer_chain_size);
+	DUP_COLLATERAL_FIELD(root_ca_crl, root_ca_crl_size);
+	DUP_COLLATERAL_FIELD(pck_crl, pck_crl_size);
+	DUP_COLLATERAL_FIELD(tcb_info_issuer_chain, tcb_info_issuer_chain_size);
+	DUP_COLLATERAL_FIELD(tcb_info, tcb_info_size);
+	DUP_COLLATERAL_FIELD(qe_identity_issuer_chain, qe_identity_issuer_chain_size);
+	DUP_COLLATERAL_FIELD(qe_identity, qe_identity_size);
+#undef DUP_COLLATERAL_FIELD
+
+	return 0;
+
+err:
+	sgx_collateral_free(dst);
+	return -1;
+}
@@ -0,0 +1,223 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <openssl/x509.h>
+#include <openssl/pem.h>
+#include <openssl/err.h>
+#include <rats-tls/log.h>
+#include "internal/der.h"
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define X509_CRL_get0_nextUpdate X509_CRL_get_nextUpdate
+#endif
+
+uint64_t civil_to_epoch(unsigned int year, unsigned int month, unsigned int day,
+			unsigned int hour, unsigned int minute, unsigned int second)
+{
+	if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 ||
+	    minute > 59 || second > 60)
+		return 0;
+
+	/* Days since the Epoch of the proleptic Gregorian calendar date */
+	unsigned int y = year - (month <= 2);
+	unsigned int era = y / 400;
+	unsigned int yoe = y - era * 400;
+	unsigned int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	uint64_t days = (uint64_t)era * 146097 + doe - 719468;
+
+	return days * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+/* Return the tag of the DER element at *p and advance *p past it, or -1 if
+ * the element is malformed or runs beyond end.
+ */
+int der_next_element(const uint8_t **p, const uint8_t *end, const uint8_t **content,
+		     size_t *content_len)
+{
+	const uint8_t *s = *p;
+
+	if (end - s < 2)
+		return -1;
+
+	int tag = s[0];
+	size_t len = s[1];
+	s += 2;
+
+	if (len & 0x80) {
+		size_t n = len & 0x7f;
+
+		/* Indefinite lengths are not allowed by DER */
+		if (!n || n > sizeof(uint32_t) || (size_t)(end - s) < n)
+			return -1;
+
+		for (len = 0; n; --n)
+			len = (len << 8) | *s++;
+	}
+
+	if ((size_t)(end - s) < len)
+		return -1;
+
+	*content = s;
+	*content_len = len;
+	*p = s + len;
+
+	return tag;
+}
+
+/* Decode the first PEM block labelled as label into a buffer to be freed by the caller */
+uint8_t *pem_to_der(const char *pem, size_t pem_len, const char *label, size_t *der_len)
+{
+	char *name, *header;
+	unsigned char *data;
+	long len;
+	uint8_t *der = NULL;
+
+	BIO *bio = BIO_new_mem_buf(pem, (int)pem_len);
+	if (!bio)
+		return NULL;
+
+	ERR_set_mark();
+	while (!der && PEM_read_bio(bio, &name, &header, &data, &len)) {
+		if (!strcmp(name, label) && len > 0) {
+			der = malloc((size_t)len);
+			if (der) {
+				memcpy(der, data, (size_t)len);
+				*der_len = (size_t)len;
+			}
+		}
+
+		OPENSSL_free(name);
+		OPENSSL_free(header);
+		OPENSSL_free(data);
+	}
+
+	/* Don't leave the end of the input reported to the next TLS operation */
+	ERR_pop_to_mark();
+	BIO_free(bio);
+
+	return der;
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+/* Decode a certificate or CRL of a collateral into DER. Depending on the
+ * provider, they come PEM encoded, as hex encoded DER or as raw DER.
+ */
+uint8_t *collateral_to_der(const char *buf, size_t len, const char *label, size_t *der_len)
+{
+	/* The size of a collateral string may include its terminating NUL */
+	while (len && buf[len - 1] == '\0')
+		--len;
+
+	if (!len)
+		return NULL;
+
+	if ((uint8_t)buf[0] == DER_TAG_SEQUENCE) {
+		uint8_t *der = malloc(len);
+		if (!der)
+			return NULL;
+
+		memcpy(der, buf, len);
+		*der_len = len;
+
+		return der;
+	}
+
+	if (buf[0] == '-')
+		return pem_to_der(buf, len, label, der_len);
+
+	if (len % 2)
+		return NULL;
+
+	uint8_t *der = malloc(len / 2);
+	if (!der)
+		return NULL;
+
+	for (size_t i = 0; i < len; i += 2) {
+		int hi = hex_value(buf[i]);
+		int lo = hex_value(buf[i + 1]);
+		if (hi < 0 || lo < 0) {
+			free(der);
+			return NULL;
+		}
+
+		der[i / 2] = (uint8_t)(hi << 4 | lo);
+	}
+	*der_len = len / 2;
+
+	return der;
+}
+
+/* Parse a CRL, which comes PEM encoded, as hex encoded DER or as raw DER */
+static X509_CRL *collateral_to_crl(const char *crl, size_t crl_len)
+{
+	X509_CRL *x509_crl = NULL;
+	size_t der_len;
+
+	if (crl_len && crl[0] == '-') {
+		BIO *bio = BIO_new_mem_buf(crl, (int)crl_len);
+		if (!bio)
+			return NULL;
+
+		ERR_set_mark();
+		x509_crl = PEM_read_bio_X509_CRL(bio, NULL, NULL, NULL);
+		ERR_pop_to_mark();
+		BIO_free(bio);
+
+		return x509_crl;
+	}
+
+	uint8_t *der = collateral_to_der(crl, crl_len, "X509 CRL", &der_len);
+	if (!der)
+		return NULL;
+
+	const unsigned char *p = der;
+	x509_crl = d2i_X509_CRL(NULL, &p, (long)der_len);
+	free(der);
+
+	return x509_crl;
+}
+
+/* Return the nextUpdate time of a CRL, or 0 if unknown */
+uint64_t crl_next_update(const char *crl, size_t crl_len)
+{
+	uint64_t next_update = 0;
+
+	if (!crl)
+		return 0;
+
+	X509_CRL *x509_crl = collateral_to_crl(crl, crl_len);
+	if (!x509_crl) {
+		RTLS_DEBUG("failed to parse the CRL\n");
+		return 0;
+	}
+
+	/* The time is relative to the Epoch, without depending on the local clock */
+	const ASN1_TIME *time = X509_CRL_get0_nextUpdate(x509_crl);
+	ASN1_TIME *epoch = ASN1_TIME_set(NULL, 0);
+	int days, seconds;
+	if (time && epoch && ASN1_TIME_diff(&days, &seconds, epoch, time) && days >= 0)
+		next_update = (uint64_t)days * 86400 + (uint64_t)seconds;
+
+	ASN1_TIME_free(epoch);
+	X509_CRL_free(x509_crl);
+
+	return next_update;
+}
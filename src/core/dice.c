@@ -156,6 +156,24 @@ int evidence_from_raw(const uint8_t *data, size_t size, uint64_t tag,
 * DICE related attester functions
 */
 
+/* The size of the buffer allocated by cbor_serialize_alloc() may be larger than
+ * the encoded data, so report the length of the data rather than the buffer
+ * size. Otherwise the trailing bytes are undefined.
+ */
+static bool dice_serialize_alloc(const cbor_item_t *item, uint8_t **buffer_out,
+				 size_t *buffer_size_out)
+{
+	size_t buffer_size = 0;
+	size_t length = cbor_serialize_alloc(item, buffer_out, &buffer_size);
+
+	if (!length)
+		return false;
+
+	*buffer_size_out = length;
+
+	return true;
+}
+
 enclave_attester_err_t dice_generate_pubkey_hash_value_buffer(hash_algo_t pubkey_hash_algo,
 							      const uint8_t *pubkey_hash,
 							      uint8_t **pubkey_hash_value_buffer,
@@ -189,7 +207,7 @@ enclave_attester_err_t dice_generate_pubkey_hash_value_buffer(hash_algo_t pubkey
 	if (!cbor_array_push(root, cbor_move(cbor_build_bytestring(pubkey_hash, hash_size))))
 		goto err;
 
-	if (!cbor_serialize_alloc(root, pubkey_hash_value_buffer, pubkey_hash_value_buffer_size))
+	if (!dice_serialize_alloc(root, pubkey_hash_value_buffer, pubkey_hash_value_buffer_size))
 		goto err;
 
 	ret = ENCLAVE_ATTESTER_ERR_NONE;
@@ -247,7 +265,7 @@ dice_generate_claims_buffer(hash_algo_t pubkey_hash_algo, const uint8_t *pubkey_
 
 	/* Generate claims buffer */
 	ret = ENCLAVE_ATTESTER_ERR_NO_MEM;
-	if (!cbor_serialize_alloc(root, claims_buffer_out, claims_buffer_size_out))
+	if (!dice_serialize_alloc(root, claims_buffer_out, claims_buffer_size_out))
 		goto err;
 
 	ret = ENCLAVE_ATTESTER_ERR_NONE;
@@ -297,7 +315,7 @@ enclave_attester_err_t dice_generate_evidence_buffer_with_tag(
 			     cbor_move(cbor_build_bytestring(claims_buffer, claims_buffer_size))))
 		goto err;
 	cbor_tag_set_item(root, array);
-	if (!cbor_serialize_alloc(root, evidence_buffer_out, evidence_buffer_size_out))
+	if (!dice_serialize_alloc(root, evidence_buffer_out, evidence_buffer_size_out))
 		goto err;
 
 	ret = ENCLAVE_ATTESTER_ERR_NONE;
@@ -317,7 +335,7 @@ enclave_attester_err_t dice_generate_endorsements_buffer_with_tag(
 	cbor_item_t *root = NULL;
 	cbor_item_t *array = NULL;
 
-	/* Currently we only support endorsements for SGX/TDX ECDSA mode */
+	/* Currently we only support endorsements for SGX/TDX ECDSA and SEV-SNP mode */
 	if (!strcmp(type, "sgx_ecdsa") || !strcmp(type, "tdx_ecdsa")) {
 		/* endorsements_buffer is a tagged CBOR definite-length array with 8 or 9 entries. */
 		/* endorsements_buffer: <tag1>([h'<VERSION>', h'<TCB_INFO>', h'<TCB_ISSUER_CHAIN>', h'<CRL_PCK_CERT>', h'<CRL_PCK_PROC_CA>', h'<CRL_ISSUER_CHAIN_PCK_CERT>', h'<QE_ID_INFO>', h'<QE_ID_ISSUER_CHAIN>', h'<CREATION_DATETIME>']) */
@@ -381,7 +399,44 @@ enclave_attester_err_t dice_generate_endorsements_buffer_with_tag(
 			goto err;
 
 		cbor_tag_set_item(root, array);
-		if (!cbor_serialize_alloc(root, endorsements_buffer_out,
+		if (!dice_serialize_alloc(root, endorsements_buffer_out,
+					  endorsements_buffer_size_out))
+			goto err;
+	} else if (!strcmp(type, "sev_snp")) {
+		/* endorsements_buffer is a tagged CBOR definite-length array with 3 entries. */
+		/* endorsements_buffer: <tag1>([h'<VCEK>', h'<ASK>', h'<ARK>']) */
+		ret = ENCLAVE_ATTESTER_ERR_INVALID;
+		uint64_t tag_value = tag_of_evidence_type(type);
+		if (!tag_value)
+			goto err;
+
+		ret = ENCLAVE_ATTESTER_ERR_NO_MEM;
+		root = cbor_new_tag(tag_value);
+		if (!root)
+			goto err;
+
+		array = cbor_new_definite_array(3);
+		if (!array)
+			goto err;
+
+		/* h'<VCEK>' */
+		if (!cbor_array_push(array, cbor_move(cbor_build_bytestring(
+						    (cbor_data)endorsements->snp.vcek,
+						    endorsements->snp.vcek_size))))
+			goto err;
+		/* h'<ASK>' */
+		if (!cbor_array_push(array, cbor_move(cbor_build_bytestring(
+						    (cbor_data)endorsements->snp.ask,
+						    endorsements->snp.ask_size))))
+			goto err;
+		/* h'<ARK>' */
+		if (!cbor_array_push(array, cbor_move(cbor_build_bytestring(
+						    (cbor_data)endorsements->snp.ark,
+						    endorsements->snp.ark_size))))
+			goto err;
+
+		cbor_tag_set_item(root, array);
+		if (!dice_serialize_alloc(root, endorsements_buffer_out,
 					  endorsements_buffer_size_out))
 			goto err;
 	} else {
@@ -429,6 +484,13 @@ err:
 		memcpy(buffer_field, cbor_bytestring_handle(cbor_object), buffer_size_field); \
 	}
 
+/* cbor_decref() clears the reference only once the item is freed */
+#define RATS_VERIFIER_CBOR_PUT(cbor_object) \
+	{                                   \
+		cbor_decref(&cbor_object);  \
+		cbor_object = NULL;         \
+	}
+
 enclave_verifier_err_t dice_parse_evidence_buffer_with_tag(const uint8_t *evidence_buffer,
 							   size_t evidence_buffer_size,
 							   attestation_evidence_t *evidence,
@@ -528,7 +590,7 @@ dice_parse_endorsements_buffer_with_tag(const char *type, const uint8_t *endorse
 	cbor_item_t *array = NULL;
 	cbor_item_t *array_i = NULL;
 
-	/* Currently we only support endorsements for SGX/TDX ECDSA mode */
+	/* Currently we only support endorsements for SGX/TDX ECDSA and SEV-SNP mode */
 	if (!strcmp(type, "sgx_ecdsa") || !strcmp(type, "tdx_ecdsa")) {
 		/* Parse endorsements_buffer as cbor data: an encoded tagged CBOR definite-length array with 8 entries. */
 		struct cbor_load_result result;
@@ -567,52 +629,52 @@ dice_parse_endorsements_buffer_with_tag(const char *type, const uint8_t *endorse
 		RATS_VERIFIER_CBOR_ASSERT(cbor_isa_uint(array_i));
 		RATS_VERIFIER_CBOR_ASSERT(cbor_int_get_width(array_i) == CBOR_INT_32);
 		endorsements->ecdsa.version = cbor_get_uint32(array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<TCB_INFO>' */
 		array_i = cbor_array_get(array, 1);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.tcb_info,
 						     endorsements->ecdsa.tcb_info_size, array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<TCB_ISSUER_CHAIN>' */
 		array_i = cbor_array_get(array, 2);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.tcb_info_issuer_chain,
 						     endorsements->ecdsa.tcb_info_issuer_chain_size,
 						     array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<CRL_PCK_CERT>' */
 		array_i = cbor_array_get(array, 3);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.pck_crl,
 						     endorsements->ecdsa.pck_crl_size, array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<CRL_PCK_PROC_CA>' */
 		array_i = cbor_array_get(array, 4);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.root_ca_crl,
 						     endorsements->ecdsa.root_ca_crl_size, array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<CRL_ISSUER_CHAIN_PCK_CERT>' */
 		array_i = cbor_array_get(array, 5);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.pck_crl_issuer_chain,
 						     endorsements->ecdsa.pck_crl_issuer_chain_size,
 						     array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<QE_ID_INFO>' */
 		array_i = cbor_array_get(array, 6);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->ecdsa.qe_identity,
 						     endorsements->ecdsa.qe_identity_size, array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* h'<QE_ID_ISSUER_CHAIN>' */
 		array_i = cbor_array_get(array, 7);
 		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(
 			endorsements->ecdsa.qe_identity_issuer_chain,
 			endorsements->ecdsa.qe_identity_issuer_chain_size, array_i);
-		cbor_decref(&array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 
 		/* We do'not support h'<CREATION_DATETIME>' here. */
 
@@ -620,6 +682,48 @@ dice_parse_endorsements_buffer_with_tag(const char *type, const uint8_t *endorse
 		uint64_t tag_value = tag_of_evidence_type(type);
 		if (!tag_value)
 			goto err;
+	} else if (!strcmp(type, "sev_snp")) {
+		/* Parse endorsements_buffer as cbor data: an encoded tagged CBOR definite-length array with 3 entries. */
+		struct cbor_load_result result;
+		root = cbor_load(endorsements_buffer, endorsements_buffer_size, &result);
+		if (result.error.code != CBOR_ERR_NONE) {
+			ret = result.error.code == CBOR_ERR_MEMERROR ? ENCLAVE_VERIFIER_ERR_NO_MEM :
+								       ENCLAVE_VERIFIER_ERR_CBOR;
+			RTLS_ERR("Failed to parse endorsements_buffer as cbor data. pos: %zu\n",
+				 result.error.position);
+			goto err;
+		}
+
+		/* Check cbor tag */
+		RATS_VERIFIER_CBOR_ASSERT(cbor_isa_tag(root));
+		if (cbor_tag_value(root) != OCBR_TAG_EVIDENCE_SEV_SNP) {
+			RTLS_ERR("Bad cbor data: invalid cbor tag got: 0x%zx, 0x%zx expected\n",
+				 cbor_tag_value(root), (uint64_t)OCBR_TAG_EVIDENCE_SEV_SNP);
+			goto err;
+		}
+
+		array = cbor_tag_item(root);
+		RATS_VERIFIER_CBOR_ASSERT(cbor_isa_array(array));
+		RATS_VERIFIER_CBOR_ASSERT(cbor_array_is_definite(array));
+		RATS_VERIFIER_CBOR_ASSERT(cbor_array_size(array) == 3);
+
+		/* h'<VCEK>' */
+		array_i = cbor_array_get(array, 0);
+		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->snp.vcek,
+						     endorsements->snp.vcek_size, array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
+
+		/* h'<ASK>' */
+		array_i = cbor_array_get(array, 1);
+		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->snp.ask,
+						     endorsements->snp.ask_size, array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
+
+		/* h'<ARK>' */
+		array_i = cbor_array_get(array, 2);
+		RATS_VERIFIER_CBOR_COPY_BYTE_STRINGS(endorsements->snp.ark,
+						     endorsements->snp.ark_size, array_i);
+		RATS_VERIFIER_CBOR_PUT(array_i);
 	} else {
 		RTLS_FATAL(
 			"Failed to generate endorsements buffer: unsupported evidence type: %s\n",
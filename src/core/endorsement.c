@@ -44,6 +44,11 @@ void free_endorsements(const char *type, attestation_endorsement_t *endorsements
 			free(endorsements->ecdsa.qe_identity);
 			endorsements->ecdsa.qe_identity = NULL;
 		}
+	} else if (!strcmp(type, "sev_snp")) {
+		free(endorsements->snp.vcek);
+		free(endorsements->snp.ask);
+		free(endorsements->snp.ark);
+		memset(&endorsements->snp, 0, sizeof(endorsements->snp));
 	} else {
 		RTLS_WARN("Unable to free endorsements: unsupported evidence type: %s\n", type);
 	}
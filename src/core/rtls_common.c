@@ -10,10 +10,13 @@
 #include <dlfcn.h>
 #include <strings.h>
 #include <dirent.h>
+#include <sys/sendfile.h>
 #endif
 #include <string.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <time.h>
 #include "rats-tls/api.h"
 #include "rats-tls/log.h"
 #include "internal/core.h"
@@ -41,6 +44,15 @@ void rtls_exit(void)
 	ocall_exit();
 }
 
+uint64_t rtls_time(void)
+{
+	int now = 0;
+
+	ocall_low_res_time(&now);
+
+	return (uint64_t)now;
+}
+
 rats_tls_log_level_t get_loglevel_env(const char *name)
 {
 	size_t log_level_len = 8;
@@ -158,6 +170,54 @@ ssize_t rtls_read(int fd, void *buf, size_t count)
 	return rc;
 }
 
+/* The buffers are gathered in the enclave to be written by a single ocall */
+ssize_t rtls_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	size_t count = 0;
+	for (int i = 0; i < iovcnt; ++i)
+		count += iov[i].iov_len;
+
+	uint8_t *buf = malloc(count ? count : 1);
+	if (!buf)
+		return -1;
+
+	size_t off = 0;
+	for (int i = 0; i < iovcnt; ++i) {
+		memcpy(buf + off, iov[i].iov_base, iov[i].iov_len);
+		off += iov[i].iov_len;
+	}
+
+	ssize_t rc = rtls_write(fd, buf, count);
+	free(buf);
+
+	return rc;
+}
+
+ssize_t rtls_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	ssize_t rc;
+	int sgx_status = ocall_pread(&rc, fd, buf, count, (int64_t)offset);
+
+	if (SGX_SUCCESS != sgx_status)
+		RTLS_ERR("sgx failed to read data, sgx status: 0x%04x\n", sgx_status);
+
+	return rc;
+}
+
+ssize_t rtls_sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+	ssize_t rc;
+	int64_t off = (int64_t)*offset;
+	int sgx_status = ocall_sendfile(&rc, out_fd, in_fd, &off, count);
+
+	if (SGX_SUCCESS != sgx_status)
+		RTLS_ERR("sgx failed to send file, sgx status: 0x%04x\n", sgx_status);
+	else
+		*offset = (off_t)off;
+
+	return rc;
+}
+
 uint64_t rtls_opendir(const char *name)
 {
 	uint64_t dir;
@@ -198,6 +258,11 @@ void rtls_exit(void)
 	exit(EXIT_FAILURE);
 }
 
+uint64_t rtls_time(void)
+{
+	return (uint64_t)time(NULL);
+}
+
 rats_tls_log_level_t get_loglevel_env(const char *name)
 {
 	char *log_level_str = getenv(name);
@@ -244,6 +309,21 @@ ssize_t rtls_read(int fd, void *buf, size_t count)
 	return read(fd, buf, count);
 }
 
+ssize_t rtls_writev(int fd, const struct iovec *iov, int iovcnt)
+{
+	return writev(fd, iov, iovcnt);
+}
+
+ssize_t rtls_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	return pread(fd, buf, count, offset);
+}
+
+ssize_t rtls_sendfile(int out_fd, int in_fd, off_t *offset, size_t count)
+{
+	return sendfile(out_fd, in_fd, offset, count);
+}
+
 uint64_t rtls_opendir(const char *name)
 {
 	return (uint64_t)opendir(name);
@@ -0,0 +1,158 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include <rats-tls/claim.h>
+#include "internal/core.h"
+#include "internal/cert_cache.h"
+
+/* The process-wide list of attested certificates available for reuse */
+static rtls_cert_bundle_t *cert_cache;
+static pthread_mutex_t cert_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+rtls_cert_bundle_t *rtls_cert_bundle_new(rtls_core_context_t *ctx)
+{
+	rtls_cert_bundle_t *bundle = calloc(1, sizeof(*bundle));
+	if (!bundle)
+		return NULL;
+
+	snprintf(bundle->attester_type, sizeof(bundle->attester_type), "%s",
+		 ctx->attester->opts->name);
+	snprintf(bundle->crypto_type, sizeof(bundle->crypto_type), "%s",
+		 ctx->crypto_wrapper->opts->name);
+	bundle->cert_algo = ctx->config.cert_algo;
+	bundle->flags = ctx->config.flags & RATS_TLS_CERT_CACHE_FLAGS_MASK;
+
+	if (ctx->config.custom_claims_length) {
+		bundle->custom_claims = clone_claims_list(ctx->config.custom_claims,
+							  ctx->config.custom_claims_length);
+		if (!bundle->custom_claims) {
+			free(bundle);
+			return NULL;
+		}
+		bundle->custom_claims_length = ctx->config.custom_claims_length;
+	}
+
+	unsigned int ttl = ctx->config.cert_cache_ttl;
+	if (!ttl)
+		ttl = RATS_TLS_CERT_CACHE_TTL_DEFAULT;
+	bundle->created = rtls_time();
+	bundle->expiry = bundle->created + ttl;
+	bundle->refcount = 1;
+
+	return bundle;
+}
+
+rtls_cert_bundle_t *rtls_cert_bundle_get(rtls_cert_bundle_t *bundle)
+{
+	__atomic_add_fetch(&bundle->refcount, 1, __ATOMIC_SEQ_CST);
+
+	return bundle;
+}
+
+void rtls_cert_bundle_put(rtls_cert_bundle_t *bundle)
+{
+	if (!bundle || __atomic_sub_fetch(&bundle->refcount, 1, __ATOMIC_SEQ_CST))
+		return;
+
+	free_claims_list(bundle->custom_claims, bundle->custom_claims_length);
+	free(bundle->privkey_buf);
+	free(bundle->cert_buf);
+	free(bundle->evidence_buffer);
+	free(bundle->endorsements_buffer);
+	free(bundle);
+}
+
+static bool claims_equal(const claim_t *a, size_t a_len, const claim_t *b, size_t b_len)
+{
+	if (a_len != b_len)
+		return false;
+
+	for (size_t i = 0; i < a_len; ++i) {
+		if (strcmp(a[i].name, b[i].name) || a[i].value_size != b[i].value_size ||
+		    memcmp(a[i].value, b[i].value, a[i].value_size))
+			return false;
+	}
+
+	return true;
+}
+
+/* Whether the certificate of @bundle fits the configuration of @ctx */
+static bool bundle_match(const rtls_cert_bundle_t *bundle, const rtls_core_context_t *ctx)
+{
+	unsigned long flags = ctx->config.flags & RATS_TLS_CERT_CACHE_FLAGS_MASK;
+
+	/* A certificate with endorsements also serves the handles which don't provide them */
+	if (bundle->flags & RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS)
+		flags |= RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS;
+
+	return !strcmp(bundle->attester_type, ctx->attester->opts->name) &&
+	       !strcmp(bundle->crypto_type, ctx->crypto_wrapper->opts->name) &&
+	       bundle->cert_algo == ctx->config.cert_algo && bundle->flags == flags &&
+	       claims_equal(bundle->custom_claims, bundle->custom_claims_length,
+			    ctx->config.custom_claims, ctx->config.custom_claims_length);
+}
+
+/* Must be called with cert_cache_lock held */
+static void cert_cache_evict_expired(uint64_t now)
+{
+	rtls_cert_bundle_t **pprev = &cert_cache;
+
+	while (*pprev) {
+		rtls_cert_bundle_t *bundle = *pprev;
+
+		if (bundle->expiry > now) {
+			pprev = &bundle->next;
+			continue;
+		}
+
+		RTLS_DEBUG("evict expired certificate bundle %p\n", bundle);
+
+		*pprev = bundle->next;
+		rtls_cert_bundle_put(bundle);
+	}
+}
+
+rtls_cert_bundle_t *rtls_cert_cache_lookup(rtls_core_context_t *ctx)
+{
+	rtls_cert_bundle_t *bundle;
+
+	pthread_mutex_lock(&cert_cache_lock);
+
+	cert_cache_evict_expired(rtls_time());
+
+	for (bundle = cert_cache; bundle; bundle = bundle->next) {
+		if (bundle_match(bundle, ctx)) {
+			rtls_cert_bundle_get(bundle);
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cert_cache_lock);
+
+	if (bundle)
+		RTLS_DEBUG("reuse the cached certificate bundle %p\n", bundle);
+
+	return bundle;
+}
+
+void rtls_cert_cache_insert(rtls_cert_bundle_t *bundle)
+{
+	pthread_mutex_lock(&cert_cache_lock);
+
+	cert_cache_evict_expired(rtls_time());
+
+	/* The cache holds its own reference */
+	bundle->next = cert_cache;
+	cert_cache = rtls_cert_bundle_get(bundle);
+
+	pthread_mutex_unlock(&cert_cache_lock);
+}
@@ -0,0 +1,182 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// clang-format off
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#ifndef SGX
+#include <time.h>
+#include <pthread.h>
+#endif
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/cert_cache.h"
+#include "internal/cert_rotation.h"
+// clang-format on
+
+#ifndef SGX
+struct rtls_cert_rotation {
+	pthread_t tid;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	/* Time of the last rotation attempt */
+	uint64_t rotated_at;
+	/* Whether the last rotation attempt failed */
+	bool failed;
+	bool stop;
+};
+
+/* Schedule the next rotation ahead of the certificate in use going stale */
+static uint64_t next_rotation(rtls_core_context_t *ctx, uint64_t last)
+{
+	uint64_t interval = ctx->config.cert_rotation_interval;
+	if (!interval)
+		interval = RATS_TLS_CERT_ROTATION_INTERVAL_DEFAULT;
+
+	/* Reissue the leaf certificate once three quarters of its lifetime elapsed */
+	if (ctx->config.flags & RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER) {
+		uint64_t ttl = ctx->config.leaf_cert_ttl;
+		if (!ttl)
+			ttl = RATS_TLS_LEAF_CERT_TTL_DEFAULT;
+		if (ttl * 3 / 4 < interval)
+			interval = ttl * 3 / 4;
+	}
+
+	uint64_t deadline = last + interval;
+
+	/* Don't keep rotating if the collateral fetched is already out of date */
+	uint64_t expiry = rtls_core_collateral_expiry(ctx);
+	if (expiry && expiry < deadline + RATS_TLS_CERT_ROTATION_AHEAD) {
+		deadline = expiry - RATS_TLS_CERT_ROTATION_AHEAD;
+		if (expiry < RATS_TLS_CERT_ROTATION_AHEAD ||
+		    deadline < last + RATS_TLS_CERT_ROTATION_RETRY)
+			deadline = last + RATS_TLS_CERT_ROTATION_RETRY;
+	}
+
+	return deadline;
+}
+
+static void *rotation_thread(void *arg)
+{
+	rtls_core_context_t *ctx = (rtls_core_context_t *)arg;
+	struct rtls_cert_rotation *rotation = ctx->cert_rotation;
+
+	pthread_mutex_lock(&rotation->lock);
+	while (!rotation->stop) {
+		/* Recomputed on wakeup in case of an explicit rotation */
+		uint64_t deadline = rotation->failed ?
+					    rotation->rotated_at + RATS_TLS_CERT_ROTATION_RETRY :
+					    next_rotation(ctx, rotation->rotated_at);
+		struct timespec ts = { .tv_sec = (time_t)deadline };
+		if (pthread_cond_timedwait(&rotation->cond, &rotation->lock, &ts) != ETIMEDOUT)
+			continue;
+
+		rotation->rotated_at = rtls_time();
+		pthread_mutex_unlock(&rotation->lock);
+
+		/* New TLS sessions keep using the current certificate meanwhile */
+		rats_tls_err_t err = rtls_core_rotate_certificate(ctx, false);
+		if (err == -TLS_WRAPPER_ERR_NOT_SUPPORTED) {
+			RTLS_ERR("the tls wrapper '%s' does not support certificate rotation\n",
+				 ctx->tls_wrapper->opts->name);
+			pthread_mutex_lock(&rotation->lock);
+			break;
+		}
+		if (err != RATS_TLS_ERR_NONE)
+			RTLS_ERR("failed to rotate the certificate of handle %p %#x, retry in %d seconds\n",
+				 ctx, err, RATS_TLS_CERT_ROTATION_RETRY);
+
+		pthread_mutex_lock(&rotation->lock);
+		rotation->failed = err != RATS_TLS_ERR_NONE;
+	}
+	pthread_mutex_unlock(&rotation->lock);
+
+	return NULL;
+}
+
+rats_tls_err_t rtls_core_cert_rotation_start(rtls_core_context_t *ctx)
+{
+	RTLS_DEBUG("ctx %p\n", ctx);
+
+	if (!ctx->tls_wrapper->opts->replace_cert) {
+		RTLS_ERR("the tls wrapper '%s' does not support certificate rotation\n",
+			 ctx->tls_wrapper->opts->name);
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	struct rtls_cert_rotation *rotation = calloc(1, sizeof(*rotation));
+	if (!rotation)
+		return -RATS_TLS_ERR_NO_MEM;
+
+	pthread_mutex_init(&rotation->lock, NULL);
+	pthread_cond_init(&rotation->cond, NULL);
+	rotation->rotated_at = rtls_time();
+	ctx->cert_rotation = rotation;
+
+	if (pthread_create(&rotation->tid, NULL, rotation_thread, ctx)) {
+		RTLS_ERR("failed to create the certificate rotation thread\n");
+		pthread_cond_destroy(&rotation->cond);
+		pthread_mutex_destroy(&rotation->lock);
+		free(rotation);
+		ctx->cert_rotation = NULL;
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	return RATS_TLS_ERR_NONE;
+}
+
+void rtls_core_cert_rotation_notify(rtls_core_context_t *ctx)
+{
+	struct rtls_cert_rotation *rotation = ctx->cert_rotation;
+	if (!rotation)
+		return;
+
+	pthread_mutex_lock(&rotation->lock);
+	rotation->rotated_at = rtls_time();
+	rotation->failed = false;
+	pthread_cond_signal(&rotation->cond);
+	pthread_mutex_unlock(&rotation->lock);
+}
+
+void rtls_core_cert_rotation_stop(rtls_core_context_t *ctx)
+{
+	struct rtls_cert_rotation *rotation = ctx->cert_rotation;
+	if (!rotation)
+		return;
+
+	pthread_mutex_lock(&rotation->lock);
+	rotation->stop = true;
+	pthread_cond_signal(&rotation->cond);
+	pthread_mutex_unlock(&rotation->lock);
+
+	pthread_join(rotation->tid, NULL);
+
+	pthread_cond_destroy(&rotation->cond);
+	pthread_mutex_destroy(&rotation->lock);
+	free(rotation);
+	ctx->cert_rotation = NULL;
+}
+#else
+/* No thread can be created inside the enclave. The application is expected
+ * to call rats_tls_rotate_cert() from an untrusted thread instead.
+ */
+rats_tls_err_t rtls_core_cert_rotation_start(rtls_core_context_t *ctx)
+{
+	RTLS_DEBUG("background rotation unsupported for handle %p\n", ctx);
+
+	return RATS_TLS_ERR_NONE;
+}
+
+void rtls_core_cert_rotation_notify(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+}
+
+void rtls_core_cert_rotation_stop(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+}
+#endif
@@ -0,0 +1,374 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/evidence_batch.h"
+
+/* The hash of an inner node of the Merkle tree, distinguished from the
+ * leaves, i.e, the hashes of claims buffers, by a prefix byte.
+ */
+static crypto_wrapper_err_t merkle_node(crypto_wrapper_ctx_t *crypto_ctx, const uint8_t *left,
+					const uint8_t *right, uint8_t *node)
+{
+	uint8_t buf[1 + 2 * SHA256_HASH_SIZE];
+
+	buf[0] = 1;
+	memcpy(buf + 1, left, SHA256_HASH_SIZE);
+	memcpy(buf + 1 + SHA256_HASH_SIZE, right, SHA256_HASH_SIZE);
+
+	return crypto_ctx->opts->gen_hash(crypto_ctx, HASH_ALGO_SHA256, buf, sizeof(buf), node);
+}
+
+/* Reduce a level of the tree to its parent level in place. The last node of
+ * a level with an odd number of nodes is promoted as is.
+ */
+static crypto_wrapper_err_t merkle_reduce(crypto_wrapper_ctx_t *crypto_ctx,
+					  uint8_t (*level)[SHA256_HASH_SIZE], size_t *nr_nodes)
+{
+	size_t n = *nr_nodes;
+
+	for (size_t i = 0; i < n / 2; ++i) {
+		uint8_t node[SHA256_HASH_SIZE];
+
+		crypto_wrapper_err_t err =
+			merkle_node(crypto_ctx, level[2 * i], level[2 * i + 1], node);
+		if (err != CRYPTO_WRAPPER_ERR_NONE)
+			return err;
+
+		memcpy(level[i], node, SHA256_HASH_SIZE);
+	}
+
+	if (n % 2)
+		memcpy(level[n / 2], level[n - 1], SHA256_HASH_SIZE);
+
+	*nr_nodes = (n + 1) / 2;
+
+	return CRYPTO_WRAPPER_ERR_NONE;
+}
+
+crypto_wrapper_err_t rtls_merkle_proof(crypto_wrapper_ctx_t *crypto_ctx,
+				       const uint8_t (*leaves)[SHA256_HASH_SIZE], size_t nr_leaves,
+				       size_t index, uint8_t **proof_out, size_t *proof_size_out)
+{
+	crypto_wrapper_err_t err = -CRYPTO_WRAPPER_ERR_INVALID;
+	uint8_t *proof = NULL;
+	size_t proof_size = 0;
+
+	if (!nr_leaves || index >= nr_leaves)
+		return err;
+
+	err = -CRYPTO_WRAPPER_ERR_NO_MEM;
+	uint8_t(*level)[SHA256_HASH_SIZE] = malloc(nr_leaves * SHA256_HASH_SIZE);
+	if (!level)
+		return err;
+	memcpy(level, leaves, nr_leaves * SHA256_HASH_SIZE);
+
+	/* The depth of the tree is at most the bit width of nr_leaves */
+	proof = malloc(sizeof(size_t) * 8 * MERKLE_PROOF_STEP_SIZE);
+	if (!proof)
+		goto err;
+
+	for (size_t n = nr_leaves; n > 1; index /= 2) {
+		size_t sibling = index ^ 1;
+
+		/* A promoted node has no sibling at this level */
+		if (sibling < n) {
+			uint8_t *step = proof + proof_size;
+
+			step[0] = (index & 1) ? MERKLE_PROOF_SIBLING_LEFT :
+						MERKLE_PROOF_SIBLING_RIGHT;
+			memcpy(step + 1, level[sibling], SHA256_HASH_SIZE);
+			proof_size += MERKLE_PROOF_STEP_SIZE;
+		}
+
+		err = merkle_reduce(crypto_ctx, level, &n);
+		if (err != CRYPTO_WRAPPER_ERR_NONE)
+			goto err;
+	}
+
+	*proof_out = proof;
+	*proof_size_out = proof_size;
+	proof = NULL;
+
+	err = CRYPTO_WRAPPER_ERR_NONE;
+err:
+	free(proof);
+	free(level);
+	return err;
+}
+
+crypto_wrapper_err_t rtls_merkle_root(crypto_wrapper_ctx_t *crypto_ctx,
+				      const uint8_t (*leaves)[SHA256_HASH_SIZE], size_t nr_leaves,
+				      uint8_t *root)
+{
+	if (!nr_leaves)
+		return -CRYPTO_WRAPPER_ERR_INVALID;
+
+	uint8_t(*level)[SHA256_HASH_SIZE] = malloc(nr_leaves * SHA256_HASH_SIZE);
+	if (!level)
+		return -CRYPTO_WRAPPER_ERR_NO_MEM;
+	memcpy(level, leaves, nr_leaves * SHA256_HASH_SIZE);
+
+	crypto_wrapper_err_t err = CRYPTO_WRAPPER_ERR_NONE;
+	for (size_t n = nr_leaves; n > 1 && err == CRYPTO_WRAPPER_ERR_NONE;)
+		err = merkle_reduce(crypto_ctx, level, &n);
+
+	if (err == CRYPTO_WRAPPER_ERR_NONE)
+		memcpy(root, level[0], SHA256_HASH_SIZE);
+
+	free(level);
+
+	return err;
+}
+
+crypto_wrapper_err_t rtls_merkle_root_from_proof(crypto_wrapper_ctx_t *crypto_ctx,
+						 const uint8_t *leaf, const uint8_t *proof,
+						 size_t proof_size, uint8_t *root)
+{
+	uint8_t node[SHA256_HASH_SIZE];
+
+	if (proof_size % MERKLE_PROOF_STEP_SIZE)
+		return -CRYPTO_WRAPPER_ERR_INVALID;
+
+	memcpy(node, leaf, SHA256_HASH_SIZE);
+
+	for (size_t i = 0; i < proof_size; i += MERKLE_PROOF_STEP_SIZE) {
+		const uint8_t *step = proof + i;
+		crypto_wrapper_err_t err;
+
+		if (step[0] == MERKLE_PROOF_SIBLING_LEFT)
+			err = merkle_node(crypto_ctx, step + 1, node, node);
+		else if (step[0] == MERKLE_PROOF_SIBLING_RIGHT)
+			err = merkle_node(crypto_ctx, node, step + 1, node);
+		else
+			err = -CRYPTO_WRAPPER_ERR_INVALID;
+		if (err != CRYPTO_WRAPPER_ERR_NONE)
+			return err;
+	}
+
+	memcpy(root, node, SHA256_HASH_SIZE);
+
+	return CRYPTO_WRAPPER_ERR_NONE;
+}
+
+#ifndef SGX
+// clang-format off
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+// clang-format on
+
+/* The claims buffers to be attested together by a single evidence */
+typedef struct rtls_evidence_batch {
+	struct rtls_evidence_batch *next;
+	char attester_type[ENCLAVE_ATTESTER_TYPE_NAME_SIZE];
+	rats_tls_cert_algo_t cert_algo;
+
+	uint8_t leaves[RATS_TLS_EVIDENCE_BATCH_SIZE][SHA256_HASH_SIZE];
+	size_t nr_leaves;
+	/* No more claims buffer can join the batch */
+	bool closed;
+	/* The evidence of the batch has been collected */
+	bool done;
+	enclave_attester_err_t err;
+	attestation_evidence_t evidence;
+
+	/* Number of the contexts waiting for the evidence */
+	unsigned int refcount;
+} rtls_evidence_batch_t;
+
+/* The batches open to claims buffers */
+static rtls_evidence_batch_t *open_batches;
+/* The batches whose evidence is being collected */
+static rtls_evidence_batch_t *busy_batches;
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t batch_cond = PTHREAD_COND_INITIALIZER;
+
+/* Must be called with batch_lock held */
+static void batch_unlink(rtls_evidence_batch_t **list, rtls_evidence_batch_t *batch)
+{
+	rtls_evidence_batch_t **pprev = list;
+
+	while (*pprev != batch)
+		pprev = &(*pprev)->next;
+	*pprev = batch->next;
+}
+
+/* Must be called with batch_lock held */
+static void batch_close(rtls_evidence_batch_t *batch)
+{
+	batch_unlink(&open_batches, batch);
+	batch->closed = true;
+}
+
+/* Must be called with batch_lock held */
+static rtls_evidence_batch_t *batch_find(rtls_evidence_batch_t *list, rtls_core_context_t *ctx)
+{
+	for (; list; list = list->next) {
+		if (!strcmp(list->attester_type, ctx->attester->opts->name) &&
+		    list->cert_algo == ctx->config.cert_algo)
+			break;
+	}
+
+	return list;
+}
+
+/* Must be called with batch_lock held */
+static rtls_evidence_batch_t *batch_join(rtls_core_context_t *ctx, const uint8_t *leaf,
+					 size_t *index, bool *leader)
+{
+	rtls_evidence_batch_t *batch = batch_find(open_batches, ctx);
+
+	*leader = !batch;
+	if (!batch) {
+		batch = calloc(1, sizeof(*batch));
+		if (!batch)
+			return NULL;
+
+		snprintf(batch->attester_type, sizeof(batch->attester_type), "%s",
+			 ctx->attester->opts->name);
+		batch->cert_algo = ctx->config.cert_algo;
+		batch->next = open_batches;
+		open_batches = batch;
+	}
+
+	*index = batch->nr_leaves++;
+	memcpy(batch->leaves[*index], leaf, SHA256_HASH_SIZE);
+	++batch->refcount;
+
+	/* Wake up the leader to collect the evidence of a full batch */
+	if (batch->nr_leaves == RATS_TLS_EVIDENCE_BATCH_SIZE) {
+		batch_close(batch);
+		pthread_cond_broadcast(&batch_cond);
+	}
+
+	return batch;
+}
+
+/* Must be called with batch_lock held by the context creating the batch.
+ *
+ * The evidence is collected at once if no other batch of the same attester
+ * is being attested. Otherwise, the claims buffers arriving meanwhile join
+ * the batch, which is attested as soon as the previous one is done, or the
+ * batch is full, or evidence_batch_window milliseconds elapsed.
+ */
+static void batch_attest(rtls_core_context_t *ctx, rtls_evidence_batch_t *batch)
+{
+	unsigned int window = ctx->config.evidence_batch_window;
+	if (!window)
+		window = RATS_TLS_EVIDENCE_BATCH_WINDOW_DEFAULT;
+
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_sec += window / 1000;
+	deadline.tv_nsec += (long)(window % 1000) * 1000000;
+	if (deadline.tv_nsec >= 1000000000) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	while (!batch->closed && batch_find(busy_batches, ctx)) {
+		if (pthread_cond_timedwait(&batch_cond, &batch_lock, &deadline) == ETIMEDOUT)
+			break;
+	}
+	if (!batch->closed)
+		batch_close(batch);
+
+	batch->next = busy_batches;
+	busy_batches = batch;
+
+	pthread_mutex_unlock(&batch_lock);
+
+	RTLS_DEBUG("collect the evidence of %zu claims buffers\n", batch->nr_leaves);
+
+	/* The evidence attests the root of the Merkle tree over the batch */
+	uint8_t root[SHA256_HASH_SIZE];
+	enclave_attester_err_t err = -ENCLAVE_ATTESTER_ERR_INVALID;
+	if (rtls_merkle_root(ctx->crypto_wrapper, (const uint8_t(*)[SHA256_HASH_SIZE])batch->leaves,
+			     batch->nr_leaves, root) == CRYPTO_WRAPPER_ERR_NONE)
+		err = ctx->attester->opts->collect_evidence(ctx->attester, &batch->evidence,
+							    ctx->config.cert_algo, root,
+							    sizeof(root));
+
+	pthread_mutex_lock(&batch_lock);
+
+	batch_unlink(&busy_batches, batch);
+	batch->err = err;
+	batch->done = true;
+	pthread_cond_broadcast(&batch_cond);
+}
+
+enclave_attester_err_t rtls_core_batch_collect_evidence(rtls_core_context_t *ctx,
+							const uint8_t *leaf,
+							attestation_evidence_t *evidence,
+							uint8_t **proof_out, size_t *proof_size_out)
+{
+	size_t index;
+	bool leader;
+
+	*proof_out = NULL;
+	*proof_size_out = 0;
+
+	pthread_mutex_lock(&batch_lock);
+
+	rtls_evidence_batch_t *batch = batch_join(ctx, leaf, &index, &leader);
+	if (!batch) {
+		pthread_mutex_unlock(&batch_lock);
+		return -ENCLAVE_ATTESTER_ERR_NO_MEM;
+	}
+
+	if (leader)
+		batch_attest(ctx, batch);
+
+	while (!batch->done)
+		pthread_cond_wait(&batch_cond, &batch_lock);
+
+	pthread_mutex_unlock(&batch_lock);
+
+	/* The batch is immutable once done */
+	enclave_attester_err_t err = batch->err;
+	if (err == ENCLAVE_ATTESTER_ERR_NONE) {
+		memcpy(evidence, &batch->evidence, sizeof(*evidence));
+
+		/* A single claims buffer is attested directly */
+		if (batch->nr_leaves > 1 &&
+		    rtls_merkle_proof(ctx->crypto_wrapper,
+				      (const uint8_t(*)[SHA256_HASH_SIZE])batch->leaves,
+				      batch->nr_leaves, index, proof_out,
+				      proof_size_out) != CRYPTO_WRAPPER_ERR_NONE)
+			err = -ENCLAVE_ATTESTER_ERR_NO_MEM;
+	}
+
+	pthread_mutex_lock(&batch_lock);
+	bool last = !--batch->refcount;
+	pthread_mutex_unlock(&batch_lock);
+
+	if (last)
+		free(batch);
+
+	return err;
+}
+#else
+/* Claims buffers are attested one by one in enclave */
+enclave_attester_err_t rtls_core_batch_collect_evidence(rtls_core_context_t *ctx,
+							const uint8_t *leaf,
+							attestation_evidence_t *evidence,
+							uint8_t **proof_out, size_t *proof_size_out)
+{
+	*proof_out = NULL;
+	*proof_size_out = 0;
+
+	return ctx->attester->opts->collect_evidence(ctx->attester, evidence,
+						     ctx->config.cert_algo, (uint8_t *)leaf,
+						     SHA256_HASH_SIZE);
+}
+#endif
@@ -10,21 +10,199 @@
 #include "internal/attester.h"
 #include "internal/verifier.h"
 #include "internal/dice.h"
+#include "internal/cert_cache.h"
+#include "internal/evidence_batch.h"
+#include "internal/verify_cache.h"
 #include <string.h>
+#include <pthread.h>
 
-rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
+/* Protect the certificate bundle in use by each handle, swapped on rotation */
+static pthread_mutex_t cert_bundle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Use the private key and certificate for TLS sessions, or replace the ones
+ * used by new TLS sessions on rotation.
+ */
+static tls_wrapper_err_t install_cert(rtls_core_context_t *ctx, uint8_t *privkey_buf,
+				      unsigned int privkey_len, rats_tls_cert_info_t *cert_info,
+				      bool replace)
 {
-	RTLS_DEBUG("ctx %p\n", ctx);
+#if 0
+	#ifndef SGX
+	/* Dump private key of this certificate */
+	FILE *fp = fopen("/tmp/privkey.der", "wb");
+	fwrite(privkey_buf, privkey_len, 1, fp);
+	fclose(fp);
+	#endif
+#endif
 
-	if (!ctx || !ctx->tls_wrapper || !ctx->tls_wrapper->opts || !ctx->crypto_wrapper ||
-	    !ctx->crypto_wrapper->opts || !ctx->crypto_wrapper->opts->gen_pubkey_hash ||
-	    !ctx->crypto_wrapper->opts->gen_cert)
-		return -RATS_TLS_ERR_INVALID;
+	if (replace)
+		return ctx->tls_wrapper->opts->replace_cert(ctx->tls_wrapper, ctx->config.cert_algo,
+							    privkey_buf, privkey_len, cert_info);
 
-	/* Avoid re-generation of TLS certificates */
-	if (ctx->flags & RATS_TLS_CTX_FLAGS_CERT_CREATED)
-		return RATS_TLS_ERR_NONE;
+	tls_wrapper_err_t t_err = ctx->tls_wrapper->opts->use_privkey(
+		ctx->tls_wrapper, ctx->config.cert_algo, privkey_buf, privkey_len);
+	if (t_err != TLS_WRAPPER_ERR_NONE)
+		return t_err;
+
+	return ctx->tls_wrapper->opts->use_cert(ctx->tls_wrapper, cert_info);
+}
+
+/* Sign a leaf certificate for a fresh key with the attested issuer, and use
+ * them for TLS session along with the certificate of the issuer.
+ */
+static rats_tls_err_t use_leaf_cert(rtls_core_context_t *ctx, rtls_cert_bundle_t *issuer,
+				    bool replace)
+{
+	uint8_t privkey_buf[2048];
+	unsigned int privkey_len = sizeof(privkey_buf);
+	crypto_wrapper_err_t c_err = ctx->crypto_wrapper->opts->gen_privkey(
+		ctx->crypto_wrapper, ctx->config.cert_algo, privkey_buf, &privkey_len);
+	if (c_err != CRYPTO_WRAPPER_ERR_NONE)
+		return c_err;
+
+	unsigned int ttl = ctx->config.leaf_cert_ttl;
+	if (!ttl)
+		ttl = RATS_TLS_LEAF_CERT_TTL_DEFAULT;
+
+	rats_tls_cert_info_t cert_info = {
+		.subject = {
+			.organization = (const unsigned char *)"Inclavare Containers",
+			.common_name = (const unsigned char *)"RATS-TLS",
+		},
+		.issuer_cert_buf = issuer->cert_buf,
+		.issuer_cert_len = issuer->cert_len,
+		.issuer_privkey_buf = issuer->privkey_buf,
+		.issuer_privkey_len = issuer->privkey_len,
+		.validity = ttl,
+	};
+
+	c_err = ctx->crypto_wrapper->opts->gen_cert(ctx->crypto_wrapper, ctx->config.cert_algo,
+						    &cert_info);
+	if (c_err != CRYPTO_WRAPPER_ERR_NONE)
+		return c_err;
+
+	rats_tls_err_t ret = RATS_TLS_ERR_NONE;
+	if (ctx->attester->opts->extend_cert) {
+		enclave_attester_err_t a_ret =
+			ctx->attester->opts->extend_cert(ctx->attester, &cert_info);
+		if (a_ret != ENCLAVE_ATTESTER_ERR_NONE) {
+			RTLS_ERR("failed to extend the leaf certificate %#x\n", a_ret);
+			ret = a_ret;
+			goto err;
+		}
+	}
+
+	ret = install_cert(ctx, privkey_buf, privkey_len, &cert_info, replace);
+	if (ret != TLS_WRAPPER_ERR_NONE)
+		goto err;
+
+	RTLS_DEBUG("leaf certificate issued for %u seconds\n", ttl);
+
+	ret = RATS_TLS_ERR_NONE;
+err:
+	free(cert_info.cert_buf);
+	return ret;
+}
+
+/* Use the certificate in the bundle for TLS sessions, and take over the
+ * reference to the bundle.
+ */
+static rats_tls_err_t use_cert_bundle(rtls_core_context_t *ctx, rtls_cert_bundle_t *bundle,
+				      bool replace)
+{
+	rats_tls_err_t err = RATS_TLS_ERR_NONE;
+
+	if (bundle->privkey_len && (ctx->config.flags & RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER)) {
+		err = use_leaf_cert(ctx, bundle, replace);
+	} else if (bundle->privkey_len) {
+		/* Use the TLS certificate and private key for TLS session */
+		rats_tls_cert_info_t cert_info = {
+			.cert_buf = bundle->cert_buf,
+			.cert_len = bundle->cert_len,
+			.evidence_buffer = bundle->evidence_buffer,
+			.evidence_buffer_size = bundle->evidence_buffer_size,
+			.endorsements_buffer = bundle->endorsements_buffer,
+			.endorsements_buffer_size = bundle->endorsements_buffer_size,
+		};
+
+		tls_wrapper_err_t t_err = install_cert(ctx, bundle->privkey_buf,
+						       bundle->privkey_len, &cert_info, replace);
+		if (t_err != TLS_WRAPPER_ERR_NONE)
+			err = t_err;
+	}
+	if (err != RATS_TLS_ERR_NONE) {
+		rtls_cert_bundle_put(bundle);
+		return err;
+	}
+
+	/* The replaced certificate is no longer used by new TLS sessions */
+	pthread_mutex_lock(&cert_bundle_lock);
+	rtls_cert_bundle_t *old_bundle = ctx->cert_bundle;
+	ctx->cert_bundle = bundle;
+	pthread_mutex_unlock(&cert_bundle_lock);
+	rtls_cert_bundle_put(old_bundle);
+
+	ctx->flags |= RATS_TLS_CTX_FLAGS_CERT_CREATED;
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* Move the generated key, certificate and evidence into a bundle */
+static rtls_cert_bundle_t *new_cert_bundle(rtls_core_context_t *ctx, uint8_t *privkey_buf,
+					   unsigned int privkey_len,
+					   rats_tls_cert_info_t *cert_info)
+{
+	rtls_cert_bundle_t *bundle = rtls_cert_bundle_new(ctx);
+	if (!bundle)
+		return NULL;
+
+	if (privkey_len) {
+		bundle->privkey_buf = malloc(privkey_len);
+		if (!bundle->privkey_buf) {
+			rtls_cert_bundle_put(bundle);
+			return NULL;
+		}
+		memcpy(bundle->privkey_buf, privkey_buf, privkey_len);
+		bundle->privkey_len = privkey_len;
+	}
+
+	bundle->cert_buf = cert_info->cert_buf;
+	bundle->cert_len = cert_info->cert_len;
+	bundle->evidence_buffer = cert_info->evidence_buffer;
+	bundle->evidence_buffer_size = cert_info->evidence_buffer_size;
+	bundle->endorsements_buffer = cert_info->endorsements_buffer;
+	bundle->endorsements_buffer_size = cert_info->endorsements_buffer_size;
+	cert_info->cert_buf = NULL;
+	cert_info->evidence_buffer = NULL;
+	cert_info->endorsements_buffer = NULL;
+
+	return bundle;
+}
+
+/* Append the inclusion proof in the batch attested by the evidence to the claims */
+static enclave_attester_err_t
+generate_claims_buffer_with_proof(rtls_core_context_t *ctx, const uint8_t *pubkey_hash,
+				  uint8_t *proof, size_t proof_size, uint8_t **claims_buffer_out,
+				  size_t *claims_buffer_size_out)
+{
+	size_t claims_length = ctx->config.custom_claims_length + 1;
+	claim_t claims[claims_length];
 
+	if (ctx->config.custom_claims_length)
+		memcpy(claims, ctx->config.custom_claims,
+		       ctx->config.custom_claims_length * sizeof(claim_t));
+	claims[claims_length - 1].name = CLAIM_MERKLE_PROOF;
+	claims[claims_length - 1].value = proof;
+	claims[claims_length - 1].value_size = proof_size;
+
+	return dice_generate_claims_buffer(HASH_ALGO_SHA256, pubkey_hash, claims, claims_length,
+					   claims_buffer_out, claims_buffer_size_out);
+}
+
+/* Generate a new key, and collect the evidence to generate the certificate */
+static rats_tls_err_t generate_cert_bundle(rtls_core_context_t *ctx,
+					   rtls_cert_bundle_t **bundle_out)
+{
 	/* Check whether the specified algorithm is supported.
 	 *
 	 * TODO: the supported algorithm list should be provided by a crypto
@@ -78,17 +256,37 @@ rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
 		return a_ret;
 	}
 
-	/* Note here we reuse `uint8_t hash[hash_size]` to store sha256 hash of claims_buffer */
+	/* The sha256 hash of claims_buffer, reused as the leaf of the Merkle tree in batch */
+	uint8_t claims_hash[SHA256_HASH_SIZE];
 	ctx->crypto_wrapper->opts->gen_hash(ctx->crypto_wrapper, HASH_ALGO_SHA256, claims_buffer,
-					    claims_buffer_size, hash);
-	if (hash_size >= 16)
-		RTLS_DEBUG(
-			"evidence user-data field [%zu] %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x...\n",
-			(size_t)hash_size, hash[0], hash[1], hash[2], hash[3], hash[4], hash[5],
-			hash[6], hash[7], hash[8], hash[9], hash[10], hash[11], hash[12], hash[13],
-			hash[14], hash[15]);
-	enclave_attester_err_t q_err = ctx->attester->opts->collect_evidence(
-		ctx->attester, &evidence, ctx->config.cert_algo, hash, hash_size);
+					    claims_buffer_size, claims_hash);
+	RTLS_DEBUG(
+		"evidence user-data field [%zu] %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x...\n",
+		sizeof(claims_hash), claims_hash[0], claims_hash[1], claims_hash[2], claims_hash[3],
+		claims_hash[4], claims_hash[5], claims_hash[6], claims_hash[7], claims_hash[8],
+		claims_hash[9], claims_hash[10], claims_hash[11], claims_hash[12], claims_hash[13],
+		claims_hash[14], claims_hash[15]);
+	enclave_attester_err_t q_err;
+	if (ctx->config.flags & RATS_TLS_CONF_FLAGS_BATCH_EVIDENCE) {
+		uint8_t *proof = NULL;
+		size_t proof_size = 0;
+
+		q_err = rtls_core_batch_collect_evidence(ctx, claims_hash, &evidence, &proof,
+							 &proof_size);
+		if (q_err == ENCLAVE_ATTESTER_ERR_NONE && proof) {
+			/* Carry the inclusion proof of the claims buffer in the batch */
+			free(claims_buffer);
+			claims_buffer = NULL;
+			q_err = generate_claims_buffer_with_proof(ctx, hash, proof, proof_size,
+								  &claims_buffer,
+								  &claims_buffer_size);
+			free(proof);
+		}
+	} else {
+		q_err = ctx->attester->opts->collect_evidence(
+			ctx->attester, &evidence, ctx->config.cert_algo, claims_hash,
+			sizeof(claims_hash));
+	}
 	if (q_err != ENCLAVE_ATTESTER_ERR_NONE) {
 		free(claims_buffer);
 		claims_buffer = NULL;
@@ -108,7 +306,10 @@ rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
 		.evidence_buffer_size = 0,
 		.endorsements_buffer = NULL,
 		.endorsements_buffer_size = 0,
+		.is_ca = !!(ctx->config.flags & RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER),
 	};
+	if (cert_info.is_ca)
+		cert_info.subject.common_name = (const unsigned char *)"RATS-TLS Issuer";
 
 	/* Get DICE evidence buffer.
 	 * This check is a workaround for the nullattester.
@@ -129,6 +330,7 @@ rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
 	RTLS_DEBUG("evidence buffer size: %zu\n", cert_info.evidence_buffer_size);
 
 	/* Collect endorsements if required */
+	uint64_t collateral_expiry = 0;
 	if ((evidence.type[0] != '\0' /* skip for nullattester */ &&
 	     ctx->config.flags & RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS) &&
 	    ctx->attester->opts->collect_endorsements) {
@@ -141,6 +343,9 @@ rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
 			RTLS_WARN("failed to collect collateral: %#x\n", q_ret);
 			/* Since endorsements are not essential, we tolerate the failure to occur. */
 		} else {
+			collateral_expiry =
+				rtls_verify_cache_collateral_expiry(evidence.type, &endorsements);
+
 			/* Get DICE endorsements buffer */
 			enclave_attester_err_t d_ret = dice_generate_endorsements_buffer_with_tag(
 				evidence.type, &endorsements, &cert_info.endorsements_buffer,
@@ -157,42 +362,137 @@ rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
 	/* Generate the TLS certificate */
 	c_err = ctx->crypto_wrapper->opts->gen_cert(ctx->crypto_wrapper, ctx->config.cert_algo,
 						    &cert_info);
-	if (c_err != CRYPTO_WRAPPER_ERR_NONE)
+	if (c_err != CRYPTO_WRAPPER_ERR_NONE) {
+		free(cert_info.evidence_buffer);
+		free(cert_info.endorsements_buffer);
 		return c_err;
+	}
 
-	/* Use the TLS certificate and private key for TLS session */
-	if (privkey_len) {
-		tls_wrapper_err_t t_err;
+	rtls_cert_bundle_t *bundle = new_cert_bundle(ctx, privkey_buf, privkey_len, &cert_info);
+	if (!bundle) {
+		free(cert_info.cert_buf);
+		free(cert_info.evidence_buffer);
+		free(cert_info.endorsements_buffer);
+		return -RATS_TLS_ERR_NO_MEM;
+	}
 
-#if 0
-	#ifndef SGX
-		/* Dump private key of this certificate */
-		FILE *fp = fopen("/tmp/privkey.der", "wb");
-		fwrite(privkey_buf, privkey_len, 1, fp);
-		fclose(fp);
-	#endif
-#endif
+	/* The certificate is renewed before the collateral it carries is out of date */
+	bundle->collateral_expiry = collateral_expiry;
+	if (collateral_expiry && collateral_expiry < bundle->expiry)
+		bundle->expiry = collateral_expiry;
 
-		t_err = ctx->tls_wrapper->opts->use_privkey(ctx->tls_wrapper, ctx->config.cert_algo,
-							    privkey_buf, privkey_len);
-		if (t_err != TLS_WRAPPER_ERR_NONE) {
-			if (cert_info.cert_buf)
-				free(cert_info.cert_buf);
-			return t_err;
-		}
+	*bundle_out = bundle;
 
-		t_err = ctx->tls_wrapper->opts->use_cert(ctx->tls_wrapper, &cert_info);
-		if (t_err != TLS_WRAPPER_ERR_NONE) {
-			if (cert_info.cert_buf)
-				free(cert_info.cert_buf);
-			return t_err;
-		}
+	return RATS_TLS_ERR_NONE;
+}
+
+static bool cert_cache_enabled(rtls_core_context_t *ctx)
+{
+	/* The attested issuer is always shared to avoid collecting new evidence */
+	return ctx->config.flags &
+	       (RATS_TLS_CONF_FLAGS_CERT_CACHE | RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER);
+}
+
+rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *ctx)
+{
+	RTLS_DEBUG("ctx %p\n", ctx);
+
+	if (!ctx || !ctx->tls_wrapper || !ctx->tls_wrapper->opts || !ctx->crypto_wrapper ||
+	    !ctx->crypto_wrapper->opts || !ctx->crypto_wrapper->opts->gen_pubkey_hash ||
+	    !ctx->crypto_wrapper->opts->gen_cert)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* Avoid re-generation of TLS certificates */
+	if (ctx->flags & RATS_TLS_CTX_FLAGS_CERT_CREATED)
+		return RATS_TLS_ERR_NONE;
+
+	/* Reuse the certificate generated for an identical configuration */
+	rtls_cert_bundle_t *bundle = NULL;
+	if (cert_cache_enabled(ctx))
+		bundle = rtls_cert_cache_lookup(ctx);
+
+	if (!bundle) {
+		rats_tls_err_t err = generate_cert_bundle(ctx, &bundle);
+		if (err != RATS_TLS_ERR_NONE)
+			return err;
+
+		if (cert_cache_enabled(ctx))
+			rtls_cert_cache_insert(bundle);
 	}
-	if (cert_info.cert_buf)
-		free(cert_info.cert_buf);
 
-	/* Prevent from re-generation of TLS certificate */
-	ctx->flags |= RATS_TLS_CTX_FLAGS_CERT_CREATED;
+	return use_cert_bundle(ctx, bundle, false);
+}
 
-	return RATS_TLS_ERR_NONE;
+/* Look up the cached certificate to rotate to, unless a fresh evidence is requested */
+static rtls_cert_bundle_t *rotate_cert_lookup(rtls_core_context_t *ctx, bool refresh)
+{
+	if (refresh || !cert_cache_enabled(ctx))
+		return NULL;
+
+	rtls_cert_bundle_t *bundle = rtls_cert_cache_lookup(ctx);
+	if (!bundle)
+		return NULL;
+
+	/* A leaf certificate is signed by the attested issuer until it expires */
+	if (ctx->config.flags & RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER)
+		return bundle;
+
+	/* Otherwise, reuse the certificate only if rotated by another handle */
+	pthread_mutex_lock(&cert_bundle_lock);
+	bool newer = !ctx->cert_bundle || (bundle != ctx->cert_bundle &&
+					   bundle->created >= ctx->cert_bundle->created);
+	pthread_mutex_unlock(&cert_bundle_lock);
+	if (newer)
+		return bundle;
+
+	rtls_cert_bundle_put(bundle);
+	return NULL;
+}
+
+rats_tls_err_t rtls_core_rotate_certificate(rtls_core_context_t *ctx, bool refresh)
+{
+	RTLS_DEBUG("ctx %p, refresh %d\n", ctx, refresh);
+
+	if (!(ctx->flags & RATS_TLS_CTX_FLAGS_CERT_CREATED) ||
+	    !ctx->tls_wrapper->opts->replace_cert)
+		return -RATS_TLS_ERR_INVALID;
+
+	/* The rotations of other handles go on meanwhile */
+	pthread_mutex_lock(&ctx->rotate_lock);
+
+	rtls_cert_bundle_t *bundle = rotate_cert_lookup(ctx, refresh);
+
+	rats_tls_err_t err = RATS_TLS_ERR_NONE;
+	if (!bundle) {
+		err = generate_cert_bundle(ctx, &bundle);
+		if (err != RATS_TLS_ERR_NONE)
+			goto err;
+
+		/* Supersede the cached certificate for the handles initialized later */
+		if (cert_cache_enabled(ctx))
+			rtls_cert_cache_insert(bundle);
+	}
+
+	err = use_cert_bundle(ctx, bundle, true);
+	if (err == RATS_TLS_ERR_NONE)
+		RTLS_INFO("the certificate of handle %p rotated\n", ctx);
+
+err:
+	pthread_mutex_unlock(&ctx->rotate_lock);
+	return err;
+}
+
+/* Return the time when the collateral attached to the certificate in use is
+ * out of date, or 0 if unknown.
+ */
+uint64_t rtls_core_collateral_expiry(rtls_core_context_t *ctx)
+{
+	uint64_t expiry = 0;
+
+	pthread_mutex_lock(&cert_bundle_lock);
+	if (ctx->cert_bundle)
+		expiry = ctx->cert_bundle->collateral_expiry;
+	pthread_mutex_unlock(&cert_bundle_lock);
+
+	return expiry;
 }
@@ -0,0 +1,223 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/receive.h"
+
+static size_t read_ahead_size(rtls_core_context_t *ctx)
+{
+	if (ctx->config.read_ahead_size)
+		return ctx->config.read_ahead_size;
+
+	return RATS_TLS_READ_AHEAD_SIZE_DEFAULT;
+}
+
+static size_t recv_buffer_pending(rtls_core_context_t *ctx)
+{
+	rtls_recv_buffer_t *rbuf = ctx->recv_buffer;
+
+	return rbuf ? rbuf->len - rbuf->off : 0;
+}
+
+static rats_tls_err_t wrapper_receive(rtls_core_context_t *ctx, void *buf, size_t *buf_size)
+{
+	tls_wrapper_err_t err = ctx->tls_wrapper->opts->receive(ctx->tls_wrapper, buf, buf_size);
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		rats_tls_err_t ret = rtls_core_update_events(ctx, err);
+		if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+			return ret;
+
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* Make room for at least need bytes in the receive buffer, in addition to the
+ * data not yet consumed.
+ */
+static rats_tls_err_t recv_buffer_reserve(rtls_core_context_t *ctx, size_t need)
+{
+	rtls_recv_buffer_t *rbuf = ctx->recv_buffer;
+
+	if (!rbuf) {
+		rbuf = calloc(1, sizeof(*rbuf));
+		if (!rbuf)
+			return -RATS_TLS_ERR_NO_MEM;
+		ctx->recv_buffer = rbuf;
+	}
+
+	size_t pending = rbuf->len - rbuf->off;
+	if (rbuf->size - rbuf->len >= need)
+		return RATS_TLS_ERR_NONE;
+
+	if (rbuf->size - pending < need) {
+		size_t size = read_ahead_size(ctx);
+		if (size < pending + need)
+			size = pending + need;
+
+		uint8_t *data = malloc(size);
+		if (!data)
+			return -RATS_TLS_ERR_NO_MEM;
+
+		if (pending)
+			memcpy(data, rbuf->data + rbuf->off, pending);
+		free(rbuf->data);
+		rbuf->data = data;
+		rbuf->size = size;
+	} else if (pending)
+		memmove(rbuf->data, rbuf->data + rbuf->off, pending);
+
+	rbuf->off = 0;
+	rbuf->len = pending;
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* Receive as much data as fits into the buffer with a single call to the tls
+ * wrapper. No data is received once the tls session is closed by the peer.
+ */
+static rats_tls_err_t recv_buffer_fill(rtls_core_context_t *ctx, size_t need, size_t *received)
+{
+	rats_tls_err_t err = recv_buffer_reserve(ctx, need);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	rtls_recv_buffer_t *rbuf = ctx->recv_buffer;
+	size_t size = rbuf->size - rbuf->len;
+
+	err = wrapper_receive(ctx, rbuf->data + rbuf->len, &size);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	rbuf->len += size;
+	*received = size;
+
+	return RATS_TLS_ERR_NONE;
+}
+
+static void recv_buffer_consume(rtls_core_context_t *ctx, void *buf, size_t size)
+{
+	rtls_recv_buffer_t *rbuf = ctx->recv_buffer;
+
+	memcpy(buf, rbuf->data + rbuf->off, size);
+	rbuf->off += size;
+
+	if (rbuf->off < rbuf->len)
+		return;
+
+	rbuf->off = 0;
+	rbuf->len = 0;
+
+	/* Don't hold on to the memory taken by an exceptionally large message */
+	if (rbuf->size > read_ahead_size(ctx)) {
+		free(rbuf->data);
+		rbuf->data = NULL;
+		rbuf->size = 0;
+	}
+}
+
+/* Return the data already buffered, or else receive the data directly into
+ * the buffer of the application when it is not smaller than the read-ahead
+ * size, and through the receive buffer otherwise.
+ */
+rats_tls_err_t rtls_core_receive(rtls_core_context_t *ctx, void *buf, size_t *buf_size)
+{
+	size_t pending = recv_buffer_pending(ctx);
+	if (pending) {
+		if (*buf_size > pending)
+			*buf_size = pending;
+		recv_buffer_consume(ctx, buf, *buf_size);
+
+		return RATS_TLS_ERR_NONE;
+	}
+
+	if (!ctx->config.read_ahead_size || *buf_size >= ctx->config.read_ahead_size)
+		return wrapper_receive(ctx, buf, buf_size);
+
+	rats_tls_err_t err = recv_buffer_fill(ctx, 1, &pending);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	if (*buf_size > pending)
+		*buf_size = pending;
+	if (*buf_size)
+		recv_buffer_consume(ctx, buf, *buf_size);
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* The data received so far is kept in the receive buffer if the fd would block,
+ * so the call can be repeated with the same arguments.
+ */
+rats_tls_err_t rtls_core_receive_exact(rtls_core_context_t *ctx, void *buf, size_t size)
+{
+	size_t pending;
+
+	while ((pending = recv_buffer_pending(ctx)) < size) {
+		size_t received;
+		rats_tls_err_t err = recv_buffer_fill(ctx, size - pending, &received);
+		if (err != RATS_TLS_ERR_NONE)
+			return err;
+
+		if (!received) {
+			RTLS_DEBUG("the tls session is closed after %zu of %zu bytes\n", pending,
+				   size);
+			return -RATS_TLS_ERR_INVALID;
+		}
+	}
+
+	if (size)
+		recv_buffer_consume(ctx, buf, size);
+
+	return RATS_TLS_ERR_NONE;
+}
+
+rats_tls_err_t rtls_core_peek(rtls_core_context_t *ctx, void *buf, size_t *buf_size)
+{
+	if (!recv_buffer_pending(ctx) && *buf_size) {
+		size_t received;
+		rats_tls_err_t err = recv_buffer_fill(ctx, 1, &received);
+		if (err != RATS_TLS_ERR_NONE)
+			return err;
+	}
+
+	size_t pending = recv_buffer_pending(ctx);
+	if (*buf_size > pending)
+		*buf_size = pending;
+	if (*buf_size)
+		memcpy(buf, ctx->recv_buffer->data + ctx->recv_buffer->off, *buf_size);
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* The fd doesn't become readable for the data already received by the handle
+ * or read ahead by the tls wrapper, so report it as a separate event.
+ */
+void rtls_core_update_recv_events(rtls_core_context_t *ctx)
+{
+	size_t pending = recv_buffer_pending(ctx);
+
+	if (!pending && ctx->tls_wrapper->opts->pending &&
+	    ctx->tls_wrapper->opts->pending(ctx->tls_wrapper, &pending) != TLS_WRAPPER_ERR_NONE)
+		pending = 0;
+
+	ctx->events = pending ? RATS_TLS_EVENT_PENDING : 0;
+}
+
+void rtls_core_recv_buffer_free(rtls_core_context_t *ctx)
+{
+	if (!ctx->recv_buffer)
+		return;
+
+	free(ctx->recv_buffer->data);
+	free(ctx->recv_buffer);
+	ctx->recv_buffer = NULL;
+}
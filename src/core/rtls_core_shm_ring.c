@@ -0,0 +1,385 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// clang-format off
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifndef SGX
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/shm_ring.h"
+// clang-format on
+
+#ifndef SGX
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+static long futex(uint32_t *uaddr, int op, uint32_t val)
+{
+	/* Not FUTEX_PRIVATE_FLAG, the futex is shared with the peer process */
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#else
+	__asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static bool rx_ready(rtls_shm_transport_t *shm)
+{
+	rtls_shm_ring_t *rx = shm->rx;
+
+	return __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE) != rx->tail ||
+	       __atomic_load_n(&rx->producer_closed, __ATOMIC_ACQUIRE);
+}
+
+/* A tail corrupted by the peer past the head is reported rather than waited on */
+static bool tx_ready(rtls_shm_transport_t *shm)
+{
+	rtls_shm_ring_t *tx = shm->tx;
+	uint64_t used = tx->head - __atomic_load_n(&tx->tail, __ATOMIC_ACQUIRE);
+
+	return used != shm->mask + 1 || __atomic_load_n(&tx->consumer_closed, __ATOMIC_ACQUIRE);
+}
+
+/* Poll the ring for a while, and then sleep on the futex seq after telling
+ * the peer through waiting that it has to wake us up.
+ */
+static void shm_wait(rtls_shm_transport_t *shm, bool (*ready)(rtls_shm_transport_t *),
+		     uint32_t *seq, uint32_t *waiting)
+{
+	for (unsigned int i = 0; i < shm->spin_count; i++) {
+		if (ready(shm))
+			return;
+		cpu_relax();
+	}
+
+	for (;;) {
+		uint32_t val = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+
+		__atomic_store_n(waiting, 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (ready(shm)) {
+			__atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+			return;
+		}
+
+		futex(seq, FUTEX_WAIT, val);
+	}
+}
+
+/* Only enter the kernel if the peer is sleeping */
+static void shm_wake(uint32_t *seq, uint32_t *waiting)
+{
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (!__atomic_load_n(waiting, __ATOMIC_RELAXED))
+		return;
+
+	__atomic_store_n(waiting, 0, __ATOMIC_RELAXED);
+	__atomic_add_fetch(seq, 1, __ATOMIC_RELEASE);
+	futex(seq, FUTEX_WAKE, INT_MAX);
+}
+
+rats_tls_err_t rtls_shm_create(size_t ring_size, int *shm_fd)
+{
+	if (!ring_size)
+		ring_size = RATS_TLS_SHM_RING_SIZE_DEFAULT;
+	if (ring_size > ((size_t)1 << 30)) {
+		RTLS_ERR("invalid ring size %zu\n", ring_size);
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	/* The offsets in the ring wrap around with a mask */
+	size_t size = RATS_TLS_SHM_CACHELINE_SIZE;
+	while (size < ring_size)
+		size <<= 1;
+
+	int fd = (int)syscall(SYS_memfd_create, "rats-tls-shm", MFD_CLOEXEC);
+	if (fd < 0) {
+		RTLS_ERR("failed to create the shared memory %d\n", errno);
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	if (ftruncate(fd, RATS_TLS_SHM_DATA_OFFSET + 2 * size)) {
+		RTLS_ERR("failed to size the shared memory %d\n", errno);
+		goto err;
+	}
+
+	rtls_shm_header_t *hdr =
+		mmap(NULL, sizeof(*hdr), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (hdr == MAP_FAILED) {
+		RTLS_ERR("failed to map the shared memory %d\n", errno);
+		goto err;
+	}
+
+	/* The shared memory is zero-filled */
+	hdr->ring_size = size;
+	__atomic_store_n(&hdr->magic, RATS_TLS_SHM_MAGIC, __ATOMIC_RELEASE);
+	munmap(hdr, sizeof(*hdr));
+
+	*shm_fd = fd;
+
+	return RATS_TLS_ERR_NONE;
+
+err:
+	close(fd);
+	return -RATS_TLS_ERR_INVALID;
+}
+
+rtls_shm_transport_t *rtls_shm_attach(int shm_fd, bool server)
+{
+	struct stat st;
+
+	if (fstat(shm_fd, &st) || st.st_size < RATS_TLS_SHM_DATA_OFFSET) {
+		RTLS_ERR("invalid shared memory fd %d\n", shm_fd);
+		return NULL;
+	}
+
+	void *base = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+	if (base == MAP_FAILED) {
+		RTLS_ERR("failed to map the shared memory %d\n", errno);
+		return NULL;
+	}
+
+	rtls_shm_header_t *hdr = base;
+	uint64_t ring_size = hdr->ring_size;
+	if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) != RATS_TLS_SHM_MAGIC ||
+	    !ring_size || (ring_size & (ring_size - 1)) ||
+	    ring_size > ((uint64_t)st.st_size - RATS_TLS_SHM_DATA_OFFSET) / 2) {
+		RTLS_ERR("invalid shared memory layout\n");
+		goto err;
+	}
+
+	rtls_shm_transport_t *shm = calloc(1, sizeof(*shm));
+	if (!shm)
+		goto err;
+
+	uint8_t *c2s_data = (uint8_t *)base + RATS_TLS_SHM_DATA_OFFSET;
+	uint8_t *s2c_data = c2s_data + ring_size;
+
+	shm->base = base;
+	shm->map_size = (size_t)st.st_size;
+	shm->refcount = 1;
+	shm->mask = ring_size - 1;
+	/* The peer can't make progress while we are polling on a single CPU */
+	if (sysconf(_SC_NPROCESSORS_ONLN) > 1)
+		shm->spin_count = RATS_TLS_SHM_SPIN_COUNT;
+	if (server) {
+		shm->tx = &hdr->rings[1];
+		shm->tx_data = s2c_data;
+		shm->rx = &hdr->rings[0];
+		shm->rx_data = c2s_data;
+	} else {
+		shm->tx = &hdr->rings[0];
+		shm->tx_data = c2s_data;
+		shm->rx = &hdr->rings[1];
+		shm->rx_data = s2c_data;
+	}
+
+	RTLS_DEBUG("attached to the %s side of the %llu-byte rings in fd %d\n",
+		   server ? "server" : "client", (unsigned long long)ring_size, shm_fd);
+
+	return shm;
+
+err:
+	munmap(base, (size_t)st.st_size);
+	return NULL;
+}
+
+rtls_shm_transport_t *rtls_shm_get(rtls_shm_transport_t *shm)
+{
+	__atomic_add_fetch(&shm->refcount, 1, __ATOMIC_SEQ_CST);
+
+	return shm;
+}
+
+void rtls_shm_detach(rtls_shm_transport_t *shm)
+{
+	if (!shm || __atomic_sub_fetch(&shm->refcount, 1, __ATOMIC_SEQ_CST))
+		return;
+
+	__atomic_store_n(&shm->tx->producer_closed, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&shm->rx->consumer_closed, 1, __ATOMIC_RELEASE);
+
+	/* Wake the peer up regardless of whether it is waiting */
+	__atomic_add_fetch(&shm->tx->data_seq, 1, __ATOMIC_SEQ_CST);
+	futex(&shm->tx->data_seq, FUTEX_WAKE, INT_MAX);
+	__atomic_add_fetch(&shm->rx->space_seq, 1, __ATOMIC_SEQ_CST);
+	futex(&shm->rx->space_seq, FUTEX_WAKE, INT_MAX);
+
+	munmap(shm->base, shm->map_size);
+	free(shm);
+}
+
+ssize_t rtls_shm_read(rtls_shm_transport_t *shm, void *buf, size_t count)
+{
+	rtls_shm_ring_t *rx = shm->rx;
+
+	if (!count)
+		return 0;
+
+	shm_wait(shm, rx_ready, &rx->data_seq, &rx->reader_waiting);
+
+	uint64_t tail = rx->tail;
+	uint64_t avail = __atomic_load_n(&rx->head, __ATOMIC_ACQUIRE) - tail;
+	/* The indices are written by the peer, which is not trusted */
+	if (avail > shm->mask + 1) {
+		errno = EIO;
+		return -1;
+	}
+	if (!avail)
+		return 0;
+
+	if (count > avail)
+		count = (size_t)avail;
+
+	size_t off = (size_t)(tail & shm->mask);
+	size_t len = count;
+	if (len > shm->mask + 1 - off)
+		len = shm->mask + 1 - off;
+	memcpy(buf, shm->rx_data + off, len);
+	memcpy((uint8_t *)buf + len, shm->rx_data, count - len);
+
+	__atomic_store_n(&rx->tail, tail + count, __ATOMIC_RELEASE);
+	shm_wake(&rx->space_seq, &rx->writer_waiting);
+
+	return (ssize_t)count;
+}
+
+ssize_t rtls_shm_write(rtls_shm_transport_t *shm, const void *buf, size_t count)
+{
+	struct iovec iov = {
+		.iov_base = (void *)buf,
+		.iov_len = count,
+	};
+
+	return rtls_shm_writev(shm, &iov, 1);
+}
+
+/* Block until all the data is written into the ring, filling the free space
+ * from as many buffers as fit before publishing it to the peer.
+ */
+ssize_t rtls_shm_writev(rtls_shm_transport_t *shm, const struct iovec *iov, int iovcnt)
+{
+	rtls_shm_ring_t *tx = shm->tx;
+	size_t written = 0;
+	size_t iov_off = 0;
+	int i = 0;
+
+	while (i < iovcnt) {
+		if (iov_off == iov[i].iov_len) {
+			++i;
+			iov_off = 0;
+			continue;
+		}
+
+		shm_wait(shm, tx_ready, &tx->space_seq, &tx->writer_waiting);
+		if (__atomic_load_n(&tx->consumer_closed, __ATOMIC_ACQUIRE)) {
+			if (written)
+				break;
+
+			errno = EPIPE;
+			return -1;
+		}
+
+		uint64_t head = tx->head;
+		uint64_t used = head - __atomic_load_n(&tx->tail, __ATOMIC_ACQUIRE);
+		if (used > shm->mask + 1) {
+			errno = EIO;
+			return -1;
+		}
+		size_t space = (size_t)(shm->mask + 1 - used);
+
+		while (space && i < iovcnt) {
+			size_t count = iov[i].iov_len - iov_off;
+			if (count > space)
+				count = space;
+
+			const uint8_t *src = (const uint8_t *)iov[i].iov_base + iov_off;
+			size_t off = (size_t)(head & shm->mask);
+			size_t len = count;
+			if (len > shm->mask + 1 - off)
+				len = shm->mask + 1 - off;
+			memcpy(shm->tx_data + off, src, len);
+			memcpy(shm->tx_data, src + len, count - len);
+
+			head += count;
+			space -= count;
+			written += count;
+			iov_off += count;
+			if (iov_off == iov[i].iov_len) {
+				++i;
+				iov_off = 0;
+			}
+		}
+
+		__atomic_store_n(&tx->head, head, __ATOMIC_RELEASE);
+		shm_wake(&tx->data_seq, &tx->reader_waiting);
+	}
+
+	return (ssize_t)written;
+}
+#else
+/* The enclave would need ocalls to map the shared memory and to wait on the futex */
+rats_tls_err_t rtls_shm_create(__attribute__((unused)) size_t ring_size,
+			       __attribute__((unused)) int *shm_fd)
+{
+	RTLS_ERR("the shared memory transport is not supported in enclave\n");
+	return -RATS_TLS_ERR_INVALID;
+}
+
+rtls_shm_transport_t *rtls_shm_attach(__attribute__((unused)) int shm_fd,
+				      __attribute__((unused)) bool server)
+{
+	RTLS_ERR("the shared memory transport is not supported in enclave\n");
+	return NULL;
+}
+
+rtls_shm_transport_t *rtls_shm_get(rtls_shm_transport_t *shm)
+{
+	return shm;
+}
+
+void rtls_shm_detach(__attribute__((unused)) rtls_shm_transport_t *shm)
+{
+}
+
+ssize_t rtls_shm_read(__attribute__((unused)) rtls_shm_transport_t *shm,
+		      __attribute__((unused)) void *buf, __attribute__((unused)) size_t count)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t rtls_shm_write(__attribute__((unused)) rtls_shm_transport_t *shm,
+		       __attribute__((unused)) const void *buf,
+		       __attribute__((unused)) size_t count)
+{
+	errno = ENOSYS;
+	return -1;
+}
+
+ssize_t rtls_shm_writev(__attribute__((unused)) rtls_shm_transport_t *shm,
+			__attribute__((unused)) const struct iovec *iov,
+			__attribute__((unused)) int iovcnt)
+{
+	errno = ENOSYS;
+	return -1;
+}
+#endif
@@ -0,0 +1,150 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/transmit.h"
+
+rats_tls_err_t rtls_core_cork(rtls_core_context_t *ctx, bool cork)
+{
+	if (cork) {
+		if (!ctx->cork_buffer) {
+			ctx->cork_buffer = calloc(1, sizeof(*ctx->cork_buffer));
+			if (!ctx->cork_buffer)
+				return -RATS_TLS_ERR_NO_MEM;
+		}
+
+		return RATS_TLS_ERR_NONE;
+	}
+
+	if (!ctx->cork_buffer)
+		return RATS_TLS_ERR_NONE;
+
+	/* The handle stays corked until the pending data is sent */
+	rats_tls_err_t err = rtls_core_flush(ctx);
+	if (err != RATS_TLS_ERR_NONE)
+		return err;
+
+	free(ctx->cork_buffer);
+	ctx->cork_buffer = NULL;
+
+	return RATS_TLS_ERR_NONE;
+}
+
+bool rtls_core_corked(rtls_core_context_t *ctx)
+{
+	return ctx->cork_buffer != NULL;
+}
+
+/* Drop the data corked for the previous TLS session, keeping the handle corked */
+void rtls_core_cork_discard(rtls_core_context_t *ctx)
+{
+	if (!ctx->cork_buffer)
+		return;
+
+	ctx->cork_buffer->len = 0;
+	ctx->cork_buffer->off = 0;
+}
+
+/* Send the TLS records batched by the tls wrapper, if it batches them */
+static rats_tls_err_t wrapper_flush(rtls_core_context_t *ctx)
+{
+	if (!ctx->tls_wrapper->opts->flush)
+		return RATS_TLS_ERR_NONE;
+
+	tls_wrapper_err_t err = ctx->tls_wrapper->opts->flush(ctx->tls_wrapper);
+	if (err != TLS_WRAPPER_ERR_NONE) {
+		rats_tls_err_t ret = rtls_core_update_events(ctx, err);
+		if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+			return ret;
+
+		return -RATS_TLS_ERR_INVALID;
+	}
+
+	return RATS_TLS_ERR_NONE;
+}
+
+/* Called once the tls wrapper accepted the data. The TLS records it could not
+ * send yet because the fd would block are left to rats_tls_flush(), and the
+ * events to wait for are kept for rats_tls_get_events().
+ */
+rats_tls_err_t rtls_core_transmit_done(rtls_core_context_t *ctx)
+{
+	ctx->events = 0;
+
+	rats_tls_err_t err = wrapper_flush(ctx);
+	if (err == -RATS_TLS_ERR_WANT_READ || err == -RATS_TLS_ERR_WANT_WRITE)
+		return RATS_TLS_ERR_NONE;
+
+	return err;
+}
+
+rats_tls_err_t rtls_core_flush(rtls_core_context_t *ctx)
+{
+	rtls_cork_buffer_t *cork = ctx->cork_buffer;
+	if (!cork)
+		return wrapper_flush(ctx);
+
+	while (cork->off < cork->len) {
+		/* Retried with the same buffer after a would-block error */
+		size_t size = cork->len - cork->off;
+		tls_wrapper_err_t err = ctx->tls_wrapper->opts->transmit(
+			ctx->tls_wrapper, cork->data + cork->off, &size);
+		if (err != TLS_WRAPPER_ERR_NONE) {
+			rats_tls_err_t ret = rtls_core_update_events(ctx, err);
+			if (ret == -RATS_TLS_ERR_WANT_READ || ret == -RATS_TLS_ERR_WANT_WRITE)
+				return ret;
+
+			return -RATS_TLS_ERR_INVALID;
+		}
+		cork->off += size;
+	}
+
+	cork->len = 0;
+	cork->off = 0;
+
+	return wrapper_flush(ctx);
+}
+
+/* Append the data to the buffer of a corked handle, and send the buffer
+ * each time it fills up a TLS record.
+ */
+rats_tls_err_t rtls_core_transmit_corked(rtls_core_context_t *ctx, const void *buf,
+					 size_t *buf_size)
+{
+	rtls_cork_buffer_t *cork = ctx->cork_buffer;
+	size_t accepted = 0;
+
+	while (accepted < *buf_size) {
+		if (cork->len == sizeof(cork->data)) {
+			rats_tls_err_t err = rtls_core_flush(ctx);
+			if (err != RATS_TLS_ERR_NONE) {
+				/* Report the data accepted before the socket would block */
+				if (accepted && (err == -RATS_TLS_ERR_WANT_READ ||
+						 err == -RATS_TLS_ERR_WANT_WRITE))
+					break;
+
+				return err;
+			}
+		}
+
+		size_t len = *buf_size - accepted;
+		if (len > sizeof(cork->data) - cork->len)
+			len = sizeof(cork->data) - cork->len;
+
+		memcpy(cork->data + cork->len, (const uint8_t *)buf + accepted, len);
+		cork->len += len;
+		accepted += len;
+	}
+	*buf_size = accepted;
+
+	ctx->events = 0;
+
+	return RATS_TLS_ERR_NONE;
+}
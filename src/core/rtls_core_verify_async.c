@@ -0,0 +1,192 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// clang-format off
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#ifndef SGX
+#include <pthread.h>
+#include <sys/eventfd.h>
+#endif
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/verify_async.h"
+// clang-format on
+
+#ifndef SGX
+/* Upper bound of the number of verification workers */
+#define VERIFY_WORKERS_MAX 64
+
+static rtls_verify_job_t *job_head;
+static rtls_verify_job_t *job_tail;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static pthread_once_t workers_once = PTHREAD_ONCE_INIT;
+static unsigned int workers_nums;
+
+static void *verify_worker(__attribute__((unused)) void *arg)
+{
+	while (1) {
+		pthread_mutex_lock(&job_lock);
+		while (!job_head)
+			pthread_cond_wait(&job_queued, &job_lock);
+
+		rtls_verify_job_t *job = job_head;
+		job_head = job->next;
+		if (!job_head)
+			job_tail = NULL;
+		pthread_mutex_unlock(&job_lock);
+
+		tls_wrapper_err_t ret = tls_wrapper_verify_certificate_extension(
+			job->tls_ctx, job->pubkey_buffer, job->pubkey_buffer_size,
+			job->evidence_buffer, job->evidence_buffer_size, job->endorsements_buffer,
+			job->endorsements_buffer_size);
+
+		/* Notify the handle under the lock, so that its async fd cannot
+		 * be closed by rats_tls_cleanup() in the meantime.
+		 */
+		pthread_mutex_lock(&job_lock);
+		job->result = ret;
+		job->done = true;
+
+		uint64_t one = 1;
+		if (write(job->tls_ctx->rtls_handle->async_fd, &one, sizeof(one)) != sizeof(one))
+			RTLS_ERR("failed to signal the completion of verification\n");
+
+		pthread_cond_broadcast(&job_done);
+		pthread_mutex_unlock(&job_lock);
+	}
+
+	return NULL;
+}
+
+static void start_verify_workers(void)
+{
+	long nums = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (nums <= 0)
+		nums = 1;
+	else if (nums > VERIFY_WORKERS_MAX)
+		nums = VERIFY_WORKERS_MAX;
+
+	for (long i = 0; i < nums; ++i) {
+		pthread_t tid;
+
+		if (pthread_create(&tid, NULL, verify_worker, NULL)) {
+			RTLS_ERR("failed to create verification worker %ld\n", i);
+			break;
+		}
+		pthread_detach(tid);
+		++workers_nums;
+	}
+
+	RTLS_DEBUG("%u verification workers started\n", workers_nums);
+}
+
+int rtls_core_get_async_fd(rtls_core_context_t *ctx)
+{
+	if (ctx->async_fd < 0) {
+		ctx->async_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (ctx->async_fd < 0)
+			RTLS_ERR("failed to create eventfd\n");
+	}
+
+	return ctx->async_fd;
+}
+
+tls_wrapper_err_t rtls_core_verify_async_submit(rtls_core_context_t *ctx, rtls_verify_job_t *job)
+{
+	pthread_once(&workers_once, start_verify_workers);
+	if (!workers_nums || rtls_core_get_async_fd(ctx) < 0)
+		return -TLS_WRAPPER_ERR_UNKNOWN;
+
+	job->next = NULL;
+	job->done = false;
+	ctx->verify_job = job;
+
+	pthread_mutex_lock(&job_lock);
+	if (job_tail)
+		job_tail->next = job;
+	else
+		job_head = job;
+	job_tail = job;
+	pthread_cond_signal(&job_queued);
+	pthread_mutex_unlock(&job_lock);
+
+	return -TLS_WRAPPER_ERR_WANT_VERIFY;
+}
+
+bool rtls_core_verify_async_done(rtls_core_context_t *ctx)
+{
+	pthread_mutex_lock(&job_lock);
+	bool done = ctx->verify_job->done;
+	pthread_mutex_unlock(&job_lock);
+
+	return done;
+}
+
+/* Wait for the completion of the job in flight and free it */
+void rtls_core_verify_async_release(rtls_core_context_t *ctx)
+{
+	rtls_verify_job_t *job = ctx->verify_job;
+
+	if (!job)
+		return;
+
+	pthread_mutex_lock(&job_lock);
+	while (!job->done)
+		pthread_cond_wait(&job_done, &job_lock);
+	pthread_mutex_unlock(&job_lock);
+
+	/* Consume the completion notification */
+	uint64_t val;
+	if (read(ctx->async_fd, &val, sizeof(val)) != sizeof(val))
+		RTLS_DEBUG("no pending completion notification\n");
+
+	free(job->pubkey_buffer);
+	free(job->evidence_buffer);
+	free(job->endorsements_buffer);
+	free(job);
+	ctx->verify_job = NULL;
+}
+
+void rtls_core_verify_async_cleanup(rtls_core_context_t *ctx)
+{
+	rtls_core_verify_async_release(ctx);
+
+	if (ctx->async_fd >= 0) {
+		close(ctx->async_fd);
+		ctx->async_fd = -1;
+	}
+}
+#else
+int rtls_core_get_async_fd(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+	return -1;
+}
+
+tls_wrapper_err_t rtls_core_verify_async_submit(__attribute__((unused)) rtls_core_context_t *ctx,
+						__attribute__((unused)) rtls_verify_job_t *job)
+{
+	return -TLS_WRAPPER_ERR_UNKNOWN;
+}
+
+bool rtls_core_verify_async_done(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+	return true;
+}
+
+void rtls_core_verify_async_release(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+}
+
+void rtls_core_verify_async_cleanup(__attribute__((unused)) rtls_core_context_t *ctx)
+{
+}
+#endif
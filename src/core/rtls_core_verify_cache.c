@@ -0,0 +1,218 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include <rats-tls/claim.h>
+#include "internal/core.h"
+#include "internal/verify_cache.h"
+#include "internal/der.h"
+
+/* The process-wide verification results, most recently used first */
+static rtls_verify_result_t *verify_cache_head;
+static rtls_verify_result_t *verify_cache_tail;
+static unsigned int verify_cache_size;
+static pthread_mutex_t verify_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+rtls_verify_result_t *rtls_verify_result_new(const rtls_verify_key_t *key)
+{
+	rtls_verify_result_t *result = calloc(1, sizeof(*result));
+	if (!result)
+		return NULL;
+
+	memcpy(&result->key, key, sizeof(result->key));
+	result->refcount = 1;
+
+	return result;
+}
+
+rtls_verify_result_t *rtls_verify_result_get(rtls_verify_result_t *result)
+{
+	__atomic_add_fetch(&result->refcount, 1, __ATOMIC_SEQ_CST);
+
+	return result;
+}
+
+void rtls_verify_result_put(rtls_verify_result_t *result)
+{
+	if (!result || __atomic_sub_fetch(&result->refcount, 1, __ATOMIC_SEQ_CST))
+		return;
+
+	if (result->custom_claims)
+		free_claims_list(result->custom_claims, result->custom_claims_length);
+	free(result);
+}
+
+/* Parse a timestamp formatted as YYYY-MM-DDThh:mm:ssZ into seconds since the Epoch */
+static uint64_t parse_utc_time(const char *s, size_t len)
+{
+	unsigned int year, month, day, hour, minute, second;
+
+	if (len < 20 || s[4] != '-' || s[7] != '-' || s[10] != 'T' || s[13] != ':' ||
+	    s[16] != ':' || s[19] != 'Z')
+		return 0;
+
+	char buf[21];
+	memcpy(buf, s, 20);
+	buf[20] = '\0';
+
+	if (sscanf(buf, "%4u-%2u-%2uT%2u:%2u:%2uZ", &year, &month, &day, &hour, &minute,
+		   &second) != 6)
+		return 0;
+
+	return civil_to_epoch(year, month, day, hour, minute, second);
+}
+
+/* Find the nextUpdate field of a TCB info or QE identity JSON structure */
+static uint64_t json_next_update(const char *json, size_t len)
+{
+	static const char field[] = "\"nextUpdate\"";
+	size_t field_len = sizeof(field) - 1;
+
+	if (!json)
+		return 0;
+
+	for (size_t i = 0; i + field_len <= len; ++i) {
+		if (memcmp(json + i, field, field_len))
+			continue;
+
+		i += field_len;
+		while (i < len && (json[i] == ' ' || json[i] == ':'))
+			++i;
+		if (i >= len || json[i] != '"')
+			return 0;
+		++i;
+
+		return parse_utc_time(json + i, len - i);
+	}
+
+	return 0;
+}
+
+/* Return the time when the collateral used to verify the evidence must be
+ * refreshed, or 0 if unknown.
+ */
+uint64_t rtls_verify_cache_collateral_expiry(const char *type,
+					     const attestation_endorsement_t *endorsements)
+{
+	if (!type || !endorsements)
+		return 0;
+
+	if (strcmp(type, "sgx_ecdsa") && strcmp(type, "tdx_ecdsa"))
+		return 0;
+
+	const sgx_ecdsa_attestation_collateral_t *c = &endorsements->ecdsa;
+	uint64_t next_updates[] = {
+		json_next_update(c->tcb_info, c->tcb_info_size),
+		json_next_update(c->qe_identity, c->qe_identity_size),
+		crl_next_update(c->pck_crl, c->pck_crl_size),
+		crl_next_update(c->root_ca_crl, c->root_ca_crl_size),
+	};
+	uint64_t expiry = 0;
+
+	for (size_t i = 0; i < sizeof(next_updates) / sizeof(next_updates[0]); ++i) {
+		if (next_updates[i] && (!expiry || next_updates[i] < expiry))
+			expiry = next_updates[i];
+	}
+
+	return expiry;
+}
+
+/* Must be called with verify_cache_lock held */
+static void verify_cache_unlink(rtls_verify_result_t *result)
+{
+	if (result->prev)
+		result->prev->next = result->next;
+	else
+		verify_cache_head = result->next;
+
+	if (result->next)
+		result->next->prev = result->prev;
+	else
+		verify_cache_tail = result->prev;
+
+	result->prev = result->next = NULL;
+	--verify_cache_size;
+}
+
+/* Must be called with verify_cache_lock held */
+static void verify_cache_link_head(rtls_verify_result_t *result)
+{
+	result->prev = NULL;
+	result->next = verify_cache_head;
+	if (verify_cache_head)
+		verify_cache_head->prev = result;
+	else
+		verify_cache_tail = result;
+	verify_cache_head = result;
+	++verify_cache_size;
+}
+
+rtls_verify_result_t *rtls_verify_cache_lookup(const rtls_verify_key_t *key)
+{
+	rtls_verify_result_t *result;
+
+	pthread_mutex_lock(&verify_cache_lock);
+
+	for (result = verify_cache_head; result; result = result->next) {
+		if (!memcmp(&result->key, key, sizeof(*key)))
+			break;
+	}
+
+	if (result) {
+		verify_cache_unlink(result);
+
+		if (result->expiry <= rtls_time()) {
+			RTLS_DEBUG("evict expired verification result %p\n", result);
+			rtls_verify_result_put(result);
+			result = NULL;
+		} else {
+			/* Move the result to the most recently used position */
+			verify_cache_link_head(result);
+			rtls_verify_result_get(result);
+		}
+	}
+
+	pthread_mutex_unlock(&verify_cache_lock);
+
+	if (result)
+		RTLS_DEBUG("reuse the cached verification result %p, err %#x\n", result,
+			   result->err);
+
+	return result;
+}
+
+void rtls_verify_cache_insert(rtls_verify_result_t *result)
+{
+	pthread_mutex_lock(&verify_cache_lock);
+
+	/* Replace the result of a concurrent verification of the same extension */
+	for (rtls_verify_result_t *r = verify_cache_head; r; r = r->next) {
+		if (!memcmp(&r->key, &result->key, sizeof(r->key))) {
+			verify_cache_unlink(r);
+			rtls_verify_result_put(r);
+			break;
+		}
+	}
+
+	while (verify_cache_size >= RATS_TLS_VERIFY_CACHE_SIZE) {
+		rtls_verify_result_t *lru = verify_cache_tail;
+
+		RTLS_DEBUG("evict least recently used verification result %p\n", lru);
+
+		verify_cache_unlink(lru);
+		rtls_verify_result_put(lru);
+	}
+
+	/* The cache holds its own reference */
+	verify_cache_link_head(rtls_verify_result_get(result));
+
+	pthread_mutex_unlock(&verify_cache_lock);
+}
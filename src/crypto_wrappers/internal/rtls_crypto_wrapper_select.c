@@ -43,6 +43,8 @@ rats_tls_err_t rtls_crypto_wrapper_select(rtls_core_context_t *ctx, const char *
 		crypto_ctx->conf_flags = ctx->config.flags;
 		crypto_ctx->log_level = ctx->config.log_level;
 		crypto_ctx->cert_algo = ctx->config.cert_algo;
+		memcpy(crypto_ctx->key_pool_depth, ctx->config.key_pool_depth,
+		       sizeof(crypto_ctx->key_pool_depth));
 
 		if (init_crypto_wrapper(crypto_ctx) == RATS_TLS_ERR_NONE)
 			break;
@@ -15,7 +15,8 @@ crypto_wrapper_err_t openssl_cleanup(crypto_wrapper_ctx_t *ctx)
 
 	openssl_ctx *octx = ctx->crypto_private;
 
-	/* octx->key has been freed by EVP_PKEY_free() */
+	EC_KEY_free(octx->eckey);
+	RSA_free(octx->key);
 	free(octx);
 
 	return CRYPTO_WRAPPER_ERR_NONE;
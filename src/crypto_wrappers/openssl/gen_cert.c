@@ -14,15 +14,17 @@
 
 static bool using_cert_nonce = false;
 
-static int x509_extension_add_common(X509 *cert)
+static int x509_extension_add_common(X509 *cert, X509 *issuer, bool is_ca)
 {
 	int ret = 0;
 	X509V3_CTX ctx;
 
 	X509V3_set_ctx_nodb(&ctx);
-	X509V3_set_ctx(&ctx, cert, cert, NULL, NULL, 0);
+	X509V3_set_ctx(&ctx, issuer, cert, NULL, NULL, 0);
 
-	X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, &ctx, NID_basic_constraints, "CA:FALSE");
+	/* The attested issuer only signs leaf certificates */
+	X509_EXTENSION *ext = X509V3_EXT_conf_nid(NULL, &ctx, NID_basic_constraints,
+						  is_ca ? "critical,CA:TRUE,pathlen:0" : "CA:FALSE");
 	if (!ext) {
 		RTLS_ERR("failed to create basic constraint extension\n");
 		goto err;
@@ -116,6 +118,46 @@ err:
 	return ret;
 }
 
+/* Load the certificate and private key of the attested issuer */
+static int load_issuer(const rats_tls_cert_info_t *cert_info, X509 **issuer_out,
+		       EVP_PKEY **issuer_pkey_out)
+{
+	const unsigned char *p = cert_info->issuer_cert_buf;
+	X509 *issuer = d2i_X509(NULL, &p, cert_info->issuer_cert_len);
+	if (!issuer) {
+		RTLS_ERR("failed to load the issuer certificate\n");
+		return 0;
+	}
+
+	p = cert_info->issuer_privkey_buf;
+	EVP_PKEY *issuer_pkey = d2i_AutoPrivateKey(NULL, &p, cert_info->issuer_privkey_len);
+	if (!issuer_pkey) {
+		RTLS_ERR("failed to load the issuer private key\n");
+		X509_free(issuer);
+		return 0;
+	}
+
+	*issuer_out = issuer;
+	*issuer_pkey_out = issuer_pkey;
+
+	return 1;
+}
+
+/* The serial numbers of the certificates signed by an issuer must be unique */
+static int set_random_serial_number(X509 *cert)
+{
+	BIGNUM *bn = BN_new();
+	if (!bn)
+		return 0;
+
+	int ret = BN_rand(bn, 63, 0, 0) &&
+		  BN_to_ASN1_INTEGER(bn, X509_get_serialNumber(cert)) != NULL;
+
+	BN_free(bn);
+
+	return ret;
+}
+
 crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
 				      rats_tls_cert_info_t *cert_info)
 {
@@ -124,6 +166,8 @@ crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_a
 	X509 *cert = NULL;
 	X509_NAME *name;
 	EVP_PKEY *pkey = NULL;
+	X509 *issuer = NULL;
+	EVP_PKEY *issuer_pkey = NULL;
 	int len;
 	int ret;
 
@@ -140,28 +184,40 @@ crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_a
 
 	ret = -CRYPTO_WRAPPER_ERR_PRIV_KEY_LEN;
 
+	/* The key is still owned by octx and freed along with it */
 	if (algo == RATS_TLS_CERT_ALGO_ECC_256_SHA256) {
-		if (!EVP_PKEY_assign_EC_KEY(pkey, octx->eckey))
+		if (!EVP_PKEY_set1_EC_KEY(pkey, octx->eckey))
 			goto err;
 	} else if (algo == RATS_TLS_CERT_ALGO_RSA_3072_SHA256) {
-		if (!EVP_PKEY_assign_RSA(pkey, octx->key))
+		if (!EVP_PKEY_set1_RSA(pkey, octx->key))
 			goto err;
 	} else {
 		return -CRYPTO_WRAPPER_ERR_UNSUPPORTED_ALGO;
 	}
 
+	ret = -CRYPTO_WRAPPER_ERR_CERT;
+	if (cert_info->issuer_cert_buf && !load_issuer(cert_info, &issuer, &issuer_pkey))
+		goto err;
+
 	ret = -CRYPTO_WRAPPER_ERR_NO_MEM;
 	cert = X509_new();
 	if (!cert)
 		goto err;
 
 	X509_set_version(cert, 2 /* x509 version 3 cert */);
-	ASN1_INTEGER_set(X509_get_serialNumber(cert), CERT_SERIAL_NUMBER);
+	if (issuer) {
+		if (!set_random_serial_number(cert))
+			goto err;
+	} else
+		ASN1_INTEGER_set(X509_get_serialNumber(cert), CERT_SERIAL_NUMBER);
 	if (!using_cert_nonce) {
 		/* WORKAROUND: allow 1 hour delay for the systems behind current clock */
 		X509_gmtime_adj(X509_get_notBefore(cert), -3600);
-		/* 1 year */
-		X509_gmtime_adj(X509_get_notAfter(cert), (long)3600 * 24 * 365 * 1);
+		/* 1 year by default */
+		if (cert_info->validity)
+			X509_gmtime_adj(X509_get_notAfter(cert), (long)cert_info->validity);
+		else
+			X509_gmtime_adj(X509_get_notAfter(cert), (long)3600 * 24 * 365 * 1);
 	} else {
 		/* WORKAROUND: with nonce mechanism, the validity of cert can be fixed within a larger range. */
 		const char timestr_notBefore[] = "19700101000001Z";
@@ -183,12 +239,12 @@ crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_a
 	X509_NAME_add_entry_by_txt(name, "O", MBSTRING_ASC, subject->organization, -1, -1, 0);
 	X509_NAME_add_entry_by_txt(name, "OU", MBSTRING_ASC, subject->organization_unit, -1, -1, 0);
 	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, subject->common_name, -1, -1, 0);
-	if (!X509_set_issuer_name(cert, name))
+	if (!X509_set_issuer_name(cert, issuer ? X509_get_subject_name(issuer) : name))
 		goto err;
 
 	ret = -CRYPTO_WRAPPER_ERR_CERT_EXTENSION;
 
-	if (!x509_extension_add_common(cert))
+	if (!x509_extension_add_common(cert, issuer ? issuer : cert, cert_info->is_ca))
 		goto err;
 
 	/* Add evidence extension */
@@ -209,7 +265,7 @@ crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_a
 	}
 
 	ret = -CRYPTO_WRAPPER_ERR_CERT;
-	if (!X509_sign(cert, pkey, EVP_sha256()))
+	if (!X509_sign(cert, issuer_pkey ? issuer_pkey : pkey, EVP_sha256()))
 		goto err;
 
 	cert_info->cert_buf = NULL;
@@ -219,8 +275,9 @@ crypto_wrapper_err_t openssl_gen_cert(crypto_wrapper_ctx_t *ctx, rats_tls_cert_a
 
 	cert_info->cert_len = len;
 
-	RTLS_DEBUG("self-signing certificate generated. cert_buf: %p, cert_len: %u\n",
-		   cert_info->cert_buf, cert_info->cert_len);
+	RTLS_DEBUG("%s certificate generated. cert_buf: %p, cert_len: %u\n",
+		   issuer ? "issuer-signed" : "self-signing", cert_info->cert_buf,
+		   cert_info->cert_len);
 
 #if 0
 	#ifndef SGX
@@ -243,5 +300,11 @@ err:
 	if (pkey)
 		EVP_PKEY_free(pkey);
 
+	if (issuer)
+		X509_free(issuer);
+
+	if (issuer_pkey)
+		EVP_PKEY_free(issuer_pkey);
+
 	return ret;
 }
@@ -8,12 +8,59 @@
 #include <rats-tls/crypto_wrapper.h>
 #include "openssl.h"
 
+EC_KEY *openssl_gen_ec_key(void)
+{
+	EC_KEY *eckey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+	if (eckey == NULL)
+		return NULL;
+
+	EC_KEY_set_asn1_flag(eckey, OPENSSL_EC_NAMED_CURVE);
+
+	/* Generating public-private key */
+	if (!EC_KEY_generate_key(eckey))
+		goto err;
+
+	/* check key */
+	if (!EC_KEY_check_key(eckey))
+		goto err;
+
+	return eckey;
+
+err:
+	EC_KEY_free(eckey);
+	return NULL;
+}
+
+RSA *openssl_gen_rsa_key(void)
+{
+	RSA *key = RSA_new();
+	if (key == NULL)
+		return NULL;
+
+	BIGNUM *e = BN_new();
+	if (e == NULL)
+		goto err;
+
+	BN_set_word(e, RSA_F4);
+	if (!RSA_generate_key_ex(key, 3072, e, NULL))
+		goto err;
+
+	BN_free(e);
+
+	return key;
+
+err:
+	if (e)
+		BN_free(e);
+	RSA_free(key);
+	return NULL;
+}
+
 crypto_wrapper_err_t openssl_gen_privkey(crypto_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
 					 uint8_t *privkey_buf, uint32_t *privkey_len)
 {
 	openssl_ctx *octx = NULL;
 	unsigned char *p = privkey_buf;
-	BIGNUM *e = NULL;
 	int len = 0;
 	int ret;
 
@@ -30,23 +77,20 @@ crypto_wrapper_err_t openssl_gen_privkey(crypto_wrapper_ctx_t *ctx, rats_tls_cer
 
 	octx = ctx->crypto_private;
 
-	ret = -CRYPTO_WRAPPER_ERR_NO_MEM;
+	/* Replace the key generated previously, e.g. the key being rotated */
+	EC_KEY_free(octx->eckey);
+	octx->eckey = NULL;
+	RSA_free(octx->key);
+	octx->key = NULL;
 
 	if (algo == RATS_TLS_CERT_ALGO_ECC_256_SHA256) {
-		octx->eckey = EC_KEY_new_by_curve_name(NID_X9_62_prime256v1);
+		/* Take a key pre-generated in background if available */
+		octx->eckey = openssl_key_pool_get(algo);
 		if (octx->eckey == NULL)
-			goto err;
+			octx->eckey = openssl_gen_ec_key();
 
 		ret = -CRYPTO_WRAPPER_ERR_PRIV_KEY_LEN;
-
-		EC_KEY_set_asn1_flag(octx->eckey, OPENSSL_EC_NAMED_CURVE);
-
-		/* Generating public-private key */
-		if (!EC_KEY_generate_key(octx->eckey))
-			goto err;
-
-		/* check key */
-		if (!EC_KEY_check_key(octx->eckey))
+		if (octx->eckey == NULL)
 			goto err;
 
 		/* Encode elliptic curve key Der */
@@ -71,16 +115,12 @@ crypto_wrapper_err_t openssl_gen_privkey(crypto_wrapper_ctx_t *ctx, rats_tls_cer
 		RTLS_DEBUG("ECC-256 private key (%d-byte) in DER format generated\n", len);
 
 	} else if (algo == RATS_TLS_CERT_ALGO_RSA_3072_SHA256) {
-		octx->key = RSA_new();
+		octx->key = openssl_key_pool_get(algo);
 		if (octx->key == NULL)
-			goto err;
-
-		if ((e = BN_new()) == NULL)
-			goto err;
+			octx->key = openssl_gen_rsa_key();
 
 		ret = -CRYPTO_WRAPPER_ERR_PRIV_KEY_LEN;
-		BN_set_word(e, RSA_F4);
-		if (!RSA_generate_key_ex(octx->key, 3072, e, NULL))
+		if (octx->key == NULL)
 			goto err;
 
 		len = i2d_RSAPrivateKey(octx->key, NULL);
@@ -125,9 +165,6 @@ err:
 			RSA_free(octx->key);
 			octx->key = NULL;
 		}
-
-		if (e)
-			BN_free(e);
 	}
 	return ret;
 }
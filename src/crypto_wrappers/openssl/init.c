@@ -21,5 +21,8 @@ crypto_wrapper_err_t openssl_init(crypto_wrapper_ctx_t *ctx)
 
 	ctx->crypto_private = octx;
 
+	/* Start pre-generating the keys requested by the configuration */
+	openssl_key_pool_reserve(ctx->key_pool_depth);
+
 	return CRYPTO_WRAPPER_ERR_NONE;
 }
@@ -0,0 +1,155 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <rats-tls/log.h>
+#include <rats-tls/crypto_wrapper.h>
+#include "openssl.h"
+
+#ifndef SGX
+// clang-format off
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+// clang-format on
+
+/* The keys generated in advance for an algorithm, taken in LIFO order */
+typedef struct {
+	void *keys[OPENSSL_KEY_POOL_DEPTH_MAX];
+	unsigned int count;
+	unsigned int depth;
+} key_pool_t;
+
+static key_pool_t key_pools[RATS_TLS_CERT_ALGO_MAX];
+static pthread_mutex_t key_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t key_pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_once_t key_pool_once = PTHREAD_ONCE_INIT;
+
+static void *gen_key(rats_tls_cert_algo_t algo)
+{
+	if (algo == RATS_TLS_CERT_ALGO_ECC_256_SHA256)
+		return openssl_gen_ec_key();
+
+	return openssl_gen_rsa_key();
+}
+
+/* Must be called with key_pool_lock held */
+static int key_pool_next_algo(void)
+{
+	for (int algo = 0; algo < RATS_TLS_CERT_ALGO_MAX; ++algo) {
+		if (key_pools[algo].count < key_pools[algo].depth)
+			return algo;
+	}
+
+	return -1;
+}
+
+static void *key_pool_refill(__attribute__((unused)) void *arg)
+{
+	/* Only generate keys when the CPU would be idle otherwise */
+	struct sched_param param = { 0 };
+	if (pthread_setschedparam(pthread_self(), SCHED_IDLE, &param))
+		RTLS_DEBUG("failed to lower the priority of the key pool thread\n");
+
+	pthread_mutex_lock(&key_pool_lock);
+
+	for (;;) {
+		int algo;
+
+		while ((algo = key_pool_next_algo()) < 0)
+			pthread_cond_wait(&key_pool_cond, &key_pool_lock);
+
+		pthread_mutex_unlock(&key_pool_lock);
+
+		void *key = gen_key(algo);
+		if (!key) {
+			RTLS_WARN("failed to pre-generate the key of algorithm %d\n", algo);
+			sleep(1);
+		}
+
+		pthread_mutex_lock(&key_pool_lock);
+
+		/* Only this thread fills the pools whose depth never decreases */
+		if (key)
+			key_pools[algo].keys[key_pools[algo].count++] = key;
+	}
+
+	return NULL;
+}
+
+static void key_pool_start(void)
+{
+	pthread_t tid;
+
+	if (pthread_create(&tid, NULL, key_pool_refill, NULL)) {
+		RTLS_ERR("failed to create the key pool thread\n");
+		return;
+	}
+
+	pthread_detach(tid);
+}
+
+void openssl_key_pool_reserve(const unsigned int *depth)
+{
+	bool reserved = false;
+
+	pthread_mutex_lock(&key_pool_lock);
+
+	for (int algo = 0; algo < RATS_TLS_CERT_ALGO_MAX; ++algo) {
+		unsigned int d = depth[algo];
+		if (d > OPENSSL_KEY_POOL_DEPTH_MAX)
+			d = OPENSSL_KEY_POOL_DEPTH_MAX;
+
+		if (d > key_pools[algo].depth) {
+			RTLS_DEBUG("pre-generate %u keys of algorithm %d\n", d, algo);
+			key_pools[algo].depth = d;
+			reserved = true;
+		}
+	}
+
+	pthread_mutex_unlock(&key_pool_lock);
+
+	if (!reserved)
+		return;
+
+	pthread_once(&key_pool_once, key_pool_start);
+	pthread_cond_signal(&key_pool_cond);
+}
+
+void *openssl_key_pool_get(rats_tls_cert_algo_t algo)
+{
+	void *key = NULL;
+
+	if (algo >= RATS_TLS_CERT_ALGO_MAX)
+		return NULL;
+
+	pthread_mutex_lock(&key_pool_lock);
+
+	key_pool_t *pool = &key_pools[algo];
+	if (pool->count) {
+		key = pool->keys[--pool->count];
+		pthread_cond_signal(&key_pool_cond);
+	}
+
+	pthread_mutex_unlock(&key_pool_lock);
+
+	if (key)
+		RTLS_DEBUG("take a pre-generated key of algorithm %d\n", algo);
+
+	return key;
+}
+#else
+/* No thread is available to generate keys in background in enclave */
+void openssl_key_pool_reserve(__attribute__((unused)) const unsigned int *depth)
+{
+}
+
+void *openssl_key_pool_get(__attribute__((unused)) rats_tls_cert_algo_t algo)
+{
+	return NULL;
+}
+#endif
@@ -18,10 +18,21 @@
 #include <openssl/objects.h>
 #include <openssl/ec.h>
 #include <openssl/pem.h>
+#include <rats-tls/api.h>
 
-typedef union {
+/* The key generated last, only one of them is set at a time */
+typedef struct {
 	RSA *key;
 	EC_KEY *eckey;
 } openssl_ctx;
 
+/* Maximum number of pre-generated keys of each algorithm */
+#define OPENSSL_KEY_POOL_DEPTH_MAX 64
+
+extern EC_KEY *openssl_gen_ec_key(void);
+extern RSA *openssl_gen_rsa_key(void);
+
+extern void openssl_key_pool_reserve(const unsigned int *depth);
+extern void *openssl_key_pool_get(rats_tls_cert_algo_t algo);
+
 #endif
@@ -0,0 +1,43 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _RTLS_ENCLAVE_H
+#define _RTLS_ENCLAVE_H
+
+#include <sgx_urts.h>
+
+/* Default number of untrusted worker threads serving the switchless ocalls.
+ * A recv or a read holds its worker until the peer sends data, so a thread
+ * waiting on the peer may leave none free for the others. Their ocalls then
+ * fall back to regular ones after retries_before_fallback, and more workers
+ * avoid it for the applications receiving on several threads at once.
+ */
+#define RATS_TLS_SWITCHLESS_UWORKERS_DEFAULT 2
+
+typedef struct {
+	/* Number of untrusted worker threads, 0 means the default */
+	unsigned int num_uworkers;
+	/* Number of retries for a free worker before falling back to a regular
+	 * ocall, 0 means the default of the SGX SDK.
+	 */
+	unsigned int retries_before_fallback;
+	/* Number of polls of an idle worker before it sleeps, 0 means the default
+	 * of the SGX SDK.
+	 */
+	unsigned int retries_before_sleep;
+} rtls_switchless_conf_t;
+
+/* Create the enclave hosting rats-tls. If rats-tls is built with SGX_SWITCHLESS,
+ * the ocalls on the network and time paths are served by untrusted worker
+ * threads configured with conf, or if NULL, with the environment variables
+ * RATS_TLS_SWITCHLESS_UWORKERS, RATS_TLS_SWITCHLESS_RETRIES_BEFORE_FALLBACK
+ * and RATS_TLS_SWITCHLESS_RETRIES_BEFORE_SLEEP.
+ */
+extern sgx_status_t rtls_sgx_create_enclave(const char *file_name, int debug,
+					    const rtls_switchless_conf_t *conf,
+					    sgx_enclave_id_t *eid);
+
+#endif
@@ -0,0 +1,67 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_CERT_CACHE_H
+#define _INTERNAL_CERT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rats-tls/api.h>
+#include <rats-tls/claim.h>
+
+/* Default lifetime in seconds of a cached attested certificate */
+#define RATS_TLS_CERT_CACHE_TTL_DEFAULT 3600
+/* Default lifetime in seconds of a leaf certificate signed by an attested issuer */
+#define RATS_TLS_LEAF_CERT_TTL_DEFAULT 3600
+
+/* The configuration flags which change the evidence or the certificate */
+#define RATS_TLS_CERT_CACHE_FLAGS_MASK                                                   \
+	(RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS | RATS_TLS_CONF_FLAGS_BATCH_EVIDENCE | \
+	 RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER)
+
+/* The private key, certificate and evidence generated for a configuration,
+ * shared by all handles initialized with the same configuration.
+ */
+typedef struct rtls_cert_bundle {
+	struct rtls_cert_bundle *next;
+
+	/* Cache key */
+	char attester_type[ENCLAVE_ATTESTER_TYPE_NAME_SIZE];
+	char crypto_type[CRYPTO_TYPE_NAME_SIZE];
+	rats_tls_cert_algo_t cert_algo;
+	unsigned long flags;
+	claim_t *custom_claims;
+	size_t custom_claims_length;
+
+	uint8_t *privkey_buf;
+	unsigned int privkey_len;
+	uint8_t *cert_buf;
+	unsigned int cert_len;
+	uint8_t *evidence_buffer;
+	size_t evidence_buffer_size;
+	uint8_t *endorsements_buffer;
+	size_t endorsements_buffer_size;
+
+	/* Time when the certificate was generated, in seconds since the Epoch */
+	uint64_t created;
+	/* Expiration time in seconds since the Epoch */
+	uint64_t expiry;
+	/* Time when the collateral in the endorsements is out of date, or 0 */
+	uint64_t collateral_expiry;
+	/* Number of references held by the cache and the handles */
+	unsigned int refcount;
+} rtls_cert_bundle_t;
+
+struct rtls_core_context_t;
+
+extern rtls_cert_bundle_t *rtls_cert_bundle_new(struct rtls_core_context_t *ctx);
+extern rtls_cert_bundle_t *rtls_cert_bundle_get(rtls_cert_bundle_t *bundle);
+extern void rtls_cert_bundle_put(rtls_cert_bundle_t *bundle);
+
+extern rtls_cert_bundle_t *rtls_cert_cache_lookup(struct rtls_core_context_t *ctx);
+extern void rtls_cert_cache_insert(rtls_cert_bundle_t *bundle);
+
+#endif
@@ -0,0 +1,25 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_CERT_ROTATION_H
+#define _INTERNAL_CERT_ROTATION_H
+
+#include <rats-tls/err.h>
+
+/* Default interval in seconds between certificate rotations */
+#define RATS_TLS_CERT_ROTATION_INTERVAL_DEFAULT 86400
+/* Seconds ahead of the collateral going out of date to rotate */
+#define RATS_TLS_CERT_ROTATION_AHEAD 300
+/* Minimal seconds between two rotation attempts */
+#define RATS_TLS_CERT_ROTATION_RETRY 60
+
+struct rtls_core_context_t;
+
+extern rats_tls_err_t rtls_core_cert_rotation_start(struct rtls_core_context_t *ctx);
+extern void rtls_core_cert_rotation_notify(struct rtls_core_context_t *ctx);
+extern void rtls_core_cert_rotation_stop(struct rtls_core_context_t *ctx);
+
+#endif
@@ -0,0 +1,38 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_COLLATERAL_H
+#define _INTERNAL_COLLATERAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rats-tls/endorsement.h>
+
+#define SGX_FMSPC_SIZE 6
+
+typedef enum {
+	SGX_PCK_CA_UNKNOWN,
+	SGX_PCK_CA_PROCESSOR,
+	SGX_PCK_CA_PLATFORM,
+} sgx_pck_ca_t;
+
+/* The collateral of a SGX quote only depends on the platform family and on
+ * the CA issuing its PCK certificate.
+ */
+typedef struct {
+	uint8_t fmspc[SGX_FMSPC_SIZE];
+	sgx_pck_ca_t ca;
+} sgx_collateral_key_t;
+
+bool sgx_collateral_key_from_quote(const uint8_t *quote, uint32_t quote_len,
+				   sgx_collateral_key_t *key);
+const char *sgx_pck_ca_name(sgx_pck_ca_t ca);
+
+int sgx_collateral_dup(sgx_ecdsa_attestation_collateral_t *dst,
+		       const sgx_ecdsa_attestation_collateral_t *src);
+void sgx_collateral_free(sgx_ecdsa_attestation_collateral_t *collateral);
+
+#endif
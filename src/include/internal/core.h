@@ -9,6 +9,7 @@
 
 // clang-format off
 #include <sys/types.h>
+#include <pthread.h>
 #include <rats-tls/attester.h>
 #include <rats-tls/verifier.h>
 #include <rats-tls/tls_wrapper.h>
@@ -25,8 +26,34 @@ typedef struct rtls_core_context_t {
 	rats_tls_callback_t user_callback;
 	enclave_attester_ctx_t *attester;
 	enclave_verifier_ctx_t *verifier;
+	/* The verifier instances initialized on demand for the identity, in
+	 * the same order as enclave_verifiers_ctx.
+	 */
+	enclave_verifier_ctx_t *verifiers[ENCLAVE_VERIFIER_TYPE_MAX];
 	tls_wrapper_ctx_t *tls_wrapper;
 	crypto_wrapper_ctx_t *crypto_wrapper;
+	/* The handle owning the attested identity (key, certificate, attester,
+	 * verifier and crypto wrapper instances) shared by this session. NULL
+	 * if this context is the identity itself.
+	 */
+	struct rtls_core_context_t *identity;
+	/* Number of references to the identity, held by itself and its sessions */
+	unsigned int refcount;
+	/* The cached attested certificate in use, if any */
+	struct rtls_cert_bundle *cert_bundle;
+	/* The fd events the pending non-blocking operation is waiting for */
+	int events;
+	/* The eventfd signaled on completion of the verification in flight */
+	int async_fd;
+	struct rtls_verify_job *verify_job;
+	/* The background thread rotating the certificate of the identity */
+	struct rtls_cert_rotation *cert_rotation;
+	/* Serialize the rotations triggered by the application and the thread */
+	pthread_mutex_t rotate_lock;
+	/* The data written while the handle is corked, NULL if uncorked */
+	struct rtls_cork_buffer *cork_buffer;
+	/* The data received ahead of the reads of the application */
+	struct rtls_recv_buffer *recv_buffer;
 } rtls_core_context_t;
 
 #ifdef SGX
@@ -38,21 +65,62 @@ typedef struct dirent rtls_dirent;
 extern rtls_core_context_t global_core_context;
 
 extern rats_tls_err_t rtls_core_generate_certificate(rtls_core_context_t *);
+extern rats_tls_err_t rtls_core_rotate_certificate(rtls_core_context_t *ctx, bool refresh);
+extern uint64_t rtls_core_collateral_expiry(rtls_core_context_t *ctx);
 
 extern void rtls_exit(void);
 
+extern uint64_t rtls_time(void);
+
 extern rats_tls_err_t rtls_instance_init(const char *type, const char *realpath, void **handle);
 
 extern ssize_t rtls_write(int fd, const void *buf, size_t count);
 
 extern ssize_t rtls_read(int fd, void *buf, size_t count);
 
+extern ssize_t rtls_writev(int fd, const struct iovec *iov, int iovcnt);
+
+extern ssize_t rtls_pread(int fd, void *buf, size_t count, off_t offset);
+
+extern ssize_t rtls_sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+
 extern uint64_t rtls_opendir(const char *name);
 
 extern int rtls_readdir(uint64_t dirp, rtls_dirent **ptr);
 
 extern int rtls_closedir(uint64_t dir);
 
+static inline rtls_core_context_t *rtls_core_get_identity(rtls_core_context_t *ctx)
+{
+	return ctx->identity ? ctx->identity : ctx;
+}
+
+/* Record the fd events which a would-block operation waits for, and convert
+ * its tls wrapper error code to the one returned by the rats-tls API.
+ */
+static inline rats_tls_err_t rtls_core_update_events(rtls_core_context_t *ctx,
+						     tls_wrapper_err_t err)
+{
+	ctx->events = 0;
+
+	if (err == -TLS_WRAPPER_ERR_WANT_READ) {
+		ctx->events = RATS_TLS_EVENT_READ;
+		return -RATS_TLS_ERR_WANT_READ;
+	}
+
+	if (err == -TLS_WRAPPER_ERR_WANT_WRITE) {
+		ctx->events = RATS_TLS_EVENT_WRITE;
+		return -RATS_TLS_ERR_WANT_WRITE;
+	}
+
+	if (err == -TLS_WRAPPER_ERR_WANT_VERIFY) {
+		ctx->events = RATS_TLS_EVENT_VERIFY;
+		return -RATS_TLS_ERR_WANT_VERIFY;
+	}
+
+	return err;
+}
+
 // Whether the quote instance is initialized
 #define RATS_TLS_CTX_FLAGS_QUOTING_INITIALIZED (1 << 0)
 // Whether the tls lib is initialized
@@ -61,5 +129,7 @@ extern int rtls_closedir(uint64_t dir);
 #define RATS_TLS_CTX_FLAGS_CERT_CREATED (1 << 17)
 // Whether the crypto lib is initialized
 #define RATS_TLS_CTX_FLAGS_CRYPTO_INITIALIZED (1 << 18)
+// Whether the handshake over the shared memory rings is in progress
+#define RATS_TLS_CTX_FLAGS_SHM_NEGOTIATING (1 << 19)
 
 #endif
@@ -0,0 +1,29 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_DER_H
+#define _INTERNAL_DER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DER_TAG_OCTET_STRING 0x04
+#define DER_TAG_OID	     0x06
+#define DER_TAG_SEQUENCE     0x30
+
+/* Seconds since the Epoch of a date and time of the proleptic Gregorian calendar */
+uint64_t civil_to_epoch(unsigned int year, unsigned int month, unsigned int day,
+			unsigned int hour, unsigned int minute, unsigned int second);
+
+int der_next_element(const uint8_t **p, const uint8_t *end, const uint8_t **content,
+		     size_t *content_len);
+
+uint8_t *pem_to_der(const char *pem, size_t pem_len, const char *label, size_t *der_len);
+uint8_t *collateral_to_der(const char *buf, size_t len, const char *label, size_t *der_len);
+
+uint64_t crl_next_update(const char *crl, size_t crl_len);
+
+#endif
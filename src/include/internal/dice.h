@@ -26,6 +26,7 @@
 
 #define CLAIM_PUBLIC_KEY_HASH "pubkey-hash"
 #define CLAIM_NONCE	      "nonce"
+#define CLAIM_MERKLE_PROOF    "merkle-proof"
 
 #define TCG_DICE_TAGGED_EVIDENCE_OID	  "2.23.133.5.4.9"
 #define TCG_DICE_ENDORSEMENT_MANIFEST_OID "2.23.133.5.4.2"
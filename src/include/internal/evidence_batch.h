@@ -0,0 +1,46 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_EVIDENCE_BATCH_H
+#define _INTERNAL_EVIDENCE_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rats-tls/hash.h>
+#include <rats-tls/cert.h>
+#include <rats-tls/crypto_wrapper.h>
+
+/* Maximum number of claims buffers attested by a single evidence */
+#define RATS_TLS_EVIDENCE_BATCH_SIZE 256
+/* Default time in milliseconds for a batch to wait for the previous one */
+#define RATS_TLS_EVIDENCE_BATCH_WINDOW_DEFAULT 10
+
+/* A step of the inclusion proof of a claims buffer in a batch: the side of
+ * the sibling node, followed by its hash.
+ */
+#define MERKLE_PROOF_SIBLING_LEFT  0
+#define MERKLE_PROOF_SIBLING_RIGHT 1
+#define MERKLE_PROOF_STEP_SIZE	   (1 + SHA256_HASH_SIZE)
+
+struct rtls_core_context_t;
+
+extern crypto_wrapper_err_t rtls_merkle_root(crypto_wrapper_ctx_t *crypto_ctx,
+					     const uint8_t (*leaves)[SHA256_HASH_SIZE],
+					     size_t nr_leaves, uint8_t *root);
+extern crypto_wrapper_err_t rtls_merkle_proof(crypto_wrapper_ctx_t *crypto_ctx,
+					      const uint8_t (*leaves)[SHA256_HASH_SIZE],
+					      size_t nr_leaves, size_t index, uint8_t **proof_out,
+					      size_t *proof_size_out);
+extern crypto_wrapper_err_t rtls_merkle_root_from_proof(crypto_wrapper_ctx_t *crypto_ctx,
+							const uint8_t *leaf, const uint8_t *proof,
+							size_t proof_size, uint8_t *root);
+
+extern enclave_attester_err_t
+rtls_core_batch_collect_evidence(struct rtls_core_context_t *ctx, const uint8_t *leaf,
+				 attestation_evidence_t *evidence, uint8_t **proof_out,
+				 size_t *proof_size_out);
+
+#endif
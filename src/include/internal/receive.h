@@ -0,0 +1,37 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_RECEIVE_H
+#define _INTERNAL_RECEIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <rats-tls/err.h>
+
+/* Default number of bytes read ahead by rats_tls_receive_exact() and rats_tls_peek() */
+#define RATS_TLS_READ_AHEAD_SIZE_DEFAULT 16384
+
+/* The data received from the TLS session and not yet consumed by the application */
+typedef struct rtls_recv_buffer {
+	uint8_t *data;
+	size_t size;
+	/* The received data spans from off to len */
+	size_t off;
+	size_t len;
+} rtls_recv_buffer_t;
+
+struct rtls_core_context_t;
+
+extern rats_tls_err_t rtls_core_receive(struct rtls_core_context_t *ctx, void *buf,
+					size_t *buf_size);
+extern rats_tls_err_t rtls_core_receive_exact(struct rtls_core_context_t *ctx, void *buf,
+					      size_t size);
+extern rats_tls_err_t rtls_core_peek(struct rtls_core_context_t *ctx, void *buf,
+				     size_t *buf_size);
+extern void rtls_core_update_recv_events(struct rtls_core_context_t *ctx);
+extern void rtls_core_recv_buffer_free(struct rtls_core_context_t *ctx);
+
+#endif
@@ -0,0 +1,84 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_SHM_RING_H
+#define _INTERNAL_SHM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <rats-tls/err.h>
+
+#define RATS_TLS_SHM_MAGIC 0x534c5452 /* "RTLS" */
+/* Default number of bytes buffered by the ring in each direction */
+#define RATS_TLS_SHM_RING_SIZE_DEFAULT (256 * 1024)
+/* Number of polls of the ring before sleeping on the futex */
+#define RATS_TLS_SHM_SPIN_COUNT 2048
+
+#define RATS_TLS_SHM_CACHELINE_SIZE 64
+
+/* The control block of a ring in the shared memory. Each cacheline is only
+ * written by one side, except for the waiting flags.
+ */
+typedef struct {
+	/* Written by the producer */
+	uint64_t head __attribute__((aligned(RATS_TLS_SHM_CACHELINE_SIZE)));
+	uint32_t data_seq;
+	uint32_t producer_closed;
+
+	/* Written by the consumer */
+	uint64_t tail __attribute__((aligned(RATS_TLS_SHM_CACHELINE_SIZE)));
+	uint32_t space_seq;
+	uint32_t consumer_closed;
+
+	/* Set by a side before sleeping, and cleared by the other side waking it up */
+	uint32_t reader_waiting __attribute__((aligned(RATS_TLS_SHM_CACHELINE_SIZE)));
+	uint32_t writer_waiting;
+} rtls_shm_ring_t;
+
+/* The shared memory starts with this header, followed by the data of the
+ * client-to-server ring and of the server-to-client ring.
+ */
+typedef struct {
+	uint32_t magic;
+	uint32_t reserved;
+	uint64_t ring_size;
+	rtls_shm_ring_t rings[2];
+} rtls_shm_header_t;
+
+#define RATS_TLS_SHM_DATA_OFFSET 4096
+
+/* The view of the shared memory from one side */
+typedef struct rtls_shm_transport {
+	void *base;
+	size_t map_size;
+	uint64_t mask;
+	/* Number of polls of the ring before sleeping, 0 on a single CPU */
+	unsigned int spin_count;
+	rtls_shm_ring_t *tx;
+	uint8_t *tx_data;
+	rtls_shm_ring_t *rx;
+	uint8_t *rx_data;
+	/* Number of references held by the handle and the TLS objects using it */
+	unsigned int refcount;
+} rtls_shm_transport_t;
+
+extern rats_tls_err_t rtls_shm_create(size_t ring_size, int *shm_fd);
+extern rtls_shm_transport_t *rtls_shm_attach(int shm_fd, bool server);
+extern rtls_shm_transport_t *rtls_shm_get(rtls_shm_transport_t *shm);
+/* Drop a reference, and close the rings and unmap them along with the last one */
+extern void rtls_shm_detach(rtls_shm_transport_t *shm);
+
+/* The transport blocks like a socket, and sets errno to EPIPE once the peer
+ * has detached. The reads return 0 at the end of the data sent by the peer.
+ */
+extern ssize_t rtls_shm_read(rtls_shm_transport_t *shm, void *buf, size_t count);
+extern ssize_t rtls_shm_write(rtls_shm_transport_t *shm, const void *buf, size_t count);
+extern ssize_t rtls_shm_writev(rtls_shm_transport_t *shm, const struct iovec *iov, int iovcnt);
+
+#endif
@@ -0,0 +1,36 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_TRANSMIT_H
+#define _INTERNAL_TRANSMIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <rats-tls/err.h>
+
+/* The data of a corked handle is sent in chunks filling a full TLS record */
+#define RATS_TLS_CORK_BUFFER_SIZE 16384
+
+/* The data written to a corked handle and not yet transmitted */
+typedef struct rtls_cork_buffer {
+	uint8_t data[RATS_TLS_CORK_BUFFER_SIZE];
+	size_t len;
+	/* Offset of the data not yet accepted by the tls wrapper */
+	size_t off;
+} rtls_cork_buffer_t;
+
+struct rtls_core_context_t;
+
+extern rats_tls_err_t rtls_core_cork(struct rtls_core_context_t *ctx, bool cork);
+extern bool rtls_core_corked(struct rtls_core_context_t *ctx);
+extern void rtls_core_cork_discard(struct rtls_core_context_t *ctx);
+extern rats_tls_err_t rtls_core_transmit_corked(struct rtls_core_context_t *ctx, const void *buf,
+						size_t *buf_size);
+extern rats_tls_err_t rtls_core_flush(struct rtls_core_context_t *ctx);
+extern rats_tls_err_t rtls_core_transmit_done(struct rtls_core_context_t *ctx);
+
+#endif
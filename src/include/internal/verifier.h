@@ -16,6 +16,7 @@ extern rats_tls_err_t rtls_enclave_verifier_load_all(void);
 extern rats_tls_err_t rtls_enclave_verifier_load_single(const char *);
 extern rats_tls_err_t rtls_verifier_select(rtls_core_context_t *, const char *,
 					   rats_tls_cert_algo_t);
+extern void rtls_verifier_cleanup_all(rtls_core_context_t *);
 extern enclave_verifier_opts_t *enclave_verifiers_opts[ENCLAVE_VERIFIER_TYPE_MAX];
 extern enclave_verifier_ctx_t *enclave_verifiers_ctx[ENCLAVE_VERIFIER_TYPE_MAX];
 extern unsigned int enclave_verifier_nums;
@@ -0,0 +1,38 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_VERIFY_ASYNC_H
+#define _INTERNAL_VERIFY_ASYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <rats-tls/tls_wrapper.h>
+
+/* A certificate extension verification dispatched to the worker pool */
+typedef struct rtls_verify_job {
+	struct rtls_verify_job *next;
+	tls_wrapper_ctx_t *tls_ctx;
+	uint8_t *pubkey_buffer;
+	size_t pubkey_buffer_size;
+	uint8_t *evidence_buffer;
+	size_t evidence_buffer_size;
+	uint8_t *endorsements_buffer;
+	size_t endorsements_buffer_size;
+	tls_wrapper_err_t result;
+	bool done;
+} rtls_verify_job_t;
+
+struct rtls_core_context_t;
+
+extern tls_wrapper_err_t rtls_core_verify_async_submit(struct rtls_core_context_t *ctx,
+						       rtls_verify_job_t *job);
+extern bool rtls_core_verify_async_done(struct rtls_core_context_t *ctx);
+extern void rtls_core_verify_async_release(struct rtls_core_context_t *ctx);
+extern int rtls_core_get_async_fd(struct rtls_core_context_t *ctx);
+extern void rtls_core_verify_async_cleanup(struct rtls_core_context_t *ctx);
+
+#endif
@@ -0,0 +1,76 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _INTERNAL_VERIFY_CACHE_H
+#define _INTERNAL_VERIFY_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <rats-tls/api.h>
+#include <rats-tls/hash.h>
+#include <rats-tls/claim.h>
+#include <rats-tls/cert.h>
+#include <rats-tls/endorsement.h>
+#include <rats-tls/tls_wrapper.h>
+
+/* Maximum number of verification results kept in the cache */
+#define RATS_TLS_VERIFY_CACHE_SIZE 256
+/* Default lifetime in seconds of a successful verification result */
+#define RATS_TLS_VERIFY_CACHE_TTL_DEFAULT 3600
+/* Lifetime in seconds of a failed verification result */
+#define RATS_TLS_VERIFY_CACHE_NEGATIVE_TTL 30
+
+typedef struct {
+	uint8_t evidence_digest[SHA256_HASH_SIZE];
+	size_t evidence_buffer_size;
+	uint8_t endorsements_digest[SHA256_HASH_SIZE];
+	size_t endorsements_buffer_size;
+	/* The enforced verifier, or empty if selected by the evidence type */
+	char verifier_type[ENCLAVE_VERIFIER_TYPE_NAME_SIZE];
+	/* The quote type specific parameters of the handle */
+	uint8_t sgx_epid_spid[ENCLAVE_SGX_SPID_LENGTH];
+	bool sgx_epid_linkable;
+	uint8_t sgx_ecdsa_cert_type;
+} rtls_verify_key_t;
+
+/* The outcome of verifying a certificate extension, along with everything
+ * parsed from it that is needed to check the public key of a certificate
+ * carrying the same extension and to call the user verification callback.
+ */
+typedef struct rtls_verify_result {
+	struct rtls_verify_result *prev;
+	struct rtls_verify_result *next;
+
+	rtls_verify_key_t key;
+
+	tls_wrapper_err_t err;
+	/* The verifier failed for a reason which may not persist, i.e. the
+	 * collateral couldn't be fetched, so the failure is not cached.
+	 */
+	bool transient;
+	attestation_evidence_t evidence;
+	hash_algo_t pubkey_hash_algo;
+	uint8_t pubkey_hash[MAX_HASH_SIZE];
+	claim_t *custom_claims;
+	size_t custom_claims_length;
+
+	/* Expiration time in seconds since the Epoch */
+	uint64_t expiry;
+	/* Number of references held by the cache and the verifying threads */
+	unsigned int refcount;
+} rtls_verify_result_t;
+
+extern rtls_verify_result_t *rtls_verify_result_new(const rtls_verify_key_t *key);
+extern rtls_verify_result_t *rtls_verify_result_get(rtls_verify_result_t *result);
+extern void rtls_verify_result_put(rtls_verify_result_t *result);
+
+extern uint64_t rtls_verify_cache_collateral_expiry(const char *type,
+						     const attestation_endorsement_t *endorsements);
+extern rtls_verify_result_t *rtls_verify_cache_lookup(const rtls_verify_key_t *key);
+extern void rtls_verify_cache_insert(rtls_verify_result_t *result);
+
+#endif
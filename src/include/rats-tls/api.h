@@ -10,6 +10,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <sys/types.h>
+#include <sys/uio.h>
 #include <rats-tls/err.h>
 #include <rats-tls/claim.h>
 
@@ -63,6 +65,55 @@ typedef struct {
 		bool valid;
 		uint8_t cert_type;
 	} quote_sgx_ecdsa;
+
+	/* With RATS_TLS_CONF_FLAGS_CERT_CACHE, the attested certificate is
+	 * shared by the handles initialized with the same attester, crypto
+	 * wrapper, cert_algo, flags and custom claims for cert_cache_ttl
+	 * seconds. 0 means the default lifetime.
+	 */
+	unsigned int cert_cache_ttl;
+	/* With RATS_TLS_CONF_FLAGS_VERIFY_CACHE, the result of verifying the
+	 * evidence in a peer's certificate is reused for certificates carrying
+	 * the same evidence and endorsements for verify_cache_ttl seconds, or
+	 * until the endorsements expire. 0 means the default lifetime.
+	 */
+	unsigned int verify_cache_ttl;
+	/* The number of private keys of each algorithm which the crypto wrapper
+	 * pre-generates in background if supported. 0 disables the key pool.
+	 */
+	unsigned int key_pool_depth[RATS_TLS_CERT_ALGO_MAX];
+	/* With RATS_TLS_CONF_FLAGS_BATCH_EVIDENCE, the certificates generated
+	 * while an evidence is being collected share the next evidence, which
+	 * attests the root of a Merkle tree over their claims buffers. They
+	 * wait at most evidence_batch_window milliseconds for the previous
+	 * evidence. 0 means the default window.
+	 */
+	unsigned int evidence_batch_window;
+	/* With RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER, the attested certificate
+	 * shared through the certificate cache signs a leaf certificate with a
+	 * fresh key for each handle, valid for leaf_cert_ttl seconds. 0 means
+	 * the default lifetime. RATS_TLS_CONF_FLAGS_CERT_ROTATION is implied to
+	 * reissue the leaf certificate before it expires. In the enclave, where
+	 * no rotation thread runs, it must be set explicitly and the leaf
+	 * certificate reissued by calling rats_tls_rotate_cert().
+	 */
+	unsigned int leaf_cert_ttl;
+	/* With RATS_TLS_CONF_FLAGS_CERT_ROTATION, a background thread replaces
+	 * the certificate used by new TLS sessions every cert_rotation_interval
+	 * seconds, and before the collateral in the endorsements or the leaf
+	 * certificate signed by the attested issuer is out of date. 0 means
+	 * the default interval.
+	 */
+	unsigned int cert_rotation_interval;
+	/* The number of bytes rats_tls_receive() reads ahead from the TLS session
+	 * into a per-handle buffer when the application asks for less, so that
+	 * small reads are served without going through the socket. The TLS
+	 * wrapper may also read several TLS records per syscall, so with a
+	 * non-blocking fd, the application must only wait for the fd once
+	 * RATS_TLS_ERR_WANT_READ is returned. 0 disables the read-ahead of
+	 * rats_tls_receive().
+	 */
+	unsigned int read_ahead_size;
 } rats_tls_conf_t;
 
 typedef struct rtls_sgx_evidence {
@@ -137,18 +188,104 @@ typedef struct rtls_evidence {
 #define RATS_TLS_CONF_FLAGS_MUTUAL		 (1UL << 0)
 #define RATS_TLS_CONF_FLAGS_SERVER		 (RATS_TLS_CONF_FLAGS_MUTUAL << 1)
 #define RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS (RATS_TLS_CONF_FLAGS_SERVER << 1)
+#define RATS_TLS_CONF_FLAGS_CERT_CACHE		 (RATS_TLS_CONF_FLAGS_PROVIDE_ENDORSEMENTS << 1)
+#define RATS_TLS_CONF_FLAGS_ASYNC_VERIFY	 (RATS_TLS_CONF_FLAGS_CERT_CACHE << 1)
+#define RATS_TLS_CONF_FLAGS_VERIFY_CACHE	 (RATS_TLS_CONF_FLAGS_ASYNC_VERIFY << 1)
+#define RATS_TLS_CONF_FLAGS_BATCH_EVIDENCE	 (RATS_TLS_CONF_FLAGS_VERIFY_CACHE << 1)
+#define RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER	 (RATS_TLS_CONF_FLAGS_BATCH_EVIDENCE << 1)
+#define RATS_TLS_CONF_FLAGS_CERT_ROTATION	 (RATS_TLS_CONF_FLAGS_ATTESTED_ISSUER << 1)
+#define RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION	 (RATS_TLS_CONF_FLAGS_CERT_ROTATION << 1)
+#define RATS_TLS_CONF_FLAGS_KTLS		 (RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION << 1)
 /* Internal flags */
 #define RATS_TLS_CONF_FLAGS_ATTESTER_ENFORCED (1UL << RATS_TLS_CONF_FLAGS_PRIVATE_MASK_SHIFT)
 #define RATS_TLS_CONF_FLAGS_VERIFIER_ENFORCED (RATS_TLS_CONF_FLAGS_ATTESTER_ENFORCED << 1)
 
+/* The fd events reported by rats_tls_get_events() */
+#define RATS_TLS_EVENT_READ    (1 << 0)
+#define RATS_TLS_EVENT_WRITE   (1 << 1)
+/* Wait for the fd returned by rats_tls_get_async_fd() to be readable */
+#define RATS_TLS_EVENT_VERIFY  (1 << 2)
+/* Received data is buffered by the handle, and is returned by rats_tls_receive()
+ * or rats_tls_peek() without waiting for the fd to be readable.
+ */
+#define RATS_TLS_EVENT_PENDING (1 << 3)
+
 typedef int (*rats_tls_callback_t)(void *);
 
 rats_tls_err_t rats_tls_init(const rats_tls_conf_t *conf, rats_tls_handle *handle);
+/* Create a lightweight per-connection handle sharing the attested identity of
+ * handle, without generating a new key, evidence and certificate. The session
+ * is released with rats_tls_cleanup() and may outlive its parent handle.
+ */
+rats_tls_err_t rats_tls_session_init(rats_tls_handle handle, rats_tls_handle *session);
 rats_tls_err_t rats_tls_set_verification_callback(rats_tls_handle *handle,
 						  rats_tls_callback_t user_callback);
 rats_tls_err_t rats_tls_negotiate(rats_tls_handle handle, int fd);
 rats_tls_err_t rats_tls_receive(rats_tls_handle handle, void *buf, size_t *buf_size);
 rats_tls_err_t rats_tls_transmit(rats_tls_handle handle, void *buf, size_t *buf_size);
 rats_tls_err_t rats_tls_cleanup(rats_tls_handle handle);
+/* With a non-blocking fd, rats_tls_negotiate(), rats_tls_transmit() and
+ * rats_tls_receive() return RATS_TLS_ERR_WANT_READ or RATS_TLS_ERR_WANT_WRITE
+ * instead of blocking, and must be called again with the same arguments once
+ * the fd is ready. The events to wait for are reported by this function, and
+ * 0 means no operation is pending. If the data accepted by a transmit can't be
+ * sent in full yet, the transmit succeeds and RATS_TLS_EVENT_WRITE is reported:
+ * rats_tls_flush() must then be called once the fd is writable, until it
+ * returns RATS_TLS_ERR_NONE. After a receive, RATS_TLS_EVENT_PENDING tells to
+ * receive again before waiting for the fd.
+ */
+rats_tls_err_t rats_tls_get_events(rats_tls_handle handle, int *events);
+/* With RATS_TLS_CONF_FLAGS_ASYNC_VERIFY, the evidence of the peer is verified
+ * by a pool of worker threads, and rats_tls_negotiate() returns
+ * RATS_TLS_ERR_WANT_VERIFY in the meantime. The returned fd becomes readable
+ * once the verification completes, and the user verification callback is
+ * called from a worker thread.
+ */
+rats_tls_err_t rats_tls_get_async_fd(rats_tls_handle handle, int *fd);
+/* Replace the certificate used by the TLS sessions negotiated from now on
+ * with a new one carrying fresh evidence, e.g. after a TCB recovery. The TLS
+ * sessions already negotiated are not affected.
+ */
+rats_tls_err_t rats_tls_rotate_cert(rats_tls_handle handle);
+/* Send up to *size bytes of the file file_fd from offset over the negotiated
+ * TLS session, and update *size with the number of bytes sent. The file is
+ * sent without copying it to user space if the TLS session is offloaded to
+ * the kernel with RATS_TLS_CONF_FLAGS_KTLS.
+ */
+rats_tls_err_t rats_tls_sendfile(rats_tls_handle handle, int file_fd, off_t offset,
+				 size_t *size);
+/* Transmit the data gathered from iovcnt buffers, packed into as few TLS
+ * records as possible, and update *size with the number of bytes sent.
+ */
+rats_tls_err_t rats_tls_transmitv(rats_tls_handle handle, const struct iovec *iov, int iovcnt,
+				  size_t *size);
+/* While a handle is corked, the data written by rats_tls_transmit() and
+ * rats_tls_transmitv() is buffered and only sent in full TLS records, until
+ * rats_tls_flush() is called or the handle is uncorked. The data still
+ * buffered is discarded by rats_tls_cleanup(). With a non-blocking fd,
+ * rats_tls_flush() returns RATS_TLS_ERR_WANT_WRITE until all the data is sent,
+ * and must be called again once the fd is writable.
+ */
+rats_tls_err_t rats_tls_cork(rats_tls_handle handle, bool cork);
+rats_tls_err_t rats_tls_flush(rats_tls_handle handle);
+/* Receive exactly size bytes, e.g. a length prefix and then the message it
+ * announces. With a non-blocking fd, the data received before the fd would
+ * block is kept by the handle until the call is repeated.
+ */
+rats_tls_err_t rats_tls_receive_exact(rats_tls_handle handle, void *buf, size_t size);
+/* Copy up to *buf_size bytes of the received data without consuming them,
+ * and update *buf_size with the number of bytes copied. The data is only
+ * received from the TLS session if none is buffered by the handle.
+ */
+rats_tls_err_t rats_tls_peek(rats_tls_handle handle, void *buf, size_t *buf_size);
+/* Create a shared memory region for a TLS session between two processes on
+ * the same host, carrying the data in a pair of lock-free rings buffering
+ * ring_size bytes each, or a default size if 0. The close-on-exec fd is
+ * passed to the peer, e.g. over a unix socket, and both sides negotiate the
+ * TLS session over it with rats_tls_negotiate_shm() instead of a socket.
+ * The data is then transferred without syscalls while both sides are busy.
+ */
+rats_tls_err_t rats_tls_shm_create(size_t ring_size, int *shm_fd);
+rats_tls_err_t rats_tls_negotiate_shm(rats_tls_handle handle, int shm_fd);
 
 #endif
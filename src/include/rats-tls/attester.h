@@ -44,6 +44,7 @@ typedef struct {
 	/* Optional */
 	enclave_attester_err_t (*pre_init)(void);
 	enclave_attester_err_t (*init)(enclave_attester_ctx_t *ctx, rats_tls_cert_algo_t algo);
+	/* Called with each leaf certificate signed by the attested issuer */
 	enclave_attester_err_t (*extend_cert)(enclave_attester_ctx_t *ctx,
 					      const rats_tls_cert_info_t *cert_info);
 	enclave_attester_err_t (*collect_evidence)(enclave_attester_ctx_t *ctx,
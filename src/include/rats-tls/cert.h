@@ -75,6 +75,17 @@ typedef struct {
 	size_t evidence_buffer_size;
 	uint8_t *endorsements_buffer;
 	size_t endorsements_buffer_size;
+	/* The certificate and private key in DER format of the attested issuer
+	 * signing the certificate. The certificate is self-signed without them.
+	 */
+	const uint8_t *issuer_cert_buf;
+	unsigned int issuer_cert_len;
+	const uint8_t *issuer_privkey_buf;
+	unsigned int issuer_privkey_len;
+	/* Validity in seconds of the certificate, 0 for the default */
+	unsigned int validity;
+	/* The certificate is allowed to sign leaf certificates */
+	bool is_ca;
 } rats_tls_cert_info_t;
 
 #endif
@@ -52,6 +52,7 @@ struct crypto_wrapper_ctx {
 	rats_tls_log_level_t log_level;
 	rats_tls_cert_algo_t cert_algo;
 	void *handle;
+	unsigned int key_pool_depth[RATS_TLS_CERT_ALGO_MAX];
 };
 
 extern crypto_wrapper_err_t crypto_wrapper_register(const crypto_wrapper_opts_t *);
@@ -27,9 +27,20 @@ typedef struct {
 	uint32_t qe_identity_size;
 } sgx_ecdsa_attestation_collateral_t;
 
+/* The DER certs of the VCEK and its chain provided by the host of the SEV-SNP guest */
+typedef struct {
+	uint8_t *vcek;
+	uint32_t vcek_size;
+	uint8_t *ask;
+	uint32_t ask_size;
+	uint8_t *ark;
+	uint32_t ark_size;
+} snp_attestation_collateral_t;
+
 typedef struct {
 	union {
 		sgx_ecdsa_attestation_collateral_t ecdsa; /* SGX / TDX ECDSA */
+		snp_attestation_collateral_t snp; /* SEV-SNP */
 	};
 } attestation_endorsement_t;
 
@@ -85,6 +85,12 @@ typedef enum {
 	RATS_TLS_ERR_INIT,
 	RATS_TLS_ERR_UNSUPPORTED_CERT_ALGO,
 	RATS_TLS_ERR_NO_NAME,
+	/* The operation would block and must be retried once the fd is readable */
+	RATS_TLS_ERR_WANT_READ,
+	/* The operation would block and must be retried once the fd is writable */
+	RATS_TLS_ERR_WANT_WRITE,
+	/* The operation must be retried once the async fd is readable */
+	RATS_TLS_ERR_WANT_VERIFY,
 } rats_tls_err_t;
 
 typedef enum {
@@ -103,6 +109,8 @@ typedef enum {
 	ENCLAVE_VERIFIER_ERR_INVALID,
 	ENCLAVE_VERIFIER_ERR_NO_TOOL,
 	ENCLAVE_VERIFIER_ERR_CBOR,
+	/* The collateral couldn't be fetched, so the evidence may be verified later */
+	ENCLAVE_VERIFIER_ERR_COLLATERAL,
 } enclave_verifier_err_t;
 
 typedef enum {
@@ -117,6 +125,11 @@ typedef enum {
 	TLS_WRAPPER_ERR_PRIV_KEY,
 	TLS_WRAPPER_ERR_CERT,
 	TLS_WRAPPER_ERR_UNKNOWN,
+	TLS_WRAPPER_ERR_WANT_READ,
+	TLS_WRAPPER_ERR_WANT_WRITE,
+	TLS_WRAPPER_ERR_WANT_VERIFY,
+	/* The operation is not supported by the TLS library */
+	TLS_WRAPPER_ERR_NOT_SUPPORTED,
 } tls_wrapper_err_t;
 
 typedef enum {
@@ -40,6 +40,34 @@ typedef struct {
 	tls_wrapper_err_t (*transmit)(tls_wrapper_ctx_t *ctx, void *buf, size_t *buf_size);
 	tls_wrapper_err_t (*receive)(tls_wrapper_ctx_t *ctx, void *buf, size_t *buf_size);
 	tls_wrapper_err_t (*cleanup)(tls_wrapper_ctx_t *ctx);
+	/* Set up a per-connection session_ctx sharing the TLS identity of ctx */
+	tls_wrapper_err_t (*session_init)(tls_wrapper_ctx_t *ctx, tls_wrapper_ctx_t *session_ctx);
+	/* Replace the private key and certificate for the TLS sessions established
+	 * from now on, without affecting the ones established or in progress.
+	 */
+	tls_wrapper_err_t (*replace_cert)(tls_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
+					  void *privkey_buf, size_t privkey_len,
+					  rats_tls_cert_info_t *cert_info);
+	/* Send up to *size bytes of the file from offset, and update *size with
+	 * the number of bytes sent.
+	 */
+	tls_wrapper_err_t (*sendfile)(tls_wrapper_ctx_t *ctx, int file_fd, off_t offset,
+				      size_t *size);
+	/* Transmit the data gathered from the buffers, and update *size with the
+	 * number of bytes sent.
+	 */
+	tls_wrapper_err_t (*transmitv)(tls_wrapper_ctx_t *ctx, const struct iovec *iov,
+				       int iovcnt, size_t *size);
+	/* Send the data batched by the tls library after it was accepted by
+	 * transmit, transmitv or sendfile. It returns -TLS_WRAPPER_ERR_WANT_WRITE
+	 * if the fd would block, and must be called again once the fd is ready.
+	 */
+	tls_wrapper_err_t (*flush)(tls_wrapper_ctx_t *ctx);
+	/* Update *size with the number of bytes received by the tls library and
+	 * not yet returned by receive, including the ones not yet decrypted. It
+	 * may only be a lower bound, but is nonzero if any byte is pending.
+	 */
+	tls_wrapper_err_t (*pending)(tls_wrapper_ctx_t *ctx, size_t *size);
 } tls_wrapper_opts_t;
 
 struct tls_wrapper_ctx {
@@ -51,6 +79,12 @@ struct tls_wrapper_ctx {
 	unsigned long conf_flags;
 	rats_tls_log_level_t log_level;
 	void *handle;
+	/* With RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION, the verified evidence of
+	 * the peer in the current TLS session, which a resumed session is bound to.
+	 */
+	struct rtls_verify_result *peer_evidence;
+	/* The shared memory rings carrying the TLS session instead of fd, if any */
+	struct rtls_shm_transport *shm;
 };
 
 extern tls_wrapper_err_t tls_wrapper_register(const tls_wrapper_opts_t *);
@@ -61,4 +95,19 @@ tls_wrapper_verify_certificate_extension(tls_wrapper_ctx_t *tls_ctx, const uint8
 					 size_t evidence_buffer_size, uint8_t *endorsements_buffer,
 					 size_t endorsements_buffer_size);
 
+/* Dispatch tls_wrapper_verify_certificate_extension() to the worker pool. It
+ * returns -TLS_WRAPPER_ERR_WANT_VERIFY until the result is available, and must
+ * be called again with the same arguments to collect it.
+ */
+extern tls_wrapper_err_t tls_wrapper_verify_certificate_extension_async(
+	tls_wrapper_ctx_t *tls_ctx, const uint8_t *pubkey_buffer, size_t pubkey_buffer_size,
+	uint8_t *evidence_buffer, size_t evidence_buffer_size, uint8_t *endorsements_buffer,
+	size_t endorsements_buffer_size);
+
+/* Check the evidence verified in the TLS session being resumed, and report it
+ * to the user callback instead of verifying the certificate extension again.
+ */
+extern tls_wrapper_err_t tls_wrapper_verify_resumed_session(tls_wrapper_ctx_t *tls_ctx,
+							    struct rtls_verify_result *result);
+
 #endif
@@ -0,0 +1,62 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <sgx_urts.h>
+#ifdef SGX_SWITCHLESS
+#include <sgx_uswitchless.h>
+#endif
+#include "rtls_enclave.h"
+
+#ifdef SGX_SWITCHLESS
+static unsigned int getenv_uint(const char *name)
+{
+	const char *value = getenv(name);
+	if (!value)
+		return 0;
+
+	return (unsigned int)strtoul(value, NULL, 10);
+}
+
+sgx_status_t rtls_sgx_create_enclave(const char *file_name, int debug,
+				     const rtls_switchless_conf_t *conf, sgx_enclave_id_t *eid)
+{
+	rtls_switchless_conf_t env_conf;
+
+	if (!conf) {
+		env_conf.num_uworkers = getenv_uint("RATS_TLS_SWITCHLESS_UWORKERS");
+		env_conf.retries_before_fallback =
+			getenv_uint("RATS_TLS_SWITCHLESS_RETRIES_BEFORE_FALLBACK");
+		env_conf.retries_before_sleep =
+			getenv_uint("RATS_TLS_SWITCHLESS_RETRIES_BEFORE_SLEEP");
+		conf = &env_conf;
+	}
+
+	sgx_uswitchless_config_t us_config = SGX_USWITCHLESS_CONFIG_INITIALIZER;
+	us_config.num_uworkers = conf->num_uworkers;
+	if (!us_config.num_uworkers)
+		us_config.num_uworkers = RATS_TLS_SWITCHLESS_UWORKERS_DEFAULT;
+	/* Only the ocalls are switchless */
+	us_config.num_tworkers = 0;
+	if (conf->retries_before_fallback)
+		us_config.retries_before_fallback = conf->retries_before_fallback;
+	if (conf->retries_before_sleep)
+		us_config.retries_before_sleep = conf->retries_before_sleep;
+
+	const void *enclave_ex_p[32] = { 0 };
+	enclave_ex_p[SGX_CREATE_ENCLAVE_EX_SWITCHLESS_BIT_IDX] = &us_config;
+
+	return sgx_create_enclave_ex(file_name, debug, NULL, NULL, eid, NULL,
+				     SGX_CREATE_ENCLAVE_EX_SWITCHLESS, enclave_ex_p);
+}
+#else
+sgx_status_t rtls_sgx_create_enclave(const char *file_name, int debug,
+				     __attribute__((unused)) const rtls_switchless_conf_t *conf,
+				     sgx_enclave_id_t *eid)
+{
+	return sgx_create_enclave(file_name, debug, NULL, NULL, eid, NULL);
+}
+#endif
@@ -13,6 +13,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/sendfile.h>
 #include <sys/time.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
@@ -116,6 +117,21 @@ ssize_t ocall_write(int fd, const void *buf, size_t count)
 	return write(fd, buf, count);
 }
 
+ssize_t ocall_pread(int fd, void *buf, size_t count, int64_t offset)
+{
+	return pread(fd, buf, count, (off_t)offset);
+}
+
+ssize_t ocall_sendfile(int out_fd, int in_fd, int64_t *offset, size_t count)
+{
+	off_t off = (off_t)*offset;
+	ssize_t rc = sendfile(out_fd, in_fd, &off, count);
+
+	*offset = (int64_t)off;
+
+	return rc;
+}
+
 void ocall_getenv(const char *name, char *value, size_t len)
 {
 	memset(value, 0, len);
@@ -12,6 +12,9 @@
 #include "internal/attester.h"
 #include "internal/verifier.h"
 #include "internal/dice.h"
+#include "internal/core.h"
+#include "internal/verify_cache.h"
+#include "internal/evidence_batch.h"
 
 #include <rats-tls/csv.h>
 // clang-format off
@@ -21,11 +24,17 @@
 #include "sgx_quote_3.h"
 // clang-format on
 
+/* Verify @evidence against @hash. On failure, @transient tells whether the verifier
+ * may succeed later, i.e. the collateral couldn't be fetched or memory ran out,
+ * rather than rejected the evidence.
+ */
 tls_wrapper_err_t
 tls_wrapper_verify_evidence(tls_wrapper_ctx_t *tls_ctx, attestation_evidence_t *evidence,
 			    uint8_t *hash, uint32_t hash_len,
-			    attestation_endorsement_t *endorsements /* Optional */)
+			    attestation_endorsement_t *endorsements /* Optional */, bool *transient)
 {
+	*transient = false;
+
 	RTLS_DEBUG("tls_wrapper_verify_evidence() called with evidence type: '%s'\n",
 		   evidence->type);
 
@@ -61,46 +70,92 @@ tls_wrapper_verify_evidence(tls_wrapper_ctx_t *tls_ctx, attestation_evidence_t *
 		tls_ctx->rtls_handle->verifier, evidence, hash, hash_len, endorsements);
 	if (err != ENCLAVE_VERIFIER_ERR_NONE) {
 		RTLS_ERR("failed to verify evidence %#x\n", err);
+		*transient = err == -ENCLAVE_VERIFIER_ERR_COLLATERAL ||
+			     err == -ENCLAVE_VERIFIER_ERR_NO_MEM;
 		return -TLS_WRAPPER_ERR_INVALID;
 	}
 
 	return TLS_WRAPPER_ERR_NONE;
 }
 
-tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
-	tls_wrapper_ctx_t *tls_ctx,
-	const uint8_t *pubkey_buffer /* in SubjectPublicKeyInfo format */,
-	size_t pubkey_buffer_size, uint8_t *evidence_buffer /* optional, for nullverifier */,
-	size_t evidence_buffer_size, uint8_t *endorsements_buffer /* optional */,
-	size_t endorsements_buffer_size)
+/* Compute the root of the batch from the inclusion proof carried in the claims
+ * buffer, if any. The proof is removed from the custom claims, and the hash of
+ * the claims buffer without it is the leaf of the Merkle tree.
+ */
+static tls_wrapper_err_t batch_root_of_claims(tls_wrapper_ctx_t *tls_ctx,
+					      rtls_verify_result_t *result, uint8_t *hash)
 {
-	tls_wrapper_err_t ret;
+	crypto_wrapper_ctx_t *crypto_ctx = tls_ctx->rtls_handle->crypto_wrapper;
+	claim_t *claims = result->custom_claims;
+	size_t claims_length = result->custom_claims_length;
+	size_t i;
+
+	for (i = 0; i < claims_length; ++i) {
+		if (!strcmp(claims[i].name, CLAIM_MERKLE_PROOF))
+			break;
+	}
+	if (i == claims_length)
+		return TLS_WRAPPER_ERR_NONE;
 
-	attestation_evidence_t evidence;
+	claim_t proof = claims[i];
+	memmove(&claims[i], &claims[i + 1], (claims_length - i - 1) * sizeof(claim_t));
+	result->custom_claims_length = --claims_length;
 
+	tls_wrapper_err_t ret = -TLS_WRAPPER_ERR_INVALID;
 	uint8_t *claims_buffer = NULL;
 	size_t claims_buffer_size = 0;
-	claim_t *custom_claims = NULL;
-	size_t custom_claims_length = 0;
+	enclave_attester_err_t a_ret = dice_generate_claims_buffer(
+		result->pubkey_hash_algo, result->pubkey_hash, claims, claims_length,
+		&claims_buffer, &claims_buffer_size);
+	if (a_ret != ENCLAVE_ATTESTER_ERR_NONE) {
+		RTLS_ERR("failed to generate the claims buffer without proof: %#x\n", a_ret);
+		goto err;
+	}
 
-	RTLS_DEBUG(
-		"tls_ctx: %p, pubkey_buffer: %p, pubkey_buffer_size: %zu, evidence_buffer: %p, evidence_buffer_size: %zu, endorsements_buffer: %p, endorsements_buffer_size: %zu\n",
-		tls_ctx, pubkey_buffer, pubkey_buffer_size, evidence_buffer, evidence_buffer_size,
-		endorsements_buffer, endorsements_buffer_size);
+	uint8_t leaf[SHA256_HASH_SIZE];
+	crypto_wrapper_err_t c_err = crypto_ctx->opts->gen_hash(
+		crypto_ctx, HASH_ALGO_SHA256, claims_buffer, claims_buffer_size, leaf);
+	if (c_err == CRYPTO_WRAPPER_ERR_NONE)
+		c_err = rtls_merkle_root_from_proof(crypto_ctx, leaf, proof.value,
+						    proof.value_size, hash);
+	if (c_err != CRYPTO_WRAPPER_ERR_NONE) {
+		RTLS_ERR("failed to calculate the root of the batch: %#x\n", c_err);
+		goto err;
+	}
 
-	if (!tls_ctx || !tls_ctx->rtls_handle || !tls_ctx->rtls_handle->verifier ||
-	    !tls_ctx->rtls_handle->verifier->opts ||
-	    !tls_ctx->rtls_handle->verifier->opts->verify_evidence || !pubkey_buffer)
-		return -TLS_WRAPPER_ERR_INVALID;
+	RTLS_DEBUG("the claims buffer is attested in batch, proof size %zu\n", proof.value_size);
+
+	ret = TLS_WRAPPER_ERR_NONE;
+err:
+	free(claims_buffer);
+	free(proof.name);
+	free(proof.value);
+	return ret;
+}
+
+/* Parse and verify the evidence and endorsements, and extract the claims to
+ * check the public key of the certificate against.
+ */
+static tls_wrapper_err_t verify_evidence_buffer(tls_wrapper_ctx_t *tls_ctx,
+						rtls_verify_result_t *result,
+						uint8_t *evidence_buffer, size_t evidence_buffer_size,
+						uint8_t *endorsements_buffer,
+						size_t endorsements_buffer_size)
+{
+	tls_wrapper_err_t ret;
+	attestation_evidence_t *evidence = &result->evidence;
+
+	uint8_t *claims_buffer = NULL;
+	size_t claims_buffer_size = 0;
 
 	/* Get evidence struct and claims_buffer from evidence_buffer. */
 	if (!evidence_buffer) {
 		/* evidence_buffer is empty, which means that the other party is using a non-dice certificate or is using a nullattester */
 		RTLS_WARN("No evidence available in peer's certificate\n");
-		memset(&evidence, 0, sizeof(attestation_evidence_t));
+		memset(evidence, 0, sizeof(attestation_evidence_t));
 	} else {
 		enclave_verifier_err_t d_ret = dice_parse_evidence_buffer_with_tag(
-			evidence_buffer, evidence_buffer_size, &evidence, &claims_buffer,
+			evidence_buffer, evidence_buffer_size, evidence, &claims_buffer,
 			&claims_buffer_size);
 		if (d_ret != ENCLAVE_VERIFIER_ERR_NONE) {
 			ret = TLS_WRAPPER_ERR_INVALID;
@@ -109,7 +164,27 @@ tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
 			goto err;
 		}
 	}
-	RTLS_DEBUG("evidence->type: '%s'\n", evidence.type);
+	RTLS_DEBUG("evidence->type: '%s'\n", evidence->type);
+
+	/* Parse claims buffer */
+	if (claims_buffer) {
+		enclave_verifier_err_t d_ret = dice_parse_claims_buffer(
+			claims_buffer, claims_buffer_size, &result->pubkey_hash_algo,
+			result->pubkey_hash, &result->custom_claims, &result->custom_claims_length);
+		if (d_ret != ENCLAVE_VERIFIER_ERR_NONE) {
+			ret = TLS_WRAPPER_ERR_INVALID;
+			RTLS_ERR("dice failed to parse claims from claims_buffer: %#x\n", d_ret);
+			goto err;
+		}
+
+		RTLS_DEBUG("custom_claims %p, claims_size %zu\n", result->custom_claims,
+			   result->custom_claims_length);
+		for (size_t i = 0; i < result->custom_claims_length; ++i) {
+			RTLS_DEBUG("custom_claims[%zu] -> name: '%s' value_size: %zu\n", i,
+				   result->custom_claims[i].name,
+				   result->custom_claims[i].value_size);
+		}
+	}
 
 	/* Get endorsements (optional) from endorsements_buffer */
 	attestation_endorsement_t endorsements;
@@ -119,7 +194,7 @@ tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
 	RTLS_DEBUG("has_endorsements: %s\n", has_endorsements ? "true" : "false");
 	if (has_endorsements) {
 		enclave_verifier_err_t d_ret = dice_parse_endorsements_buffer_with_tag(
-			evidence.type, endorsements_buffer, endorsements_buffer_size,
+			evidence->type, endorsements_buffer, endorsements_buffer_size,
 			&endorsements);
 		if (d_ret != ENCLAVE_VERIFIER_ERR_NONE) {
 			ret = TLS_WRAPPER_ERR_INVALID;
@@ -150,8 +225,21 @@ tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
 		if (c_err != CRYPTO_WRAPPER_ERR_NONE) {
 			RTLS_ERR("failed to calculate hash of claims_buffer: %#x\n", c_err);
 			ret = TLS_WRAPPER_ERR_INVALID;
+			if (has_endorsements)
+				free_endorsements(evidence->type, &endorsements);
 			goto err;
 		}
+
+		/* The evidence of a batch attests the root of the Merkle tree
+		 * over the hashes of the claims buffers instead.
+		 */
+		ret = batch_root_of_claims(tls_ctx, result, claims_buffer_hash);
+		if (ret != TLS_WRAPPER_ERR_NONE) {
+			if (has_endorsements)
+				free_endorsements(evidence->type, &endorsements);
+			goto err;
+		}
+
 		if (claims_buffer_hash_len >= 16)
 			RTLS_DEBUG(
 				"sha256 of claims_buffer [%zu] %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x...\n",
@@ -165,77 +253,114 @@ tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
 	}
 
 	/* Verify evidence and userdata */
-	ret = tls_wrapper_verify_evidence(tls_ctx, &evidence, claims_buffer_hash,
+	ret = tls_wrapper_verify_evidence(tls_ctx, evidence, claims_buffer_hash,
 					  claims_buffer_hash_len,
-					  has_endorsements ? &endorsements : NULL);
-	if (has_endorsements)
-		free_endorsements(evidence.type, &endorsements);
+					  has_endorsements ? &endorsements : NULL,
+					  &result->transient);
+	if (has_endorsements) {
+		/* The verification result is valid as long as the endorsements */
+		result->expiry = rtls_verify_cache_collateral_expiry(evidence->type, &endorsements);
+		free_endorsements(evidence->type, &endorsements);
+	}
 	if (ret != TLS_WRAPPER_ERR_NONE) {
 		RTLS_ERR("failed to verify evidence: %#x\n", ret);
 		goto err;
 	}
 
-	/* Parse and verify claims buffer */
-	if (claims_buffer) {
-		hash_algo_t pubkey_hash_algo = HASH_ALGO_RESERVED;
-		uint8_t pubkey_hash[MAX_HASH_SIZE];
-		enclave_verifier_err_t d_ret = dice_parse_claims_buffer(
-			claims_buffer, claims_buffer_size, &pubkey_hash_algo, pubkey_hash,
-			&custom_claims, &custom_claims_length);
+	ret = TLS_WRAPPER_ERR_NONE;
+err:
+	if (claims_buffer)
 		free(claims_buffer);
-		claims_buffer = NULL;
-		if (d_ret != ENCLAVE_VERIFIER_ERR_NONE) {
-			ret = TLS_WRAPPER_ERR_INVALID;
-			RTLS_ERR("dice failed to parse claims from claims_buffer: %#x\n", d_ret);
-			goto err;
-		}
 
-		RTLS_DEBUG("custom_claims %p, claims_size %zu\n", custom_claims,
-			   custom_claims_length);
-		for (size_t i = 0; i < custom_claims_length; ++i) {
-			RTLS_DEBUG("custom_claims[%zu] -> name: '%s' value_size: %zu\n", i,
-				   custom_claims[i].name, custom_claims[i].value_size);
-		}
+	return ret;
+}
 
-		/* Verify pubkey_hash */
-		RTLS_DEBUG("check pubkey hash. pubkey_hash: %p, pubkey_hash_algo: %d\n",
-			   pubkey_hash, pubkey_hash_algo);
+/* Compute the key to look up the verification result of a certificate
+ * extension. The verifier is part of the key only when enforced, because
+ * it is otherwise selected by the evidence type. The configuration of the
+ * handle which may change the result is part of the key too.
+ */
+static bool verify_cache_key(tls_wrapper_ctx_t *tls_ctx, rtls_verify_key_t *key,
+			     uint8_t *evidence_buffer, size_t evidence_buffer_size,
+			     uint8_t *endorsements_buffer, size_t endorsements_buffer_size)
+{
+	crypto_wrapper_ctx_t *crypto_ctx = tls_ctx->rtls_handle->crypto_wrapper;
+	const rats_tls_conf_t *conf = &tls_ctx->rtls_handle->config;
 
-		uint8_t calculated_pubkey_hash[MAX_HASH_SIZE];
-		crypto_wrapper_err_t c_err = tls_ctx->rtls_handle->crypto_wrapper->opts->gen_hash(
-			tls_ctx->rtls_handle->crypto_wrapper, pubkey_hash_algo, pubkey_buffer,
-			pubkey_buffer_size, calculated_pubkey_hash);
-		if (c_err != CRYPTO_WRAPPER_ERR_NONE) {
-			RTLS_ERR("failed to calculate hash of pubkey: %#x\n", c_err);
-			ret = TLS_WRAPPER_ERR_INVALID;
-			goto err;
-		}
+	/* A digest computed by nullcrypto doesn't identify the evidence. The
+	 * key also binds the TLS sessions to be resumed to the evidence.
+	 */
+	if (!(tls_ctx->conf_flags &
+	      (RATS_TLS_CONF_FLAGS_VERIFY_CACHE | RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION)) ||
+	    !evidence_buffer || !strcmp(crypto_ctx->opts->name, "nullcrypto"))
+		return false;
+
+	memset(key, 0, sizeof(*key));
+
+	if (crypto_ctx->opts->gen_hash(crypto_ctx, HASH_ALGO_SHA256, evidence_buffer,
+				       evidence_buffer_size,
+				       key->evidence_digest) != CRYPTO_WRAPPER_ERR_NONE)
+		return false;
+	key->evidence_buffer_size = evidence_buffer_size;
+
+	if (endorsements_buffer && endorsements_buffer_size) {
+		if (crypto_ctx->opts->gen_hash(crypto_ctx, HASH_ALGO_SHA256, endorsements_buffer,
+					       endorsements_buffer_size,
+					       key->endorsements_digest) != CRYPTO_WRAPPER_ERR_NONE)
+			return false;
+		key->endorsements_buffer_size = endorsements_buffer_size;
+	}
 
-		size_t hash_size = hash_size_of_algo(pubkey_hash_algo);
-		if (hash_size == 0) {
-			RTLS_FATAL("failed verify hash of pubkey: unsupported hash algo id: %u\n",
-				   pubkey_hash_algo);
-			ret = TLS_WRAPPER_ERR_INVALID;
-			goto err;
-		}
-		RTLS_DEBUG("The hash of public key [%zu] %02x%02x%02x%02x%02x%02x%02x%02x...\n",
-			   hash_size, calculated_pubkey_hash[0], calculated_pubkey_hash[1],
-			   calculated_pubkey_hash[2], calculated_pubkey_hash[3],
-			   calculated_pubkey_hash[4], calculated_pubkey_hash[5],
-			   calculated_pubkey_hash[6], calculated_pubkey_hash[7]);
+	if (tls_ctx->rtls_handle->flags & RATS_TLS_CONF_FLAGS_VERIFIER_ENFORCED)
+		snprintf(key->verifier_type, sizeof(key->verifier_type), "%s",
+			 tls_ctx->rtls_handle->verifier->opts->name);
 
-		if (memcmp(pubkey_hash, calculated_pubkey_hash, hash_size)) {
-			RTLS_ERR("unmatched pubkey hash value in claims buffer\n");
-			ret = TLS_WRAPPER_ERR_INVALID;
-			goto err;
-		}
+	if (conf->quote_sgx_epid.valid) {
+		memcpy(key->sgx_epid_spid, conf->quote_sgx_epid.spid, sizeof(key->sgx_epid_spid));
+		key->sgx_epid_linkable = conf->quote_sgx_epid.linkable;
 	}
+	if (conf->quote_sgx_ecdsa.valid)
+		key->sgx_ecdsa_cert_type = conf->quote_sgx_ecdsa.cert_type;
+
+	return true;
+}
+
+static void verify_cache_store(tls_wrapper_ctx_t *tls_ctx, rtls_verify_result_t *result)
+{
+	uint64_t now = rtls_time();
+
+	if (result->err != TLS_WRAPPER_ERR_NONE) {
+		/* A malformed extension or a rejected evidence is sure to fail again */
+		if (result->transient || result->err == -TLS_WRAPPER_ERR_NO_MEM)
+			return;
+
+		result->expiry = now + RATS_TLS_VERIFY_CACHE_NEGATIVE_TTL;
+	} else {
+		unsigned int ttl = tls_ctx->rtls_handle->config.verify_cache_ttl;
+		if (!ttl)
+			ttl = RATS_TLS_VERIFY_CACHE_TTL_DEFAULT;
+
+		if (!result->expiry || result->expiry > now + ttl)
+			result->expiry = now + ttl;
+	}
+
+	if (result->expiry > now)
+		rtls_verify_cache_insert(result);
+}
+
+/* Report the verified evidence and custom claims to the user callback */
+static tls_wrapper_err_t report_evidence(tls_wrapper_ctx_t *tls_ctx, rtls_verify_result_t *result)
+{
+	attestation_evidence_t evidence;
+
+	/* The evidence may be modified while being reported to user_callback */
+	memcpy(&evidence, &result->evidence, sizeof(evidence));
 
 	/* Verify evidence struct via user_callback */
 	rtls_evidence_t ev;
 	memset(&ev, 0, sizeof(ev));
-	ev.custom_claims = custom_claims;
-	ev.custom_claims_length = custom_claims_length;
+	ev.custom_claims = result->custom_claims;
+	ev.custom_claims_length = result->custom_claims_length;
 	if (!strncmp(evidence.type, "sgx_ecdsa", sizeof(evidence.type))) {
 		sgx_quote3_t *quote3 = (sgx_quote3_t *)evidence.ecdsa.quote;
 
@@ -288,17 +413,138 @@ tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
 		int rc = tls_ctx->rtls_handle->user_callback(&ev);
 		if (!rc) {
 			RTLS_ERR("failed to verify user callback %d\n", rc);
+			return TLS_WRAPPER_ERR_INVALID;
+		}
+	}
+
+	return TLS_WRAPPER_ERR_NONE;
+}
+
+tls_wrapper_err_t tls_wrapper_verify_certificate_extension(
+	tls_wrapper_ctx_t *tls_ctx,
+	const uint8_t *pubkey_buffer /* in SubjectPublicKeyInfo format */,
+	size_t pubkey_buffer_size, uint8_t *evidence_buffer /* optional, for nullverifier */,
+	size_t evidence_buffer_size, uint8_t *endorsements_buffer /* optional */,
+	size_t endorsements_buffer_size)
+{
+	tls_wrapper_err_t ret;
+
+	rtls_verify_result_t *result = NULL;
+	rtls_verify_key_t key;
+
+	RTLS_DEBUG(
+		"tls_ctx: %p, pubkey_buffer: %p, pubkey_buffer_size: %zu, evidence_buffer: %p, evidence_buffer_size: %zu, endorsements_buffer: %p, endorsements_buffer_size: %zu\n",
+		tls_ctx, pubkey_buffer, pubkey_buffer_size, evidence_buffer, evidence_buffer_size,
+		endorsements_buffer, endorsements_buffer_size);
+
+	if (!tls_ctx || !tls_ctx->rtls_handle || !tls_ctx->rtls_handle->verifier ||
+	    !tls_ctx->rtls_handle->verifier->opts ||
+	    !tls_ctx->rtls_handle->verifier->opts->verify_evidence || !pubkey_buffer)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	bool cacheable = verify_cache_key(tls_ctx, &key, evidence_buffer, evidence_buffer_size,
+					  endorsements_buffer, endorsements_buffer_size);
+	if (cacheable && (tls_ctx->conf_flags & RATS_TLS_CONF_FLAGS_VERIFY_CACHE))
+		result = rtls_verify_cache_lookup(&key);
+
+	if (!result) {
+		if (!cacheable)
+			memset(&key, 0, sizeof(key));
+
+		result = rtls_verify_result_new(&key);
+		if (!result)
+			return -TLS_WRAPPER_ERR_NO_MEM;
+
+		result->err = verify_evidence_buffer(tls_ctx, result, evidence_buffer,
+						     evidence_buffer_size, endorsements_buffer,
+						     endorsements_buffer_size);
+		if (cacheable)
+			verify_cache_store(tls_ctx, result);
+	}
+
+	ret = result->err;
+	if (ret != TLS_WRAPPER_ERR_NONE)
+		goto err;
+
+	/* Verify pubkey_hash in claims buffer */
+	if (evidence_buffer) {
+		hash_algo_t pubkey_hash_algo = result->pubkey_hash_algo;
+		uint8_t *pubkey_hash = result->pubkey_hash;
+
+		RTLS_DEBUG("check pubkey hash. pubkey_hash: %p, pubkey_hash_algo: %d\n",
+			   pubkey_hash, pubkey_hash_algo);
+
+		uint8_t calculated_pubkey_hash[MAX_HASH_SIZE];
+		crypto_wrapper_err_t c_err = tls_ctx->rtls_handle->crypto_wrapper->opts->gen_hash(
+			tls_ctx->rtls_handle->crypto_wrapper, pubkey_hash_algo, pubkey_buffer,
+			pubkey_buffer_size, calculated_pubkey_hash);
+		if (c_err != CRYPTO_WRAPPER_ERR_NONE) {
+			RTLS_ERR("failed to calculate hash of pubkey: %#x\n", c_err);
 			ret = TLS_WRAPPER_ERR_INVALID;
 			goto err;
 		}
+
+		size_t hash_size = hash_size_of_algo(pubkey_hash_algo);
+		if (hash_size == 0) {
+			RTLS_FATAL("failed verify hash of pubkey: unsupported hash algo id: %u\n",
+				   pubkey_hash_algo);
+			ret = TLS_WRAPPER_ERR_INVALID;
+			goto err;
+		}
+		RTLS_DEBUG("The hash of public key [%zu] %02x%02x%02x%02x%02x%02x%02x%02x...\n",
+			   hash_size, calculated_pubkey_hash[0], calculated_pubkey_hash[1],
+			   calculated_pubkey_hash[2], calculated_pubkey_hash[3],
+			   calculated_pubkey_hash[4], calculated_pubkey_hash[5],
+			   calculated_pubkey_hash[6], calculated_pubkey_hash[7]);
+
+		if (memcmp(pubkey_hash, calculated_pubkey_hash, hash_size)) {
+			RTLS_ERR("unmatched pubkey hash value in claims buffer\n");
+			ret = TLS_WRAPPER_ERR_INVALID;
+			goto err;
+		}
+	}
+
+	ret = report_evidence(tls_ctx, result);
+	if (ret != TLS_WRAPPER_ERR_NONE)
+		goto err;
+
+	/* Only the results kept in the cache can be looked up on resumption */
+	if ((tls_ctx->conf_flags & RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION) && result->expiry) {
+		rtls_verify_result_put(tls_ctx->peer_evidence);
+		tls_ctx->peer_evidence = rtls_verify_result_get(result);
 	}
 
 	ret = TLS_WRAPPER_ERR_NONE;
 err:
-	if (claims_buffer)
-		free(claims_buffer);
-	if (custom_claims)
-		free_claims_list(custom_claims, custom_claims_length);
+	rtls_verify_result_put(result);
 
 	return ret;
 }
+
+tls_wrapper_err_t tls_wrapper_verify_resumed_session(tls_wrapper_ctx_t *tls_ctx,
+						     rtls_verify_result_t *result)
+{
+	RTLS_DEBUG("tls_ctx: %p, result: %p\n", tls_ctx, result);
+
+	if (!tls_ctx || !tls_ctx->rtls_handle)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	/* The session must not outlive the verification result it is bound to */
+	if (!result || result->err != TLS_WRAPPER_ERR_NONE || result->expiry <= rtls_time()) {
+		RTLS_ERR("no valid evidence bound to the resumed session\n");
+		return -TLS_WRAPPER_ERR_INVALID;
+	}
+
+	tls_wrapper_err_t ret = report_evidence(tls_ctx, result);
+	if (ret != TLS_WRAPPER_ERR_NONE)
+		return ret;
+
+	if (tls_ctx->peer_evidence != result) {
+		rtls_verify_result_put(tls_ctx->peer_evidence);
+		tls_ctx->peer_evidence = rtls_verify_result_get(result);
+	}
+
+	RTLS_DEBUG("the evidence of the resumed session reported\n");
+
+	return TLS_WRAPPER_ERR_NONE;
+}
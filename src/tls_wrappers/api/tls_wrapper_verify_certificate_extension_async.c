@@ -0,0 +1,114 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include "internal/core.h"
+#include "internal/tls_wrapper.h"
+#include "internal/verify_async.h"
+
+static int clone_buffer(const uint8_t *buf, size_t size, uint8_t **out)
+{
+	*out = NULL;
+
+	if (!buf || !size)
+		return 0;
+
+	*out = malloc(size);
+	if (!*out)
+		return -1;
+
+	memcpy(*out, buf, size);
+
+	return 0;
+}
+
+static bool buffer_equal(const uint8_t *a, size_t a_size, const uint8_t *b, size_t b_size)
+{
+	if (!a || !b)
+		return a == b;
+
+	return a_size == b_size && !memcmp(a, b, a_size);
+}
+
+/* Whether the job verifies the given certificate extension */
+static bool job_match(rtls_verify_job_t *job, const uint8_t *pubkey_buffer,
+		      size_t pubkey_buffer_size, uint8_t *evidence_buffer,
+		      size_t evidence_buffer_size, uint8_t *endorsements_buffer,
+		      size_t endorsements_buffer_size)
+{
+	return buffer_equal(job->pubkey_buffer, job->pubkey_buffer_size, pubkey_buffer,
+			    pubkey_buffer_size) &&
+	       buffer_equal(job->evidence_buffer, job->evidence_buffer_size, evidence_buffer,
+			    evidence_buffer_size) &&
+	       buffer_equal(job->endorsements_buffer, job->endorsements_buffer_size,
+			    endorsements_buffer, endorsements_buffer_size);
+}
+
+tls_wrapper_err_t tls_wrapper_verify_certificate_extension_async(
+	tls_wrapper_ctx_t *tls_ctx, const uint8_t *pubkey_buffer, size_t pubkey_buffer_size,
+	uint8_t *evidence_buffer, size_t evidence_buffer_size, uint8_t *endorsements_buffer,
+	size_t endorsements_buffer_size)
+{
+	RTLS_DEBUG("tls_ctx: %p\n", tls_ctx);
+
+	if (!tls_ctx || !tls_ctx->rtls_handle || !pubkey_buffer)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	rtls_core_context_t *ctx = tls_ctx->rtls_handle;
+	rtls_verify_job_t *job = ctx->verify_job;
+
+	/* Collect the result of the verification dispatched previously */
+	if (job) {
+		if (job_match(job, pubkey_buffer, pubkey_buffer_size, evidence_buffer,
+			      evidence_buffer_size, endorsements_buffer,
+			      endorsements_buffer_size)) {
+			if (!rtls_core_verify_async_done(ctx))
+				return -TLS_WRAPPER_ERR_WANT_VERIFY;
+
+			tls_wrapper_err_t ret = job->result;
+			rtls_core_verify_async_release(ctx);
+
+			return ret;
+		}
+
+		/* The job belongs to an abandoned handshake */
+		rtls_core_verify_async_release(ctx);
+	}
+
+	job = calloc(1, sizeof(*job));
+	if (!job)
+		return -TLS_WRAPPER_ERR_NO_MEM;
+
+	job->tls_ctx = tls_ctx;
+	job->pubkey_buffer_size = pubkey_buffer_size;
+	job->evidence_buffer_size = evidence_buffer_size;
+	job->endorsements_buffer_size = endorsements_buffer_size;
+	if (clone_buffer(pubkey_buffer, pubkey_buffer_size, &job->pubkey_buffer) ||
+	    clone_buffer(evidence_buffer, evidence_buffer_size, &job->evidence_buffer) ||
+	    clone_buffer(endorsements_buffer, endorsements_buffer_size,
+			 &job->endorsements_buffer))
+		goto err;
+
+	tls_wrapper_err_t ret = rtls_core_verify_async_submit(ctx, job);
+	if (ret == -TLS_WRAPPER_ERR_WANT_VERIFY)
+		return ret;
+
+	RTLS_WARN("fall back to synchronous verification %#x\n", ret);
+
+err:
+	free(job->pubkey_buffer);
+	free(job->evidence_buffer);
+	free(job->endorsements_buffer);
+	free(job);
+
+	return tls_wrapper_verify_certificate_extension(tls_ctx, pubkey_buffer, pubkey_buffer_size,
+							evidence_buffer, evidence_buffer_size,
+							endorsements_buffer,
+							endorsements_buffer_size);
+}
@@ -17,6 +17,14 @@ extern tls_wrapper_err_t nulltls_negotiate(tls_wrapper_ctx_t *, int fd);
 extern tls_wrapper_err_t nulltls_transmit(tls_wrapper_ctx_t *, void *, size_t *);
 extern tls_wrapper_err_t nulltls_receive(tls_wrapper_ctx_t *, void *, size_t *);
 extern tls_wrapper_err_t nulltls_cleanup(tls_wrapper_ctx_t *);
+extern tls_wrapper_err_t nulltls_session_init(tls_wrapper_ctx_t *, tls_wrapper_ctx_t *);
+extern tls_wrapper_err_t nulltls_replace_cert(tls_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
+					      void *privkey_buf, size_t privkey_len,
+					      rats_tls_cert_info_t *cert_info);
+extern tls_wrapper_err_t nulltls_sendfile(tls_wrapper_ctx_t *ctx, int file_fd, off_t offset,
+					  size_t *size);
+extern tls_wrapper_err_t nulltls_transmitv(tls_wrapper_ctx_t *ctx, const struct iovec *iov,
+					   int iovcnt, size_t *size);
 
 static tls_wrapper_opts_t nulltls_opts = {
 	.api_version = TLS_WRAPPER_API_VERSION_DEFAULT,
@@ -30,6 +38,10 @@ static tls_wrapper_opts_t nulltls_opts = {
 	.transmit = nulltls_transmit,
 	.receive = nulltls_receive,
 	.cleanup = nulltls_cleanup,
+	.session_init = nulltls_session_init,
+	.replace_cert = nulltls_replace_cert,
+	.sendfile = nulltls_sendfile,
+	.transmitv = nulltls_transmitv,
 };
 
 #ifdef SGX
@@ -5,16 +5,25 @@
  */
 
 #include <unistd.h>
+#include <errno.h>
 #include <rats-tls/log.h>
 #include <rats-tls/tls_wrapper.h>
 #include "internal/core.h"
+#include "internal/shm_ring.h"
 
 tls_wrapper_err_t nulltls_receive(tls_wrapper_ctx_t *ctx, void *buf, size_t *buf_size)
 {
 	RTLS_DEBUG("ctx %p, buf %p, buf_size %p\n", ctx, buf, buf_size);
 
-	ssize_t rc = rtls_read(ctx->fd, buf, *buf_size);
+	ssize_t rc;
+	if (ctx->shm)
+		rc = rtls_shm_read(ctx->shm, buf, *buf_size);
+	else
+		rc = rtls_read(ctx->fd, buf, *buf_size);
 	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return -TLS_WRAPPER_ERR_WANT_READ;
+
 		RTLS_ERR("failed to receive data %zu\n", rc);
 		return -TLS_WRAPPER_ERR_RECEIVE;
 	}
@@ -0,0 +1,19 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+
+tls_wrapper_err_t nulltls_replace_cert(tls_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
+				       void *privkey_buf, size_t privkey_len,
+				       rats_tls_cert_info_t *cert_info)
+{
+	RTLS_DEBUG("ctx %p, algo %d, privkey_buf %p, privkey_len %zu, cert_info %p\n", ctx, algo,
+		   privkey_buf, privkey_len, cert_info);
+
+	/* No certificate is used at all */
+	return -TLS_WRAPPER_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,46 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "internal/core.h"
+#include "internal/shm_ring.h"
+
+/* The size of the chunks of the file copied into the shared memory rings */
+#define NULLTLS_SENDFILE_CHUNK_SIZE 16384
+
+tls_wrapper_err_t nulltls_sendfile(tls_wrapper_ctx_t *ctx, int file_fd, off_t offset,
+				   size_t *size)
+{
+	RTLS_DEBUG("ctx %p, file_fd %d, offset %lld, size %p\n", ctx, file_fd, (long long)offset,
+		   size);
+
+	ssize_t rc;
+	if (ctx->shm) {
+		uint8_t buf[NULLTLS_SENDFILE_CHUNK_SIZE];
+		size_t len = *size;
+		if (len > sizeof(buf))
+			len = sizeof(buf);
+
+		rc = rtls_pread(file_fd, buf, len, offset);
+		if (rc > 0)
+			rc = rtls_shm_write(ctx->shm, buf, (size_t)rc);
+	} else
+		rc = rtls_sendfile(ctx->fd, file_fd, &offset, *size);
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return -TLS_WRAPPER_ERR_WANT_WRITE;
+
+		RTLS_DEBUG("ERROR: tls_wrapper_null sendfile()\n");
+		return -TLS_WRAPPER_ERR_TRANSMIT;
+	}
+
+	*size = (size_t)rc;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
@@ -0,0 +1,17 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+
+tls_wrapper_err_t nulltls_session_init(tls_wrapper_ctx_t *ctx, tls_wrapper_ctx_t *session_ctx)
+{
+	RTLS_DEBUG("ctx %p, session_ctx %p\n", ctx, session_ctx);
+
+	session_ctx->tls_private = ctx->tls_private;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
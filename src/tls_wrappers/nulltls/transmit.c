@@ -5,18 +5,27 @@
  */
 
 #include <unistd.h>
+#include <errno.h>
 #include <rats-tls/log.h>
 #include <rats-tls/tls_wrapper.h>
 #include "internal/core.h"
+#include "internal/shm_ring.h"
 
 tls_wrapper_err_t nulltls_transmit(tls_wrapper_ctx_t *ctx, void *buf, size_t *buf_size)
 {
 	RTLS_DEBUG("ctx %p, buf %p, buf_size %p\n", ctx, buf, buf_size);
 
-	ssize_t rc = rtls_write(ctx->fd, buf, *buf_size);
+	ssize_t rc;
+	if (ctx->shm)
+		rc = rtls_shm_write(ctx->shm, buf, *buf_size);
+	else
+		rc = rtls_write(ctx->fd, buf, *buf_size);
 	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return -TLS_WRAPPER_ERR_WANT_WRITE;
+
 		RTLS_DEBUG("ERROR: tls_wrapper_null transmit()\n");
-		return TLS_WRAPPER_ERR_TRANSMIT;
+		return -TLS_WRAPPER_ERR_TRANSMIT;
 	}
 
 	*buf_size = (size_t)rc;
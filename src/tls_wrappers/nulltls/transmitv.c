@@ -0,0 +1,35 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "internal/core.h"
+#include "internal/shm_ring.h"
+
+tls_wrapper_err_t nulltls_transmitv(tls_wrapper_ctx_t *ctx, const struct iovec *iov, int iovcnt,
+				    size_t *size)
+{
+	RTLS_DEBUG("ctx %p, iov %p, iovcnt %d, size %p\n", ctx, iov, iovcnt, size);
+
+	ssize_t rc;
+	if (ctx->shm)
+		rc = rtls_shm_writev(ctx->shm, iov, iovcnt);
+	else
+		rc = rtls_writev(ctx->fd, iov, iovcnt);
+	if (rc < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return -TLS_WRAPPER_ERR_WANT_WRITE;
+
+		RTLS_DEBUG("ERROR: tls_wrapper_null transmitv()\n");
+		return -TLS_WRAPPER_ERR_TRANSMIT;
+	}
+
+	*size = (size_t)rc;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
@@ -0,0 +1,218 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+#include "internal/core.h"
+
+/* Large enough for a couple of TLS records */
+#define OPENSSL_BIO_BUFFER_SIZE (2 * SSL3_RT_MAX_PACKET_SIZE)
+
+/* A socket BIO reading ahead and batching the writes, so that the header and
+ * the body of the TLS records don't cost a system call each, i.e. an ocall
+ * inside an SGX enclave.
+ */
+typedef struct {
+	int fd;
+	uint8_t rbuf[OPENSSL_BIO_BUFFER_SIZE];
+	size_t roff;
+	size_t rlen;
+	uint8_t wbuf[OPENSSL_BIO_BUFFER_SIZE];
+	size_t woff;
+	size_t wlen;
+} buffered_bio_t;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+static BIO_METHOD *buffered_bio_method;
+
+static bool io_would_block(void)
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+/* Write out the batched data, and return 0 if the socket would block */
+static int buffered_bio_flush(BIO *bio, buffered_bio_t *b)
+{
+	while (b->woff < b->wlen) {
+		ssize_t rc = rtls_write(b->fd, b->wbuf + b->woff, b->wlen - b->woff);
+		if (rc <= 0) {
+			if (rc < 0 && io_would_block()) {
+				BIO_set_retry_write(bio);
+				return 0;
+			}
+
+			return -1;
+		}
+		b->woff += (size_t)rc;
+	}
+
+	b->woff = 0;
+	b->wlen = 0;
+
+	return 1;
+}
+
+static int buffered_bio_write(BIO *bio, const char *buf, int len)
+{
+	buffered_bio_t *b = BIO_get_data(bio);
+
+	BIO_clear_retry_flags(bio);
+
+	if (len <= 0)
+		return 0;
+
+	if (b->wlen + (size_t)len > sizeof(b->wbuf)) {
+		int ret = buffered_bio_flush(bio, b);
+		if (ret <= 0)
+			return -1;
+	}
+
+	/* Don't copy what fills up the whole buffer anyway */
+	if ((size_t)len >= sizeof(b->wbuf)) {
+		ssize_t rc = rtls_write(b->fd, buf, (size_t)len);
+		if (rc < 0 && io_would_block())
+			BIO_set_retry_write(bio);
+
+		return (int)rc;
+	}
+
+	memcpy(b->wbuf + b->wlen, buf, (size_t)len);
+	b->wlen += (size_t)len;
+
+	return len;
+}
+
+static int buffered_bio_read(BIO *bio, char *buf, int len)
+{
+	buffered_bio_t *b = BIO_get_data(bio);
+
+	BIO_clear_retry_flags(bio);
+
+	if (len <= 0)
+		return 0;
+
+	/* The peer may wait for the batched data before replying */
+	int ret = buffered_bio_flush(bio, b);
+	if (ret <= 0)
+		return -1;
+
+	if (b->roff == b->rlen) {
+		b->roff = 0;
+		b->rlen = 0;
+
+		ssize_t rc;
+		if ((size_t)len >= sizeof(b->rbuf))
+			rc = rtls_read(b->fd, buf, (size_t)len);
+		else
+			rc = rtls_read(b->fd, b->rbuf, sizeof(b->rbuf));
+		if (rc <= 0) {
+			if (rc < 0 && io_would_block())
+				BIO_set_retry_read(bio);
+
+			return (int)rc;
+		}
+
+		if ((size_t)len >= sizeof(b->rbuf))
+			return (int)rc;
+
+		b->rlen = (size_t)rc;
+	}
+
+	size_t n = b->rlen - b->roff;
+	if (n > (size_t)len)
+		n = (size_t)len;
+	memcpy(buf, b->rbuf + b->roff, n);
+	b->roff += n;
+
+	return (int)n;
+}
+
+static long buffered_bio_ctrl(BIO *bio, int cmd, long num, void *ptr)
+{
+	buffered_bio_t *b = BIO_get_data(bio);
+
+	switch (cmd) {
+	case BIO_CTRL_FLUSH:
+		BIO_clear_retry_flags(bio);
+		return buffered_bio_flush(bio, b);
+	case BIO_CTRL_PENDING:
+		return (long)(b->rlen - b->roff);
+	case BIO_CTRL_WPENDING:
+		return (long)(b->wlen - b->woff);
+	case BIO_C_GET_FD:
+		if (ptr)
+			*(int *)ptr = b->fd;
+		return b->fd;
+	default:
+		return 0;
+	}
+}
+
+static int buffered_bio_destroy(BIO *bio)
+{
+	free(BIO_get_data(bio));
+	BIO_set_data(bio, NULL);
+
+	return 1;
+}
+
+void openssl_buffered_bio_init(void)
+{
+	BIO_METHOD *method = BIO_meth_new(BIO_get_new_index() | BIO_TYPE_SOURCE_SINK |
+						  BIO_TYPE_DESCRIPTOR,
+					  "rats-tls buffered socket");
+	if (!method)
+		return;
+
+	if (!BIO_meth_set_write(method, buffered_bio_write) ||
+	    !BIO_meth_set_read(method, buffered_bio_read) ||
+	    !BIO_meth_set_ctrl(method, buffered_bio_ctrl) ||
+	    !BIO_meth_set_destroy(method, buffered_bio_destroy)) {
+		BIO_meth_free(method);
+		return;
+	}
+
+	buffered_bio_method = method;
+}
+
+BIO *openssl_buffered_bio_new(int fd)
+{
+	if (!buffered_bio_method) {
+		RTLS_ERR("failed to create the buffered BIO method\n");
+		return NULL;
+	}
+
+	buffered_bio_t *b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+	b->fd = fd;
+
+	BIO *bio = BIO_new(buffered_bio_method);
+	if (!bio) {
+		free(b);
+		return NULL;
+	}
+
+	BIO_set_data(bio, b);
+	BIO_set_init(bio, 1);
+
+	return bio;
+}
+#else
+void openssl_buffered_bio_init(void)
+{
+}
+
+BIO *openssl_buffered_bio_new(__attribute__((unused)) int fd)
+{
+	RTLS_ERR("the buffered BIO requires openssl 1.1.0 or later\n");
+	return NULL;
+}
+#endif
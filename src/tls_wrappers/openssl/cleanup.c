@@ -20,8 +20,12 @@ tls_wrapper_err_t openssl_tls_cleanup(tls_wrapper_ctx_t *ctx)
 	if (ssl_ctx != NULL) {
 		if (ssl_ctx->ssl != NULL) {
 			SSL_shutdown(ssl_ctx->ssl);
+			openssl_flush(ssl_ctx->ssl);
 			SSL_free(ssl_ctx->ssl);
 		}
+		if (ssl_ctx->pending_ssl != NULL)
+			SSL_free(ssl_ctx->pending_ssl);
+		openssl_session_cache_cleanup(ssl_ctx);
 		if (ssl_ctx->sctx != NULL)
 			SSL_CTX_free(ssl_ctx->sctx);
 	}
@@ -48,6 +48,23 @@ tls_wrapper_err_t openssl_tls_init(tls_wrapper_ctx_t *ctx)
 		return -TLS_WRAPPER_ERR_NO_MEM;
 	}
 
+#if OPENSSL_VERSION_NUMBER < 0x30000000L
+	if (ctx->conf_flags & RATS_TLS_CONF_FLAGS_ASYNC_VERIFY)
+		RTLS_WARN("asynchronous verification requires openssl 3.0 or later\n");
+#endif
+
+	if (ctx->conf_flags & RATS_TLS_CONF_FLAGS_KTLS) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+		/* Offload the record layer to the kernel once negotiated, if supported */
+		SSL_CTX_set_options(ssl_ctx->sctx, SSL_OP_ENABLE_KTLS);
+#else
+		RTLS_WARN("kernel TLS offload requires openssl 3.0 or later built with ktls\n");
+#endif
+	}
+
+	if (ctx->conf_flags & RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION)
+		openssl_session_cache_init(ctx, ssl_ctx);
+
 	ctx->tls_private = ssl_ctx;
 
 	return TLS_WRAPPER_ERR_NONE;
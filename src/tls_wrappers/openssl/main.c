@@ -19,6 +19,16 @@ extern tls_wrapper_err_t openssl_tls_negotiate(tls_wrapper_ctx_t *, int fd);
 extern tls_wrapper_err_t openssl_tls_transmit(tls_wrapper_ctx_t *, void *, size_t *);
 extern tls_wrapper_err_t openssl_tls_receive(tls_wrapper_ctx_t *, void *, size_t *);
 extern tls_wrapper_err_t openssl_tls_cleanup(tls_wrapper_ctx_t *);
+extern tls_wrapper_err_t openssl_tls_session_init(tls_wrapper_ctx_t *, tls_wrapper_ctx_t *);
+extern tls_wrapper_err_t openssl_tls_replace_cert(tls_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
+						  void *privkey_buf, size_t privkey_len,
+						  rats_tls_cert_info_t *cert_info);
+extern tls_wrapper_err_t openssl_tls_sendfile(tls_wrapper_ctx_t *ctx, int file_fd, off_t offset,
+					      size_t *size);
+extern tls_wrapper_err_t openssl_tls_transmitv(tls_wrapper_ctx_t *ctx, const struct iovec *iov,
+					       int iovcnt, size_t *size);
+extern tls_wrapper_err_t openssl_tls_flush(tls_wrapper_ctx_t *ctx);
+extern tls_wrapper_err_t openssl_tls_pending(tls_wrapper_ctx_t *ctx, size_t *size);
 
 static tls_wrapper_opts_t openssl_opts = {
 	.api_version = TLS_WRAPPER_API_VERSION_DEFAULT,
@@ -32,6 +42,12 @@ static tls_wrapper_opts_t openssl_opts = {
 	.transmit = openssl_tls_transmit,
 	.receive = openssl_tls_receive,
 	.cleanup = openssl_tls_cleanup,
+	.session_init = openssl_tls_session_init,
+	.replace_cert = openssl_tls_replace_cert,
+	.sendfile = openssl_tls_sendfile,
+	.transmitv = openssl_tls_transmitv,
+	.flush = openssl_tls_flush,
+	.pending = openssl_tls_pending,
 };
 
 int openssl_ex_data_idx;
@@ -48,5 +64,13 @@ void __attribute__((constructor)) libtls_wrapper_openssl_init(void)
 	if (err != TLS_WRAPPER_ERR_NONE)
 		RTLS_ERR("failed to register the tls wrapper 'openssl' %#x\n", err);
 
-	openssl_ex_data_idx = X509_STORE_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+	openssl_ex_data_idx = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+	openssl_session_ex_data_idx =
+		SSL_SESSION_get_ex_new_index(0, NULL, NULL, openssl_session_evidence_dup,
+					     openssl_session_evidence_free);
+#endif
+#ifdef SGX
+	openssl_buffered_bio_init();
+#endif
 }
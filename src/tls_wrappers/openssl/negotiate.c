@@ -9,11 +9,12 @@
 #include <rats-tls/err.h>
 #include <rats-tls/tls_wrapper.h>
 #include "openssl.h"
+#include "internal/core.h"
 
 extern int verify_certificate(int preverify_ok, X509_STORE_CTX *store);
 
-tls_wrapper_err_t openssl_internal_negotiate(tls_wrapper_ctx_t *ctx, unsigned long conf_flags,
-					     int fd, int (*verify)(int, X509_STORE_CTX *))
+static SSL *openssl_new_ssl(tls_wrapper_ctx_t *ctx, unsigned long conf_flags, int fd,
+			    int (*verify)(int, X509_STORE_CTX *))
 {
 	openssl_ctx_t *ssl_ctx = ctx->tls_private;
 
@@ -25,7 +26,16 @@ tls_wrapper_err_t openssl_internal_negotiate(tls_wrapper_ctx_t *ctx, unsigned lo
 	 * server: SSL_VERIFY_NONE
 	 * client+mutual: SSL_VERIFY_PEER
 	 * server+mutual: SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT
+	 *
+	 * The mode is applied to the SSL object rather than the SSL_CTX,
+	 * which may be shared by several sessions negotiating concurrently.
 	 */
+	pthread_rwlock_rdlock(&openssl_cert_lock);
+	SSL *ssl = SSL_new(ssl_ctx->sctx);
+	pthread_rwlock_unlock(&openssl_cert_lock);
+	if (!ssl)
+		return NULL;
+
 	if (verify) {
 		int mode = SSL_VERIFY_NONE;
 
@@ -34,45 +44,131 @@ tls_wrapper_err_t openssl_internal_negotiate(tls_wrapper_ctx_t *ctx, unsigned lo
 		else if (conf_flags & RATS_TLS_CONF_FLAGS_MUTUAL)
 			mode |= SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
 
-		SSL_CTX_set_verify(ssl_ctx->sctx, mode, verify);
+		SSL_set_verify(ssl, mode, verify);
 	}
 
-	SSL *ssl = SSL_new(ssl_ctx->sctx);
-	if (!ssl)
-		return -TLS_WRAPPER_ERR_NO_MEM;
+	/* The verify callback locates the tls wrapper context through the SSL object */
+	SSL_set_ex_data(ssl, openssl_ex_data_idx, ctx);
 
-	X509_STORE *cert_store = SSL_CTX_get_cert_store(ssl_ctx->sctx);
-	X509_STORE_set_ex_data(cert_store, openssl_ex_data_idx, ctx);
+	/* A write retried after a would-block error may pass the same data
+	 * gathered into another buffer.
+	 */
+	SSL_set_mode(ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
+	/* Read as many TLS records as fit into the read-ahead size per syscall */
+	unsigned int read_ahead_size = ctx->rtls_handle->config.read_ahead_size;
+	if (read_ahead_size) {
+		SSL_set_read_ahead(ssl, 1);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+		SSL_set_default_read_buffer_len(ssl, read_ahead_size);
+#endif
+	}
 
-	/* Attach openssl to the socket */
-	int ret = SSL_set_fd(ssl, fd);
-	if (ret != SSL_SUCCESS) {
-		RTLS_ERR("failed to attach SSL with fd, ret is %x\n", ret);
-		return -TLS_WRAPPER_ERR_INVALID;
+	if (conf_flags & RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION)
+		openssl_session_resume(ctx, ssl, fd);
+
+	/* Attach openssl to the shared memory rings or to the socket */
+	if (ctx->shm) {
+		BIO *bio = openssl_shm_bio_new(ctx->shm);
+		if (!bio) {
+			SSL_free(ssl);
+			return NULL;
+		}
+		SSL_set_bio(ssl, bio, bio);
+	} else {
+#ifdef SGX
+		/* Batch the socket I/O of openssl into as few ocalls as possible */
+		BIO *bio = openssl_buffered_bio_new(fd);
+		if (!bio) {
+			SSL_free(ssl);
+			return NULL;
+		}
+		SSL_set_bio(ssl, bio, bio);
+#else
+		int ret = SSL_set_fd(ssl, fd);
+		if (ret != SSL_SUCCESS) {
+			RTLS_ERR("failed to attach SSL with fd, ret is %x\n", ret);
+			SSL_free(ssl);
+			return NULL;
+		}
+#endif
 	}
 
-	ERR_clear_error();
-	int err;
 	if (conf_flags & RATS_TLS_CONF_FLAGS_SERVER)
-		err = SSL_accept(ssl);
+		SSL_set_accept_state(ssl);
 	else
-		err = SSL_connect(ssl);
+		SSL_set_connect_state(ssl);
+
+	return ssl;
+}
+
+tls_wrapper_err_t openssl_internal_negotiate(tls_wrapper_ctx_t *ctx, unsigned long conf_flags,
+					     int fd, int (*verify)(int, X509_STORE_CTX *))
+{
+	openssl_ctx_t *ssl_ctx = ctx->tls_private;
 
+	/* Resume the handshake interrupted on a non-blocking fd, unless the
+	 * caller has given up on it and negotiates over another fd or rings.
+	 */
+	SSL *ssl = ssl_ctx->pending_ssl;
+	if (ssl && (ctx->shm ? !openssl_shm_bio_attached(ssl, ctx->shm) : SSL_get_fd(ssl) != fd)) {
+		SSL_free(ssl);
+		ssl = NULL;
+	}
+	ssl_ctx->pending_ssl = NULL;
+
+	if (!ssl) {
+		ssl = openssl_new_ssl(ctx, conf_flags, fd, verify);
+		if (!ssl)
+			return -TLS_WRAPPER_ERR_INVALID;
+	}
+
+	ERR_clear_error();
+	int err = SSL_do_handshake(ssl);
 	if (err != 1) {
+		tls_wrapper_err_t want = openssl_want_err(ssl, err);
+		if (want != TLS_WRAPPER_ERR_NONE) {
+			RTLS_DEBUG("handshake in progress, SSL_get_error(): %d\n",
+				   SSL_get_error(ssl, err));
+			ssl_ctx->pending_ssl = ssl;
+			return want;
+		}
+
 		if (conf_flags & RATS_TLS_CONF_FLAGS_SERVER)
 			RTLS_ERR("failed to negotiate %d, SSL_get_error(): %d\n", err,
 				 SSL_get_error(ssl, err));
 		else
 			RTLS_ERR("failed to connect %d, SSL_get_error(): %d\n", err,
 				 SSL_get_error(ssl, err));
-		// TODO: handle result of SSL_get_error()
 		print_openssl_err_all(ssl, err);
+		SSL_free(ssl);
 
 		return OPENSSL_ERR_CODE(err);
 	}
 
+	if (conf_flags & RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION) {
+		tls_wrapper_err_t t_err = openssl_session_established(ctx, ssl, verify != NULL);
+		if (t_err != TLS_WRAPPER_ERR_NONE) {
+			SSL_free(ssl);
+			return t_err;
+		}
+	}
+
+	/* Release the connection negotiated previously on this context, if any */
+	if (ssl_ctx->ssl) {
+		SSL_shutdown(ssl_ctx->ssl);
+		openssl_flush(ssl_ctx->ssl);
+		SSL_free(ssl_ctx->ssl);
+	}
 	ssl_ctx->ssl = ssl;
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+	if (conf_flags & RATS_TLS_CONF_FLAGS_KTLS)
+		RTLS_DEBUG("kernel TLS offload: send %d, receive %d\n",
+			   (int)BIO_get_ktls_send(SSL_get_wbio(ssl)),
+			   (int)BIO_get_ktls_recv(SSL_get_rbio(ssl)));
+#endif
+
 	if (conf_flags & RATS_TLS_CONF_FLAGS_SERVER)
 		RTLS_DEBUG("success to negotiate\n");
 	else
@@ -23,14 +23,38 @@
 #include <openssl/objects.h>
 #include <openssl/ec.h>
 #include <openssl/opensslv.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #define SSL_SUCCESS 1
 
 extern int openssl_ex_data_idx;
+extern pthread_rwlock_t openssl_cert_lock;
+extern int openssl_session_ex_data_idx;
+
+/* Maximum number of servers whose sessions a client keeps for resumption */
+#define OPENSSL_RESUME_SESSIONS_MAX 16
+/* Large enough for the address of any socket, i.e, sizeof(struct sockaddr_storage) */
+#define OPENSSL_PEER_ADDR_SIZE 128
+
+/* The latest session issued by a server, identified by its address */
+typedef struct {
+	uint8_t peer[OPENSSL_PEER_ADDR_SIZE];
+	unsigned int peer_len;
+	SSL_SESSION *session;
+	uint64_t last_used;
+} openssl_resume_session_t;
 
 typedef struct {
 	SSL_CTX *sctx;
 	SSL *ssl;
+	/* The handshake in progress on a non-blocking fd */
+	SSL *pending_ssl;
+	/* The sessions of the client to resume in the next handshakes */
+	openssl_resume_session_t *resume_sessions;
+	/* The address of the peer in the current handshake, empty if unknown */
+	uint8_t peer[OPENSSL_PEER_ADDR_SIZE];
+	unsigned int peer_len;
 } openssl_ctx_t;
 
 static inline void print_openssl_err_all()
@@ -45,13 +69,68 @@ static inline void print_openssl_err_all()
 	}
 }
 
+/* Return the error code telling which fd event the would-block operation waits for */
+static inline tls_wrapper_err_t openssl_want_err(SSL *ssl, int ret)
+{
+	switch (SSL_get_error(ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+		return -TLS_WRAPPER_ERR_WANT_READ;
+	case SSL_ERROR_WANT_WRITE:
+		return -TLS_WRAPPER_ERR_WANT_WRITE;
+#ifdef SSL_ERROR_WANT_RETRY_VERIFY
+	case SSL_ERROR_WANT_RETRY_VERIFY:
+		return -TLS_WRAPPER_ERR_WANT_VERIFY;
+#endif
+	default:
+		return TLS_WRAPPER_ERR_NONE;
+	}
+}
+
+struct rtls_shm_transport;
+
+extern BIO *openssl_shm_bio_new(struct rtls_shm_transport *shm);
+extern bool openssl_shm_bio_attached(SSL *ssl, struct rtls_shm_transport *shm);
+extern void openssl_buffered_bio_init(void);
+extern BIO *openssl_buffered_bio_new(int fd);
+
+/* Send the TLS records batched by the BIO, if any. The records left over by
+ * a would-block error are sent before the next read or write, or by the next
+ * flush once the fd is ready.
+ */
+static inline tls_wrapper_err_t openssl_flush(SSL *ssl)
+{
+	BIO *wbio = SSL_get_wbio(ssl);
+
+	if (BIO_flush(wbio) > 0)
+		return TLS_WRAPPER_ERR_NONE;
+
+	if (BIO_should_retry(wbio))
+		return BIO_should_read(wbio) ? -TLS_WRAPPER_ERR_WANT_READ :
+					       -TLS_WRAPPER_ERR_WANT_WRITE;
+
+	RTLS_ERR("failed to flush the TLS records\n");
+	return -TLS_WRAPPER_ERR_TRANSMIT;
+}
+
+extern void openssl_session_cache_init(tls_wrapper_ctx_t *ctx, openssl_ctx_t *ssl_ctx);
+extern void openssl_session_cache_cleanup(openssl_ctx_t *ssl_ctx);
+extern void openssl_session_resume(tls_wrapper_ctx_t *ctx, SSL *ssl, int fd);
+extern tls_wrapper_err_t openssl_session_established(tls_wrapper_ctx_t *ctx, SSL *ssl,
+						     bool verify);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+extern int openssl_session_evidence_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+					void **from_d, int idx, long argl, void *argp);
+#elif OPENSSL_VERSION_NUMBER >= 0x10101000L
+extern int openssl_session_evidence_dup(CRYPTO_EX_DATA *to, const CRYPTO_EX_DATA *from,
+					void *from_d, int idx, long argl, void *argp);
+#endif
+extern void openssl_session_evidence_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx,
+					  long argl, void *argp);
+
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
-extern int X509_STORE_get_ex_new_index(long argl, void *argp, CRYPTO_EX_new *new_func,
-				       CRYPTO_EX_dup *dup_func, CRYPTO_EX_free *free_func);
 extern const STACK_OF(X509_EXTENSION) * X509_get0_extensions(const X509 *x);
-extern int X509_STORE_set_ex_data(X509_STORE *ctx, int idx, void *data);
-extern void *X509_STORE_get_ex_data(const X509_STORE *ctx, int idx);
-extern X509_STORE *X509_STORE_CTX_get0_store(X509_STORE_CTX *ctx);
+extern int SSL_CTX_up_ref(SSL_CTX *ctx);
+extern STACK_OF(X509) * X509_STORE_CTX_get0_chain(X509_STORE_CTX *ctx);
 extern int X509_get_signature_info(X509 *x, int *mdnid, int *pknid, int *secbits, uint32_t *flags);
 #endif
 #endif
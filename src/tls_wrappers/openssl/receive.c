@@ -23,7 +23,10 @@ tls_wrapper_err_t openssl_tls_receive(tls_wrapper_ctx_t *ctx, void *buf, size_t
 
 	int rc = SSL_read(ssl_ctx->ssl, buf, (int)*buf_size);
 	if (rc <= 0) {
-		// TODO: handle result of SSL_get_error()
+		tls_wrapper_err_t want = openssl_want_err(ssl_ctx->ssl, rc);
+		if (want != TLS_WRAPPER_ERR_NONE)
+			return want;
+
 		RTLS_ERR("SSL_read() failed: %d, SSL_get_error(): %d\n", rc,
 			 SSL_get_error(ssl_ctx->ssl, rc));
 		print_openssl_err_all();
@@ -33,3 +36,23 @@ tls_wrapper_err_t openssl_tls_receive(tls_wrapper_ctx_t *ctx, void *buf, size_t
 
 	return TLS_WRAPPER_ERR_NONE;
 }
+
+tls_wrapper_err_t openssl_tls_pending(tls_wrapper_ctx_t *ctx, size_t *size)
+{
+	if (!ctx || !size)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+	if (ssl_ctx == NULL || ssl_ctx->ssl == NULL)
+		return -TLS_WRAPPER_ERR_RECEIVE;
+
+	/* The records read ahead by the BIO are not known to openssl yet */
+	*size = (size_t)SSL_pending(ssl_ctx->ssl) + BIO_ctrl_pending(SSL_get_rbio(ssl_ctx->ssl));
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+	/* Nor are counted by SSL_pending() the records openssl read ahead itself */
+	if (!*size && SSL_has_pending(ssl_ctx->ssl))
+		*size = 1;
+#endif
+
+	return TLS_WRAPPER_ERR_NONE;
+}
@@ -0,0 +1,109 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+
+/* Serialize the replacement of the certificate in a SSL_CTX with the creation
+ * of SSL objects from it, which copy the certificate in use. SSL objects are
+ * created concurrently, and a certificate is rarely replaced.
+ */
+pthread_rwlock_t openssl_cert_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+static X509 *load_cert(const uint8_t *cert_buf, unsigned int cert_len)
+{
+	const unsigned char *p = cert_buf;
+
+	return d2i_X509(NULL, &p, cert_len);
+}
+
+tls_wrapper_err_t openssl_tls_replace_cert(tls_wrapper_ctx_t *ctx, rats_tls_cert_algo_t algo,
+					   void *privkey_buf, size_t privkey_len,
+					   rats_tls_cert_info_t *cert_info)
+{
+	RTLS_DEBUG("ctx %p, privkey_buf %p, privkey_len %zu, cert_info %p\n", ctx, privkey_buf,
+		   privkey_len, cert_info);
+
+	if (!ctx || !privkey_buf || !privkey_len || !cert_info)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+
+	int type;
+	if (algo == RATS_TLS_CERT_ALGO_ECC_256_SHA256)
+		type = EVP_PKEY_EC;
+	else if (algo == RATS_TLS_CERT_ALGO_RSA_3072_SHA256)
+		type = EVP_PKEY_RSA;
+	else
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	tls_wrapper_err_t err = -TLS_WRAPPER_ERR_INVALID;
+	X509 *cert = NULL;
+	STACK_OF(X509) *chain = NULL;
+
+	const unsigned char *p = privkey_buf;
+	EVP_PKEY *pkey = d2i_PrivateKey(type, NULL, &p, (long)privkey_len);
+	if (!pkey) {
+		RTLS_ERR("failed to load the private key\n");
+		goto err;
+	}
+
+	cert = load_cert(cert_info->cert_buf, cert_info->cert_len);
+	if (!cert) {
+		RTLS_ERR("failed to load the certificate\n");
+		goto err;
+	}
+
+	chain = sk_X509_new_null();
+	if (!chain) {
+		err = -TLS_WRAPPER_ERR_NO_MEM;
+		goto err;
+	}
+
+	if (cert_info->issuer_cert_buf) {
+		X509 *issuer = load_cert(cert_info->issuer_cert_buf, cert_info->issuer_cert_len);
+		if (!issuer) {
+			RTLS_ERR("failed to load the issuer certificate\n");
+			goto err;
+		}
+
+		if (!sk_X509_push(chain, issuer)) {
+			X509_free(issuer);
+			err = -TLS_WRAPPER_ERR_NO_MEM;
+			goto err;
+		}
+	}
+
+	/* The SSL objects created so far keep using the previous certificate */
+	pthread_rwlock_wrlock(&openssl_cert_lock);
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+	int ret = SSL_CTX_use_cert_and_key(ssl_ctx->sctx, cert, pkey, chain, 1);
+#else
+	/* The private key not matching the new certificate is dropped first */
+	int ret = SSL_CTX_use_certificate(ssl_ctx->sctx, cert) == SSL_SUCCESS &&
+		  SSL_CTX_use_PrivateKey(ssl_ctx->sctx, pkey) == SSL_SUCCESS &&
+		  SSL_CTX_set1_chain(ssl_ctx->sctx, chain) == SSL_SUCCESS;
+#endif
+	pthread_rwlock_unlock(&openssl_cert_lock);
+
+	if (ret != SSL_SUCCESS) {
+		RTLS_ERR("failed to replace the certificate\n");
+		print_openssl_err_all();
+		goto err;
+	}
+
+	err = TLS_WRAPPER_ERR_NONE;
+err:
+	if (chain)
+		sk_X509_pop_free(chain, X509_free);
+	if (cert)
+		X509_free(cert);
+	if (pkey)
+		EVP_PKEY_free(pkey);
+	return err;
+}
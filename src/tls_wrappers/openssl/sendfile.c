@@ -0,0 +1,103 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <limits.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+#include "internal/core.h"
+
+/* The size of the chunks of the file encrypted by openssl without kTLS */
+#define OPENSSL_SENDFILE_CHUNK_SIZE 16384
+
+static tls_wrapper_err_t sendfile_err(SSL *ssl, int rc)
+{
+	tls_wrapper_err_t want = openssl_want_err(ssl, rc);
+	if (want != TLS_WRAPPER_ERR_NONE)
+		return want;
+
+	RTLS_ERR("failed to send file: %d, SSL_get_error(): %d\n", rc, SSL_get_error(ssl, rc));
+	print_openssl_err_all();
+	return -TLS_WRAPPER_ERR_TRANSMIT;
+}
+
+tls_wrapper_err_t openssl_tls_sendfile(tls_wrapper_ctx_t *ctx, int file_fd, off_t offset,
+				       size_t *size)
+{
+	RTLS_DEBUG("ctx %p, file_fd %d, offset %lld, size %p\n", ctx, file_fd, (long long)offset,
+		   size);
+
+	if (!ctx || !size)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+	if (ssl_ctx == NULL || ssl_ctx->ssl == NULL)
+		return -TLS_WRAPPER_ERR_TRANSMIT;
+
+	SSL *ssl = ssl_ctx->ssl;
+
+	ERR_clear_error();
+
+	size_t sent = 0;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L && !defined(OPENSSL_NO_KTLS)
+	/* The kernel encrypts the pages of the file sent to the socket, at most
+	 * INT_MAX bytes at a time as openssl reports the result of a write as an int.
+	 */
+	if (BIO_get_ktls_send(SSL_get_wbio(ssl))) {
+		while (sent < *size) {
+			size_t len = *size - sent;
+			if (len > INT_MAX)
+				len = INT_MAX;
+
+			ossl_ssize_t rc =
+				SSL_sendfile(ssl, file_fd, offset + (off_t)sent, len, 0);
+			if (rc < 0) {
+				if (sent && openssl_want_err(ssl, (int)rc) != TLS_WRAPPER_ERR_NONE)
+					break;
+
+				return sendfile_err(ssl, (int)rc);
+			}
+			if (rc == 0)
+				break;
+			sent += (size_t)rc;
+		}
+		*size = sent;
+
+		return TLS_WRAPPER_ERR_NONE;
+	}
+#endif
+
+	/* Otherwise encrypt the file read in chunks */
+	uint8_t buf[OPENSSL_SENDFILE_CHUNK_SIZE];
+
+	while (sent < *size) {
+		size_t len = *size - sent;
+		if (len > sizeof(buf))
+			len = sizeof(buf);
+
+		ssize_t n = rtls_pread(file_fd, buf, len, offset + (off_t)sent);
+		if (n < 0) {
+			RTLS_ERR("failed to read the file to send\n");
+			return -TLS_WRAPPER_ERR_TRANSMIT;
+		}
+		if (n == 0)
+			break;
+
+		int rc = SSL_write(ssl, buf, (int)n);
+		if (rc <= 0) {
+			/* Report the bytes sent before the socket would block */
+			if (sent && openssl_want_err(ssl, rc) != TLS_WRAPPER_ERR_NONE)
+				break;
+
+			return sendfile_err(ssl, rc);
+		}
+		sent += (size_t)rc;
+	}
+	*size = sent;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
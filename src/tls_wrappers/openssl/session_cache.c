@@ -0,0 +1,350 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#ifndef SGX
+#include <sys/socket.h>
+#endif
+#include <rats-tls/log.h>
+#include <rats-tls/err.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+#include "internal/core.h"
+#include "internal/verify_cache.h"
+
+/* A TLS session is bound to the verification result of the evidence of the
+ * peer, which is reported again on resumption instead of being verified.
+ *
+ * client: the result is attached to the SSL_SESSION kept for resumption,
+ *         one per server address.
+ * server: the ticket carries the key to look up the result in the verify
+ *         cache, so that a ticket is only accepted while the evidence is
+ *         known as verified.
+ */
+int openssl_session_ex_data_idx = -1;
+
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+/* Protect the sessions kept by the clients for resumption */
+static pthread_mutex_t session_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Incremented on each use of a session, to evict the least recently used one */
+static uint64_t session_clock;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+int openssl_session_evidence_dup(__attribute__((unused)) CRYPTO_EX_DATA *to,
+				 __attribute__((unused)) const CRYPTO_EX_DATA *from, void **from_d,
+				 __attribute__((unused)) int idx, __attribute__((unused)) long argl,
+				 __attribute__((unused)) void *argp)
+#else
+int openssl_session_evidence_dup(__attribute__((unused)) CRYPTO_EX_DATA *to,
+				 __attribute__((unused)) const CRYPTO_EX_DATA *from, void *from_d,
+				 __attribute__((unused)) int idx, __attribute__((unused)) long argl,
+				 __attribute__((unused)) void *argp)
+#endif
+{
+	/* The copy of the session shares the result */
+	rtls_verify_result_t *result = *(rtls_verify_result_t **)from_d;
+	if (result)
+		rtls_verify_result_get(result);
+
+	return 1;
+}
+
+void openssl_session_evidence_free(__attribute__((unused)) void *parent, void *ptr,
+				   __attribute__((unused)) CRYPTO_EX_DATA *ad,
+				   __attribute__((unused)) int idx,
+				   __attribute__((unused)) long argl,
+				   __attribute__((unused)) void *argp)
+{
+	rtls_verify_result_put((rtls_verify_result_t *)ptr);
+}
+
+static openssl_ctx_t *identity_ssl_ctx(tls_wrapper_ctx_t *ctx)
+{
+	return rtls_core_get_identity(ctx->rtls_handle)->tls_wrapper->tls_private;
+}
+
+/* Bind the session to the evidence of the peer verified in the handshake */
+static void session_bind_evidence(SSL_SESSION *session, rtls_verify_result_t *result)
+{
+	if (!result || SSL_SESSION_get_ex_data(session, openssl_session_ex_data_idx))
+		return;
+
+	if (SSL_SESSION_set_ex_data(session, openssl_session_ex_data_idx, result))
+		rtls_verify_result_get(result);
+}
+
+/* Must be called with session_lock held */
+static openssl_resume_session_t *session_find(openssl_ctx_t *ssl_ctx, const uint8_t *peer,
+					      unsigned int peer_len)
+{
+	for (unsigned int i = 0; i < OPENSSL_RESUME_SESSIONS_MAX; ++i) {
+		openssl_resume_session_t *entry = &ssl_ctx->resume_sessions[i];
+
+		if (entry->session && entry->peer_len == peer_len &&
+		    !memcmp(entry->peer, peer, peer_len))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Must be called with session_lock held */
+static openssl_resume_session_t *session_victim(openssl_ctx_t *ssl_ctx)
+{
+	openssl_resume_session_t *victim = &ssl_ctx->resume_sessions[0];
+
+	for (unsigned int i = 0; i < OPENSSL_RESUME_SESSIONS_MAX; ++i) {
+		openssl_resume_session_t *entry = &ssl_ctx->resume_sessions[i];
+
+		if (!entry->session)
+			return entry;
+		if (entry->last_used < victim->last_used)
+			victim = entry;
+	}
+
+	return victim;
+}
+
+/* Keep the latest session issued by the server for the next connection to it.
+ * With TLS 1.2, the session is issued before the handshake is complete.
+ */
+static int new_session_cb(SSL *ssl, SSL_SESSION *session)
+{
+	tls_wrapper_ctx_t *ctx = SSL_get_ex_data(ssl, openssl_ex_data_idx);
+	if (!ctx)
+		return 0;
+
+	session_bind_evidence(session, ctx->peer_evidence);
+	if (!SSL_SESSION_get_ex_data(session, openssl_session_ex_data_idx))
+		return 0;
+
+	openssl_ctx_t *ssl_ctx = identity_ssl_ctx(ctx);
+	openssl_ctx_t *conn_ssl_ctx = ctx->tls_private;
+	if (!ssl_ctx->resume_sessions)
+		return 0;
+
+	pthread_mutex_lock(&session_lock);
+	openssl_resume_session_t *entry =
+		session_find(ssl_ctx, conn_ssl_ctx->peer, conn_ssl_ctx->peer_len);
+	if (!entry) {
+		entry = session_victim(ssl_ctx);
+		memcpy(entry->peer, conn_ssl_ctx->peer, conn_ssl_ctx->peer_len);
+		entry->peer_len = conn_ssl_ctx->peer_len;
+	}
+	SSL_SESSION *old_session = entry->session;
+	entry->session = session;
+	entry->last_used = ++session_clock;
+	pthread_mutex_unlock(&session_lock);
+
+	if (old_session)
+		SSL_SESSION_free(old_session);
+
+	RTLS_DEBUG("session %p kept for resumption\n", session);
+
+	/* Take over the reference to the session */
+	return 1;
+}
+
+static int gen_ticket_cb(SSL *ssl, __attribute__((unused)) void *arg)
+{
+	tls_wrapper_ctx_t *ctx = SSL_get_ex_data(ssl, openssl_ex_data_idx);
+	if (!ctx || !ctx->peer_evidence)
+		return 1;
+
+	rtls_verify_result_t *result = ctx->peer_evidence;
+
+	return SSL_SESSION_set1_ticket_appdata(SSL_get0_session(ssl), &result->key,
+					       sizeof(result->key));
+}
+
+static SSL_TICKET_RETURN dec_ticket_cb(SSL *ssl, SSL_SESSION *session,
+				       __attribute__((unused)) const unsigned char *keyname,
+				       __attribute__((unused)) size_t keyname_len,
+				       SSL_TICKET_STATUS status, __attribute__((unused)) void *arg)
+{
+	SSL_TICKET_RETURN use = SSL_TICKET_RETURN_USE;
+
+	switch (status) {
+	case SSL_TICKET_SUCCESS:
+		break;
+	case SSL_TICKET_SUCCESS_RENEW:
+		use = SSL_TICKET_RETURN_USE_RENEW;
+		break;
+	default:
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+	}
+
+	tls_wrapper_ctx_t *ctx = SSL_get_ex_data(ssl, openssl_ex_data_idx);
+	if (!ctx)
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+
+	/* Nothing to verify without a client certificate */
+	if (!(ctx->conf_flags & RATS_TLS_CONF_FLAGS_MUTUAL))
+		return use;
+
+	void *key = NULL;
+	size_t key_len = 0;
+	if (!SSL_SESSION_get0_ticket_appdata(session, &key, &key_len) ||
+	    key_len != sizeof(rtls_verify_key_t))
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+
+	/* Fall back to a full handshake once the result is evicted or expired */
+	rtls_verify_result_t *result = rtls_verify_cache_lookup((rtls_verify_key_t *)key);
+	if (!result || result->err != TLS_WRAPPER_ERR_NONE) {
+		RTLS_DEBUG("no verified evidence for the ticket\n");
+		rtls_verify_result_put(result);
+		return SSL_TICKET_RETURN_IGNORE_RENEW;
+	}
+
+	rtls_verify_result_put(ctx->peer_evidence);
+	ctx->peer_evidence = result;
+
+	return use;
+}
+
+void openssl_session_cache_init(tls_wrapper_ctx_t *ctx, openssl_ctx_t *ssl_ctx)
+{
+	/* Required by openssl to resume a session with a verified peer */
+	SSL_CTX_set_session_id_context(ssl_ctx->sctx, (const unsigned char *)"rats-tls",
+				       strlen("rats-tls"));
+
+	if (ctx->conf_flags & RATS_TLS_CONF_FLAGS_SERVER) {
+		/* Session tickets are issued even without a session cache */
+		SSL_CTX_set_session_cache_mode(ssl_ctx->sctx, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_set_session_ticket_cb(ssl_ctx->sctx, gen_ticket_cb, dec_ticket_cb, NULL);
+	} else {
+		ssl_ctx->resume_sessions =
+			calloc(OPENSSL_RESUME_SESSIONS_MAX, sizeof(*ssl_ctx->resume_sessions));
+		if (!ssl_ctx->resume_sessions) {
+			RTLS_WARN("failed to allocate the sessions to resume\n");
+			return;
+		}
+
+		SSL_CTX_set_session_cache_mode(ssl_ctx->sctx,
+					       SSL_SESS_CACHE_CLIENT |
+						       SSL_SESS_CACHE_NO_INTERNAL_STORE);
+		SSL_CTX_sess_set_new_cb(ssl_ctx->sctx, new_session_cb);
+	}
+}
+
+void openssl_session_cache_cleanup(openssl_ctx_t *ssl_ctx)
+{
+	if (!ssl_ctx->resume_sessions)
+		return;
+
+	for (unsigned int i = 0; i < OPENSSL_RESUME_SESSIONS_MAX; ++i) {
+		if (ssl_ctx->resume_sessions[i].session)
+			SSL_SESSION_free(ssl_ctx->resume_sessions[i].session);
+	}
+
+	free(ssl_ctx->resume_sessions);
+	ssl_ctx->resume_sessions = NULL;
+}
+
+/* Identify the server by its address. The address is unknown in enclave, and
+ * over shared memory, where all the servers share a single session.
+ */
+static void session_peer(openssl_ctx_t *ssl_ctx, __attribute__((unused)) int fd)
+{
+	ssl_ctx->peer_len = 0;
+
+#ifndef SGX
+	struct sockaddr_storage addr;
+	socklen_t len = sizeof(addr);
+
+	if (fd >= 0 && !getpeername(fd, (struct sockaddr *)&addr, &len) &&
+	    len <= sizeof(ssl_ctx->peer)) {
+		memcpy(ssl_ctx->peer, &addr, len);
+		ssl_ctx->peer_len = len;
+	}
+#endif
+}
+
+void openssl_session_resume(tls_wrapper_ctx_t *ctx, SSL *ssl, int fd)
+{
+	/* Forget the evidence of the peer in the previous TLS session */
+	rtls_verify_result_put(ctx->peer_evidence);
+	ctx->peer_evidence = NULL;
+
+	if (ctx->conf_flags & RATS_TLS_CONF_FLAGS_SERVER)
+		return;
+
+	openssl_ctx_t *conn_ssl_ctx = ctx->tls_private;
+	session_peer(conn_ssl_ctx, ctx->shm ? -1 : fd);
+
+	openssl_ctx_t *ssl_ctx = identity_ssl_ctx(ctx);
+	if (!ssl_ctx->resume_sessions)
+		return;
+
+	pthread_mutex_lock(&session_lock);
+	openssl_resume_session_t *entry =
+		session_find(ssl_ctx, conn_ssl_ctx->peer, conn_ssl_ctx->peer_len);
+	if (entry) {
+		SSL_SESSION *session = entry->session;
+		rtls_verify_result_t *result =
+			SSL_SESSION_get_ex_data(session, openssl_session_ex_data_idx);
+
+		if (!SSL_SESSION_is_resumable(session) || !result ||
+		    result->expiry <= rtls_time()) {
+			entry->session = NULL;
+			SSL_SESSION_free(session);
+		} else if (SSL_set_session(ssl, session) == SSL_SUCCESS) {
+			entry->last_used = ++session_clock;
+			RTLS_DEBUG("try to resume session %p\n", session);
+		}
+	}
+	pthread_mutex_unlock(&session_lock);
+}
+
+tls_wrapper_err_t openssl_session_established(tls_wrapper_ctx_t *ctx, SSL *ssl, bool verify)
+{
+	SSL_SESSION *session = SSL_get_session(ssl);
+
+	if (!SSL_session_reused(ssl)) {
+		/* The tickets issued later with TLS 1.3 inherit the evidence */
+		if (session)
+			session_bind_evidence(session, ctx->peer_evidence);
+
+		return TLS_WRAPPER_ERR_NONE;
+	}
+
+	RTLS_DEBUG("session %p resumed\n", session);
+
+	if (!verify)
+		return TLS_WRAPPER_ERR_NONE;
+
+	/* The result is looked up through the ticket by the server */
+	rtls_verify_result_t *result = ctx->peer_evidence;
+	if (!result && session)
+		result = SSL_SESSION_get_ex_data(session, openssl_session_ex_data_idx);
+
+	return tls_wrapper_verify_resumed_session(ctx, result);
+}
+#else
+void openssl_session_cache_init(__attribute__((unused)) tls_wrapper_ctx_t *ctx,
+				__attribute__((unused)) openssl_ctx_t *ssl_ctx)
+{
+	RTLS_WARN("session resumption requires openssl 1.1.1 or later\n");
+}
+
+void openssl_session_cache_cleanup(__attribute__((unused)) openssl_ctx_t *ssl_ctx)
+{
+}
+
+void openssl_session_resume(__attribute__((unused)) tls_wrapper_ctx_t *ctx,
+			    __attribute__((unused)) SSL *ssl, __attribute__((unused)) int fd)
+{
+}
+
+tls_wrapper_err_t openssl_session_established(__attribute__((unused)) tls_wrapper_ctx_t *ctx,
+					      __attribute__((unused)) SSL *ssl,
+					      __attribute__((unused)) bool verify)
+{
+	return TLS_WRAPPER_ERR_NONE;
+}
+#endif
@@ -0,0 +1,37 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+
+tls_wrapper_err_t openssl_tls_session_init(tls_wrapper_ctx_t *ctx, tls_wrapper_ctx_t *session_ctx)
+{
+	RTLS_DEBUG("ctx %p, session_ctx %p\n", ctx, session_ctx);
+
+	if (!ctx || !ctx->tls_private || !session_ctx)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+	openssl_ctx_t *session_ssl_ctx = calloc(1, sizeof(*session_ssl_ctx));
+	if (!session_ssl_ctx)
+		return -TLS_WRAPPER_ERR_NO_MEM;
+
+	/* The SSL_CTX carrying the attested key and certificate is shared
+	 * with the session, which holds its own reference to it.
+	 */
+	if (!SSL_CTX_up_ref(ssl_ctx->sctx)) {
+		RTLS_ERR("failed to take a reference to SSL_CTX\n");
+		free(session_ssl_ctx);
+		return -TLS_WRAPPER_ERR_INVALID;
+	}
+	session_ssl_ctx->sctx = ssl_ctx->sctx;
+
+	session_ctx->tls_private = session_ssl_ctx;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
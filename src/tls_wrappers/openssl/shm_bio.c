@@ -0,0 +1,116 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+#include "internal/shm_ring.h"
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+static BIO_METHOD *shm_bio_method;
+static int shm_bio_type;
+static pthread_once_t shm_bio_once = PTHREAD_ONCE_INIT;
+
+static int shm_bio_write(BIO *bio, const char *buf, int len)
+{
+	BIO_clear_retry_flags(bio);
+
+	ssize_t rc = rtls_shm_write(BIO_get_data(bio), buf, (size_t)len);
+	if (rc < 0)
+		return -1;
+
+	return (int)rc;
+}
+
+static int shm_bio_read(BIO *bio, char *buf, int len)
+{
+	BIO_clear_retry_flags(bio);
+
+	ssize_t rc = rtls_shm_read(BIO_get_data(bio), buf, (size_t)len);
+	if (rc < 0)
+		return -1;
+
+	return (int)rc;
+}
+
+static long shm_bio_ctrl(__attribute__((unused)) BIO *bio, int cmd,
+			 __attribute__((unused)) long num, __attribute__((unused)) void *ptr)
+{
+	switch (cmd) {
+	/* The data written is visible to the peer right away */
+	case BIO_CTRL_FLUSH:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/* The BIO holds a reference to the rings, released once the SSL object is freed */
+static int shm_bio_destroy(BIO *bio)
+{
+	rtls_shm_detach(BIO_get_data(bio));
+	BIO_set_data(bio, NULL);
+
+	return 1;
+}
+
+static void shm_bio_method_init(void)
+{
+	int type = BIO_get_new_index() | BIO_TYPE_SOURCE_SINK;
+	BIO_METHOD *method = BIO_meth_new(type, "rats-tls shared memory ring");
+	if (!method)
+		return;
+
+	if (!BIO_meth_set_write(method, shm_bio_write) ||
+	    !BIO_meth_set_read(method, shm_bio_read) || !BIO_meth_set_ctrl(method, shm_bio_ctrl) ||
+	    !BIO_meth_set_destroy(method, shm_bio_destroy)) {
+		BIO_meth_free(method);
+		return;
+	}
+
+	shm_bio_method = method;
+	shm_bio_type = type;
+}
+
+BIO *openssl_shm_bio_new(struct rtls_shm_transport *shm)
+{
+	pthread_once(&shm_bio_once, shm_bio_method_init);
+	if (!shm_bio_method) {
+		RTLS_ERR("failed to create the shared memory BIO method\n");
+		return NULL;
+	}
+
+	BIO *bio = BIO_new(shm_bio_method);
+	if (!bio)
+		return NULL;
+
+	BIO_set_data(bio, rtls_shm_get(shm));
+	BIO_set_init(bio, 1);
+
+	return bio;
+}
+
+/* Whether the SSL object transfers the data through the rings */
+bool openssl_shm_bio_attached(SSL *ssl, struct rtls_shm_transport *shm)
+{
+	BIO *bio = SSL_get_rbio(ssl);
+
+	return bio && shm_bio_type && BIO_method_type(bio) == shm_bio_type &&
+	       BIO_get_data(bio) == shm;
+}
+#else
+BIO *openssl_shm_bio_new(__attribute__((unused)) struct rtls_shm_transport *shm)
+{
+	RTLS_ERR("the shared memory transport requires openssl 1.1.0 or later\n");
+	return NULL;
+}
+
+bool openssl_shm_bio_attached(__attribute__((unused)) SSL *ssl,
+			      __attribute__((unused)) struct rtls_shm_transport *shm)
+{
+	return false;
+}
+#endif
@@ -23,7 +23,10 @@ tls_wrapper_err_t openssl_tls_transmit(tls_wrapper_ctx_t *ctx, void *buf, size_t
 
 	int rc = SSL_write(ssl_ctx->ssl, buf, (int)*buf_size);
 	if (rc <= 0) {
-		// TODO: handle result of SSL_get_error()
+		tls_wrapper_err_t want = openssl_want_err(ssl_ctx->ssl, rc);
+		if (want != TLS_WRAPPER_ERR_NONE)
+			return want;
+
 		RTLS_ERR("SSL_write() failed: %d, SSL_get_error(): %d\n", rc,
 			 SSL_get_error(ssl_ctx->ssl, rc));
 		print_openssl_err_all();
@@ -33,3 +36,17 @@ tls_wrapper_err_t openssl_tls_transmit(tls_wrapper_ctx_t *ctx, void *buf, size_t
 
 	return TLS_WRAPPER_ERR_NONE;
 }
+
+tls_wrapper_err_t openssl_tls_flush(tls_wrapper_ctx_t *ctx)
+{
+	RTLS_DEBUG("ctx %p\n", ctx);
+
+	if (!ctx)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+	if (ssl_ctx == NULL || ssl_ctx->ssl == NULL)
+		return -TLS_WRAPPER_ERR_TRANSMIT;
+
+	return openssl_flush(ssl_ctx->ssl);
+}
@@ -0,0 +1,104 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <limits.h>
+#include <string.h>
+#include <rats-tls/log.h>
+#include <rats-tls/tls_wrapper.h>
+#include "openssl.h"
+
+static tls_wrapper_err_t transmitv_err(SSL *ssl, int rc)
+{
+	tls_wrapper_err_t want = openssl_want_err(ssl, rc);
+	if (want != TLS_WRAPPER_ERR_NONE)
+		return want;
+
+	RTLS_ERR("SSL_write() failed: %d, SSL_get_error(): %d\n", rc, SSL_get_error(ssl, rc));
+	print_openssl_err_all();
+	return -TLS_WRAPPER_ERR_TRANSMIT;
+}
+
+tls_wrapper_err_t openssl_tls_transmitv(tls_wrapper_ctx_t *ctx, const struct iovec *iov,
+					int iovcnt, size_t *size)
+{
+	RTLS_DEBUG("ctx %p, iov %p, iovcnt %d, size %p\n", ctx, iov, iovcnt, size);
+
+	if (!ctx || !iov || !size)
+		return -TLS_WRAPPER_ERR_INVALID;
+
+	openssl_ctx_t *ssl_ctx = (openssl_ctx_t *)ctx->tls_private;
+	if (ssl_ctx == NULL || ssl_ctx->ssl == NULL)
+		return -TLS_WRAPPER_ERR_TRANSMIT;
+
+	SSL *ssl = ssl_ctx->ssl;
+
+	ERR_clear_error();
+
+	/* Gather the small buffers into full records, instead of sending a
+	 * record for each of them.
+	 */
+	uint8_t record[SSL3_RT_MAX_PLAIN_LENGTH];
+	size_t record_len = 0;
+	size_t sent = 0;
+	int i = 0;
+	size_t off = 0;
+
+	while (i < iovcnt || record_len) {
+		const uint8_t *buf = NULL;
+		size_t len = 0;
+
+		if (i < iovcnt && !record_len && iov[i].iov_len - off >= sizeof(record)) {
+			/* A large buffer is sent directly, at most INT_MAX bytes at a time */
+			buf = (const uint8_t *)iov[i].iov_base + off;
+			len = iov[i].iov_len - off;
+			if (len > INT_MAX)
+				len = INT_MAX;
+		} else if (i < iovcnt && record_len < sizeof(record)) {
+			size_t n = iov[i].iov_len - off;
+			if (n > sizeof(record) - record_len)
+				n = sizeof(record) - record_len;
+
+			memcpy(record + record_len, (const uint8_t *)iov[i].iov_base + off, n);
+			record_len += n;
+			off += n;
+			if (off == iov[i].iov_len) {
+				++i;
+				off = 0;
+			}
+
+			if (i < iovcnt && record_len < sizeof(record))
+				continue;
+		}
+
+		if (!buf) {
+			buf = record;
+			len = record_len;
+		}
+
+		int rc = SSL_write(ssl, buf, (int)len);
+		if (rc <= 0) {
+			/* Report the bytes sent before the socket would block */
+			if (sent && openssl_want_err(ssl, rc) != TLS_WRAPPER_ERR_NONE)
+				break;
+
+			return transmitv_err(ssl, rc);
+		}
+		sent += (size_t)rc;
+
+		if (buf == record) {
+			record_len = 0;
+		} else {
+			off += (size_t)rc;
+			if (off == iov[i].iov_len) {
+				++i;
+				off = 0;
+			}
+		}
+	}
+	*size = sent;
+
+	return TLS_WRAPPER_ERR_NONE;
+}
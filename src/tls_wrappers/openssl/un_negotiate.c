@@ -151,8 +151,13 @@ int verify_certificate(int preverify_ok, X509_STORE_CTX *ctx)
 	#endif
 #endif
 
-	X509_STORE *cert_store = X509_STORE_CTX_get0_store(ctx);
-	tls_wrapper_ctx_t *tls_ctx = X509_STORE_get_ex_data(cert_store, openssl_ex_data_idx);
+	SSL *ssl = X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx());
+	if (!ssl) {
+		RTLS_ERR("failed to get SSL pointer\n");
+		return 0;
+	}
+
+	tls_wrapper_ctx_t *tls_ctx = SSL_get_ex_data(ssl, openssl_ex_data_idx);
 	if (!tls_ctx) {
 		RTLS_ERR("failed to get tls_wrapper_ctx pointer\n");
 		return 0;
@@ -164,6 +169,15 @@ int verify_certificate(int preverify_ok, X509_STORE_CTX *ctx)
 		return 0;
 	}
 
+	/* Only accept a self-signed certificate, or a leaf certificate signed
+	 * by a self-signed attested issuer.
+	 */
+	int depth = X509_STORE_CTX_get_error_depth(ctx);
+	if (depth > 1) {
+		RTLS_ERR("the certificate chain is too long\n");
+		return 0;
+	}
+
 	if (!preverify_ok) {
 		int err = X509_STORE_CTX_get_error(ctx);
 
@@ -171,6 +185,10 @@ int verify_certificate(int preverify_ok, X509_STORE_CTX *ctx)
 		if (err == X509_V_ERR_DEPTH_ZERO_SELF_SIGNED_CERT)
 			return SSL_SUCCESS;
 
+		/* The same applies to the attested issuer of a leaf certificate */
+		if (err == X509_V_ERR_SELF_SIGNED_CERT_IN_CHAIN && depth == 1)
+			return SSL_SUCCESS;
+
 #if 0
 		/* According to the dice standard, the DiceTaggedEvidence extension should be set to critical=true.
 		 * However, there is no way via the openssl api to know directly which extension is causing
@@ -199,6 +217,14 @@ int verify_certificate(int preverify_ok, X509_STORE_CTX *ctx)
 		return 0;
 	}
 
+	/* The leaf certificate is vouched for by the signature of its issuer
+	 * checked by openssl, and the evidence is carried by the issuer.
+	 */
+	if (depth == 0 && sk_X509_num(X509_STORE_CTX_get0_chain(ctx)) > 1) {
+		RTLS_DEBUG("leaf certificate signed by the attested issuer\n");
+		return SSL_SUCCESS;
+	}
+
 	/* Get pubkey in SubjectPublicKeyInfo format from cert */
 	EVP_PKEY *pkey = X509_get_pubkey(cert);
 	if (!pkey) {
@@ -235,9 +261,31 @@ int verify_certificate(int preverify_ok, X509_STORE_CTX *ctx)
 		return rc;
 	}
 
-	tls_wrapper_err_t t_err = tls_wrapper_verify_certificate_extension(
-		tls_ctx, pubkey_buffer, pubkey_buffer_size, evidence_buffer, evidence_buffer_size,
-		endorsements_buffer, endorsements_buffer_size);
+	tls_wrapper_err_t t_err;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	/* Openssl only allows the client to suspend the handshake for verification */
+	if ((tls_ctx->conf_flags & RATS_TLS_CONF_FLAGS_ASYNC_VERIFY) &&
+	    !(tls_ctx->conf_flags & RATS_TLS_CONF_FLAGS_SERVER)) {
+		t_err = tls_wrapper_verify_certificate_extension_async(
+			tls_ctx, pubkey_buffer, pubkey_buffer_size, evidence_buffer,
+			evidence_buffer_size, endorsements_buffer, endorsements_buffer_size);
+		/* Suspend the handshake until the evidence is verified. The
+		 * certificate will be verified again on resumption, which
+		 * collects the result of the verification.
+		 */
+		if (t_err == -TLS_WRAPPER_ERR_WANT_VERIFY) {
+			free(evidence_buffer);
+			free(endorsements_buffer);
+			SSL_set_retry_verify(ssl);
+			return SSL_SUCCESS;
+		}
+	} else
+#endif
+		t_err = tls_wrapper_verify_certificate_extension(
+			tls_ctx, pubkey_buffer, pubkey_buffer_size, evidence_buffer,
+			evidence_buffer_size, endorsements_buffer, endorsements_buffer_size);
+	free(evidence_buffer);
+	free(endorsements_buffer);
 	if (t_err != TLS_WRAPPER_ERR_NONE) {
 		RTLS_ERR("failed to verify certificate extension %#x\n", t_err);
 		return 0;
@@ -23,5 +23,22 @@ tls_wrapper_err_t openssl_tls_use_cert(tls_wrapper_ctx_t *ctx, rats_tls_cert_inf
 		return OPENSSL_ERR_CODE(ret);
 	}
 
+	/* Send the attested issuer along with the leaf certificate signed by it */
+	SSL_CTX_clear_chain_certs(ssl_ctx->sctx);
+	if (cert_info->issuer_cert_buf) {
+		const unsigned char *p = cert_info->issuer_cert_buf;
+		X509 *issuer = d2i_X509(NULL, &p, cert_info->issuer_cert_len);
+		if (!issuer) {
+			RTLS_ERR("failed to load the issuer certificate\n");
+			return -TLS_WRAPPER_ERR_INVALID;
+		}
+
+		if (!SSL_CTX_add0_chain_cert(ssl_ctx->sctx, issuer)) {
+			RTLS_ERR("failed to use the issuer certificate\n");
+			X509_free(issuer);
+			return -TLS_WRAPPER_ERR_INVALID;
+		}
+	}
+
 	return TLS_WRAPPER_ERR_NONE;
 }
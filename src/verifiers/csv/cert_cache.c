@@ -0,0 +1,125 @@
+/* Copyright (c) 2022 Hygon Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "hygoncert.h"
+#include "cert_cache.h"
+
+/* The public key of a CEK, kept once its chain up to the HRK is validated */
+typedef struct {
+	uint8_t chip_id[CSV_ATTESTATION_CHIP_SN_SIZE];
+	/* The HSK and CEK certs, compared in full since the ChipId is not signed */
+	uint8_t hsk_cek[HYGON_HSK_CEK_CERT_SIZE];
+	hygon_sm2_key_t *cek_key;
+	uint64_t last_used;
+} csv_chain_entry_t;
+
+static csv_chain_entry_t chains[CSV_CHAIN_CACHE_SIZE];
+static uint64_t chain_clock;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Validate the HSK by the HRK and the CEK by the HSK, and convert the public key of the CEK */
+static enclave_verifier_err_t validate_cert_chain(const uint8_t *hsk_cek, hygon_sm2_key_t **cek_key)
+{
+	hygon_root_cert_t hsk_cert;
+	csv_cert_t cek_cert;
+
+	/* Verify a copy, so that the certs can't change once validated */
+	memcpy(&hsk_cert, hsk_cek, sizeof(hsk_cert));
+	memcpy(&cek_cert, hsk_cek + HYGON_CERT_SIZE, sizeof(cek_cert));
+
+	/* Verify HSK cert with HRK */
+	if (verify_hsk_cert(&hsk_cert) != 1) {
+		RTLS_ERR("failed to verify HSK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_DEBUG("verify HSK cert successfully\n");
+
+	/* Verify CEK cert with HSK */
+	if (verify_cek_cert(&hsk_cert, &cek_cert) != 1) {
+		RTLS_ERR("failed to verify CEK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_DEBUG("verify CEK cert successfully\n");
+
+	*cek_key = hygon_sm2_key_new((hygon_pubkey_t *)&cek_cert.sm2_pubkey);
+	if (!*cek_key)
+		return -ENCLAVE_VERIFIER_ERR_NO_MEM;
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+/* Must be called with the lock held */
+static csv_chain_entry_t *chain_find(const uint8_t *chip_id, const uint8_t *hsk_cek)
+{
+	for (unsigned int i = 0; i < CSV_CHAIN_CACHE_SIZE; ++i) {
+		if (chains[i].cek_key &&
+		    !memcmp(chains[i].chip_id, chip_id, sizeof(chains[i].chip_id)) &&
+		    !memcmp(chains[i].hsk_cek, hsk_cek, sizeof(chains[i].hsk_cek)))
+			return &chains[i];
+	}
+
+	return NULL;
+}
+
+/* Must be called with the lock held */
+static csv_chain_entry_t *chain_victim(const uint8_t *chip_id)
+{
+	csv_chain_entry_t *victim = &chains[0];
+
+	for (unsigned int i = 0; i < CSV_CHAIN_CACHE_SIZE; ++i) {
+		/* A chip has one HSK and CEK chain, so replace the former one */
+		if (!chains[i].cek_key ||
+		    !memcmp(chains[i].chip_id, chip_id, sizeof(chains[i].chip_id)))
+			return &chains[i];
+		if (chains[i].last_used < victim->last_used)
+			victim = &chains[i];
+	}
+
+	return victim;
+}
+
+/* Return a reference to the public key of the CEK of the chip @chip_id, so that only
+ * the PEK cert and the attestation report are left to verify. The caller must release
+ * it with hygon_sm2_key_free().
+ */
+enclave_verifier_err_t csv_get_cek_key(const uint8_t *chip_id, const uint8_t *hsk_cek,
+				       hygon_sm2_key_t **cek_key)
+{
+	pthread_mutex_lock(&cache_lock);
+	csv_chain_entry_t *entry = chain_find(chip_id, hsk_cek);
+	if (entry) {
+		entry->last_used = ++chain_clock;
+		hygon_sm2_key_up_ref(entry->cek_key);
+		*cek_key = entry->cek_key;
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	if (entry)
+		return ENCLAVE_VERIFIER_ERR_NONE;
+
+	enclave_verifier_err_t err = validate_cert_chain(hsk_cek, cek_key);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	pthread_mutex_lock(&cache_lock);
+	/* Another thread may have validated the same chain meanwhile */
+	entry = chain_find(chip_id, hsk_cek);
+	if (!entry) {
+		entry = chain_victim(chip_id);
+		hygon_sm2_key_free(entry->cek_key);
+		memcpy(entry->chip_id, chip_id, sizeof(entry->chip_id));
+		memcpy(entry->hsk_cek, hsk_cek, sizeof(entry->hsk_cek));
+		entry->cek_key = *cek_key;
+		hygon_sm2_key_up_ref(entry->cek_key);
+	}
+	entry->last_used = ++chain_clock;
+	pthread_mutex_unlock(&cache_lock);
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
@@ -0,0 +1,20 @@
+/* Copyright (c) 2022 Hygon Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _CERT_CACHE_H
+#define _CERT_CACHE_H
+
+#include <rats-tls/verifier.h>
+#include <rats-tls/csv.h>
+#include "hygoncert.h"
+
+/* Number of HSK and CEK chains kept, one per chip */
+#define CSV_CHAIN_CACHE_SIZE 16
+
+enclave_verifier_err_t csv_get_cek_key(const uint8_t *chip_id, const uint8_t *hsk_cek,
+				       hygon_sm2_key_t **cek_key);
+
+#endif /* _CERT_CACHE_H */
@@ -4,10 +4,12 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <fcntl.h>
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <rats-tls/log.h>
@@ -774,65 +776,242 @@ static void hygon_to_sm2_userid(hygon_pubkey_t *pubkey, sm2_userid_t *userid)
 	memcpy(userid->uid, (uint8_t *)pubkey->userid, userid->len);
 }
 
+/* OpenSSL verifies SM2 signatures natively, given the digest of Z and the message.
+ * Before 3.2 it rebuilds a generic curve for each key, without the precomputed table
+ * of sm2_group, which measured slower than sm2_sig_verify() above. Build with
+ * -DHYGON_SM2_NATIVE to use it anyway, e.g. to check it with bench/csv_sm2.
+ */
+#if !defined(HYGON_SM2_NATIVE) && OPENSSL_VERSION_NUMBER >= 0x30200000L && \
+	!defined(OPENSSL_NO_SM2)
+#define HYGON_SM2_NATIVE
+#endif
+
+#define SM3_DIGEST_LENGTH 32
+
+/* An SM2 public key in the form ready to verify signatures */
+struct hygon_sm2_key {
+	unsigned int refcount;
+	EC_KEY *ec_key;
+#ifdef HYGON_SM2_NATIVE
+	EVP_PKEY *pkey;
+#endif
+	/* Digest of the userid, the curve and the public key, as signed along the message */
+	uint8_t z[SM3_DIGEST_LENGTH];
+};
+
+/* The SM2 curve, built once with a precomputed table of multiples of the generator */
+static EC_GROUP *sm2_group;
+static pthread_once_t sm2_group_once = PTHREAD_ONCE_INIT;
+
+static void sm2_group_init(void)
+{
+	sm2_group = ec_group_new_from_data(sm2_curve);
+	if (!sm2_group) {
+		RTLS_ERR("failed to build SM2 curve\n");
+		return;
+	}
+
+	if (!EC_GROUP_precompute_mult(sm2_group, NULL))
+		RTLS_WARN("failed to precompute multiples of SM2 generator\n");
+}
+
+static const EC_GROUP *get_sm2_group(void)
+{
+	pthread_once(&sm2_group_once, sm2_group_init);
+
+	return sm2_group;
+}
+
 /**
- * Verify SM2 signature
+ * Convert the SM2 public key in a Hygon cert to the form ready to verify signatures
  *
  * Params:
- * 	sm2_pubkey [in]: SM2 public key
- * 	msg        [in]: plain text
- * 	msg_len    [in]: plain text len
- * 	user_id    [in]: SM2 userid
- * 	sig        [in]: SM2 signature
+ * 	pubkey [in]: SM2 public key in cert
  * Return:
- * 	1: success
- * 	otherwise fail
+ * 	the key to release with hygon_sm2_key_free(): success
+ * 	NULL: fail
  */
-static int sm2_verify_sig(const sm2_pubkey_t *sm2_pubkey, const uint8_t *msg, size_t msg_len,
-			  const sm2_userid_t *user_id, const sm2_signature_t *sig)
+hygon_sm2_key_t *hygon_sm2_key_new(const hygon_pubkey_t *pubkey)
 {
-	int ret = -1;
-	EC_KEY *ec_key = NULL;
-	EC_GROUP *group = NULL;
-	ECDSA_SIG *ecdsa_sig = NULL;
-	BIGNUM *bn_qx, *bn_qy, *bn_sig_r, *bn_sig_s;
+	hygon_sm2_key_t *key = NULL;
+	const EC_GROUP *group;
+	EC_POINT *point = NULL;
+	BIGNUM *bn_qx = NULL, *bn_qy = NULL;
+	sm2_pubkey_t sm2_pubkey;
+	sm2_userid_t sm2_userid;
+
+	if (!(group = get_sm2_group()))
+		return NULL;
+
+	key = calloc(1, sizeof(*key));
+	if (!key)
+		return NULL;
+	key->refcount = 1;
+
+	hygon_to_sm2_pubkey((hygon_pubkey_t *)pubkey, &sm2_pubkey);
+	hygon_to_sm2_userid((hygon_pubkey_t *)pubkey, &sm2_userid);
 
 	// convert @sm2_pubkey to EC_KEY
-	if (!(ec_key = EC_KEY_new())) {
+	if (!(key->ec_key = EC_KEY_new())) {
 		RTLS_DEBUG("EC_KEY_new() fail\n");
-		return -1;
+		goto err;
 	}
-	if (!(bn_qx = BN_new())) {
-		RTLS_DEBUG("BN_new() bn_qx fail\n");
-		goto err_free_ec_key;
+
+	/* The group is shared along with its precomputed table */
+	if (EC_KEY_set_group(key->ec_key, group) != 1) {
+		RTLS_DEBUG("EC_KEY_set_group() fail\n");
+		goto err;
 	}
-	if (!(bn_qy = BN_new())) {
-		RTLS_DEBUG("BN_new() bn_qy fail\n");
-		goto err_free_bn_qx;
+
+	bn_qx = BN_bin2bn(sm2_pubkey.qx, HYGON_SM2_POINT_SIZE, NULL);
+	bn_qy = BN_bin2bn(sm2_pubkey.qy, HYGON_SM2_POINT_SIZE, NULL);
+	if (!bn_qx || !bn_qy || !(point = EC_POINT_new(group))) {
+		RTLS_DEBUG("BN_bin2bn() fail\n");
+		goto err;
 	}
-	BN_bin2bn(sm2_pubkey->qx, HYGON_SM2_POINT_SIZE, bn_qx);
-	BN_bin2bn(sm2_pubkey->qy, HYGON_SM2_POINT_SIZE, bn_qy);
 
-	if (!(group = ec_group_new_from_data(sm2_curve))) {
-		RTLS_DEBUG("EC_GROUP_new_by_curve_name() fail\n");
-		goto err_free_bn_qy;
+	/* The cofactor of SM2 is 1, so a point on the curve is of the right order. This
+	 * saves the multiplication by the order of EC_KEY_set_public_key_affine_coordinates().
+	 */
+	if (EC_POINT_set_affine_coordinates(group, point, bn_qx, bn_qy, NULL) != 1 ||
+	    EC_KEY_set_public_key(key->ec_key, point) != 1) {
+		RTLS_DEBUG("EC_KEY_set_public_key() fail\n");
+		goto err;
 	}
-	ret = EC_KEY_set_group(ec_key, group);
-	if (ret != 1) {
-		RTLS_DEBUG("EC_KEY_set_group() fail\n");
-		goto err_free_group;
+
+	if (sm2_compute_z_digest(key->z, EVP_sm3(), sm2_userid.uid, sm2_userid.len,
+				 key->ec_key) != 1) {
+		RTLS_DEBUG("sm2_compute_z_digest() fail\n");
+		goto err;
 	}
 
-	ret = EC_KEY_set_public_key_affine_coordinates(ec_key, bn_qx, bn_qy);
-	if (ret != 1) {
-		RTLS_DEBUG("EC_KEY_set_public_key_affine_coordinates() fail\n");
-		goto err_free_group;
+#ifdef HYGON_SM2_NATIVE
+	/* An EC_KEY on the SM2 curve makes an SM2 EVP_PKEY */
+	if (!(key->pkey = EVP_PKEY_new()) || EVP_PKEY_set1_EC_KEY(key->pkey, key->ec_key) != 1) {
+		RTLS_DEBUG("EVP_PKEY_set1_EC_KEY() fail\n");
+		goto err;
+	}
+#endif
+
+	EC_POINT_free(point);
+	BN_free(bn_qy);
+	BN_free(bn_qx);
+
+	return key;
+err:
+	EC_POINT_free(point);
+	BN_free(bn_qy);
+	BN_free(bn_qx);
+	hygon_sm2_key_free(key);
+
+	return NULL;
+}
+
+void hygon_sm2_key_up_ref(hygon_sm2_key_t *key)
+{
+	__atomic_add_fetch(&key->refcount, 1, __ATOMIC_SEQ_CST);
+}
+
+void hygon_sm2_key_free(hygon_sm2_key_t *key)
+{
+	if (!key || __atomic_sub_fetch(&key->refcount, 1, __ATOMIC_SEQ_CST))
+		return;
+
+#ifdef HYGON_SM2_NATIVE
+	EVP_PKEY_free(key->pkey);
+#endif
+	EC_KEY_free(key->ec_key);
+	free(key);
+}
+
+/* The HRK, converted once */
+static hygon_sm2_key_t *hrk_key;
+static pthread_once_t hrk_key_once = PTHREAD_ONCE_INIT;
+
+static void hrk_key_init(void)
+{
+	hrk_key = hygon_sm2_key_new(&hrk_pubkey);
+}
+
+/* Compute e = SM3(Z || M), the digest actually signed */
+static int sm2_compute_e(const hygon_sm2_key_t *key, const uint8_t *msg, size_t msg_len,
+			 uint8_t *e)
+{
+	EVP_MD_CTX *hash = EVP_MD_CTX_new();
+	int ret = 0;
+
+	if (hash && EVP_DigestInit_ex(hash, EVP_sm3(), NULL) &&
+	    EVP_DigestUpdate(hash, key->z, sizeof(key->z)) &&
+	    EVP_DigestUpdate(hash, msg, msg_len) && EVP_DigestFinal_ex(hash, e, NULL))
+		ret = 1;
+
+	EVP_MD_CTX_free(hash);
+
+	return ret;
+}
+
+#ifdef HYGON_SM2_NATIVE
+static int sm2_verify_e(const hygon_sm2_key_t *key, const ECDSA_SIG *sig, const uint8_t *e)
+{
+	EVP_PKEY_CTX *ctx = NULL;
+	uint8_t *der = NULL;
+	int ret = -1;
+
+	int der_len = i2d_ECDSA_SIG(sig, &der);
+	if (der_len <= 0) {
+		RTLS_DEBUG("i2d_ECDSA_SIG() fail\n");
+		return -1;
+	}
+
+	if (!(ctx = EVP_PKEY_CTX_new(key->pkey, NULL)) || EVP_PKEY_verify_init(ctx) != 1) {
+		RTLS_DEBUG("EVP_PKEY_verify_init() fail\n");
+		goto err;
 	}
 
+	ret = EVP_PKEY_verify(ctx, der, der_len, e, SM3_DIGEST_LENGTH);
+err:
+	EVP_PKEY_CTX_free(ctx);
+	OPENSSL_free(der);
+	return ret;
+}
+#else
+static int sm2_verify_e(const hygon_sm2_key_t *key, const ECDSA_SIG *sig, const uint8_t *e)
+{
+	BIGNUM *bn_e = BN_bin2bn(e, SM3_DIGEST_LENGTH, NULL);
+	if (!bn_e)
+		return -1;
+
+	int ret = sm2_sig_verify(key->ec_key, sig, bn_e);
+	BN_free(bn_e);
+
+	return ret;
+}
+#endif
+
+/**
+ * Verify SM2 signature
+ *
+ * Params:
+ * 	key     [in]: SM2 public key
+ * 	msg     [in]: plain text
+ * 	msg_len [in]: plain text len
+ * 	sig     [in]: SM2 signature
+ * Return:
+ * 	1: success
+ * 	otherwise fail
+ */
+static int sm2_verify_sig(const hygon_sm2_key_t *key, const uint8_t *msg, size_t msg_len,
+			  const sm2_signature_t *sig)
+{
+	int ret = -1;
+	ECDSA_SIG *ecdsa_sig = NULL;
+	BIGNUM *bn_sig_r, *bn_sig_s;
+	uint8_t e[SM3_DIGEST_LENGTH];
+
 	// convert @sig to ECDSA_SIG
-	ret = -1;
 	if (!(bn_sig_r = BN_new())) {
 		RTLS_DEBUG("BN_new() bn_sig_r fail\n");
-		goto err_free_group;
+		return -1;
 	}
 	if (!(bn_sig_s = BN_new())) {
 		RTLS_DEBUG("BN_new() bn_sig_s fail\n");
@@ -852,41 +1031,53 @@ static int sm2_verify_sig(const sm2_pubkey_t *sm2_pubkey, const uint8_t *msg, si
 	}
 
 	// verify ECDSA_SIG
-	ret = sm2_do_verify(ec_key, EVP_sm3(), ecdsa_sig, user_id->uid, user_id->len, msg, msg_len);
+	ret = -1;
+	if (sm2_compute_e(key, msg, msg_len, e) != 1) {
+		RTLS_DEBUG("sm2_compute_e() fail\n");
+		goto err_free_ecdsa_sig;
+	}
+
+	ret = sm2_verify_e(key, ecdsa_sig, e);
 	if (ret != 1)
-		RTLS_DEBUG("sm2_do_verify() ret %d\n", ret);
+		RTLS_DEBUG("sm2_verify_e() ret %d\n", ret);
 
 err_free_ecdsa_sig:
 	// ECDSA_SIG_free will free bn_sig_r and bn_sig_s
 	ECDSA_SIG_free(ecdsa_sig);
-	goto err_free_group;
+	return ret;
 err_free_bn_sig_s:
 	BN_free(bn_sig_s);
 err_free_bn_sig_r:
 	BN_free(bn_sig_r);
-err_free_group:
-	EC_GROUP_free(group);
-err_free_bn_qy:
-	BN_free(bn_qy);
-err_free_bn_qx:
-	BN_free(bn_qx);
-err_free_ec_key:
-	EC_KEY_free(ec_key);
+
+	return ret;
+}
+
+/* Verify the SM2 signature @sig of @msg with the public key in cert @pubkey */
+static int sm2_verify_sig_by_pubkey(const hygon_pubkey_t *pubkey, const uint8_t *msg,
+				    size_t msg_len, const sm2_signature_t *sig)
+{
+	hygon_sm2_key_t *key = hygon_sm2_key_new(pubkey);
+	if (!key)
+		return -1;
+
+	int ret = sm2_verify_sig(key, msg, msg_len, sig);
+	hygon_sm2_key_free(key);
 
 	return ret;
 }
 
 static int verify_hsk_cert_signature(hygon_root_cert_t *hsk_cert)
 {
-	sm2_pubkey_t sm2_pubkey;
 	sm2_signature_t sm2_sig;
-	sm2_userid_t sm2_userid;
 
-	hygon_to_sm2_pubkey((hygon_pubkey_t *)&hrk_pubkey, &sm2_pubkey);
+	pthread_once(&hrk_key_once, hrk_key_init);
+	if (!hrk_key)
+		return -1;
+
 	hygon_to_sm2_signature((hygon_signature_t *)hsk_cert->signature, &sm2_sig);
-	hygon_to_sm2_userid((hygon_pubkey_t *)&hrk_pubkey, &sm2_userid);
 
-	return sm2_verify_sig(&sm2_pubkey, (uint8_t *)hsk_cert, 64 + 512, &sm2_userid, &sm2_sig);
+	return sm2_verify_sig(hrk_key, (uint8_t *)hsk_cert, 64 + 512, &sm2_sig);
 }
 
 /**
@@ -910,20 +1101,15 @@ int verify_hsk_cert(hygon_root_cert_t *cert)
 
 static int verify_cek_cert_signature(hygon_root_cert_t *hsk_cert, csv_cert_t *cek_cert)
 {
-	sm2_pubkey_t sm2_pubkey;
 	sm2_signature_t sm2_sig;
-	sm2_userid_t sm2_userid;
-
-	hygon_to_sm2_pubkey((hygon_pubkey_t *)hsk_cert->pubkey, &sm2_pubkey);
 
 	if (cek_cert->sig1_usage == KEY_USAGE_TYPE_INVALID)
 		hygon_to_sm2_signature((hygon_signature_t *)&cek_cert->ecc_sig2, &sm2_sig);
 	else
 		hygon_to_sm2_signature((hygon_signature_t *)&cek_cert->ecc_sig1, &sm2_sig);
 
-	hygon_to_sm2_userid((hygon_pubkey_t *)hsk_cert->pubkey, &sm2_userid);
-
-	return sm2_verify_sig(&sm2_pubkey, (uint8_t *)cek_cert, 16 + 1028, &sm2_userid, &sm2_sig);
+	return sm2_verify_sig_by_pubkey(&hsk_cert->ecc_pubkey, (uint8_t *)cek_cert, 16 + 1028,
+					&sm2_sig);
 }
 
 /**
@@ -956,17 +1142,33 @@ int verify_cek_cert(hygon_root_cert_t *hsk_cert, csv_cert_t *cek_cert)
 	return verify_cek_cert_signature(hsk_cert, cek_cert);
 }
 
-static int verify_pek_cert_signature(csv_cert_t *cek_cert, csv_cert_t *pek_cert)
+/**
+ * Verify PEK cert through the prepared CEK public key
+ *
+ * Params:
+ * 	cek_key  [in]: CEK public key from hygon_sm2_key_new()
+ * 	pek_cert [in]: PEK cert buffer
+ * Return:
+ * 	1: success
+ * 	otherwise fail
+ */
+int verify_pek_cert_by_key(const hygon_sm2_key_t *cek_key, csv_cert_t *pek_cert)
 {
-	sm2_pubkey_t sm2_pubkey;
 	sm2_signature_t sm2_sig;
-	sm2_userid_t sm2_userid;
 
-	hygon_to_sm2_pubkey((hygon_pubkey_t *)&cek_cert->sm2_pubkey, &sm2_pubkey);
+	if (pek_cert->pubkey_usage != KEY_USAGE_TYPE_PEK) {
+		RTLS_ERR("CSV: PEK cert public key usage type invalid\n");
+		return -1;
+	}
+
+	if (pek_cert->sig1_usage != KEY_USAGE_TYPE_CEK) {
+		RTLS_ERR("CSV: PEK cert sig 1 usage type invalid\n");
+		return -1;
+	}
+
 	hygon_to_sm2_signature((hygon_signature_t *)&pek_cert->ecc_sig1, &sm2_sig);
-	hygon_to_sm2_userid((hygon_pubkey_t *)&cek_cert->sm2_pubkey, &sm2_userid);
 
-	return sm2_verify_sig(&sm2_pubkey, (uint8_t *)pek_cert, 16 + 1028, &sm2_userid, &sm2_sig);
+	return sm2_verify_sig(cek_key, (uint8_t *)pek_cert, 16 + 1028, &sm2_sig);
 }
 
 /**
@@ -981,17 +1183,14 @@ static int verify_pek_cert_signature(csv_cert_t *cek_cert, csv_cert_t *pek_cert)
  */
 int verify_pek_cert(csv_cert_t *cek_cert, csv_cert_t *pek_cert)
 {
-	if (pek_cert->pubkey_usage != KEY_USAGE_TYPE_PEK) {
-		RTLS_ERR("CSV: PEK cert public key usage type invalid\n");
+	hygon_sm2_key_t *cek_key = hygon_sm2_key_new((hygon_pubkey_t *)&cek_cert->sm2_pubkey);
+	if (!cek_key)
 		return -1;
-	}
 
-	if (pek_cert->sig1_usage != KEY_USAGE_TYPE_CEK) {
-		RTLS_ERR("CSV: PEK cert sig 1 usage type invalid\n");
-		return -1;
-	}
+	int ret = verify_pek_cert_by_key(cek_key, pek_cert);
+	hygon_sm2_key_free(cek_key);
 
-	return verify_pek_cert_signature(cek_cert, pek_cert);
+	return ret;
 }
 
 /**
@@ -1006,15 +1205,11 @@ int verify_pek_cert(csv_cert_t *cek_cert, csv_cert_t *pek_cert)
  */
 int sm2_verify_attestation_report(csv_cert_t *pek_cert, csv_attestation_report *report)
 {
-	sm2_pubkey_t sm2_pubkey;
 	sm2_signature_t sm2_sig;
-	sm2_userid_t sm2_userid;
 
-	hygon_to_sm2_pubkey((hygon_pubkey_t *)&pek_cert->sm2_pubkey, &sm2_pubkey);
 	hygon_to_sm2_signature((hygon_signature_t *)&report->ecc_sig1, &sm2_sig);
-	hygon_to_sm2_userid((hygon_pubkey_t *)&pek_cert->sm2_pubkey, &sm2_userid);
 
-	return sm2_verify_sig(&sm2_pubkey,
-			      (uint8_t *)report + CSV_ATTESTATION_REPORT_SIGN_DATA_OFFSET,
-			      CSV_ATTESTATION_REPORT_SIGN_DATA_SIZE, &sm2_userid, &sm2_sig);
+	return sm2_verify_sig_by_pubkey((hygon_pubkey_t *)&pek_cert->sm2_pubkey,
+					(uint8_t *)report + CSV_ATTESTATION_REPORT_SIGN_DATA_OFFSET,
+					CSV_ATTESTATION_REPORT_SIGN_DATA_SIZE, &sm2_sig);
 }
@@ -86,9 +86,17 @@ typedef struct __attribute__((__packed__)) csv_cert {
 	hygon_csv_signature_t ecc_sig2;
 } csv_cert_t;
 
+/* An SM2 public key of a cert, converted once to verify many signatures */
+typedef struct hygon_sm2_key hygon_sm2_key_t;
+
+hygon_sm2_key_t *hygon_sm2_key_new(const hygon_pubkey_t *pubkey);
+void hygon_sm2_key_up_ref(hygon_sm2_key_t *key);
+void hygon_sm2_key_free(hygon_sm2_key_t *key);
+
 int verify_hsk_cert(hygon_root_cert_t *cert);
 int verify_cek_cert(hygon_root_cert_t *hsk_cert, csv_cert_t *cek_cert);
 int verify_pek_cert(csv_cert_t *cek_cert, csv_cert_t *pek_cert);
+int verify_pek_cert_by_key(const hygon_sm2_key_t *cek_key, csv_cert_t *pek_cert);
 int sm2_verify_attestation_report(csv_cert_t *pek_cert, csv_attestation_report *report);
 
 #endif /* _HYGONCERT_H_ */
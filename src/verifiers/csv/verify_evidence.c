@@ -10,15 +10,14 @@
 #include <rats-tls/verifier.h>
 #include <rats-tls/csv.h>
 #include "hygoncert.h"
+#include "cert_cache.h"
 
 static enclave_verifier_err_t verify_cert_chain(csv_evidence *evidence)
 {
-	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_INVALID;
+	enclave_verifier_err_t err;
 	csv_attestation_report *report = &evidence->attestation_report;
-
-	hygon_root_cert_t *hsk_cert = (hygon_root_cert_t *)evidence->hsk_cek_cert;
-	csv_cert_t *cek_cert = (csv_cert_t *)(&evidence->hsk_cek_cert[HYGON_CERT_SIZE]);
 	csv_cert_t *pek_cert = (csv_cert_t *)report->pek_cert;
+	hygon_sm2_key_t *cek_key;
 
 	assert(sizeof(hygon_root_cert_t) == HYGON_CERT_SIZE);
 	assert(sizeof(csv_cert_t) == HYGON_CSV_CERT_SIZE);
@@ -32,24 +31,17 @@ static enclave_verifier_err_t verify_cert_chain(csv_evidence *evidence)
 	for (i = 0; i < j; i++)
 		((uint32_t *)report->pek_cert)[i] ^= report->anonce;
 
-	/* Verify HSK cert with HRK */
-	if (verify_hsk_cert(hsk_cert) != 1) {
-		RTLS_ERR("failed to verify HSK cert\n");
-		return err;
-	}
-	RTLS_DEBUG("verify HSK cert successfully\n");
-
-	/* Verify CEK cert with HSK */
-	if (verify_cek_cert(hsk_cert, cek_cert) != 1) {
-		RTLS_ERR("failed to verify CEK cert\n");
+	/* Get the CEK of the chip, whose HSK and CEK certs are validated once */
+	err = csv_get_cek_key(report->chip_id, evidence->hsk_cek_cert, &cek_key);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
 		return err;
-	}
-	RTLS_DEBUG("verify CEK cert successfully\n");
 
 	/* Verigy PEK cert with CEK */
-	if (verify_pek_cert(cek_cert, pek_cert) != 1) {
+	int ret = verify_pek_cert_by_key(cek_key, pek_cert);
+	hygon_sm2_key_free(cek_key);
+	if (ret != 1) {
 		RTLS_ERR("failed to verify PEK cert\n");
-		return err;
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
 	}
 	RTLS_DEBUG("verify PEK cert successfully\n");
 
@@ -5,6 +5,7 @@
  */
 
 #include <string.h>
+#include <pthread.h>
 #include <rats-tls/err.h>
 #include <rats-tls/log.h>
 #include "internal/verifier.h"
@@ -26,21 +27,38 @@ static rats_tls_err_t init_enclave_verifier(rtls_core_context_t *ctx,
 	return RATS_TLS_ERR_NONE;
 }
 
+/* Guard the verifier instance tables of the handles, which are shared by
+ * the sessions of a handle negotiating concurrently.
+ */
+static pthread_mutex_t verifiers_lock = PTHREAD_MUTEX_INITIALIZER;
+
 rats_tls_err_t rtls_verifier_select(rtls_core_context_t *ctx, const char *name,
 				    rats_tls_cert_algo_t algo)
 {
 	RTLS_DEBUG("selecting the enclave verifier '%s' ...\n", name);
 
+	/* Reuse the verifier instances initialized for the identity */
+	rtls_core_context_t *identity = rtls_core_get_identity(ctx);
 	enclave_verifier_ctx_t *verifier_ctx = NULL;
+
+	pthread_mutex_lock(&verifiers_lock);
+
 	for (unsigned int i = 0; i < enclave_verifier_nums; ++i) {
 		RTLS_DEBUG("trying to match %s ...\n", enclave_verifiers_ctx[i]->opts->name);
 
 		if (name && strcmp(name, enclave_verifiers_ctx[i]->opts->name))
 			continue;
 
+		if (identity->verifiers[i]) {
+			verifier_ctx = identity->verifiers[i];
+			break;
+		}
+
 		verifier_ctx = malloc(sizeof(*verifier_ctx));
-		if (!verifier_ctx)
+		if (!verifier_ctx) {
+			pthread_mutex_unlock(&verifiers_lock);
 			return -RATS_TLS_ERR_NO_MEM;
+		}
 
 		memcpy(verifier_ctx, enclave_verifiers_ctx[i], sizeof(*verifier_ctx));
 
@@ -49,13 +67,17 @@ rats_tls_err_t rtls_verifier_select(rtls_core_context_t *ctx, const char *name,
 		 */
 		verifier_ctx->log_level = ctx->config.log_level;
 
-		if (init_enclave_verifier(ctx, verifier_ctx, algo) == RATS_TLS_ERR_NONE)
+		if (init_enclave_verifier(ctx, verifier_ctx, algo) == RATS_TLS_ERR_NONE) {
+			identity->verifiers[i] = verifier_ctx;
 			break;
+		}
 
 		free(verifier_ctx);
 		verifier_ctx = NULL;
 	}
 
+	pthread_mutex_unlock(&verifiers_lock);
+
 	if (!verifier_ctx) {
 		if (!name)
 			RTLS_ERR("failed to select an enclave verifier\n");
@@ -65,8 +87,10 @@ rats_tls_err_t rtls_verifier_select(rtls_core_context_t *ctx, const char *name,
 		return -RATS_TLS_ERR_INVALID;
 	}
 
-	/* Explicitly specify the enclave verifier which will never be changed */
-	if (name)
+	/* Explicitly specify the enclave verifier which will never be changed,
+	 * unlike the verifiers switched to according to the evidence type.
+	 */
+	if (name && !ctx->verifier)
 		ctx->flags |= RATS_TLS_CONF_FLAGS_VERIFIER_ENFORCED;
 
 	ctx->verifier = verifier_ctx;
@@ -75,3 +99,22 @@ rats_tls_err_t rtls_verifier_select(rtls_core_context_t *ctx, const char *name,
 
 	return RATS_TLS_ERR_NONE;
 }
+
+void rtls_verifier_cleanup_all(rtls_core_context_t *ctx)
+{
+	for (unsigned int i = 0; i < ENCLAVE_VERIFIER_TYPE_MAX; ++i) {
+		enclave_verifier_ctx_t *verifier_ctx = ctx->verifiers[i];
+		if (!verifier_ctx)
+			continue;
+
+		enclave_verifier_err_t err = verifier_ctx->opts->cleanup(verifier_ctx);
+		if (err != ENCLAVE_VERIFIER_ERR_NONE)
+			RTLS_DEBUG("failed to clean up verifier '%s' %#x\n",
+				   verifier_ctx->opts->name, err);
+
+		free(verifier_ctx);
+		ctx->verifiers[i] = NULL;
+	}
+
+	ctx->verifier = NULL;
+}
@@ -0,0 +1,364 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+#include <rats-tls/log.h>
+#include "x509cert.h"
+#include "kds.h"
+#include "cert_cache.h"
+
+/* The ARK and ASK of a product line, kept once the ASK is validated by the ARK */
+typedef struct {
+	const char *name;
+	X509 *ark;
+	X509 *ask;
+} snp_product_t;
+
+static snp_product_t products[] = {
+	{ .name = "Milan" },
+	{ .name = "Genoa" },
+};
+
+#define NR_PRODUCTS (sizeof(products) / sizeof(products[0]))
+
+/* The public key of a VCEK, kept once the VCEK is validated by the ASK */
+typedef struct {
+	uint8_t chip_id[sizeof(((snp_attestation_report_t *)0)->chip_id)];
+	uint64_t tcb;
+	EVP_PKEY *key;
+	uint64_t last_used;
+} vcek_entry_t;
+
+static vcek_entry_t vceks[SEV_SNP_VCEK_CACHE_SIZE];
+static uint64_t vcek_clock;
+/* The product line of the last chip seen, tried first for an unknown chip */
+static unsigned int last_product;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static X509 *pinned_arks[SEV_SNP_PINNED_ARKS_MAX];
+static unsigned int nr_pinned_arks;
+static pthread_once_t pinned_arks_once = PTHREAD_ONCE_INIT;
+
+/* Return the index of the product line of the chip, or -1 if unknown */
+static int product_of_report(const snp_attestation_report_t *report)
+{
+	const char *name = getenv(SEV_SNP_PRODUCT_ENV);
+
+	if (name) {
+		for (unsigned int i = 0; i < NR_PRODUCTS; ++i) {
+			if (!strcasecmp(name, products[i].name))
+				return (int)i;
+		}
+		RTLS_WARN("unknown product line '%s'\n", name);
+	}
+
+	/* Only the reports of version 3 onwards carry the CPUID of the chip */
+	if (report->version < 3 || report->cpuid_fam_id != 0x19)
+		return -1;
+
+	if (report->cpuid_mod_id <= 0x0f)
+		return 0;
+	if ((report->cpuid_mod_id >= 0x10 && report->cpuid_mod_id <= 0x1f) ||
+	    (report->cpuid_mod_id >= 0xa0 && report->cpuid_mod_id <= 0xaf))
+		return 1;
+
+	return -1;
+}
+
+/* Get the ARK and ASK of the product line, which are never released once set */
+static enclave_verifier_err_t get_cert_chain(snp_product_t *product, X509 **ark, X509 **ask)
+{
+	pthread_mutex_lock(&cache_lock);
+	*ark = product->ark;
+	*ask = product->ask;
+	pthread_mutex_unlock(&cache_lock);
+
+	if (*ark)
+		return ENCLAVE_VERIFIER_ERR_NONE;
+
+	X509 *new_ark, *new_ask;
+	enclave_verifier_err_t err = sev_snp_kds_get_cert_chain(product->name, &new_ark, &new_ask);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	/* Verify the ARK self-signed the ARK and the ASK signed by ARK */
+	if (!x509_validate_signature(new_ark, NULL, new_ark) ||
+	    !x509_validate_signature(new_ask, NULL, new_ark)) {
+		RTLS_ERR("failed to validate the cert chain of %s\n", product->name);
+		X509_free(new_ark);
+		X509_free(new_ask);
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+	if (!product->ark) {
+		product->ark = new_ark;
+		product->ask = new_ask;
+		new_ark = new_ask = NULL;
+	}
+	*ark = product->ark;
+	*ask = product->ask;
+	pthread_mutex_unlock(&cache_lock);
+
+	X509_free(new_ark);
+	X509_free(new_ask);
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+/* Fetch the VCEK of the chip from the KDS and validate it by the ASK of its product line */
+static enclave_verifier_err_t fetch_vcek_key(const snp_attestation_report_t *report,
+					     unsigned int *product_index, EVP_PKEY **vcek_key)
+{
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_COLLATERAL;
+	int product = product_of_report(report);
+
+	pthread_mutex_lock(&cache_lock);
+	unsigned int first = product >= 0 ? (unsigned int)product : last_product;
+	pthread_mutex_unlock(&cache_lock);
+
+	for (unsigned int n = 0; n < NR_PRODUCTS; ++n) {
+		unsigned int i = (first + n) % NR_PRODUCTS;
+		X509 *ark, *ask, *vcek;
+
+		/* A known product line is not worth guessing */
+		if (product >= 0 && n)
+			break;
+
+		if (sev_snp_kds_get_vcek(products[i].name, report->chip_id,
+					 sizeof(report->chip_id), &report->platform_version,
+					 &vcek) != ENCLAVE_VERIFIER_ERR_NONE)
+			continue;
+
+		err = get_cert_chain(&products[i], &ark, &ask);
+		if (err != ENCLAVE_VERIFIER_ERR_NONE) {
+			X509_free(vcek);
+			return err;
+		}
+
+		/* Verify the VCEK signed by ASK */
+		if (!x509_validate_signature(vcek, ask, ark)) {
+			RTLS_ERR("failed to validate signature of x509_vcek cert\n");
+			X509_free(vcek);
+			return -ENCLAVE_VERIFIER_ERR_INVALID;
+		}
+
+		*vcek_key = X509_get_pubkey(vcek);
+		X509_free(vcek);
+		if (!*vcek_key)
+			return -ENCLAVE_VERIFIER_ERR_INVALID;
+
+		*product_index = i;
+		return ENCLAVE_VERIFIER_ERR_NONE;
+	}
+
+	RTLS_ERR("failed to get the VCEK of the chip from the KDS\n");
+	return err;
+}
+
+static void load_pinned_arks(void)
+{
+	const char *path = getenv(SEV_SNP_ARK_ENV);
+	if (!path)
+		return;
+
+	FILE *fp = fopen(path, "r");
+	if (!fp) {
+		RTLS_ERR("failed to open %s\n", path);
+		return;
+	}
+
+	X509 *ark;
+	while (nr_pinned_arks < SEV_SNP_PINNED_ARKS_MAX &&
+	       (ark = PEM_read_X509(fp, NULL, NULL, NULL))) {
+		/* Verify the ARK self-signed */
+		if (!x509_validate_signature(ark, NULL, ark)) {
+			RTLS_ERR("failed to validate the ARK pinned by %s\n", path);
+			X509_free(ark);
+			continue;
+		}
+		pinned_arks[nr_pinned_arks++] = ark;
+	}
+	fclose(fp);
+
+	RTLS_DEBUG("%u ARKs pinned by %s\n", nr_pinned_arks, path);
+}
+
+/* Check that @ark is the ARK of a product line, without any access to the KDS once
+ * the chain of the product line is cached or when the ARKs are pinned
+ */
+static bool ark_is_trusted(X509 *ark, const snp_attestation_report_t *report)
+{
+	pthread_once(&pinned_arks_once, load_pinned_arks);
+	if (getenv(SEV_SNP_ARK_ENV)) {
+		for (unsigned int i = 0; i < nr_pinned_arks; ++i) {
+			if (!X509_cmp(ark, pinned_arks[i]))
+				return true;
+		}
+		return false;
+	}
+
+	int product = product_of_report(report);
+
+	pthread_mutex_lock(&cache_lock);
+	unsigned int first = product >= 0 ? (unsigned int)product : last_product;
+	pthread_mutex_unlock(&cache_lock);
+
+	for (unsigned int n = 0; n < NR_PRODUCTS; ++n) {
+		unsigned int i = (first + n) % NR_PRODUCTS;
+		X509 *product_ark, *product_ask;
+
+		if (product >= 0 && n)
+			break;
+
+		if (get_cert_chain(&products[i], &product_ark, &product_ask) ==
+			    ENCLAVE_VERIFIER_ERR_NONE &&
+		    !X509_cmp(ark, product_ark))
+			return true;
+	}
+
+	return false;
+}
+
+static X509 *d2i_cert(const uint8_t *der, uint32_t der_size)
+{
+	const uint8_t *p = der;
+
+	return der ? d2i_X509(NULL, &p, (long)der_size) : NULL;
+}
+
+/* Validate the VCEK chain provided by the host of the peer, so that the KDS is not involved */
+static enclave_verifier_err_t vcek_key_of_collateral(const snp_attestation_report_t *report,
+						     const snp_attestation_collateral_t *collateral,
+						     EVP_PKEY **vcek_key)
+{
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_INVALID;
+	X509 *vcek = d2i_cert(collateral->vcek, collateral->vcek_size);
+	X509 *ask = d2i_cert(collateral->ask, collateral->ask_size);
+	X509 *ark = d2i_cert(collateral->ark, collateral->ark_size);
+
+	if (!vcek || !ask || !ark) {
+		RTLS_ERR("failed to parse the VCEK chain in the endorsements\n");
+		goto err;
+	}
+
+	if (!ark_is_trusted(ark, report)) {
+		RTLS_ERR("untrusted ARK in the endorsements\n");
+		goto err;
+	}
+
+	/* Verify the ASK signed by ARK and the VCEK signed by ASK */
+	if (!x509_validate_signature(ask, NULL, ark) || !x509_validate_signature(vcek, ask, ark)) {
+		RTLS_ERR("failed to validate the VCEK chain in the endorsements\n");
+		goto err;
+	}
+
+	/* The VCEK is cached by the chip and TCB of the report */
+	if (!x509_vcek_matches(vcek, report->chip_id, sizeof(report->chip_id),
+			       &report->platform_version))
+		goto err;
+
+	*vcek_key = X509_get_pubkey(vcek);
+	if (*vcek_key)
+		err = ENCLAVE_VERIFIER_ERR_NONE;
+err:
+	X509_free(vcek);
+	X509_free(ask);
+	X509_free(ark);
+	return err;
+}
+
+/* Must be called with the lock held */
+static vcek_entry_t *vcek_find(const snp_attestation_report_t *report)
+{
+	for (unsigned int i = 0; i < SEV_SNP_VCEK_CACHE_SIZE; ++i) {
+		vcek_entry_t *entry = &vceks[i];
+
+		if (entry->key && entry->tcb == report->platform_version.val &&
+		    !memcmp(entry->chip_id, report->chip_id, sizeof(entry->chip_id)))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* Must be called with the lock held */
+static vcek_entry_t *vcek_victim(void)
+{
+	vcek_entry_t *victim = &vceks[0];
+
+	for (unsigned int i = 0; i < SEV_SNP_VCEK_CACHE_SIZE; ++i) {
+		if (!vceks[i].key)
+			return &vceks[i];
+		if (vceks[i].last_used < victim->last_used)
+			victim = &vceks[i];
+	}
+
+	return victim;
+}
+
+/* Return a reference to the public key of the VCEK of the chip and TCB of
+ * the report, so that only the signature of the report is left to verify.
+ * The VCEK comes from @collateral if provided and valid, otherwise from the KDS.
+ * The caller must release it with EVP_PKEY_free().
+ */
+enclave_verifier_err_t sev_snp_get_vcek_key(const snp_attestation_report_t *report,
+					    const snp_attestation_collateral_t *collateral,
+					    EVP_PKEY **vcek_key)
+{
+	pthread_mutex_lock(&cache_lock);
+	vcek_entry_t *entry = vcek_find(report);
+	if (entry) {
+		entry->last_used = ++vcek_clock;
+		EVP_PKEY_up_ref(entry->key);
+		*vcek_key = entry->key;
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	if (entry)
+		return ENCLAVE_VERIFIER_ERR_NONE;
+
+	unsigned int product = NR_PRODUCTS;
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_INVALID;
+	if (collateral && collateral->vcek)
+		err = vcek_key_of_collateral(report, collateral, vcek_key);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE) {
+		if (collateral && collateral->vcek)
+			RTLS_WARN("fall back to the KDS for the VCEK\n");
+
+		err = fetch_vcek_key(report, &product, vcek_key);
+		if (err != ENCLAVE_VERIFIER_ERR_NONE)
+			return err;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+	if (product < NR_PRODUCTS)
+		last_product = product;
+	/* Another thread may have fetched the same VCEK meanwhile */
+	entry = vcek_find(report);
+	if (!entry) {
+		entry = vcek_victim();
+		EVP_PKEY_free(entry->key);
+		memcpy(entry->chip_id, report->chip_id, sizeof(entry->chip_id));
+		entry->tcb = report->platform_version.val;
+		entry->key = *vcek_key;
+		EVP_PKEY_up_ref(entry->key);
+	}
+	entry->last_used = ++vcek_clock;
+	pthread_mutex_unlock(&cache_lock);
+
+	if (product < NR_PRODUCTS)
+		RTLS_DEBUG("cache the VCEK of the %s chip\n", products[product].name);
+	else
+		RTLS_DEBUG("cache the VCEK of the chip from the endorsements\n");
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
@@ -0,0 +1,33 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _CERT_CACHE_H
+#define _CERT_CACHE_H
+
+#include <openssl/evp.h>
+#include <rats-tls/verifier.h>
+#include <rats-tls/endorsement.h>
+#include "../../attesters/sev-snp/sev_snp.h"
+
+/* Name of the product line of the chips, e.g. Milan, when it cannot be told from the report */
+#define SEV_SNP_PRODUCT_ENV "RATS_TLS_SNP_PRODUCT"
+
+/* PEM file of the ARKs trusted to root the VCEK chains provided by the hosts, otherwise
+ * the ARKs served by the KDS
+ */
+#define SEV_SNP_ARK_ENV "RATS_TLS_SNP_ARK"
+
+/* Maximum number of ARKs pinned by SEV_SNP_ARK_ENV */
+#define SEV_SNP_PINNED_ARKS_MAX 4
+
+/* Number of VCEKs kept, one per chip and TCB */
+#define SEV_SNP_VCEK_CACHE_SIZE 16
+
+enclave_verifier_err_t sev_snp_get_vcek_key(const snp_attestation_report_t *report,
+					    const snp_attestation_collateral_t *collateral,
+					    EVP_PKEY **vcek_key);
+
+#endif /* _CERT_CACHE_H */
@@ -0,0 +1,196 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include <openssl/bio.h>
+#include <openssl/pem.h>
+#include <rats-tls/log.h>
+#include "kds.h"
+#include "utils.h"
+
+typedef struct {
+	uint8_t *body;
+	size_t body_size;
+} kds_response_t;
+
+/* Reused across requests to keep the connection to the KDS alive. kds_lock only
+ * guards the handle, a request in flight holds it alone and others make their own.
+ */
+static CURL *kds_curl;
+static pthread_mutex_t kds_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t kds_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+	kds_response_t *response = userp;
+	size_t len = size * nmemb;
+
+	uint8_t *body = realloc(response->body, response->body_size + len);
+	if (!body)
+		return 0;
+
+	memcpy(body + response->body_size, contents, len);
+	response->body = body;
+	response->body_size += len;
+
+	return len;
+}
+
+/* Take the shared curl handle, or make another one if it is in use */
+static CURL *kds_curl_get(void)
+{
+	pthread_mutex_lock(&kds_lock);
+	CURL *curl = kds_curl;
+	kds_curl = NULL;
+	pthread_mutex_unlock(&kds_lock);
+
+	if (curl)
+		return curl;
+
+	curl = curl_easy_init();
+	if (!curl)
+		return NULL;
+
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+
+	return curl;
+}
+
+/* Give the handle back to be shared, unless another one was given back meanwhile */
+static void kds_curl_put(CURL *curl)
+{
+	pthread_mutex_lock(&kds_lock);
+	if (!kds_curl) {
+		kds_curl = curl;
+		curl = NULL;
+	}
+	pthread_mutex_unlock(&kds_lock);
+
+	curl_easy_cleanup(curl);
+}
+
+/* Get @path relative to the VCEK API of the KDS, e.g. Milan/cert_chain */
+static enclave_verifier_err_t kds_get(const char *path, uint8_t **body, size_t *body_size)
+{
+	kds_response_t response = { 0 };
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_COLLATERAL;
+	char url[512];
+	long status = 0;
+
+	const char *site = getenv(SEV_SNP_KDS_URL_ENV);
+	if (!site)
+		site = KDS_CERT_SITE;
+	snprintf(url, sizeof(url), "%s" KDS_VCEK_API "%s", site, path);
+
+	CURL *curl = kds_curl_get();
+	if (!curl) {
+		RTLS_ERR("failed to init curl\n");
+		return err;
+	}
+
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, kds_write_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
+
+	CURLcode curl_ret = curl_easy_perform(curl);
+	if (curl_ret != CURLE_OK) {
+		RTLS_ERR("failed to get %s: %s\n", url, curl_easy_strerror(curl_ret));
+		goto err;
+	}
+
+	curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+	if (status != 200 || !response.body) {
+		/* The KDS answers with an error to a chip of another product line */
+		RTLS_DEBUG("failed to get %s: HTTP status %ld\n", url, status);
+		goto err;
+	}
+
+	*body = response.body;
+	*body_size = response.body_size;
+	response.body = NULL;
+
+	RTLS_DEBUG("got %s\n", url);
+	err = ENCLAVE_VERIFIER_ERR_NONE;
+err:
+	kds_curl_put(curl);
+	free(response.body);
+	return err;
+}
+
+enclave_verifier_err_t sev_snp_kds_get_vcek(const char *product, const uint8_t *chip_id,
+					    size_t chip_id_size, const snp_tcb_version_t *tcb,
+					    X509 **vcek)
+{
+	char path[256];
+	uint8_t *der = NULL;
+	size_t der_size;
+
+	int count = snprintf(path, sizeof(path), "%s/", product);
+	for (size_t i = 0; i < chip_id_size && count < (int)sizeof(path); ++i)
+		count += snprintf(path + count, sizeof(path) - count, "%02x", chip_id[i]);
+	snprintf(path + count, sizeof(path) - count,
+		 "?blSPL=%02u&teeSPL=%02u&snpSPL=%02u&ucodeSPL=%02u", (unsigned)tcb->f.boot_loader,
+		 (unsigned)tcb->f.tee, (unsigned)tcb->f.snp, (unsigned)tcb->f.microcode);
+
+	enclave_verifier_err_t err = kds_get(path, &der, &der_size);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	/* The VCEK is served in DER */
+	const uint8_t *p = der;
+	*vcek = d2i_X509(NULL, &p, (long)der_size);
+	free(der);
+	if (!*vcek) {
+		RTLS_ERR("failed to parse the VCEK of %s\n", product);
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+enclave_verifier_err_t sev_snp_kds_get_cert_chain(const char *product, X509 **ark, X509 **ask)
+{
+	char path[64];
+	uint8_t *pem = NULL;
+	size_t pem_size;
+
+	snprintf(path, sizeof(path), "%s/%s", product, KDS_VCEK_CERT_CHAIN);
+	enclave_verifier_err_t err = kds_get(path, &pem, &pem_size);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	err = -ENCLAVE_VERIFIER_ERR_INVALID;
+	*ark = *ask = NULL;
+
+	BIO *bio = BIO_new_mem_buf(pem, (int)pem_size);
+	if (!bio) {
+		err = -ENCLAVE_VERIFIER_ERR_NO_MEM;
+		goto err;
+	}
+
+	/* The chain is made of the ASK followed by the ARK */
+	*ask = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+	*ark = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+	if (!*ask || !*ark) {
+		RTLS_ERR("failed to parse the cert chain of %s\n", product);
+		X509_free(*ask);
+		X509_free(*ark);
+		*ark = *ask = NULL;
+		goto err;
+	}
+
+	err = ENCLAVE_VERIFIER_ERR_NONE;
+err:
+	BIO_free(bio);
+	free(pem);
+	return err;
+}
@@ -0,0 +1,24 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _KDS_H
+#define _KDS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/x509.h>
+#include <rats-tls/verifier.h>
+#include "../../attesters/sev-snp/sev_snp.h"
+
+/* Base URL of the AMD Key Distribution Service, overridden e.g. by a local mirror */
+#define SEV_SNP_KDS_URL_ENV "RATS_TLS_SNP_KDS_URL"
+
+enclave_verifier_err_t sev_snp_kds_get_vcek(const char *product, const uint8_t *chip_id,
+					    size_t chip_id_size, const snp_tcb_version_t *tcb,
+					    X509 **vcek);
+enclave_verifier_err_t sev_snp_kds_get_cert_chain(const char *product, X509 **ark, X509 **ask);
+
+#endif /* _KDS_H */
@@ -4,9 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <stdio.h>
+#include <string.h>
 #include <openssl/bn.h>
-#include <openssl/pem.h>
 #include <openssl/ssl.h>
 #include <openssl/ossl_typ.h>
 #include <openssl/x509.h>
@@ -15,42 +14,6 @@
 #include "x509cert.h"
 #include "utils.h"
 
-int convert_der_to_pem(char *in_file_name, char *out_file_name)
-{
-	char cmdline_str[200] = {
-		0,
-	};
-
-	int count = snprintf(cmdline_str, sizeof(cmdline_str),
-			     "openssl x509 -inform der -in %s -out %s", in_file_name,
-			     out_file_name);
-	cmdline_str[count] = '\0';
-
-	if (system(cmdline_str) != 0)
-		return -1;
-
-	return 0;
-}
-
-bool read_pem_into_x509(char *file_name, X509 **x509_cert)
-{
-	FILE *pFile = NULL;
-	pFile = fopen(file_name, "re");
-	if (!pFile)
-		return false;
-
-	*x509_cert = PEM_read_X509(pFile, NULL, NULL, NULL);
-	if (!x509_cert) {
-		RTLS_ERR("failed to read x509 from file: %s\n", file_name);
-		fclose(pFile);
-		return false;
-	}
-
-	fclose(pFile);
-
-	return true;
-}
-
 bool x509_validate_signature(X509 *child_cert, X509 *intermediate_cert, X509 *parent_cert)
 {
 	bool ret = false;
@@ -112,3 +75,72 @@ err:
 
 	return ret;
 }
+
+/* Get the value of the extension @oid of @cert */
+static const ASN1_OCTET_STRING *x509_get_ext_data(X509 *cert, const char *oid)
+{
+	ASN1_OBJECT *obj = OBJ_txt2obj(oid, 1);
+	if (!obj)
+		return NULL;
+
+	int index = X509_get_ext_by_OBJ(cert, obj, -1);
+	ASN1_OBJECT_free(obj);
+	if (index < 0)
+		return NULL;
+
+	return X509_EXTENSION_get_data(X509_get_ext(cert, index));
+}
+
+static bool x509_ext_int_equals(X509 *cert, const char *oid, long value)
+{
+	const ASN1_OCTET_STRING *data = x509_get_ext_data(cert, oid);
+	if (!data)
+		return false;
+
+	const unsigned char *p = ASN1_STRING_get0_data(data);
+	ASN1_INTEGER *integer = d2i_ASN1_INTEGER(NULL, &p, ASN1_STRING_length(data));
+	if (!integer)
+		return false;
+
+	bool ret = ASN1_INTEGER_get(integer) == value;
+	ASN1_INTEGER_free(integer);
+
+	return ret;
+}
+
+/* Check that the VCEK was issued for the chip @chip_id at the TCB @tcb */
+bool x509_vcek_matches(X509 *vcek, const uint8_t *chip_id, size_t chip_id_size,
+		       const snp_tcb_version_t *tcb)
+{
+	const ASN1_OCTET_STRING *hwid = x509_get_ext_data(vcek, SNP_VCEK_OID_HWID);
+	if (!hwid) {
+		RTLS_ERR("no hwID in the VCEK\n");
+		return false;
+	}
+
+	/* The hwID is the raw ChipId, or the ChipId wrapped in an octet string */
+	const unsigned char *p = ASN1_STRING_get0_data(hwid);
+	int len = ASN1_STRING_length(hwid);
+	bool ret = len == (int)chip_id_size && !memcmp(p, chip_id, chip_id_size);
+	if (!ret) {
+		ASN1_OCTET_STRING *wrapped = d2i_ASN1_OCTET_STRING(NULL, &p, len);
+
+		ret = wrapped && ASN1_STRING_length(wrapped) == (int)chip_id_size &&
+		      !memcmp(ASN1_STRING_get0_data(wrapped), chip_id, chip_id_size);
+		ASN1_OCTET_STRING_free(wrapped);
+	}
+	if (!ret) {
+		RTLS_ERR("the VCEK is not issued for the chip\n");
+		return false;
+	}
+
+	if (!x509_ext_int_equals(vcek, SNP_VCEK_OID_BL_SPL, tcb->f.boot_loader) ||
+	    !x509_ext_int_equals(vcek, SNP_VCEK_OID_TEE_SPL, tcb->f.tee) ||
+	    !x509_ext_int_equals(vcek, SNP_VCEK_OID_SNP_SPL, tcb->f.snp) ||
+	    !x509_ext_int_equals(vcek, SNP_VCEK_OID_UCODE_SPL, tcb->f.microcode)) {
+		RTLS_ERR("the VCEK is not issued for the TCB\n");
+		return false;
+	}
+
+	return true;
+}
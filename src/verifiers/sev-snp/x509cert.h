@@ -8,9 +8,18 @@
 #define _X509CERT_H
 
 #include <stdbool.h>
+#include <openssl/x509.h>
+#include "../../attesters/sev-snp/sev_snp.h"
+
+/* The extensions of the VCEK naming its chip and TCB */
+#define SNP_VCEK_OID_BL_SPL    "1.3.6.1.4.1.3704.1.3.1"
+#define SNP_VCEK_OID_TEE_SPL   "1.3.6.1.4.1.3704.1.3.2"
+#define SNP_VCEK_OID_SNP_SPL   "1.3.6.1.4.1.3704.1.3.3"
+#define SNP_VCEK_OID_UCODE_SPL "1.3.6.1.4.1.3704.1.3.8"
+#define SNP_VCEK_OID_HWID      "1.3.6.1.4.1.3704.1.4"
 
-int convert_der_to_pem(char *in_file_name, char *out_file_name);
-bool read_pem_into_x509(char *file_name, X509 **x509_cert);
 bool x509_validate_signature(X509 *child_cert, X509 *intermediate_cert, X509 *parent_cert);
+bool x509_vcek_matches(X509 *vcek, const uint8_t *chip_id, size_t chip_id_size,
+		       const snp_tcb_version_t *tcb);
 
 #endif /* _X509CERT_H */
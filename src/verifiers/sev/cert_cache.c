@@ -0,0 +1,314 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <openssl/sha.h>
+#include <rats-tls/log.h>
+#include "sev_utils.h"
+#include "amdcert.h"
+#include "sevcert.h"
+#include "cert_cache.h"
+
+/* The ARK and ASK of a device type, kept once validated */
+typedef struct {
+	bool valid;
+	sev_cert ask_pub_key;
+	EVP_PKEY *ask_key;
+} sev_ark_ask_t;
+
+static sev_ark_ask_t ark_asks[PSP_DEVICE_TYPE_INVALID];
+
+/* The public key of a PEK, kept once its chain up to the ASK is validated */
+typedef struct {
+	/* Digest of the device type and of the CEK, PEK and OCA */
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+	EVP_PKEY *pek_key;
+	uint64_t last_used;
+} sev_chain_entry_t;
+
+static sev_chain_entry_t chains[SEV_CHAIN_CACHE_SIZE];
+static uint64_t chain_clock;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int generate_ark_ask_cert(amd_cert *ask_cert, amd_cert *ark_cert,
+				 enum ePSP_DEVICE_TYPE device_type)
+{
+	char *ark_ask_cert_patch;
+	char *default_dir = NULL;
+	char *url = NULL;
+
+	switch (device_type) {
+	case PSP_DEVICE_TYPE_NAPLES:
+		default_dir = SEV_NAPLES_DEFAULT_DIR;
+		ark_ask_cert_patch = SEV_NAPLES_DEFAULT_DIR ASK_ARK_FILENAME;
+		url = ASK_ARK_NAPLES_SITE;
+		break;
+	case PSP_DEVICE_TYPE_ROME:
+		default_dir = SEV_ROME_DEFAULT_DIR;
+		ark_ask_cert_patch = SEV_ROME_DEFAULT_DIR ASK_ARK_FILENAME;
+		url = ASK_ARK_ROME_SITE;
+		break;
+	case PSP_DEVICE_TYPE_MILAN:
+		default_dir = SEV_MILAN_DEFAULT_DIR;
+		ark_ask_cert_patch = SEV_MILAN_DEFAULT_DIR ASK_ARK_FILENAME;
+		url = ASK_ARK_MILAN_SITE;
+		break;
+	default:
+		RTLS_ERR("unsupported device type %d\n", device_type);
+		return -1;
+	}
+
+	char cmdline_str[200] = {
+		0,
+	};
+	int count = 0;
+
+	if ((mkdir(SEV_DEFAULT_DIR, S_IRWXU) == -1 && errno != EEXIST) ||
+	    (mkdir(default_dir, S_IRWXU) == -1 && errno != EEXIST)) {
+		RTLS_ERR("failed to mkdir %s\n", default_dir);
+		return -1;
+	}
+
+	count = snprintf(cmdline_str, sizeof(cmdline_str), "wget --no-proxy -O %s %s",
+			 ark_ask_cert_patch, url);
+	cmdline_str[count] = '\0';
+
+	/* Don't re-download the ASK/ARK from the KDS server if you already have it */
+	if (get_file_size(ark_ask_cert_patch) == 0) {
+		if (system(cmdline_str) != 0) {
+			RTLS_ERR("failed to download %s\n", ark_ask_cert_patch);
+			return -1;
+		}
+	}
+
+	/* Read in the ask_ark so we can split it into 2 separate cert files */
+	uint8_t ask_ark_buf[sizeof(amd_cert) * 2] = { 0 };
+	if (read_file(ark_ask_cert_patch, ask_ark_buf, sizeof(ask_ark_buf)) !=
+	    sizeof(ask_ark_buf)) {
+		RTLS_ERR("read %s fail\n", ark_ask_cert_patch);
+		return -1;
+	}
+
+	/* Initialize the ASK */
+	if (amd_cert_init(ask_cert, ask_ark_buf) != 0) {
+		RTLS_ERR("failed to initialize ASK certificate\n");
+		return -1;
+	}
+
+	/* Initialize the ARK */
+	size_t ask_size = amd_cert_get_size(ask_cert);
+	if (amd_cert_init(ark_cert, (uint8_t *)(ask_ark_buf + ask_size)) != 0) {
+		RTLS_ERR("failed to initialize ASK certificate\n");
+		return -1;
+	}
+
+	/* Check the usage of the ASK and ARK */
+	if (ask_cert->key_usage != AMD_USAGE_ASK || ark_cert->key_usage != AMD_USAGE_ARK) {
+		RTLS_ERR("certificate Usage %d did not match expected value %d\n",
+			 ask_cert->key_usage, AMD_USAGE_ASK);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Load and validate the ARK and ASK of @device_type, and compile the public key of the ASK */
+static enclave_verifier_err_t load_ark_ask(enum ePSP_DEVICE_TYPE device_type,
+					   sev_ark_ask_t *ark_ask)
+{
+	amd_cert ask_cert;
+	amd_cert ark_cert;
+
+	/* The ARK and ASK are downloaded from the KDS unless already stored */
+	if (generate_ark_ask_cert(&ask_cert, &ark_cert, device_type) == -1) {
+		RTLS_ERR("failed to load ASK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_COLLATERAL;
+	}
+
+	/* Verify ARK cert with ARK */
+	if (!amd_cert_validate_ark(&ark_cert, device_type)) {
+		RTLS_ERR("failed to verify ARK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_INFO("verify ARK cert successfully\n");
+
+	/* Verify ASK cert with ARK */
+	if (!amd_cert_validate_ask(&ask_cert, &ark_cert, device_type)) {
+		RTLS_ERR("failed to verify ASK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_INFO("verify ASK cert successfully\n");
+
+	if (amd_cert_export_pub_key(&ask_cert, &ark_ask->ask_pub_key) != 0) {
+		RTLS_ERR("failed to export pub key from ask\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	ark_ask->ask_key = sev_cert_get_pub_key(&ark_ask->ask_pub_key);
+	if (!ark_ask->ask_key)
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+
+	ark_ask->valid = true;
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+/* Return the validated ASK of @device_type, which is never released once set */
+static enclave_verifier_err_t get_ask(enum ePSP_DEVICE_TYPE device_type,
+				      const sev_ark_ask_t **ask)
+{
+	if (device_type >= PSP_DEVICE_TYPE_INVALID) {
+		RTLS_ERR("unsupported device type %d\n", device_type);
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	sev_ark_ask_t *cached = &ark_asks[device_type];
+
+	pthread_mutex_lock(&cache_lock);
+	bool valid = cached->valid;
+	pthread_mutex_unlock(&cache_lock);
+
+	if (!valid) {
+		sev_ark_ask_t ark_ask = { 0 };
+
+		enclave_verifier_err_t err = load_ark_ask(device_type, &ark_ask);
+		if (err != ENCLAVE_VERIFIER_ERR_NONE)
+			return err;
+
+		pthread_mutex_lock(&cache_lock);
+		if (!cached->valid) {
+			*cached = ark_ask;
+			ark_ask.ask_key = NULL;
+		}
+		pthread_mutex_unlock(&cache_lock);
+
+		EVP_PKEY_free(ark_ask.ask_key);
+	}
+
+	*ask = cached;
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+/* Validate the CEK by the ASK and the PEK by the CEK and OCA, and compile the public key
+ * of the PEK.
+ */
+static enclave_verifier_err_t validate_cert_chain(const sev_evidence_t *sev_evidence,
+						  EVP_PKEY **pek_key)
+{
+	const sev_cert *cek = &sev_evidence->cek_cert;
+	const sev_cert *pek = &sev_evidence->pek_cert;
+	const sev_cert *oca = &sev_evidence->oca_cert;
+	const sev_ark_ask_t *ask;
+
+	enclave_verifier_err_t err = get_ask(sev_evidence->device_type, &ask);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	/* Verify CEK cert with ASK */
+	if (!verify_sev_cert_by_key(cek, &ask->ask_pub_key, ask->ask_key)) {
+		RTLS_ERR("failed to verify CEK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_INFO("verify CEK cert successfully\n");
+
+	/* Verify PEK cert with CEK and OCA */
+	if (!verify_sev_cert(pek, oca, cek)) {
+		RTLS_ERR("failed to verify PEK cert\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+	RTLS_INFO("verify PEK cert successfully\n");
+
+	*pek_key = sev_cert_get_pub_key(pek);
+	if (!*pek_key)
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+static void chain_digest(const sev_evidence_t *sev_evidence, uint8_t *digest)
+{
+	SHA256_CTX ctx;
+
+	SHA256_Init(&ctx);
+	SHA256_Update(&ctx, &sev_evidence->device_type, sizeof(sev_evidence->device_type));
+	SHA256_Update(&ctx, &sev_evidence->cek_cert, sizeof(sev_evidence->cek_cert));
+	SHA256_Update(&ctx, &sev_evidence->pek_cert, sizeof(sev_evidence->pek_cert));
+	SHA256_Update(&ctx, &sev_evidence->oca_cert, sizeof(sev_evidence->oca_cert));
+	SHA256_Final(digest, &ctx);
+}
+
+/* Must be called with the lock held */
+static sev_chain_entry_t *chain_find(const uint8_t *digest)
+{
+	for (unsigned int i = 0; i < SEV_CHAIN_CACHE_SIZE; ++i) {
+		if (chains[i].pek_key && !memcmp(chains[i].digest, digest, SHA256_DIGEST_LENGTH))
+			return &chains[i];
+	}
+
+	return NULL;
+}
+
+/* Must be called with the lock held */
+static sev_chain_entry_t *chain_victim(void)
+{
+	sev_chain_entry_t *victim = &chains[0];
+
+	for (unsigned int i = 0; i < SEV_CHAIN_CACHE_SIZE; ++i) {
+		if (!chains[i].pek_key)
+			return &chains[i];
+		if (chains[i].last_used < victim->last_used)
+			victim = &chains[i];
+	}
+
+	return victim;
+}
+
+/* Return a reference to the public key of the PEK of the evidence, so that
+ * only the signature of the attestation report is left to verify. The caller
+ * must release it with EVP_PKEY_free().
+ */
+enclave_verifier_err_t sev_get_pek_key(const sev_evidence_t *sev_evidence, EVP_PKEY **pek_key)
+{
+	uint8_t digest[SHA256_DIGEST_LENGTH];
+
+	chain_digest(sev_evidence, digest);
+
+	pthread_mutex_lock(&cache_lock);
+	sev_chain_entry_t *entry = chain_find(digest);
+	if (entry) {
+		entry->last_used = ++chain_clock;
+		EVP_PKEY_up_ref(entry->pek_key);
+		*pek_key = entry->pek_key;
+	}
+	pthread_mutex_unlock(&cache_lock);
+
+	if (entry)
+		return ENCLAVE_VERIFIER_ERR_NONE;
+
+	enclave_verifier_err_t err = validate_cert_chain(sev_evidence, pek_key);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		return err;
+
+	pthread_mutex_lock(&cache_lock);
+	/* Another thread may have validated the same chain meanwhile */
+	entry = chain_find(digest);
+	if (!entry) {
+		entry = chain_victim();
+		EVP_PKEY_free(entry->pek_key);
+		memcpy(entry->digest, digest, sizeof(entry->digest));
+		entry->pek_key = *pek_key;
+		EVP_PKEY_up_ref(entry->pek_key);
+	}
+	entry->last_used = ++chain_clock;
+	pthread_mutex_unlock(&cache_lock);
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
@@ -0,0 +1,19 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _CERT_CACHE_H
+#define _CERT_CACHE_H
+
+#include <openssl/evp.h>
+#include <rats-tls/verifier.h>
+#include "../../attesters/sev/sev.h"
+
+/* Number of CEK, OCA and PEK chains kept, one per chip and PEK */
+#define SEV_CHAIN_CACHE_SIZE 16
+
+enclave_verifier_err_t sev_get_pek_key(const sev_evidence_t *sev_evidence, EVP_PKEY **pek_key);
+
+#endif /* _CERT_CACHE_H */
@@ -13,9 +13,9 @@
 #include "../sev-snp/utils.h"
 
 #define SEV_DEFAULT_DIR	       "/opt/sev/"
-#define SEV_NAPLES_DEFAULT_DIR SEV_DEFAULT_DIR "naple"
-#define SEV_ROME_DEFAULT_DIR   SEV_DEFAULT_DIR "rome"
-#define SEV_MILAN_DEFAULT_DIR  SEV_DEFAULT_DIR "milan"
+#define SEV_NAPLES_DEFAULT_DIR SEV_DEFAULT_DIR "naple/"
+#define SEV_ROME_DEFAULT_DIR   SEV_DEFAULT_DIR "rome/"
+#define SEV_MILAN_DEFAULT_DIR  SEV_DEFAULT_DIR "milan/"
 
 #define AMD_SEV_DEVELOPER_SITE "https://developer.amd.com/sev/"
 #define ASK_ARK_PATH_SITE      "https://developer.amd.com/wp-content/resources/"
@@ -286,51 +286,47 @@ static bool validate_signature(const sev_cert *child_cert, const sev_cert *paren
 	return true;
 }
 
-/* [parent_cert1][parent_cert2] these are used to validate the 1 or 2 signatures in the child cert.
- * Assumes parent_cert1 is always valid, and parent_cert2 may be valid.
- */
-bool verify_sev_cert(const sev_cert *child_cert, const sev_cert *parent_cert1,
-		     const sev_cert *parent_cert2)
+/* Return the public key of @cert compiled into an EVP_PKEY, to be freed by the caller */
+EVP_PKEY *sev_cert_get_pub_key(const sev_cert *cert)
 {
-	RTLS_DEBUG("child_cert %p, parent_cert1 %p, parent_cert2 %p\n", child_cert, parent_cert1,
-		   parent_cert2);
+	EVP_PKEY *pub_key = EVP_PKEY_new();
+	if (!pub_key)
+		return NULL;
 
-	bool is_valid = false;
+	/* This function allocates memory and attaches an EC_Key
+	 * to your EVP_PKEY so, to prevent mem leaks, make sure
+	 * the EVP_PKEY is freed by the caller.
+	 */
+	if (compile_public_key_from_certificate(cert, pub_key) != 0) {
+		EVP_PKEY_free(pub_key);
+		return NULL;
+	}
 
-	if (!child_cert || !parent_cert1)
-		return is_valid;
+	return pub_key;
+}
 
-	EVP_PKEY *parent_pub_key[SEV_CERT_MAX_SIGNATURES] = { NULL };
+/* [parent_key1][parent_key2] are the public keys of [parent_cert1][parent_cert2],
+ * as compiled by sev_cert_get_pub_key().
+ */
+static bool verify_sev_cert_keys(const sev_cert *child_cert, const sev_cert *parent_cert1,
+				 EVP_PKEY *parent_key1, const sev_cert *parent_cert2,
+				 EVP_PKEY *parent_key2)
+{
 	const sev_cert *parent_cert[SEV_CERT_MAX_SIGNATURES] = { parent_cert1, parent_cert2 };
-
-	/* Get the public key from parent certs */
-	int i = 0;
+	EVP_PKEY *parent_key[SEV_CERT_MAX_SIGNATURES] = { parent_key1, parent_key2 };
 	int numSigs = (parent_cert1 && parent_cert2) ? 2 : 1;
 
-	for (i = 0; i < numSigs; i++) {
-		if (!(parent_pub_key[i] = EVP_PKEY_new()))
-			goto err;
-
-		/* This function allocates memory and attaches an EC_Key
-		 * to your EVP_PKEY so, to prevent mem leaks, make sure
-		 * the EVP_PKEY is freed at the end of this function.
-		 */
-		if (compile_public_key_from_certificate(parent_cert[i], parent_pub_key[i]) != 0)
-			goto err;
-
+	for (int i = 0; i < numSigs; i++) {
 		/* Validate the signature */
-		if (!validate_signature(child_cert, parent_cert[i], parent_pub_key[i])) {
+		if (!validate_signature(child_cert, parent_cert[i], parent_key[i])) {
 			RTLS_ERR("failed to validate signature\n");
-			goto err;
+			return false;
 		}
 	}
 
-	if (i != numSigs)
-		goto err;
-
 	/* Validate the certificate body */
 	if (!validate_body(child_cert))
-		goto err;
+		return false;
 
 	// Although the signature was valid, ensure that the certificate
 	// was signed with the proper key(s) in the correct order
@@ -338,7 +334,7 @@ bool verify_sev_cert(const sev_cert *child_cert, const sev_cert *parent_cert1,
 	case SEV_USAGE_PDH:
 		/* The PDH certificate must be signed by the PEK */
 		if (parent_cert1->pub_key_usage != SEV_USAGE_PEK)
-			goto err;
+			return false;
 		break;
 	case SEV_USAGE_PEK:
 		/* The PEK certificate must be signed by the CEK and the OCA */
@@ -346,58 +342,67 @@ bool verify_sev_cert(const sev_cert *child_cert, const sev_cert *parent_cert1,
 		     (parent_cert2->pub_key_usage != SEV_USAGE_CEK)) &&
 		    ((parent_cert2->pub_key_usage != SEV_USAGE_OCA) &&
 		     (parent_cert1->pub_key_usage != SEV_USAGE_CEK)))
-			goto err;
+			return false;
 		break;
 	case SEV_USAGE_OCA:
 		/* The OCA certificate must be self-signed */
 		if (parent_cert1->pub_key_usage != SEV_USAGE_OCA)
-			goto err;
+			return false;
 		break;
 	case SEV_USAGE_CEK:
 		/* The CEK must be signed by the ASK */
 		if (parent_cert1->pub_key_usage != SEV_USAGE_ASK)
-			goto err;
+			return false;
 		break;
 	default:
 		RTLS_ERR("unsupported pub_key_usage %d\n", child_cert->pub_key_usage);
-		goto err;
-	}
-
-	is_valid = true;
-
-err:
-	/* Free memory */
-	for (int i = 0; i < SEV_CERT_MAX_SIGNATURES; i++) {
-		EVP_PKEY_free(parent_pub_key[i]);
+		return false;
 	}
 
-	return is_valid;
+	return true;
 }
 
-bool validate_attestation(sev_cert *pek, sev_attestation_report *report)
+/* [parent_cert1][parent_cert2] these are used to validate the 1 or 2 signatures in the child cert.
+ * Assumes parent_cert1 is always valid, and parent_cert2 may be valid.
+ */
+bool verify_sev_cert(const sev_cert *child_cert, const sev_cert *parent_cert1,
+		     const sev_cert *parent_cert2)
 {
+	RTLS_DEBUG("child_cert %p, parent_cert1 %p, parent_cert2 %p\n", child_cert, parent_cert1,
+		   parent_cert2);
+
 	bool is_valid = false;
 
-	EVP_PKEY *pek_pub_key = NULL;
-	if (!(pek_pub_key = EVP_PKEY_new()))
+	if (!child_cert || !parent_cert1)
 		return is_valid;
 
-	/* This function allocates memory and attaches an EC_Key
-	 * to your EVP_PKEY so, to prevent mem leaks, make sure
-	 * the EVP_PKEY is freed at the end of this function.
-	 */
-	if (compile_public_key_from_certificate(pek, pek_pub_key) != 0)
-		goto err;
-
-	/* Validate the attestation report */
-	if (!verify_message((sev_sig *)&report->sig1, &pek_pub_key, (const uint8_t *)report,
-			    offsetof(sev_attestation_report, sig_usage), SEV_SIG_ALGO_ECDSA_SHA256))
-		goto err;
+	/* Get the public key from parent certs */
+	EVP_PKEY *parent_key1 = sev_cert_get_pub_key(parent_cert1);
+	EVP_PKEY *parent_key2 = parent_cert2 ? sev_cert_get_pub_key(parent_cert2) : NULL;
 
-	is_valid = true;
+	if (parent_key1 && (!parent_cert2 || parent_key2))
+		is_valid = verify_sev_cert_keys(child_cert, parent_cert1, parent_key1, parent_cert2,
+						parent_key2);
 
-err:
-	EVP_PKEY_free(pek_pub_key);
+	EVP_PKEY_free(parent_key1);
+	EVP_PKEY_free(parent_key2);
 
 	return is_valid;
 }
+
+/* Same as verify_sev_cert() with a single parent whose public key is already compiled */
+bool verify_sev_cert_by_key(const sev_cert *child_cert, const sev_cert *parent_cert,
+			    EVP_PKEY *parent_key)
+{
+	if (!child_cert || !parent_cert || !parent_key)
+		return false;
+
+	return verify_sev_cert_keys(child_cert, parent_cert, parent_key, NULL, NULL);
+}
+
+/* Validate the attestation report by the public key of the PEK */
+bool validate_attestation(EVP_PKEY *pek_pub_key, sev_attestation_report *report)
+{
+	return verify_message((sev_sig *)&report->sig1, &pek_pub_key, (const uint8_t *)report,
+			      offsetof(sev_attestation_report, sig_usage), SEV_SIG_ALGO_ECDSA_SHA256);
+}
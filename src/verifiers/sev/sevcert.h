@@ -7,10 +7,14 @@
 #ifndef _SEVCERT_H
 #define _SEVCERT_H
 
+#include <openssl/evp.h>
 #include "sev_utils.h"
 
+EVP_PKEY *sev_cert_get_pub_key(const sev_cert *cert);
 bool verify_sev_cert(const sev_cert *child_cert, const sev_cert *parent_cert1,
 		     const sev_cert *parent_cert2);
-bool validate_attestation(sev_cert *pek, sev_attestation_report *report);
+bool verify_sev_cert_by_key(const sev_cert *child_cert, const sev_cert *parent_cert,
+			    EVP_PKEY *parent_key);
+bool validate_attestation(EVP_PKEY *pek_pub_key, sev_attestation_report *report);
 
 #endif /* _SEVCERT_H */
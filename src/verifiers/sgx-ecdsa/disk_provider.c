@@ -0,0 +1,283 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <rats-tls/log.h>
+#include "endorsement_provider.h"
+
+/* The collateral of each platform is kept in a directory named after its
+ * FMSPC and PCK CA, e.g. 00906ed50000-processor, holding one file per field.
+ * The same layout may be prepared by hand as a fixture directory.
+ */
+#define COLLATERAL_FIELD(name)                                       \
+	{ #name, offsetof(sgx_ecdsa_attestation_collateral_t, name), \
+	  offsetof(sgx_ecdsa_attestation_collateral_t, name##_size) }
+
+static const struct {
+	const char *name;
+	size_t value_offset;
+	size_t size_offset;
+} collateral_fields[] = {
+	COLLATERAL_FIELD(pck_crl_issuer_chain),
+	COLLATERAL_FIELD(root_ca_crl),
+	COLLATERAL_FIELD(pck_crl),
+	COLLATERAL_FIELD(tcb_info_issuer_chain),
+	COLLATERAL_FIELD(tcb_info),
+	COLLATERAL_FIELD(qe_identity_issuer_chain),
+	COLLATERAL_FIELD(qe_identity),
+};
+
+#define NR_COLLATERAL_FIELDS (sizeof(collateral_fields) / sizeof(collateral_fields[0]))
+
+/* Version of the collateral assumed when the directory does not tell it */
+#define DISK_COLLATERAL_VERSION_DEFAULT 3
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)
+#endif
+
+static char **field_value(const sgx_ecdsa_attestation_collateral_t *collateral, size_t i)
+{
+	return (char **)((uintptr_t)collateral + collateral_fields[i].value_offset);
+}
+
+static uint32_t *field_size(const sgx_ecdsa_attestation_collateral_t *collateral, size_t i)
+{
+	return (uint32_t *)((uintptr_t)collateral + collateral_fields[i].size_offset);
+}
+
+static void disk_key_path(const char *dir, const sgx_collateral_key_t *key, char *path,
+			  size_t size)
+{
+	const char *ca = sgx_pck_ca_name(key->ca);
+
+	snprintf(path, size, "%s/%02x%02x%02x%02x%02x%02x%s%s", dir, key->fmspc[0], key->fmspc[1],
+		 key->fmspc[2], key->fmspc[3], key->fmspc[4], key->fmspc[5], ca ? "-" : "",
+		 ca ? ca : "");
+}
+
+static char *read_file(int dir_fd, const char *name, uint32_t *size)
+{
+	int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	FILE *fp = fdopen(fd, "rb");
+	if (!fp) {
+		close(fd);
+		return NULL;
+	}
+
+	char *buf = NULL;
+	if (fseek(fp, 0, SEEK_END))
+		goto out;
+
+	long len = ftell(fp);
+	if (len < 0 || len > UINT32_MAX - 1 || fseek(fp, 0, SEEK_SET))
+		goto out;
+
+	buf = malloc((size_t)len + 1);
+	if (!buf)
+		goto out;
+
+	if (fread(buf, 1, (size_t)len, fp) != (size_t)len) {
+		free(buf);
+		buf = NULL;
+		goto out;
+	}
+
+	/* Text fields are passed along with their terminating NUL, while DER is kept as is */
+	*size = (uint32_t)len;
+	if (len && buf[0] != 0x30 && buf[len - 1] != '\0')
+		buf[(*size)++] = '\0';
+out:
+	fclose(fp);
+	return buf;
+}
+
+static int write_file(const char *path, const void *buf, size_t size)
+{
+	FILE *fp = fopen(path, "wb");
+	if (!fp)
+		return -1;
+
+	int ret = fwrite(buf, 1, size, fp) == size ? 0 : -1;
+	if (fclose(fp))
+		ret = -1;
+
+	return ret;
+}
+
+static void remove_collateral_dir(const char *path)
+{
+	char file[PATH_MAX];
+
+	for (size_t i = 0; i < NR_COLLATERAL_FIELDS; ++i) {
+		snprintf(file, sizeof(file), "%s/%s", path, collateral_fields[i].name);
+		unlink(file);
+	}
+	snprintf(file, sizeof(file), "%s/version", path);
+	unlink(file);
+
+	rmdir(path);
+}
+
+/* Read all the fields from the same directory, even if it is replaced meanwhile */
+static int read_collateral_dir(const char *path, sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	int dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dir_fd < 0)
+		return -1;
+
+	memset(collateral, 0, sizeof(*collateral));
+
+	for (size_t i = 0; i < NR_COLLATERAL_FIELDS; ++i) {
+		char **value = field_value(collateral, i);
+
+		*value = read_file(dir_fd, collateral_fields[i].name, field_size(collateral, i));
+		if (!*value) {
+			sgx_collateral_free(collateral);
+			close(dir_fd);
+			return -1;
+		}
+	}
+
+	uint32_t version_size;
+	char *version = read_file(dir_fd, "version", &version_size);
+	collateral->version = version ? (uint32_t)strtoul(version, NULL, 10) :
+					DISK_COLLATERAL_VERSION_DEFAULT;
+	free(version);
+	close(dir_fd);
+
+	return 0;
+}
+
+static enclave_verifier_err_t disk_fetch(sgx_ecdsa_endorsement_provider_t *provider,
+					 const sgx_collateral_key_t *key,
+					 sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	char path[PATH_MAX];
+
+	disk_key_path(provider->priv, key, path, sizeof(path));
+
+	/* The fields of a directory replaced by disk_store() are removed after
+	 * the swap, so read the new one once if that happened while reading.
+	 */
+	for (int tries = 0; tries < 2; ++tries) {
+		if (!read_collateral_dir(path, collateral))
+			return ENCLAVE_VERIFIER_ERR_NONE;
+	}
+
+	return -ENCLAVE_VERIFIER_ERR_UNKNOWN;
+}
+
+/* Write the collateral into a directory of its own and swap it into place, so
+ * that a reader holding the previous directory never sees the fields of two
+ * different collaterals.
+ */
+static void disk_store(sgx_ecdsa_endorsement_provider_t *provider,
+		       const sgx_collateral_key_t *key,
+		       const sgx_ecdsa_attestation_collateral_t *collateral,
+		       __attribute__((unused)) uint64_t expiry)
+{
+	const char *dir = provider->priv;
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	char old[PATH_MAX];
+	char file[PATH_MAX];
+
+	if (mkdir(dir, 0700) && errno != EEXIST) {
+		RTLS_WARN("failed to create %s: %s\n", dir, strerror(errno));
+		return;
+	}
+
+	disk_key_path(dir, key, path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path);
+	if (!mkdtemp(tmp)) {
+		RTLS_WARN("failed to create %s: %s\n", tmp, strerror(errno));
+		return;
+	}
+
+	for (size_t i = 0; i < NR_COLLATERAL_FIELDS; ++i) {
+		snprintf(file, sizeof(file), "%s/%s", tmp, collateral_fields[i].name);
+		if (write_file(file, *field_value(collateral, i), *field_size(collateral, i)))
+			goto err;
+	}
+
+	char version[16];
+	int len = snprintf(version, sizeof(version), "%u\n", collateral->version);
+	snprintf(file, sizeof(file), "%s/version", tmp);
+	if (write_file(file, version, (size_t)len))
+		goto err;
+
+	/* The previous collateral ends up in tmp, to be removed */
+	if (!syscall(SYS_renameat2, AT_FDCWD, tmp, AT_FDCWD, path, RENAME_EXCHANGE)) {
+		remove_collateral_dir(tmp);
+		goto out;
+	}
+
+	if (errno == ENOENT) {
+		if (rename(tmp, path))
+			goto err;
+		goto out;
+	}
+
+	/* Without RENAME_EXCHANGE, move the previous collateral aside under a
+	 * name unique to this call.
+	 */
+	snprintf(old, sizeof(old), "%s.old.XXXXXX", path);
+	if (!mkdtemp(old))
+		goto err;
+
+	bool replace = !rename(path, old);
+	if (rename(tmp, path)) {
+		if (replace)
+			rename(old, path);
+		else
+			rmdir(old);
+		goto err;
+	}
+	if (replace)
+		remove_collateral_dir(old);
+	else
+		rmdir(old);
+
+out:
+	RTLS_DEBUG("store the collateral into %s\n", path);
+	return;
+
+err:
+	RTLS_WARN("failed to store the collateral into %s\n", path);
+	remove_collateral_dir(tmp);
+}
+
+sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_disk_provider_new(const char *dir)
+{
+	sgx_ecdsa_endorsement_provider_t *provider = calloc(1, sizeof(*provider));
+	if (!provider)
+		return NULL;
+
+	provider->priv = strdup(dir);
+	if (!provider->priv) {
+		free(provider);
+		return NULL;
+	}
+
+	provider->name = "disk";
+	provider->fetch = disk_fetch;
+	provider->store = disk_store;
+
+	return provider;
+}
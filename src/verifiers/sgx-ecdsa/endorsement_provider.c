@@ -0,0 +1,176 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/verify_cache.h"
+#include "endorsement_provider.h"
+
+#define SGX_ECDSA_PROVIDERS_MAX 3
+
+/* The providers in the order they are queried, the faster first */
+static sgx_ecdsa_endorsement_provider_t *providers[SGX_ECDSA_PROVIDERS_MAX];
+static unsigned int nr_providers;
+static pthread_once_t providers_once = PTHREAD_ONCE_INIT;
+
+/* The platforms whose collateral is being fetched past the first provider */
+typedef struct fetch_flight {
+	struct fetch_flight *next;
+	sgx_collateral_key_t key;
+} fetch_flight_t;
+
+static fetch_flight_t *flights;
+static pthread_mutex_t flights_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t flights_cond = PTHREAD_COND_INITIALIZER;
+
+static void providers_add(sgx_ecdsa_endorsement_provider_t *provider)
+{
+	if (!provider)
+		return;
+
+	RTLS_DEBUG("add the endorsement provider '%s'\n", provider->name);
+	providers[nr_providers++] = provider;
+}
+
+static void providers_init(void)
+{
+	const char *dir = getenv(SGX_ECDSA_COLLATERAL_DIR_ENV);
+	const char *url = getenv(SGX_ECDSA_PCCS_URL_ENV);
+
+	/* Leave the collateral to the quote verification library otherwise */
+	if (!dir && !url)
+		return;
+
+	providers_add(sgx_ecdsa_memory_provider_new());
+
+	if (dir)
+		providers_add(sgx_ecdsa_disk_provider_new(dir));
+
+	if (url) {
+		const char *insecure = getenv(SGX_ECDSA_PCCS_INSECURE_ENV);
+
+		providers_add(sgx_ecdsa_pccs_provider_new(url, insecure && !strcmp(insecure, "1")));
+	}
+}
+
+static uint64_t collateral_expiry(const sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	attestation_endorsement_t endorsements = { .ecdsa = *collateral };
+	uint64_t expiry = rtls_verify_cache_collateral_expiry("sgx_ecdsa", &endorsements);
+
+	return expiry ? expiry : rtls_time() + SGX_ECDSA_PROVIDER_TTL_DEFAULT;
+}
+
+/* Must be called with flights_lock held */
+static fetch_flight_t **flight_find(const sgx_collateral_key_t *key)
+{
+	fetch_flight_t **pos;
+
+	for (pos = &flights; *pos; pos = &(*pos)->next) {
+		if (!memcmp(&(*pos)->key, key, sizeof(*key)))
+			break;
+	}
+
+	return pos;
+}
+
+/* Wait for the thread fetching the collateral of the same platform, if any,
+ * and then become the one fetching it.
+ */
+static void flight_begin(fetch_flight_t *flight, const sgx_collateral_key_t *key)
+{
+	memcpy(&flight->key, key, sizeof(flight->key));
+
+	pthread_mutex_lock(&flights_lock);
+	while (*flight_find(key))
+		pthread_cond_wait(&flights_cond, &flights_lock);
+	flight->next = flights;
+	flights = flight;
+	pthread_mutex_unlock(&flights_lock);
+}
+
+static void flight_end(fetch_flight_t *flight)
+{
+	pthread_mutex_lock(&flights_lock);
+	fetch_flight_t **pos = flight_find(&flight->key);
+	*pos = flight->next;
+	pthread_cond_broadcast(&flights_cond);
+	pthread_mutex_unlock(&flights_lock);
+}
+
+/* Query the providers up to last in turn. A collateral found by a provider is
+ * stored into the providers queried before, so that it is found sooner next
+ * time.
+ */
+static enclave_verifier_err_t providers_fetch(const sgx_collateral_key_t *key, unsigned int last,
+					      attestation_endorsement_t *endorsements)
+{
+	uint64_t now = rtls_time();
+
+	for (unsigned int i = 0; i < last; ++i) {
+		sgx_ecdsa_attestation_collateral_t collateral;
+
+		if (providers[i]->fetch(providers[i], key, &collateral) !=
+		    ENCLAVE_VERIFIER_ERR_NONE)
+			continue;
+
+		/* An out of date collateral is only used when no other provider is left */
+		uint64_t expiry = collateral_expiry(&collateral);
+		if (expiry <= now && i + 1 < nr_providers) {
+			RTLS_DEBUG("skip the out of date collateral from '%s'\n",
+				   providers[i]->name);
+			sgx_collateral_free(&collateral);
+			continue;
+		}
+
+		RTLS_DEBUG("use the collateral from '%s'\n", providers[i]->name);
+
+		for (unsigned int j = 0; expiry > now && j < i; ++j) {
+			if (providers[j]->store)
+				providers[j]->store(providers[j], key, &collateral, expiry);
+		}
+
+		endorsements->ecdsa = collateral;
+
+		return ENCLAVE_VERIFIER_ERR_NONE;
+	}
+
+	return -ENCLAVE_VERIFIER_ERR_COLLATERAL;
+}
+
+/* Supply the collateral of the platform of the quote, for a peer which did not
+ * send any endorsements. Past the first provider, i.e. the memory one, only a
+ * single thread fetches the collateral of a platform, and the others find it
+ * in memory once it is done.
+ */
+enclave_verifier_err_t sgx_ecdsa_get_endorsements(const uint8_t *quote, uint32_t quote_len,
+						  attestation_endorsement_t *endorsements)
+{
+	sgx_collateral_key_t key;
+	fetch_flight_t flight;
+
+	pthread_once(&providers_once, providers_init);
+	if (!nr_providers)
+		return -ENCLAVE_VERIFIER_ERR_UNKNOWN;
+
+	if (!sgx_collateral_key_from_quote(quote, quote_len, &key)) {
+		RTLS_WARN("failed to find the FMSPC of the quote\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	if (nr_providers > 1 && providers_fetch(&key, 1, endorsements) == ENCLAVE_VERIFIER_ERR_NONE)
+		return ENCLAVE_VERIFIER_ERR_NONE;
+
+	/* The first provider is queried again, in case another thread just filled it */
+	flight_begin(&flight, &key);
+	enclave_verifier_err_t err = providers_fetch(&key, nr_providers, endorsements);
+	flight_end(&flight);
+
+	return err;
+}
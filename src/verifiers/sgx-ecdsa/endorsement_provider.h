@@ -0,0 +1,52 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _SGX_ECDSA_ENDORSEMENT_PROVIDER_H
+#define _SGX_ECDSA_ENDORSEMENT_PROVIDER_H
+
+#include <stdint.h>
+#include <rats-tls/verifier.h>
+#include <rats-tls/endorsement.h>
+#include "internal/collateral.h"
+
+/* Base URL of the PCCS, or of any service implementing the same API */
+#define SGX_ECDSA_PCCS_URL_ENV "RATS_TLS_PCCS_URL"
+/* Skip the verification of the TLS certificate of the PCCS if set to 1 */
+#define SGX_ECDSA_PCCS_INSECURE_ENV "RATS_TLS_PCCS_INSECURE"
+/* Directory of the on-disk collateral cache, which may also hold fixtures */
+#define SGX_ECDSA_COLLATERAL_DIR_ENV "RATS_TLS_COLLATERAL_DIR"
+
+/* Maximum number of platforms whose collateral is kept in memory */
+#define SGX_ECDSA_PROVIDER_MEMORY_SIZE 16
+/* Lifetime in seconds of a collateral without any nextUpdate time */
+#define SGX_ECDSA_PROVIDER_TTL_DEFAULT 3600
+
+/* A source of the collateral needed to verify the quotes of a platform,
+ * queried in turn until one of them returns an unexpired collateral.
+ */
+typedef struct sgx_ecdsa_endorsement_provider {
+	const char *name;
+	/* Return ENCLAVE_VERIFIER_ERR_NONE and a collateral to be freed by the caller */
+	enclave_verifier_err_t (*fetch)(struct sgx_ecdsa_endorsement_provider *provider,
+					const sgx_collateral_key_t *key,
+					sgx_ecdsa_attestation_collateral_t *collateral);
+	/* Optional, keep a collateral returned by the providers queried next */
+	void (*store)(struct sgx_ecdsa_endorsement_provider *provider,
+		      const sgx_collateral_key_t *key,
+		      const sgx_ecdsa_attestation_collateral_t *collateral, uint64_t expiry);
+	void *priv;
+} sgx_ecdsa_endorsement_provider_t;
+
+extern sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_memory_provider_new(void);
+extern sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_disk_provider_new(const char *dir);
+extern sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_pccs_provider_new(const char *url,
+								     bool insecure);
+
+extern enclave_verifier_err_t sgx_ecdsa_get_endorsements(const uint8_t *quote,
+							 uint32_t quote_len,
+							 attestation_endorsement_t *endorsements);
+
+#endif
@@ -0,0 +1,170 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "endorsement_provider.h"
+
+typedef struct memory_entry {
+	struct memory_entry *prev;
+	struct memory_entry *next;
+
+	sgx_collateral_key_t key;
+	sgx_ecdsa_attestation_collateral_t collateral;
+	/* Expiration time in seconds since the Epoch */
+	uint64_t expiry;
+} memory_entry_t;
+
+/* The collateral of the platforms, most recently used first */
+typedef struct {
+	memory_entry_t *head;
+	memory_entry_t *tail;
+	unsigned int size;
+	pthread_mutex_t lock;
+} memory_provider_t;
+
+/* Must be called with the lock held */
+static void memory_unlink(memory_provider_t *mem, memory_entry_t *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		mem->head = entry->next;
+
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		mem->tail = entry->prev;
+
+	entry->prev = entry->next = NULL;
+	--mem->size;
+}
+
+/* Must be called with the lock held */
+static void memory_link_head(memory_provider_t *mem, memory_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = mem->head;
+	if (mem->head)
+		mem->head->prev = entry;
+	else
+		mem->tail = entry;
+	mem->head = entry;
+	++mem->size;
+}
+
+static void memory_entry_free(memory_entry_t *entry)
+{
+	sgx_collateral_free(&entry->collateral);
+	free(entry);
+}
+
+/* Must be called with the lock held */
+static memory_entry_t *memory_find(memory_provider_t *mem, const sgx_collateral_key_t *key)
+{
+	memory_entry_t *entry;
+
+	for (entry = mem->head; entry; entry = entry->next) {
+		if (!memcmp(&entry->key, key, sizeof(*key)))
+			break;
+	}
+
+	return entry;
+}
+
+static enclave_verifier_err_t memory_fetch(sgx_ecdsa_endorsement_provider_t *provider,
+					   const sgx_collateral_key_t *key,
+					   sgx_ecdsa_attestation_collateral_t *collateral)
+{
+	memory_provider_t *mem = provider->priv;
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_UNKNOWN;
+
+	pthread_mutex_lock(&mem->lock);
+
+	memory_entry_t *entry = memory_find(mem, key);
+	if (!entry)
+		goto out;
+
+	memory_unlink(mem, entry);
+
+	if (entry->expiry <= rtls_time()) {
+		RTLS_DEBUG("evict expired collateral %p\n", entry);
+		memory_entry_free(entry);
+		goto out;
+	}
+
+	memory_link_head(mem, entry);
+
+	if (sgx_collateral_dup(collateral, &entry->collateral))
+		err = -ENCLAVE_VERIFIER_ERR_NO_MEM;
+	else
+		err = ENCLAVE_VERIFIER_ERR_NONE;
+out:
+	pthread_mutex_unlock(&mem->lock);
+
+	return err;
+}
+
+static void memory_store(sgx_ecdsa_endorsement_provider_t *provider,
+			 const sgx_collateral_key_t *key,
+			 const sgx_ecdsa_attestation_collateral_t *collateral, uint64_t expiry)
+{
+	memory_provider_t *mem = provider->priv;
+
+	memory_entry_t *entry = calloc(1, sizeof(*entry));
+	if (!entry)
+		return;
+
+	if (sgx_collateral_dup(&entry->collateral, collateral)) {
+		free(entry);
+		return;
+	}
+	memcpy(&entry->key, key, sizeof(entry->key));
+	entry->expiry = expiry;
+
+	pthread_mutex_lock(&mem->lock);
+
+	memory_entry_t *old = memory_find(mem, key);
+	if (old) {
+		memory_unlink(mem, old);
+		memory_entry_free(old);
+	}
+
+	memory_link_head(mem, entry);
+
+	while (mem->size > SGX_ECDSA_PROVIDER_MEMORY_SIZE) {
+		memory_entry_t *victim = mem->tail;
+
+		memory_unlink(mem, victim);
+		memory_entry_free(victim);
+	}
+
+	pthread_mutex_unlock(&mem->lock);
+}
+
+sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_memory_provider_new(void)
+{
+	sgx_ecdsa_endorsement_provider_t *provider = calloc(1, sizeof(*provider));
+	if (!provider)
+		return NULL;
+
+	memory_provider_t *mem = calloc(1, sizeof(*mem));
+	if (!mem) {
+		free(provider);
+		return NULL;
+	}
+	pthread_mutex_init(&mem->lock, NULL);
+
+	provider->name = "memory";
+	provider->fetch = memory_fetch;
+	provider->store = memory_store;
+	provider->priv = mem;
+
+	return provider;
+}
@@ -0,0 +1,269 @@
+/* Copyright (c) 2021 Intel Corporation
+ * Copyright (c) 2020-2021 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <curl/curl.h>
+#include <rats-tls/log.h>
+#include "endorsement_provider.h"
+
+/* Version of the collateral made of TCB info v3 and QE identity v2 */
+#define PCCS_COLLATERAL_VERSION 3
+
+typedef struct {
+	/* Base URL ending with a slash, e.g. https://localhost:8081/sgx/certification/v4/ */
+	char *url;
+	/* Reused across requests to keep the connection to the PCCS alive */
+	CURL *curl;
+	pthread_mutex_t lock;
+} pccs_provider_t;
+
+typedef struct {
+	char *body;
+	size_t body_size;
+	/* The names of the header carrying the issuer chain, depending on the API version */
+	const char *const *header_names;
+	char *header;
+} pccs_response_t;
+
+static size_t pccs_write_callback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+	pccs_response_t *response = userp;
+	size_t len = size * nmemb;
+
+	char *body = realloc(response->body, response->body_size + len + 1);
+	if (!body)
+		return 0;
+
+	memcpy(body + response->body_size, contents, len);
+	response->body = body;
+	response->body_size += len;
+	response->body[response->body_size] = '\0';
+
+	return len;
+}
+
+static size_t pccs_header_callback(char *buffer, size_t size, size_t nitems, void *userp)
+{
+	pccs_response_t *response = userp;
+	size_t len = size * nitems;
+
+	for (const char *const *name = response->header_names; name && *name; ++name) {
+		size_t name_len = strlen(*name);
+
+		if (len <= name_len || buffer[name_len] != ':' ||
+		    strncasecmp(buffer, *name, name_len))
+			continue;
+
+		const char *value = buffer + name_len + 1;
+		size_t value_len = len - name_len - 1;
+		while (value_len && (*value == ' ' || *value == '\t')) {
+			++value;
+			--value_len;
+		}
+		while (value_len && (value[value_len - 1] == '\r' || value[value_len - 1] == '\n'))
+			--value_len;
+
+		free(response->header);
+		response->header = strndup(value, value_len);
+		break;
+	}
+
+	return len;
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+/* Decode in place the issuer chains, which are URL encoded in the headers */
+static void url_decode(char *s)
+{
+	char *d = s;
+
+	for (; *s; ++s, ++d) {
+		if (*s == '%' && hex_value(s[1]) >= 0 && hex_value(s[2]) >= 0) {
+			*d = (char)(hex_value(s[1]) << 4 | hex_value(s[2]));
+			s += 2;
+		} else {
+			*d = *s;
+		}
+	}
+	*d = '\0';
+}
+
+/* The body and the header returned are NUL terminated and their sizes include
+ * the NUL, as expected by the quote verification library. The connection is
+ * shared, so the requests of different platforms are interleaved rather than
+ * waiting for the whole collateral of another one.
+ */
+static enclave_verifier_err_t pccs_get(pccs_provider_t *pccs, const char *path,
+				       const char *const *header_names, char **body,
+				       uint32_t *body_size, char **header, uint32_t *header_size)
+{
+	pccs_response_t response = { .header_names = header_names };
+	enclave_verifier_err_t err = -ENCLAVE_VERIFIER_ERR_COLLATERAL;
+	char url[1024];
+	long status = 0;
+
+	snprintf(url, sizeof(url), "%s%s", pccs->url, path);
+
+	pthread_mutex_lock(&pccs->lock);
+
+	CURL *curl = pccs->curl;
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, pccs_write_callback);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
+	curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, pccs_header_callback);
+	curl_easy_setopt(curl, CURLOPT_HEADERDATA, (void *)&response);
+
+	CURLcode curl_ret = curl_easy_perform(curl);
+	if (curl_ret == CURLE_OK)
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+	pthread_mutex_unlock(&pccs->lock);
+
+	if (curl_ret != CURLE_OK) {
+		RTLS_ERR("failed to get %s: %s\n", url, curl_easy_strerror(curl_ret));
+		goto err;
+	}
+
+	if (status != 200 || !response.body) {
+		RTLS_ERR("failed to get %s: HTTP status %ld\n", url, status);
+		goto err;
+	}
+
+	if (header) {
+		if (!response.header) {
+			RTLS_ERR("no issuer chain in the response of %s\n", url);
+			goto err;
+		}
+
+		url_decode(response.header);
+		*header = response.header;
+		*header_size = (uint32_t)strlen(response.header) + 1;
+		response.header = NULL;
+	}
+
+	*body = response.body;
+	*body_size = (uint32_t)response.body_size + 1;
+	response.body = NULL;
+
+	RTLS_DEBUG("got %s\n", url);
+	err = ENCLAVE_VERIFIER_ERR_NONE;
+err:
+	free(response.body);
+	free(response.header);
+	return err;
+}
+
+static enclave_verifier_err_t pccs_fetch(sgx_ecdsa_endorsement_provider_t *provider,
+					 const sgx_collateral_key_t *key,
+					 sgx_ecdsa_attestation_collateral_t *c)
+{
+	static const char *const pck_crl_headers[] = { "SGX-PCK-CRL-Issuer-Chain", NULL };
+	static const char *const tcb_info_headers[] = { "TCB-Info-Issuer-Chain",
+							"SGX-TCB-Info-Issuer-Chain", NULL };
+	static const char *const qe_identity_headers[] = { "SGX-Enclave-Identity-Issuer-Chain",
+							   NULL };
+	pccs_provider_t *pccs = provider->priv;
+	enclave_verifier_err_t err;
+	char path[64];
+
+	const char *ca = sgx_pck_ca_name(key->ca);
+	if (!ca) {
+		RTLS_ERR("unknown PCK CA of the quote\n");
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+	}
+
+	memset(c, 0, sizeof(*c));
+	c->version = PCCS_COLLATERAL_VERSION;
+
+	snprintf(path, sizeof(path), "pckcrl?ca=%s", ca);
+	err = pccs_get(pccs, path, pck_crl_headers, &c->pck_crl, &c->pck_crl_size,
+		       &c->pck_crl_issuer_chain, &c->pck_crl_issuer_chain_size);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		goto out;
+
+	snprintf(path, sizeof(path), "tcb?fmspc=%02x%02x%02x%02x%02x%02x", key->fmspc[0],
+		 key->fmspc[1], key->fmspc[2], key->fmspc[3], key->fmspc[4], key->fmspc[5]);
+	err = pccs_get(pccs, path, tcb_info_headers, &c->tcb_info, &c->tcb_info_size,
+		       &c->tcb_info_issuer_chain, &c->tcb_info_issuer_chain_size);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		goto out;
+
+	err = pccs_get(pccs, "qe/identity", qe_identity_headers, &c->qe_identity,
+		       &c->qe_identity_size, &c->qe_identity_issuer_chain,
+		       &c->qe_identity_issuer_chain_size);
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		goto out;
+
+	err = pccs_get(pccs, "rootcacrl", NULL, &c->root_ca_crl, &c->root_ca_crl_size, NULL,
+		       NULL);
+out:
+	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+		sgx_collateral_free(c);
+
+	return err;
+}
+
+sgx_ecdsa_endorsement_provider_t *sgx_ecdsa_pccs_provider_new(const char *url, bool insecure)
+{
+	sgx_ecdsa_endorsement_provider_t *provider = calloc(1, sizeof(*provider));
+	if (!provider)
+		return NULL;
+
+	pccs_provider_t *pccs = calloc(1, sizeof(*pccs));
+	if (!pccs)
+		goto err;
+
+	size_t len = strlen(url);
+	pccs->url = malloc(len + 2);
+	if (!pccs->url)
+		goto err;
+	snprintf(pccs->url, len + 2, "%s%s", url, len && url[len - 1] == '/' ? "" : "/");
+
+	pccs->curl = curl_easy_init();
+	if (!pccs->curl) {
+		RTLS_ERR("failed to init curl\n");
+		goto err;
+	}
+
+	curl_easy_setopt(pccs->curl, CURLOPT_CONNECTTIMEOUT, 5L);
+	curl_easy_setopt(pccs->curl, CURLOPT_TIMEOUT, 10L);
+	curl_easy_setopt(pccs->curl, CURLOPT_NOSIGNAL, 1L);
+	if (insecure) {
+		/* e.g. a local PCCS with a self-signed certificate */
+		curl_easy_setopt(pccs->curl, CURLOPT_SSL_VERIFYPEER, 0L);
+		curl_easy_setopt(pccs->curl, CURLOPT_SSL_VERIFYHOST, 0L);
+	}
+	pthread_mutex_init(&pccs->lock, NULL);
+
+	provider->name = "pccs";
+	provider->fetch = pccs_fetch;
+	provider->priv = pccs;
+
+	return provider;
+
+err:
+	if (pccs)
+		free(pccs->url);
+	free(pccs);
+	free(provider);
+	return NULL;
+}
@@ -26,6 +26,7 @@
 #include "quote_verification.h"
 #else
 #include <sgx_dcap_quoteverify.h>
+#include "endorsement_provider.h"
 #endif
 // clang-format on
 
@@ -401,9 +402,26 @@ sgx_ecdsa_verify_evidence(enclave_verifier_ctx_t *ctx, attestation_evidence_t *e
 	if (err != ENCLAVE_VERIFIER_ERR_NONE)
 		RTLS_ERR("failed to verify ecdsa\n");
 #else
+	/* Supply the collateral explicitly rather than have it fetched on each verification */
+	attestation_endorsement_t provided;
+	enclave_verifier_err_t fetch_err = ENCLAVE_VERIFIER_ERR_NONE;
+	if (!endorsements) {
+		memset(&provided, 0, sizeof(provided));
+		fetch_err = sgx_ecdsa_get_endorsements((uint8_t *)pquote, quote_size, &provided);
+		if (fetch_err == ENCLAVE_VERIFIER_ERR_NONE)
+			endorsements = &provided;
+	}
+
 	err = ecdsa_verify_evidence(pquote, quote_size, endorsements);
-	if (err != ENCLAVE_VERIFIER_ERR_NONE)
+	if (err != ENCLAVE_VERIFIER_ERR_NONE) {
 		RTLS_ERR("failed to verify ecdsa\n");
+		/* The quote may be rejected only for lack of the collateral */
+		if (fetch_err == -ENCLAVE_VERIFIER_ERR_COLLATERAL)
+			err = fetch_err;
+	}
+
+	if (endorsements == &provided)
+		free_endorsements(evidence->type, &provided);
 #endif
 
 	return err;
@@ -0,0 +1,188 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The buffered BIO batches the writes until flushed or until it reads, and
+ * reads ahead. RATS_TLS_EVENT_PENDING is reported as long as some received
+ * data is buffered by the handle or by the tls wrapper, since the fd doesn't
+ * become readable for it.
+ */
+
+#include <fcntl.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "openssl.h"
+#include "test.h"
+
+#define RECORD_SIZE 100
+
+static int listen_fd;
+static int done_fds[2];
+
+static bool readable(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+	return poll(&pfd, 1, 0) == 1;
+}
+
+static void test_bio(void)
+{
+	char buf[256];
+	int fds[2];
+
+	openssl_buffered_bio_init();
+	TEST_CHECK(!socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+	TEST_CHECK(!fcntl(fds[0], F_SETFL, O_NONBLOCK));
+	BIO *bio = openssl_buffered_bio_new(fds[0]);
+	TEST_CHECK(bio);
+
+	/* The writes are batched until flushed */
+	TEST_CHECK(BIO_write(bio, "hdr", 3) == 3);
+	TEST_CHECK(BIO_write(bio, "body", 4) == 4);
+	TEST_CHECK(BIO_ctrl_wpending(bio) == 7);
+	TEST_CHECK(!readable(fds[1]));
+	TEST_CHECK(BIO_flush(bio) == 1);
+	TEST_CHECK(!BIO_ctrl_wpending(bio));
+	TEST_CHECK(read(fds[1], buf, sizeof(buf)) == 7 && !memcmp(buf, "hdrbody", 7));
+
+	/* Nothing to read yet, but the batched data is sent first */
+	TEST_CHECK(BIO_write(bio, "ping", 4) == 4);
+	TEST_CHECK(BIO_read(bio, buf, 1) == -1 && BIO_should_retry(bio) && BIO_should_read(bio));
+	TEST_CHECK(read(fds[1], buf, sizeof(buf)) == 4 && !memcmp(buf, "ping", 4));
+
+	/* A read takes all the data available, leaving the fd unreadable */
+	TEST_CHECK(write(fds[1], "pong", 4) == 4);
+	TEST_CHECK(write(fds[1], "pang", 4) == 4);
+	TEST_CHECK(BIO_read(bio, buf, 2) == 2 && !memcmp(buf, "po", 2));
+	TEST_CHECK(BIO_ctrl_pending(bio) == 6);
+	TEST_CHECK(!readable(fds[0]));
+	TEST_CHECK(BIO_read(bio, buf, sizeof(buf)) == 6 && !memcmp(buf, "ngpang", 6));
+	TEST_CHECK(!BIO_ctrl_pending(bio));
+
+	/* A flush reports when the socket would block */
+	while (BIO_write(bio, buf, sizeof(buf)) == sizeof(buf) && BIO_flush(bio) == 1)
+		;
+	TEST_CHECK(BIO_should_retry(bio) && BIO_should_write(bio));
+	TEST_CHECK(BIO_ctrl_wpending(bio));
+
+	BIO_free(bio);
+	close(fds[0]);
+	close(fds[1]);
+}
+
+static void *serve(__attribute__((unused)) void *arg)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	char buf[RECORD_SIZE];
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(fd != -1);
+	/* Each record is sent right away, not held back until acknowledged */
+	int one = 1;
+	TEST_CHECK(!setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)));
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+
+	/* Two TLS records in a row */
+	for (int i = 0; i < 2; ++i) {
+		size_t size = sizeof(buf);
+
+		memset(buf, 'a' + i, sizeof(buf));
+		TEST_CHECK(rats_tls_transmit(handle, buf, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size == sizeof(buf));
+	}
+	TEST_CHECK(write(done_fds[1], "", 1) == 1);
+
+	/* Until the client is done */
+	size_t size = 1;
+	rats_tls_receive(handle, buf, &size);
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+
+	return NULL;
+}
+
+static void receive(rats_tls_handle handle, size_t size, char c, int events)
+{
+	char buf[RECORD_SIZE * 2];
+	size_t len = sizeof(buf) < size ? sizeof(buf) : size;
+
+	TEST_CHECK(rats_tls_receive(handle, buf, &len) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(len == size);
+	for (size_t i = 0; i < len; ++i)
+		TEST_CHECK(buf[i] == c);
+
+	int ev;
+	TEST_CHECK(rats_tls_get_events(handle, &ev) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(ev == events);
+}
+
+static void test_pending(unsigned int read_ahead_size)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	uint16_t port;
+	pthread_t thread;
+	char buf[RECORD_SIZE * 2];
+
+	listen_fd = test_listen(&port);
+	TEST_CHECK(!pipe(done_fds));
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, NULL));
+
+	test_conf_init(&conf, "openssl", 0);
+	conf.read_ahead_size = read_ahead_size;
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = test_connect(port);
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(!fcntl(fd, F_SETFL, O_NONBLOCK));
+
+	/* The loopback delivers the records by the time the server is done */
+	TEST_CHECK(read(done_fds[0], buf, 1) == 1);
+
+	/* The rest of the first record is buffered by the handle, and the
+	 * second one by openssl reading ahead.
+	 */
+	receive(handle, RECORD_SIZE / 2, 'a', RATS_TLS_EVENT_PENDING);
+	receive(handle, RECORD_SIZE / 2, 'a', RATS_TLS_EVENT_PENDING);
+	TEST_CHECK(!readable(fd));
+	receive(handle, RECORD_SIZE, 'b', 0);
+
+	size_t size = sizeof(buf);
+	int events;
+	TEST_CHECK(rats_tls_receive(handle, buf, &size) == -RATS_TLS_ERR_WANT_READ);
+	TEST_CHECK(rats_tls_get_events(handle, &events) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(events == RATS_TLS_EVENT_READ);
+
+	TEST_CHECK(!fcntl(fd, F_SETFL, 0));
+	size = 1;
+	TEST_CHECK(rats_tls_transmit(handle, buf, &size) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(!pthread_join(thread, NULL));
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+	close(listen_fd);
+	close(done_fds[0]);
+	close(done_fds[1]);
+}
+
+int main(void)
+{
+	test_bio();
+	test_pending(4096);
+
+	printf("buffered bio ok\n");
+
+	return 0;
+}
@@ -0,0 +1,54 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The handles initialized with RATS_TLS_CONF_FLAGS_CERT_CACHE share a certificate,
+ * unless their configurations change the evidence or the certificate.
+ */
+
+#include <stdint.h>
+#include <rats-tls/api.h>
+#include <rats-tls/claim.h>
+#include "internal/core.h"
+#include "test.h"
+
+static struct rtls_cert_bundle *init(const rats_tls_conf_t *conf, rats_tls_handle *handle)
+{
+	TEST_CHECK(rats_tls_init(conf, handle) == RATS_TLS_ERR_NONE);
+	TEST_CHECK((*handle)->cert_bundle);
+
+	return (*handle)->cert_bundle;
+}
+
+int main(void)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle h[4];
+	uint8_t value[] = "test";
+	claim_t claim = { .name = "test", .value = value, .value_size = sizeof(value) };
+
+	test_conf_init(&conf, "openssl",
+		       RATS_TLS_CONF_FLAGS_SERVER | RATS_TLS_CONF_FLAGS_CERT_CACHE);
+	struct rtls_cert_bundle *bundle = init(&conf, &h[0]);
+
+	/* The same configuration */
+	TEST_CHECK(init(&conf, &h[1]) == bundle);
+
+	/* The flags which don't change the certificate */
+	conf.flags |= RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION | RATS_TLS_CONF_FLAGS_KTLS;
+	TEST_CHECK(init(&conf, &h[2]) == bundle);
+
+	/* Custom claims change the certificate */
+	conf.custom_claims = &claim;
+	conf.custom_claims_length = 1;
+	TEST_CHECK(init(&conf, &h[3]) != bundle);
+
+	for (unsigned int i = 0; i < sizeof(h) / sizeof(h[0]); ++i)
+		TEST_CHECK(rats_tls_cleanup(h[i]) == RATS_TLS_ERR_NONE);
+
+	printf("cert cache ok\n");
+
+	return 0;
+}
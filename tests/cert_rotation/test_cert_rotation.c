@@ -0,0 +1,96 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Rotating the certificate of a handle replaces its private key, of either
+ * algorithm, and the handle is still usable and released cleanly afterwards.
+ */
+
+#include <pthread.h>
+#include "internal/core.h"
+#include "internal/cert_cache.h"
+#include "test.h"
+
+#define ROTATIONS 3
+
+static rats_tls_handle server;
+static int listen_fd;
+
+static void *serve(__attribute__((unused)) void *arg)
+{
+	rats_tls_handle session;
+	char buf[1] = { 'x' };
+	size_t len = sizeof(buf);
+
+	int fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(rats_tls_session_init(server, &session) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_negotiate(session, fd) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_transmit(session, buf, &len) == RATS_TLS_ERR_NONE);
+
+	TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+	close(fd);
+
+	return NULL;
+}
+
+static void test_rotation(rats_tls_cert_algo_t algo)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle client;
+	uint8_t privkey[4096];
+	unsigned int privkey_len = 0;
+	uint16_t port;
+	pthread_t thread;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	conf.cert_algo = algo;
+	TEST_CHECK(rats_tls_init(&conf, &server) == RATS_TLS_ERR_NONE);
+
+	/* Each rotation generates a new key */
+	for (unsigned int i = 0; i < ROTATIONS; ++i) {
+		rtls_cert_bundle_t *bundle = server->cert_bundle;
+
+		TEST_CHECK(bundle && bundle->privkey_len <= sizeof(privkey));
+		TEST_CHECK(bundle->privkey_len != privkey_len ||
+			   memcmp(bundle->privkey_buf, privkey, privkey_len));
+		memcpy(privkey, bundle->privkey_buf, bundle->privkey_len);
+		privkey_len = bundle->privkey_len;
+
+		TEST_CHECK(rats_tls_rotate_cert(server) == RATS_TLS_ERR_NONE);
+	}
+
+	/* The last key is the one used by the TLS sessions */
+	listen_fd = test_listen(&port);
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, NULL));
+
+	test_conf_init(&conf, "openssl", 0);
+	conf.cert_algo = algo;
+	TEST_CHECK(rats_tls_init(&conf, &client) == RATS_TLS_ERR_NONE);
+
+	int fd = test_connect(port);
+	char buf[1];
+	size_t len = sizeof(buf);
+	TEST_CHECK(rats_tls_negotiate(client, fd) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_receive(client, buf, &len) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(!pthread_join(thread, NULL));
+
+	TEST_CHECK(rats_tls_cleanup(client) == RATS_TLS_ERR_NONE);
+	close(fd);
+	close(listen_fd);
+	TEST_CHECK(rats_tls_cleanup(server) == RATS_TLS_ERR_NONE);
+}
+
+int main(void)
+{
+	test_rotation(RATS_TLS_CERT_ALGO_RSA_3072_SHA256);
+	test_rotation(RATS_TLS_CERT_ALGO_ECC_256_SHA256);
+	/* The previous key was of the other algorithm */
+	test_rotation(RATS_TLS_CERT_ALGO_RSA_3072_SHA256);
+
+	printf("cert rotation ok\n");
+
+	return 0;
+}
@@ -0,0 +1,158 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The sgx_ecdsa collateral is cached by the FMSPC and the CA found in the PCK
+ * certificate of a quote, until the nextUpdate time of its CRLs.
+ */
+
+#include <stdint.h>
+#include <openssl/err.h>
+#include "internal/der.h"
+#include "internal/collateral.h"
+#include "test.h"
+
+/* The size of the quote header, of the report body and of the ECDSA signature data */
+#define QUOTE_SIGNATURE_DATA_OFFSET 436
+#define QUOTE_ECDSA_SIG_DATA_SIZE   576
+#define QUOTE_PCK_CERT_CHAIN	    5
+
+/* The nextUpdate time of crl.pem, i.e. 2026-10-23T13:01:38Z */
+#define CRL_NEXT_UPDATE 1792760498ULL
+
+static const char *dir;
+
+static char *read_fixture(const char *name, size_t *len)
+{
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *fp = fopen(path, "rb");
+	TEST_CHECK(fp);
+
+	TEST_CHECK(!fseek(fp, 0, SEEK_END));
+	long size = ftell(fp);
+	TEST_CHECK(size > 0);
+	rewind(fp);
+
+	char *buf = malloc(size);
+	TEST_CHECK(buf);
+	TEST_CHECK(fread(buf, 1, size, fp) == (size_t)size);
+	fclose(fp);
+
+	*len = size;
+	return buf;
+}
+
+static void put_le(uint8_t *p, uint32_t v, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+/* Build a quote carrying the PCK certificate @name, and derive its collateral key */
+static bool key_from_pck(const char *name, sgx_collateral_key_t *key)
+{
+	size_t pck_len;
+	char *pck = read_fixture(name, &pck_len);
+
+	/* The certification data follows the empty QE authentication data */
+	size_t quote_len =
+		QUOTE_SIGNATURE_DATA_OFFSET + QUOTE_ECDSA_SIG_DATA_SIZE + 2 + 6 + pck_len;
+	uint8_t *quote = calloc(1, quote_len);
+	TEST_CHECK(quote);
+
+	put_le(quote + QUOTE_SIGNATURE_DATA_OFFSET - 4, quote_len - QUOTE_SIGNATURE_DATA_OFFSET, 4);
+	uint8_t *p = quote + QUOTE_SIGNATURE_DATA_OFFSET + QUOTE_ECDSA_SIG_DATA_SIZE;
+	put_le(p, 0, 2);
+	p += 2;
+	put_le(p, QUOTE_PCK_CERT_CHAIN, 2);
+	put_le(p + 2, pck_len, 4);
+	memcpy(p + 6, pck, pck_len);
+
+	bool found = sgx_collateral_key_from_quote(quote, quote_len, key);
+
+	/* A quote cut short never yields a key */
+	sgx_collateral_key_t cut;
+	TEST_CHECK(!sgx_collateral_key_from_quote(quote, quote_len - 1, &cut));
+
+	free(quote);
+	free(pck);
+
+	return found;
+}
+
+static void test_collateral_key(void)
+{
+	static const uint8_t platform_fmspc[] = { 0x00, 0x90, 0x6e, 0xa1, 0x00, 0x00 };
+	static const uint8_t processor_fmspc[] = { 0x20, 0x60, 0x6a, 0x00, 0x00, 0x00 };
+	sgx_collateral_key_t key;
+
+	TEST_CHECK(key_from_pck("pck_platform.pem", &key));
+	TEST_CHECK(key.ca == SGX_PCK_CA_PLATFORM);
+	TEST_CHECK(!memcmp(key.fmspc, platform_fmspc, sizeof(key.fmspc)));
+
+	TEST_CHECK(key_from_pck("pck_processor.pem", &key));
+	TEST_CHECK(key.ca == SGX_PCK_CA_PROCESSOR);
+	TEST_CHECK(!memcmp(key.fmspc, processor_fmspc, sizeof(key.fmspc)));
+
+	/* No SGX extension */
+	TEST_CHECK(!key_from_pck("pck_noext.pem", &key));
+}
+
+static void test_crl_next_update(void)
+{
+	size_t pem_len, der_len;
+	char *pem = read_fixture("crl.pem", &pem_len);
+
+	/* The CRLs come PEM encoded, as hex encoded DER or as raw DER */
+	TEST_CHECK(crl_next_update(pem, pem_len) == CRL_NEXT_UPDATE);
+
+	uint8_t *der = pem_to_der(pem, pem_len, "X509 CRL", &der_len);
+	TEST_CHECK(der);
+	TEST_CHECK(crl_next_update((const char *)der, der_len) == CRL_NEXT_UPDATE);
+
+	/* Only the block of the label is decoded, past those of other labels */
+	size_t cert_len, chain_len;
+	char *cert = read_fixture("pck_platform.pem", &cert_len);
+	char *chain = malloc(cert_len + pem_len);
+	TEST_CHECK(chain);
+	memcpy(chain, cert, cert_len);
+	memcpy(chain + cert_len, pem, pem_len);
+	uint8_t *chain_der = pem_to_der(chain, cert_len + pem_len, "X509 CRL", &chain_len);
+	TEST_CHECK(chain_der && chain_len == der_len && !memcmp(chain_der, der, der_len));
+	TEST_CHECK(!pem_to_der(cert, cert_len, "X509 CRL", &chain_len));
+	/* Nothing is left in the error queue of the thread for the TLS session */
+	TEST_CHECK(!ERR_peek_error());
+	free(chain_der);
+	free(chain);
+	free(cert);
+
+	char *hex = malloc(der_len * 2 + 1);
+	TEST_CHECK(hex);
+	for (size_t i = 0; i < der_len; ++i)
+		snprintf(hex + i * 2, 3, "%02x", der[i]);
+	TEST_CHECK(crl_next_update(hex, der_len * 2 + 1) == CRL_NEXT_UPDATE);
+
+	/* A truncated CRL has no known nextUpdate */
+	TEST_CHECK(crl_next_update((const char *)der, der_len / 2) == 0);
+
+	free(hex);
+	free(der);
+	free(pem);
+}
+
+int main(int argc, char **argv)
+{
+	TEST_CHECK(argc == 2);
+	dir = argv[1];
+
+	test_collateral_key();
+	test_crl_next_update();
+
+	printf("collateral ok\n");
+
+	return 0;
+}
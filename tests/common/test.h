@@ -0,0 +1,74 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _TEST_H
+#define _TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <rats-tls/api.h>
+
+/* Fail the test with the location of the check unless @cond holds */
+#define TEST_CHECK(cond)                                                                    \
+	do {                                                                                \
+		if (!(cond)) {                                                              \
+			fprintf(stderr, "%s:%d: '%s' failed\n", __FILE__, __LINE__, #cond); \
+			exit(EXIT_FAILURE);                                                 \
+		}                                                                           \
+	} while (0)
+
+/* Set up a configuration needing no TEE, with the tls wrapper @tls_type */
+static inline void test_conf_init(rats_tls_conf_t *conf, const char *tls_type, unsigned long flags)
+{
+	memset(conf, 0, sizeof(*conf));
+	conf->api_version = RATS_TLS_API_VERSION_DEFAULT;
+	conf->log_level = RATS_TLS_LOG_LEVEL_ERROR;
+	snprintf(conf->attester_type, sizeof(conf->attester_type), "nullattester");
+	snprintf(conf->verifier_type, sizeof(conf->verifier_type), "nullverifier");
+	snprintf(conf->tls_type, sizeof(conf->tls_type), "%s", tls_type);
+	snprintf(conf->crypto_type, sizeof(conf->crypto_type), "openssl");
+	conf->cert_algo = RATS_TLS_CERT_ALGO_ECC_256_SHA256;
+	conf->flags = flags;
+}
+
+/* Listen on a port of the loopback address picked by the kernel */
+static inline int test_listen(uint16_t *port)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET };
+	socklen_t addr_len = sizeof(addr);
+
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(!bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+	TEST_CHECK(!listen(fd, 16));
+	TEST_CHECK(!getsockname(fd, (struct sockaddr *)&addr, &addr_len));
+
+	*port = ntohs(addr.sin_port);
+
+	return fd;
+}
+
+static inline int test_connect(uint16_t port)
+{
+	struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons(port) };
+
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(!connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+
+	return fd;
+}
+
+#endif
@@ -0,0 +1,124 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* An attester and a verifier needing no TEE, registered in the process of the test
+ * rather than loaded from the instance directories. Unlike with nullattester, the
+ * evidence is bound to the certificate, so the verification results are cached and
+ * the sessions are resumed as with a real TEE.
+ */
+
+#include <string.h>
+#include <rats-tls/attester.h>
+#include <rats-tls/verifier.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "test.h"
+#include "test_instance.h"
+
+extern enclave_attester_err_t enclave_attester_register(enclave_attester_opts_t *);
+extern enclave_verifier_err_t enclave_verifier_register(enclave_verifier_opts_t *);
+extern rats_tls_err_t rtls_enclave_attester_post_init(const char *name, void *handle);
+extern rats_tls_err_t rtls_enclave_verifier_post_init(const char *name, void *handle);
+
+unsigned int test_instance_evidences;
+unsigned int test_instance_verifications;
+enclave_verifier_err_t test_instance_verify_err = ENCLAVE_VERIFIER_ERR_NONE;
+
+/* The private data of the instances only has to be set */
+static enclave_attester_err_t test_attester_init(enclave_attester_ctx_t *ctx,
+						 __attribute__((unused)) rats_tls_cert_algo_t algo)
+{
+	ctx->attester_private = &test_instance_evidences;
+	return ENCLAVE_ATTESTER_ERR_NONE;
+}
+
+/* The evidence is the hash of the public key and claims of the certificate */
+static enclave_attester_err_t
+test_collect_evidence(__attribute__((unused)) enclave_attester_ctx_t *ctx,
+		      attestation_evidence_t *evidence,
+		      __attribute__((unused)) rats_tls_cert_algo_t algo, uint8_t *hash,
+		      uint32_t hash_len)
+{
+	if (hash_len > sizeof(evidence->csv.report))
+		return -ENCLAVE_ATTESTER_ERR_INVALID;
+
+	snprintf(evidence->type, sizeof(evidence->type), "csv");
+	memcpy(evidence->csv.report, hash, hash_len);
+	evidence->csv.report_len = hash_len;
+
+	__atomic_add_fetch(&test_instance_evidences, 1, __ATOMIC_SEQ_CST);
+
+	return ENCLAVE_ATTESTER_ERR_NONE;
+}
+
+static enclave_attester_err_t test_attester_cleanup(__attribute__((unused))
+						    enclave_attester_ctx_t *ctx)
+{
+	return ENCLAVE_ATTESTER_ERR_NONE;
+}
+
+static enclave_verifier_err_t test_verifier_init(enclave_verifier_ctx_t *ctx,
+						 __attribute__((unused)) rats_tls_cert_algo_t algo)
+{
+	ctx->verifier_private = &test_instance_verifications;
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+static enclave_verifier_err_t
+test_verify_evidence(__attribute__((unused)) enclave_verifier_ctx_t *ctx,
+		     attestation_evidence_t *evidence, uint8_t *hash, unsigned int hash_len,
+		     __attribute__((unused)) attestation_endorsement_t *endorsements)
+{
+	__atomic_add_fetch(&test_instance_verifications, 1, __ATOMIC_SEQ_CST);
+
+	if (test_instance_verify_err != ENCLAVE_VERIFIER_ERR_NONE)
+		return test_instance_verify_err;
+
+	if (evidence->csv.report_len != hash_len || memcmp(evidence->csv.report, hash, hash_len))
+		return -ENCLAVE_VERIFIER_ERR_INVALID;
+
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+static enclave_verifier_err_t test_verifier_cleanup(__attribute__((unused))
+						    enclave_verifier_ctx_t *ctx)
+{
+	return ENCLAVE_VERIFIER_ERR_NONE;
+}
+
+static enclave_attester_opts_t test_attester_opts = {
+	.api_version = ENCLAVE_ATTESTER_API_VERSION_DEFAULT,
+	.flags = ENCLAVE_ATTESTER_FLAGS_DEFAULT,
+	.name = TEST_INSTANCE_NAME,
+	.type = "csv",
+	.priority = 0,
+	.init = test_attester_init,
+	.collect_evidence = test_collect_evidence,
+	.cleanup = test_attester_cleanup,
+};
+
+static enclave_verifier_opts_t test_verifier_opts = {
+	.api_version = ENCLAVE_VERIFIER_API_VERSION_DEFAULT,
+	.flags = ENCLAVE_VERIFIER_OPTS_FLAGS_DEFAULT,
+	.name = TEST_INSTANCE_NAME,
+	.type = "csv",
+	.priority = 0,
+	.init = test_verifier_init,
+	.verify_evidence = test_verify_evidence,
+	.cleanup = test_verifier_cleanup,
+};
+
+/* Register the instances, selected by setting the attester and verifier types of a
+ * configuration to TEST_INSTANCE_NAME.
+ */
+void test_instance_register(void)
+{
+	TEST_CHECK(enclave_attester_register(&test_attester_opts) == ENCLAVE_ATTESTER_ERR_NONE);
+	TEST_CHECK(rtls_enclave_attester_post_init(TEST_INSTANCE_NAME, NULL) == RATS_TLS_ERR_NONE);
+
+	TEST_CHECK(enclave_verifier_register(&test_verifier_opts) == ENCLAVE_VERIFIER_ERR_NONE);
+	TEST_CHECK(rtls_enclave_verifier_post_init(TEST_INSTANCE_NAME, NULL) == RATS_TLS_ERR_NONE);
+}
@@ -0,0 +1,26 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _TEST_INSTANCE_H
+#define _TEST_INSTANCE_H
+
+#include <rats-tls/err.h>
+
+/* The name of the attester and verifier instances registered by test_instance_register() */
+#define TEST_INSTANCE_NAME "test"
+
+/* Number of evidences collected and verified by the test instances */
+extern unsigned int test_instance_evidences;
+extern unsigned int test_instance_verifications;
+
+/* Unless ENCLAVE_VERIFIER_ERR_NONE, the default, the error returned by the test verifier
+ * instead of checking the evidence
+ */
+extern enclave_verifier_err_t test_instance_verify_err;
+
+extern void test_instance_register(void);
+
+#endif
@@ -0,0 +1,159 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* rats_tls_transmitv() sends the buffers of a call in a single TLS record, and
+ * the small writes to a corked handle are coalesced into full TLS records.
+ */
+
+#include <pthread.h>
+#include <sys/uio.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "internal/transmit.h"
+#include "openssl.h"
+#include "test.h"
+
+#define MESSAGES      200
+#define HEADER_SIZE   7
+#define BODY_SIZE(k)  (100 + (k) * 13)
+#define SMALL_WRITES  5000
+#define SMALL_SIZE    5
+#define CORKED_VECS   100
+#define CORKED_BODY   50
+#define RECORDS(size) (((size) + RATS_TLS_CORK_BUFFER_SIZE - 1) / RATS_TLS_CORK_BUFFER_SIZE)
+
+static int listen_fd;
+static unsigned int records;
+
+/* The data sent by the server, in order */
+static char expected[1 << 20];
+static size_t expected_len;
+
+static void expect(const void *buf, size_t len)
+{
+	TEST_CHECK(expected_len + len <= sizeof(expected));
+	memcpy(expected + expected_len, buf, len);
+	expected_len += len;
+}
+
+/* Count the application data records written by the server */
+static void msg_callback(int write_p, __attribute__((unused)) int version, int content_type,
+			 const void *buf, size_t len, __attribute__((unused)) SSL *ssl,
+			 __attribute__((unused)) void *arg)
+{
+	if (write_p && content_type == SSL3_RT_INNER_CONTENT_TYPE && len == 1 &&
+	    *(const uint8_t *)buf == SSL3_RT_APPLICATION_DATA)
+		++records;
+}
+
+static void transmitv(rats_tls_handle handle, int k, size_t body_size)
+{
+	char header[HEADER_SIZE + 1], body[BODY_SIZE(MESSAGES)];
+	struct iovec iov[2] = {
+		{ .iov_base = header, .iov_len = HEADER_SIZE },
+		{ .iov_base = body, .iov_len = body_size },
+	};
+	size_t size;
+
+	snprintf(header, sizeof(header), "H%05d:", k);
+	memset(body, 'a' + k % 26, body_size);
+	TEST_CHECK(rats_tls_transmitv(handle, iov, 2, &size) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(size == HEADER_SIZE + body_size);
+
+	expect(header, HEADER_SIZE);
+	expect(body, body_size);
+}
+
+static void *serve(__attribute__((unused)) void *arg)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+	SSL_set_msg_callback(((openssl_ctx_t *)handle->tls_wrapper->tls_private)->ssl,
+			     msg_callback);
+
+	/* A record per call */
+	records = 0;
+	for (int k = 0; k < MESSAGES; ++k)
+		transmitv(handle, k, BODY_SIZE(k));
+	TEST_CHECK(records == MESSAGES);
+
+	/* The records are only sent once full, or flushed */
+	records = 0;
+	TEST_CHECK(rats_tls_cork(handle, true) == RATS_TLS_ERR_NONE);
+	for (int k = 0; k < SMALL_WRITES; ++k) {
+		char buf[SMALL_SIZE + 1];
+		size_t size = SMALL_SIZE;
+
+		snprintf(buf, sizeof(buf), "%04d|", k % 10000);
+		TEST_CHECK(rats_tls_transmit(handle, buf, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size == SMALL_SIZE);
+		expect(buf, SMALL_SIZE);
+	}
+	TEST_CHECK(records == SMALL_WRITES * SMALL_SIZE / RATS_TLS_CORK_BUFFER_SIZE);
+	TEST_CHECK(rats_tls_flush(handle) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(records == RECORDS(SMALL_WRITES * SMALL_SIZE));
+
+	/* The buffers of transmitv are coalesced too, and uncorking flushes them */
+	records = 0;
+	for (int k = 0; k < CORKED_VECS; ++k)
+		transmitv(handle, k, CORKED_BODY);
+	TEST_CHECK(records == 0);
+	TEST_CHECK(rats_tls_cork(handle, false) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(records == RECORDS(CORKED_VECS * (HEADER_SIZE + CORKED_BODY)));
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+
+	return NULL;
+}
+
+int main(void)
+{
+	static char received[sizeof(expected)];
+	size_t received_len = 0;
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	uint16_t port;
+	pthread_t thread;
+
+	listen_fd = test_listen(&port);
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, NULL));
+
+	test_conf_init(&conf, "openssl", 0);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = test_connect(port);
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+
+	/* Until the server closes the connection */
+	for (;;) {
+		size_t len = sizeof(received) - received_len;
+
+		if (rats_tls_receive(handle, received + received_len, &len) != RATS_TLS_ERR_NONE ||
+		    !len)
+			break;
+		received_len += len;
+	}
+	TEST_CHECK(!pthread_join(thread, NULL));
+
+	TEST_CHECK(received_len == expected_len);
+	TEST_CHECK(!memcmp(received, expected, expected_len));
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+	close(listen_fd);
+
+	printf("cork ok\n");
+
+	return 0;
+}
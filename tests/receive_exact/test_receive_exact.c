@@ -0,0 +1,170 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Length-prefixed messages are received with rats_tls_receive_exact() and
+ * rats_tls_peek(), with and without read-ahead, and the data read ahead from
+ * a TLS session is not received once the handle negotiates another one.
+ */
+
+#include <pthread.h>
+#include <sys/uio.h>
+#include "test.h"
+
+#define MESSAGES	200
+#define MESSAGE_SIZE(k) (1 + (k) * 41)
+#define TAIL_SIZE	1000
+#define LEFTOVER_SIZE	100
+#define SECOND		"second"
+
+static rats_tls_handle server;
+static int listen_fd;
+
+static void fill(uint8_t *buf, size_t size, unsigned int seed)
+{
+	for (size_t i = 0; i < size; ++i)
+		buf[i] = (uint8_t)(seed * 7 + i);
+}
+
+static void send_all(rats_tls_handle session, const void *buf, size_t size)
+{
+	size_t len = size;
+
+	TEST_CHECK(rats_tls_transmit(session, (void *)buf, &len) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(len == size);
+}
+
+static void *serve(__attribute__((unused)) void *arg)
+{
+	static uint8_t body[MESSAGE_SIZE(MESSAGES)];
+	rats_tls_handle session;
+
+	/* The first connection carries the messages */
+	int fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(rats_tls_session_init(server, &session) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_negotiate(session, fd) == RATS_TLS_ERR_NONE);
+
+	for (unsigned int k = 0; k < MESSAGES; ++k) {
+		uint32_t len = htonl(MESSAGE_SIZE(k));
+		struct iovec iov[2] = {
+			{ .iov_base = &len, .iov_len = sizeof(len) },
+			{ .iov_base = body, .iov_len = MESSAGE_SIZE(k) },
+		};
+		size_t size;
+
+		fill(body, MESSAGE_SIZE(k), k);
+		TEST_CHECK(rats_tls_transmitv(session, iov, 2, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size == sizeof(len) + MESSAGE_SIZE(k));
+	}
+
+	fill(body, TAIL_SIZE, MESSAGES);
+	send_all(session, body, TAIL_SIZE);
+
+	/* Mostly left to the read-ahead buffer of the client */
+	memset(body, 'x', LEFTOVER_SIZE);
+	send_all(session, body, LEFTOVER_SIZE);
+
+	/* Wait for the client to be connected again */
+	int second_fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(second_fd != -1);
+	TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+	close(fd);
+
+	TEST_CHECK(rats_tls_session_init(server, &session) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_negotiate(session, second_fd) == RATS_TLS_ERR_NONE);
+	send_all(session, SECOND, strlen(SECOND));
+
+	TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+	close(second_fd);
+
+	return NULL;
+}
+
+static void test_receive(unsigned int read_ahead_size, uint16_t port)
+{
+	static uint8_t buf[MESSAGE_SIZE(MESSAGES)], expected[MESSAGE_SIZE(MESSAGES)];
+	rats_tls_conf_t conf;
+	rats_tls_handle client;
+	pthread_t thread;
+
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, NULL));
+
+	test_conf_init(&conf, "openssl", 0);
+	conf.read_ahead_size = read_ahead_size;
+	TEST_CHECK(rats_tls_init(&conf, &client) == RATS_TLS_ERR_NONE);
+
+	int fd = test_connect(port);
+	TEST_CHECK(rats_tls_negotiate(client, fd) == RATS_TLS_ERR_NONE);
+
+	for (unsigned int k = 0; k < MESSAGES; ++k) {
+		uint32_t len;
+		uint8_t first[4];
+		size_t size = sizeof(first);
+
+		TEST_CHECK(rats_tls_receive_exact(client, &len, sizeof(len)) == RATS_TLS_ERR_NONE);
+		len = ntohl(len);
+		TEST_CHECK(len == MESSAGE_SIZE(k));
+
+		/* Peeking consumes nothing, and only returns some of the data */
+		fill(expected, len, k);
+		for (unsigned int i = 0; i < 2; ++i) {
+			size = sizeof(first);
+			TEST_CHECK(rats_tls_peek(client, first, &size) == RATS_TLS_ERR_NONE);
+			TEST_CHECK(size && size <= sizeof(first) && size <= len);
+			TEST_CHECK(!memcmp(first, expected, size));
+		}
+
+		TEST_CHECK(rats_tls_receive_exact(client, buf, len) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(!memcmp(buf, expected, len));
+	}
+
+	/* Small reads return the data in order */
+	fill(expected, TAIL_SIZE, MESSAGES);
+	for (size_t off = 0; off < TAIL_SIZE;) {
+		size_t size = 3;
+
+		TEST_CHECK(rats_tls_receive(client, buf + off, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size && size <= 3);
+		off += size;
+	}
+	TEST_CHECK(!memcmp(buf, expected, TAIL_SIZE));
+
+	TEST_CHECK(rats_tls_receive_exact(client, buf, 1) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(buf[0] == 'x');
+
+	int second_fd = test_connect(port);
+	TEST_CHECK(rats_tls_negotiate(client, second_fd) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_receive_exact(client, buf, strlen(SECOND)) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(!memcmp(buf, SECOND, strlen(SECOND)));
+
+	/* Not enough data before the session is closed */
+	TEST_CHECK(!pthread_join(thread, NULL));
+	TEST_CHECK(rats_tls_receive_exact(client, buf, 1) != RATS_TLS_ERR_NONE);
+
+	TEST_CHECK(rats_tls_cleanup(client) == RATS_TLS_ERR_NONE);
+	close(second_fd);
+	close(fd);
+}
+
+int main(void)
+{
+	rats_tls_conf_t conf;
+	uint16_t port;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	TEST_CHECK(rats_tls_init(&conf, &server) == RATS_TLS_ERR_NONE);
+	listen_fd = test_listen(&port);
+
+	test_receive(0, port);
+	test_receive(4096, port);
+
+	close(listen_fd);
+	TEST_CHECK(rats_tls_cleanup(server) == RATS_TLS_ERR_NONE);
+
+	printf("receive exact ok\n");
+
+	return 0;
+}
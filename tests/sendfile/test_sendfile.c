@@ -0,0 +1,112 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* rats_tls_sendfile() sends a file from an offset up to its end, with and without
+ * kernel TLS offload, and the client receives it unchanged.
+ */
+
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "test.h"
+
+#define FILE_SIZE   ((1 << 20) + 123)
+#define FILE_OFFSET 4103
+
+static int listen_fd;
+static int file_fd;
+static char content[FILE_SIZE];
+
+static void *serve(void *arg)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	size_t sent = 0;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER | *(unsigned long *)arg);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = accept(listen_fd, NULL, NULL);
+	TEST_CHECK(fd != -1);
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+
+	/* Ask for more than is left, until the end of the file */
+	for (;;) {
+		size_t size = FILE_SIZE;
+
+		TEST_CHECK(rats_tls_sendfile(handle, file_fd, FILE_OFFSET + (off_t)sent, &size) ==
+			   RATS_TLS_ERR_NONE);
+		if (!size)
+			break;
+		sent += size;
+	}
+	TEST_CHECK(sent == FILE_SIZE - FILE_OFFSET);
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+
+	return NULL;
+}
+
+static void test_sendfile(unsigned long flags)
+{
+	static char received[FILE_SIZE];
+	size_t received_len = 0;
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	uint16_t port;
+	pthread_t thread;
+
+	listen_fd = test_listen(&port);
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, &flags));
+
+	test_conf_init(&conf, "openssl", flags);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+
+	int fd = test_connect(port);
+	TEST_CHECK(rats_tls_negotiate(handle, fd) == RATS_TLS_ERR_NONE);
+
+	/* Until the server closes the connection */
+	for (;;) {
+		size_t len = sizeof(received) - received_len;
+
+		if (!len ||
+		    rats_tls_receive(handle, received + received_len, &len) != RATS_TLS_ERR_NONE ||
+		    !len)
+			break;
+		received_len += len;
+	}
+	TEST_CHECK(!pthread_join(thread, NULL));
+
+	TEST_CHECK(received_len == FILE_SIZE - FILE_OFFSET);
+	TEST_CHECK(!memcmp(received, content + FILE_OFFSET, received_len));
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(fd);
+	close(listen_fd);
+}
+
+int main(void)
+{
+	char path[] = "/tmp/test_sendfile.XXXXXX";
+
+	file_fd = mkstemp(path);
+	TEST_CHECK(file_fd != -1);
+	unlink(path);
+
+	for (size_t i = 0; i < sizeof(content); ++i)
+		content[i] = (char)(i * 7 + i / 251);
+	TEST_CHECK(write(file_fd, content, sizeof(content)) == (ssize_t)sizeof(content));
+
+	test_sendfile(0);
+	/* Falls back to encrypting the file in user space without kernel TLS */
+	test_sendfile(RATS_TLS_CONF_FLAGS_KTLS);
+
+	close(file_fd);
+
+	printf("sendfile ok\n");
+
+	return 0;
+}
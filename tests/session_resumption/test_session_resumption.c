@@ -0,0 +1,125 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* With RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION, a client connecting alternately to
+ * two servers resumes the session of each, with TLS 1.3 and TLS 1.2 alike. The
+ * evidence of the server is verified once, and still reported to the verification
+ * callback on resumption.
+ */
+
+#include <pthread.h>
+#include <rats-tls/log.h>
+#include "internal/core.h"
+#include "openssl.h"
+#include "test.h"
+#include "test_instance.h"
+
+#define CONNECTIONS 8
+
+static rats_tls_handle server;
+static int listen_fds[2];
+static unsigned int callbacks;
+
+static SSL *handle_ssl(rats_tls_handle handle)
+{
+	return ((openssl_ctx_t *)handle->tls_wrapper->tls_private)->ssl;
+}
+
+static int verification_callback(__attribute__((unused)) void *evidence)
+{
+	__atomic_add_fetch(&callbacks, 1, __ATOMIC_SEQ_CST);
+	return 1;
+}
+
+static void *serve(__attribute__((unused)) void *arg)
+{
+	for (unsigned int i = 0; i < CONNECTIONS; ++i) {
+		rats_tls_handle session;
+		char buf[1] = { 'x' };
+		size_t len = sizeof(buf);
+
+		int fd = accept(listen_fds[i % 2], NULL, NULL);
+		TEST_CHECK(fd != -1);
+		TEST_CHECK(rats_tls_session_init(server, &session) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(rats_tls_negotiate(session, fd) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(!SSL_session_reused(handle_ssl(session)) == (i < 2));
+
+		/* The client reads the session tickets sent before along with it */
+		TEST_CHECK(rats_tls_transmit(session, buf, &len) == RATS_TLS_ERR_NONE);
+
+		TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+static void test_resumption(int max_version)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle client;
+	uint16_t ports[2];
+	pthread_t thread;
+
+	test_conf_init(&conf, "openssl",
+		       RATS_TLS_CONF_FLAGS_SERVER | RATS_TLS_CONF_FLAGS_SESSION_RESUMPTION);
+	snprintf(conf.attester_type, sizeof(conf.attester_type), TEST_INSTANCE_NAME);
+	snprintf(conf.verifier_type, sizeof(conf.verifier_type), TEST_INSTANCE_NAME);
+	TEST_CHECK(rats_tls_init(&conf, &server) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(SSL_CTX_set_max_proto_version(
+		((openssl_ctx_t *)server->tls_wrapper->tls_private)->sctx, max_version));
+
+	conf.flags &= ~RATS_TLS_CONF_FLAGS_SERVER;
+	TEST_CHECK(rats_tls_init(&conf, &client) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_set_verification_callback(&client, verification_callback) ==
+		   RATS_TLS_ERR_NONE);
+
+	for (unsigned int i = 0; i < 2; ++i)
+		listen_fds[i] = test_listen(&ports[i]);
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, NULL));
+
+	callbacks = 0;
+	unsigned int verifications = test_instance_verifications;
+	for (unsigned int i = 0; i < CONNECTIONS; ++i) {
+		rats_tls_handle session;
+		char buf[1];
+		size_t len = sizeof(buf);
+
+		int fd = test_connect(ports[i % 2]);
+		TEST_CHECK(rats_tls_session_init(client, &session) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(rats_tls_negotiate(session, fd) == RATS_TLS_ERR_NONE);
+
+		/* Each server issued a session on the first connection to it */
+		SSL *ssl = handle_ssl(session);
+		TEST_CHECK(SSL_version(ssl) == max_version);
+		TEST_CHECK(!SSL_session_reused(ssl) == (i < 2));
+
+		TEST_CHECK(rats_tls_receive(session, buf, &len) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+		close(fd);
+	}
+	TEST_CHECK(!pthread_join(thread, NULL));
+	TEST_CHECK(callbacks == CONNECTIONS);
+	/* The evidence is only verified in the full handshakes */
+	TEST_CHECK(test_instance_verifications - verifications == 2);
+
+	for (unsigned int i = 0; i < 2; ++i)
+		close(listen_fds[i]);
+	TEST_CHECK(rats_tls_cleanup(client) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_cleanup(server) == RATS_TLS_ERR_NONE);
+}
+
+int main(void)
+{
+	test_instance_register();
+
+	test_resumption(TLS1_3_VERSION);
+	test_resumption(TLS1_2_VERSION);
+
+	printf("session resumption ok\n");
+
+	return 0;
+}
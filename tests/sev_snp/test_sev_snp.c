@@ -0,0 +1,208 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The VCEK chain found in the cert table of the host is carried by the DICE
+ * endorsements, and yields the VCEK key of the chip and TCB of the report
+ * without asking the KDS once its ARK is trusted.
+ */
+
+#include <openssl/pem.h>
+#include <rats-tls/log.h>
+#include "internal/dice.h"
+#include "sev_snp.h"
+#include "certs.h"
+#include "cert_cache.h"
+#include "x509cert.h"
+#include "test.h"
+
+/* The GUIDs of the VCEK, ASK and ARK in the cert table */
+static const uint8_t guids[3][16] = {
+	{ 0x63, 0xda, 0x75, 0x8d, 0xe6, 0x64, 0x45, 0x64, 0xad, 0xc5, 0xf4, 0xb9, 0x3b, 0xe8,
+	  0xac, 0xcd },
+	{ 0x4a, 0xb7, 0xb3, 0x79, 0xbb, 0xac, 0x4f, 0xe4, 0xa0, 0x2f, 0x05, 0xae, 0xf3, 0x27,
+	  0xc7, 0x82 },
+	{ 0xc0, 0xb4, 0x06, 0xa4, 0xa8, 0x03, 0x49, 0x52, 0x97, 0x43, 0x3f, 0xb6, 0x01, 0x4c,
+	  0xd0, 0xae },
+};
+
+/* The chip and TCB of vcek.pem */
+#define CHIP_ID_0	0xab
+#define BOOT_LOADER_SPL 3
+#define TEE_SPL		0
+#define SNP_SPL		8
+#define UCODE_SPL	115
+
+static const char *dir;
+static X509 *certs[3];
+
+static X509 *read_cert(const char *name)
+{
+	char path[512];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	FILE *fp = fopen(path, "r");
+	TEST_CHECK(fp);
+	X509 *cert = PEM_read_X509(fp, NULL, NULL, NULL);
+	TEST_CHECK(cert);
+	fclose(fp);
+
+	return cert;
+}
+
+/* Lay out the certs in a table as returned by SNP_GET_EXT_REPORT */
+static uint8_t *cert_table(unsigned int nr_certs)
+{
+	uint8_t *table = calloc(1, SNP_CERTS_MAX_SIZE);
+	TEST_CHECK(table);
+
+	snp_cert_table_entry_t *entry = (snp_cert_table_entry_t *)table;
+	uint32_t offset = 0x100;
+	for (unsigned int i = 0; i < nr_certs; ++i) {
+		uint8_t *p = table + offset;
+
+		memcpy(entry[i].guid, guids[i], sizeof(entry[i].guid));
+		entry[i].offset = offset;
+		entry[i].length = (uint32_t)i2d_X509(certs[i], &p);
+		offset += entry[i].length;
+	}
+
+	return table;
+}
+
+static void check_collateral(const snp_attestation_collateral_t *collateral)
+{
+	const uint8_t *ders[3] = { collateral->vcek, collateral->ask, collateral->ark };
+	const uint32_t sizes[3] = { collateral->vcek_size, collateral->ask_size,
+				    collateral->ark_size };
+
+	for (unsigned int i = 0; i < 3; ++i) {
+		uint8_t *der = NULL;
+		int len = i2d_X509(certs[i], &der);
+
+		TEST_CHECK(len > 0 && sizes[i] == (uint32_t)len && !memcmp(ders[i], der, len));
+		OPENSSL_free(der);
+	}
+}
+
+static void test_cert_table(attestation_endorsement_t *endorsements)
+{
+	snp_attestation_collateral_t collateral;
+
+	uint8_t *table = cert_table(3);
+	snp_certs_save(table, SNP_CERTS_MAX_SIZE);
+	TEST_CHECK(!snp_certs_get(&endorsements->snp));
+	check_collateral(&endorsements->snp);
+
+	/* An entry out of the table */
+	snp_cert_table_entry_t *entry = (snp_cert_table_entry_t *)table;
+	entry[1].offset = SNP_CERTS_MAX_SIZE - 2;
+	snp_certs_save(table, SNP_CERTS_MAX_SIZE);
+	TEST_CHECK(snp_certs_get(&collateral));
+	free(table);
+
+	/* No ARK */
+	table = cert_table(2);
+	snp_certs_save(table, SNP_CERTS_MAX_SIZE);
+	TEST_CHECK(snp_certs_get(&collateral));
+	free(table);
+}
+
+static void test_dice(const attestation_endorsement_t *endorsements)
+{
+	attestation_endorsement_t parsed;
+	uint8_t *buf;
+	size_t size;
+
+	TEST_CHECK(dice_generate_endorsements_buffer_with_tag("sev_snp", endorsements, &buf,
+							      &size) == ENCLAVE_ATTESTER_ERR_NONE);
+
+	memset(&parsed, 0, sizeof(parsed));
+	TEST_CHECK(dice_parse_endorsements_buffer_with_tag("sev_snp", buf, size, &parsed) ==
+		   ENCLAVE_VERIFIER_ERR_NONE);
+	check_collateral(&parsed.snp);
+	free_endorsements("sev_snp", &parsed);
+
+	/* Cut short */
+	memset(&parsed, 0, sizeof(parsed));
+	TEST_CHECK(dice_parse_endorsements_buffer_with_tag("sev_snp", buf, size - 1, &parsed) !=
+		   ENCLAVE_VERIFIER_ERR_NONE);
+	free_endorsements("sev_snp", &parsed);
+
+	free(buf);
+}
+
+static void test_vcek(const attestation_endorsement_t *endorsements)
+{
+	snp_attestation_report_t report;
+	EVP_PKEY *key = NULL;
+
+	memset(&report, 0, sizeof(report));
+	report.chip_id[0] = CHIP_ID_0;
+	report.platform_version.f.boot_loader = BOOT_LOADER_SPL;
+	report.platform_version.f.tee = TEE_SPL;
+	report.platform_version.f.snp = SNP_SPL;
+	report.platform_version.f.microcode = UCODE_SPL;
+
+	/* The chain is checked up to the ARK trusted */
+	X509 *vcek = certs[0], *ask = certs[1], *ark = certs[2];
+	TEST_CHECK(x509_validate_signature(ask, NULL, ark));
+	TEST_CHECK(x509_validate_signature(vcek, ask, ark));
+	TEST_CHECK(!x509_validate_signature(vcek, NULL, ark));
+	TEST_CHECK(!x509_validate_signature(ark, NULL, ask));
+
+	TEST_CHECK(sev_snp_get_vcek_key(&report, &endorsements->snp, &key) ==
+		   ENCLAVE_VERIFIER_ERR_NONE);
+	uint8_t *der = NULL, *vcek_der = NULL;
+	int len = i2d_PUBKEY(key, &der);
+	TEST_CHECK(len > 0 && i2d_PUBKEY(X509_get0_pubkey(vcek), &vcek_der) == len &&
+		   !memcmp(der, vcek_der, len));
+	OPENSSL_free(der);
+	OPENSSL_free(vcek_der);
+	EVP_PKEY_free(key);
+
+	/* The VCEK is only valid for its chip and TCB */
+	TEST_CHECK(x509_vcek_matches(vcek, report.chip_id, sizeof(report.chip_id),
+				     &report.platform_version));
+
+	report.platform_version.f.microcode = UCODE_SPL + 1;
+	TEST_CHECK(!x509_vcek_matches(vcek, report.chip_id, sizeof(report.chip_id),
+				      &report.platform_version));
+	report.platform_version.f.microcode = UCODE_SPL;
+
+	report.chip_id[1] = 1;
+	TEST_CHECK(!x509_vcek_matches(vcek, report.chip_id, sizeof(report.chip_id),
+				      &report.platform_version));
+}
+
+int main(int argc, char **argv)
+{
+	attestation_endorsement_t endorsements;
+	char path[512];
+
+	TEST_CHECK(argc == 2);
+	dir = argv[1];
+
+	/* Trust the ARK of the fixtures rather than the ones of the KDS */
+	snprintf(path, sizeof(path), "%s/ark.pem", dir);
+	TEST_CHECK(!setenv(SEV_SNP_ARK_ENV, path, 1));
+
+	certs[0] = read_cert("vcek.pem");
+	certs[1] = read_cert("ask.pem");
+	certs[2] = read_cert("ark.pem");
+
+	memset(&endorsements, 0, sizeof(endorsements));
+	test_cert_table(&endorsements);
+	test_dice(&endorsements);
+	test_vcek(&endorsements);
+	free_endorsements("sev_snp", &endorsements);
+
+	for (unsigned int i = 0; i < 3; ++i)
+		X509_free(certs[i]);
+
+	printf("sev snp ok\n");
+
+	return 0;
+}
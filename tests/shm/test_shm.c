@@ -0,0 +1,157 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* A TLS session is negotiated over the shared memory rings between two
+ * processes, and the rings fail rather than overflow when the peer corrupts
+ * their indices or the layout of the shared memory.
+ */
+
+#include <errno.h>
+#include <sys/wait.h>
+#include "internal/shm_ring.h"
+#include "test.h"
+
+/* Small enough for the messages to wrap around the rings */
+#define RING_SIZE 4096
+#define MESSAGES  64
+
+static size_t message_size(unsigned int k)
+{
+	return 1 + k * 397;
+}
+
+static void fill(uint8_t *buf, size_t size, unsigned int seed)
+{
+	for (size_t i = 0; i < size; ++i)
+		buf[i] = (uint8_t)(seed + i * 13);
+}
+
+/* Echo the messages of the client, in the child process */
+static void serve(int shm_fd)
+{
+	static uint8_t buf[1 << 16];
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_negotiate_shm(handle, shm_fd) == RATS_TLS_ERR_NONE);
+
+	for (unsigned int k = 0; k < MESSAGES; ++k) {
+		size_t size = message_size(k);
+
+		TEST_CHECK(rats_tls_receive_exact(handle, buf, size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(rats_tls_transmit(handle, buf, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size == message_size(k));
+	}
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	exit(EXIT_SUCCESS);
+}
+
+static void test_echo(void)
+{
+	static uint8_t buf[1 << 16], expected[1 << 16];
+	rats_tls_conf_t conf;
+	rats_tls_handle handle;
+	int shm_fd, status;
+
+	TEST_CHECK(rats_tls_shm_create(RING_SIZE, &shm_fd) == RATS_TLS_ERR_NONE);
+
+	pid_t pid = fork();
+	TEST_CHECK(pid != -1);
+	if (!pid)
+		serve(shm_fd);
+
+	test_conf_init(&conf, "openssl", 0);
+	TEST_CHECK(rats_tls_init(&conf, &handle) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(rats_tls_negotiate_shm(handle, shm_fd) == RATS_TLS_ERR_NONE);
+
+	for (unsigned int k = 0; k < MESSAGES; ++k) {
+		size_t size = message_size(k);
+
+		fill(expected, size, k);
+		TEST_CHECK(rats_tls_transmit(handle, expected, &size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(size == message_size(k));
+		TEST_CHECK(rats_tls_receive_exact(handle, buf, size) == RATS_TLS_ERR_NONE);
+		TEST_CHECK(!memcmp(buf, expected, size));
+	}
+
+	TEST_CHECK(waitpid(pid, &status, 0) == pid);
+	TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+
+	/* The server is gone */
+	size_t size = 1;
+	TEST_CHECK(rats_tls_receive(handle, buf, &size) != RATS_TLS_ERR_NONE || !size);
+
+	TEST_CHECK(rats_tls_cleanup(handle) == RATS_TLS_ERR_NONE);
+	close(shm_fd);
+}
+
+static void test_hostile_indices(void)
+{
+	uint8_t buf[64] = { 0 };
+	int shm_fd;
+
+	TEST_CHECK(rtls_shm_create(RING_SIZE, &shm_fd) == RATS_TLS_ERR_NONE);
+
+	rtls_shm_transport_t *client = rtls_shm_attach(shm_fd, false);
+	TEST_CHECK(client);
+	rtls_shm_transport_t *server = rtls_shm_attach(shm_fd, true);
+	TEST_CHECK(server);
+	rtls_shm_header_t *hdr = client->base;
+
+	TEST_CHECK(rtls_shm_write(client, buf, sizeof(buf)) == sizeof(buf));
+
+	/* The client claims more data than the ring holds */
+	uint64_t head = hdr->rings[0].head;
+	hdr->rings[0].head = hdr->rings[0].tail + 4 * RING_SIZE;
+	errno = 0;
+	TEST_CHECK(rtls_shm_read(server, buf, sizeof(buf)) == -1 && errno == EIO);
+	hdr->rings[0].head = head;
+	TEST_CHECK(rtls_shm_read(server, buf, sizeof(buf)) == sizeof(buf));
+
+	/* The server claims to have consumed data never written */
+	hdr->rings[0].tail = hdr->rings[0].head + 1;
+	errno = 0;
+	TEST_CHECK(rtls_shm_write(client, buf, sizeof(buf)) == -1 && errno == EIO);
+
+	/* Once the server detaches, the client reads the end of the data and
+	 * can't write anymore.
+	 */
+	rtls_shm_detach(server);
+	TEST_CHECK(rtls_shm_read(client, buf, sizeof(buf)) == 0);
+	errno = 0;
+	TEST_CHECK(rtls_shm_write(client, buf, sizeof(buf)) == -1 && errno == EPIPE);
+
+	/* The ring size is checked against the size of the shared memory */
+	hdr->ring_size = RING_SIZE * 2;
+	TEST_CHECK(!rtls_shm_attach(shm_fd, true));
+	hdr->ring_size = RING_SIZE + RATS_TLS_SHM_CACHELINE_SIZE;
+	TEST_CHECK(!rtls_shm_attach(shm_fd, true));
+	hdr->ring_size = RING_SIZE;
+	hdr->magic = 0;
+	TEST_CHECK(!rtls_shm_attach(shm_fd, true));
+
+	rtls_shm_detach(client);
+	close(shm_fd);
+
+	/* Not a shared memory created by rats-tls */
+	TEST_CHECK(rats_tls_shm_create(0, &shm_fd) == RATS_TLS_ERR_NONE);
+	TEST_CHECK(!ftruncate(shm_fd, RATS_TLS_SHM_DATA_OFFSET - 1));
+	TEST_CHECK(!rtls_shm_attach(shm_fd, false));
+	close(shm_fd);
+}
+
+int main(void)
+{
+	test_echo();
+	test_hostile_indices();
+
+	printf("shm ok\n");
+
+	return 0;
+}
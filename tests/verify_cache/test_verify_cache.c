@@ -0,0 +1,193 @@
+/* Copyright (c) 2022 Intel Corporation
+ * Copyright (c) 2020-2022 Alibaba Cloud
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* The verification results are looked up by the evidence along with the
+ * configuration of the handle which may change the result, and expire. An
+ * evidence rejected by the verifier is not verified again until the failure
+ * expires, unlike one failed for lack of the collateral.
+ */
+
+#include <stdint.h>
+#include <signal.h>
+#include <pthread.h>
+#include "internal/core.h"
+#include "internal/verify_cache.h"
+#include "test.h"
+#include "test_instance.h"
+
+#define CONNECTIONS 2
+
+struct server {
+	rats_tls_handle handle;
+	int listen_fd;
+};
+
+static void key_init(rtls_verify_key_t *key, unsigned int n)
+{
+	memset(key, 0, sizeof(*key));
+	memcpy(key->evidence_digest, &n, sizeof(n));
+	key->evidence_buffer_size = 1024;
+}
+
+/* Cache a result for @key, failed with @err and valid for @ttl seconds */
+static void insert(const rtls_verify_key_t *key, tls_wrapper_err_t err, int ttl)
+{
+	rtls_verify_result_t *result = rtls_verify_result_new(key);
+	TEST_CHECK(result);
+
+	result->err = err;
+	result->expiry = rtls_time() + ttl;
+	rtls_verify_cache_insert(result);
+	rtls_verify_result_put(result);
+}
+
+/* Return the error of the result cached for @key, or 1 if none */
+static tls_wrapper_err_t lookup(const rtls_verify_key_t *key)
+{
+	rtls_verify_result_t *result = rtls_verify_cache_lookup(key);
+	if (!result)
+		return 1;
+
+	tls_wrapper_err_t err = result->err;
+	rtls_verify_result_put(result);
+
+	return err;
+}
+
+static void *serve(void *arg)
+{
+	struct server *server = arg;
+
+	for (unsigned int i = 0; i < CONNECTIONS; ++i) {
+		rats_tls_handle session;
+
+		int fd = accept(server->listen_fd, NULL, NULL);
+		TEST_CHECK(fd != -1);
+		TEST_CHECK(rats_tls_session_init(server->handle, &session) == RATS_TLS_ERR_NONE);
+		/* Fails along with the client when the evidence is rejected */
+		rats_tls_negotiate(session, fd);
+		TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+		close(fd);
+	}
+
+	return NULL;
+}
+
+/* Return the number of verifications of CONNECTIONS handshakes with a new server,
+ * failed by the verifier with @err
+ */
+static unsigned int handshakes(rats_tls_handle client, enclave_verifier_err_t err)
+{
+	struct server server;
+	rats_tls_conf_t conf;
+	pthread_t thread;
+	uint16_t port;
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_SERVER);
+	snprintf(conf.attester_type, sizeof(conf.attester_type), TEST_INSTANCE_NAME);
+	TEST_CHECK(rats_tls_init(&conf, &server.handle) == RATS_TLS_ERR_NONE);
+	server.listen_fd = test_listen(&port);
+	TEST_CHECK(!pthread_create(&thread, NULL, serve, &server));
+
+	test_instance_verify_err = err;
+	unsigned int verifications = test_instance_verifications;
+	for (unsigned int i = 0; i < CONNECTIONS; ++i) {
+		rats_tls_handle session;
+
+		int fd = test_connect(port);
+		TEST_CHECK(rats_tls_session_init(client, &session) == RATS_TLS_ERR_NONE);
+		TEST_CHECK((rats_tls_negotiate(session, fd) == RATS_TLS_ERR_NONE) ==
+			   (err == ENCLAVE_VERIFIER_ERR_NONE));
+		TEST_CHECK(rats_tls_cleanup(session) == RATS_TLS_ERR_NONE);
+		close(fd);
+	}
+	test_instance_verify_err = ENCLAVE_VERIFIER_ERR_NONE;
+
+	TEST_CHECK(!pthread_join(thread, NULL));
+	close(server.listen_fd);
+	TEST_CHECK(rats_tls_cleanup(server.handle) == RATS_TLS_ERR_NONE);
+
+	return test_instance_verifications - verifications;
+}
+
+static void test_negative(void)
+{
+	rats_tls_conf_t conf;
+	rats_tls_handle client;
+
+	test_instance_register();
+
+	/* The server may still write to the client which dropped the connection */
+	signal(SIGPIPE, SIG_IGN);
+
+	test_conf_init(&conf, "openssl", RATS_TLS_CONF_FLAGS_VERIFY_CACHE);
+	snprintf(conf.attester_type, sizeof(conf.attester_type), TEST_INSTANCE_NAME);
+	snprintf(conf.verifier_type, sizeof(conf.verifier_type), TEST_INSTANCE_NAME);
+	TEST_CHECK(rats_tls_init(&conf, &client) == RATS_TLS_ERR_NONE);
+
+	TEST_CHECK(handshakes(client, ENCLAVE_VERIFIER_ERR_NONE) == 1);
+	/* A rejected evidence, e.g. for a bad signature or an untrusted TCB */
+	TEST_CHECK(handshakes(client, -ENCLAVE_VERIFIER_ERR_INVALID) == 1);
+	/* The verifier may succeed once the collateral can be fetched */
+	TEST_CHECK(handshakes(client, -ENCLAVE_VERIFIER_ERR_COLLATERAL) == CONNECTIONS);
+	TEST_CHECK(handshakes(client, -ENCLAVE_VERIFIER_ERR_NO_MEM) == CONNECTIONS);
+
+	TEST_CHECK(rats_tls_cleanup(client) == RATS_TLS_ERR_NONE);
+}
+
+int main(void)
+{
+	rtls_verify_key_t key, other;
+
+	/* The parameters of the quote type are part of the key */
+	key_init(&key, 0);
+	memset(key.sgx_epid_spid, 1, sizeof(key.sgx_epid_spid));
+	insert(&key, TLS_WRAPPER_ERR_NONE, 60);
+	TEST_CHECK(lookup(&key) == TLS_WRAPPER_ERR_NONE);
+
+	memcpy(&other, &key, sizeof(other));
+	other.sgx_epid_linkable = true;
+	TEST_CHECK(lookup(&other) == 1);
+
+	memcpy(&other, &key, sizeof(other));
+	other.sgx_ecdsa_cert_type = 1;
+	TEST_CHECK(lookup(&other) == 1);
+
+	memcpy(&other, &key, sizeof(other));
+	snprintf(other.verifier_type, sizeof(other.verifier_type), "nullverifier");
+	TEST_CHECK(lookup(&other) == 1);
+
+	/* A later result replaces the one of the same extension */
+	insert(&key, -TLS_WRAPPER_ERR_INVALID, 60);
+	TEST_CHECK(lookup(&key) == -TLS_WRAPPER_ERR_INVALID);
+
+	/* An expired result is dropped */
+	key_init(&key, 1);
+	insert(&key, TLS_WRAPPER_ERR_NONE, 0);
+	TEST_CHECK(lookup(&key) == 1);
+
+	/* The least recently used results are evicted first */
+	for (unsigned int i = 2; i < RATS_TLS_VERIFY_CACHE_SIZE + 2; ++i) {
+		key_init(&key, i);
+		insert(&key, TLS_WRAPPER_ERR_NONE, 60);
+	}
+	key_init(&key, 2);
+	TEST_CHECK(lookup(&key) == TLS_WRAPPER_ERR_NONE);
+
+	key_init(&key, RATS_TLS_VERIFY_CACHE_SIZE + 2);
+	insert(&key, TLS_WRAPPER_ERR_NONE, 60);
+
+	key_init(&key, 2);
+	TEST_CHECK(lookup(&key) == TLS_WRAPPER_ERR_NONE);
+	key_init(&key, 3);
+	TEST_CHECK(lookup(&key) == 1);
+
+	test_negative();
+
+	printf("verify cache ok\n");
+
+	return 0;
+}